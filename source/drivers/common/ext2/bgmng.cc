@@ -50,7 +50,7 @@ Ext2BGMng::Ext2BGMng(Ext2FileSystem *fs) : _dirty(false), _groups(), _fs(fs) {
 void Ext2BGMng::update() {
 	block_t bno;
 	size_t i,count,bcount;
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	_fs->sbLock.lock();
 
 	if(!_dirty)
 		goto done;
@@ -78,7 +78,7 @@ void Ext2BGMng::update() {
 	/* now we're in sync */
 	_dirty = false;
 done:
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	_fs->sbLock.unlock();
 }
 
 #if DEBUGGING
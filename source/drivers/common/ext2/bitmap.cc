@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <esc/util.h>
 #include <fs/blockcache.h>
 #include <fs/fsdev.h>
 #include <sys/common.h>
@@ -32,29 +33,27 @@ using namespace fs;
 
 ino_t Ext2Bitmap::allocInode(Ext2FileSystem *e,Ext2CInode *dirInode,bool isDir) {
 	size_t gcount = e->getBlockGroupCount();
-	block_t block = e->getBlockOfInode(dirInode->inodeNo);
-	block_t i,group = e->getGroupOfBlock(block);
+	block_t i,group = e->getGroupOfInode(dirInode->inodeNo);
 	ino_t ino = 0;
-	uint32_t inodesPerGroup = le32tocpu(e->sb.get()->inodesPerGroup);
 
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	e->sbLock.lock();
 	if(le32tocpu(e->sb.get()->freeInodeCount) == 0)
 		goto done;
 
-	/* first try to find a block in the block-group of the inode */
-	ino = allocInodeIn(e,group * inodesPerGroup,e->bgs.get(group),isDir);
+	/* first try to find an inode in the block-group of the directory */
+	ino = allocInodeIn(e,group,isDir);
 	if(ino != 0)
 		goto done;
 
 	/* now try the other block-groups */
-	for(i = group + 1; i != group; i = (i + 1) % gcount) {
-		ino = allocInodeIn(e,i * inodesPerGroup,e->bgs.get(i),isDir);
+	for(i = (group + 1) % gcount; i != group; i = (i + 1) % gcount) {
+		ino = allocInodeIn(e,i,isDir);
 		if(ino != 0)
 			goto done;
 	}
 
 done:
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	e->sbLock.unlock();
 	return ino;
 }
 
@@ -65,10 +64,10 @@ int Ext2Bitmap::freeInode(Ext2FileSystem *e,ino_t ino,bool isDir) {
 	uint16_t freeInodeCount;
 	uint32_t sFreeInodeCount;
 
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	e->sbLock.lock();
 	bitmap = e->blockCache.request(le32tocpu(e->bgs.get(group)->inodeBitmap),BlockCache::WRITE);
 	if(bitmap == NULL) {
-		sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+		e->sbLock.unlock();
 		return -1;
 	}
 
@@ -92,16 +91,18 @@ int Ext2Bitmap::freeInode(Ext2FileSystem *e,ino_t ino,bool isDir) {
 
 	e->blockCache.markDirty(bitmap);
 	e->blockCache.release(bitmap);
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	e->sbLock.unlock();
 	return 0;
 }
 
-ino_t Ext2Bitmap::allocInodeIn(Ext2FileSystem *e,block_t groupStart,Ext2BlockGrp *group,bool isDir) {
-	size_t i,j;
-	ino_t ino;
+ino_t Ext2Bitmap::allocInodeIn(Ext2FileSystem *e,block_t groupNo,bool isDir) {
+	Ext2BlockGrp *group = e->bgs.get(groupNo);
+	uint32_t inodesPerGroup = le32tocpu(e->sb.get()->inodesPerGroup);
+	uint32_t sFreeInodeCount;
+	uint16_t freeInodeCount;
 	CBlock *bitmap;
 	uint8_t *bitmapbuf;
-	uint32_t sFreeInodeCount;
+	size_t bit;
 	if(le16tocpu(group->freeInodeCount) == 0)
 		return 0;
 
@@ -110,102 +111,148 @@ ino_t Ext2Bitmap::allocInodeIn(Ext2FileSystem *e,block_t groupStart,Ext2BlockGrp
 	if(bitmap == NULL)
 		return 0;
 
-	ino = 0;
 	bitmapbuf = (uint8_t*)bitmap->buffer;
-	for(i = 0; i < e->blockSize(); i++) {
-		for(j = 1; j < 256; ino++, j <<= 1) {
-			if(ino >= (ino_t)le32tocpu(e->sb.get()->inodeCount)) {
-				e->blockCache.release(bitmap);
-				return 0;
-			}
-			if(!(bitmapbuf[i] & j)) {
-				uint16_t freeInodeCount = le16tocpu(group->freeInodeCount);
-				group->freeInodeCount = cputole16(freeInodeCount - 1);
-				if(isDir) {
-					uint16_t usedDirCount = le16tocpu(group->usedDirCount);
-					group->usedDirCount = cputole16(usedDirCount + 1);
-				}
-				e->bgs.markDirty();
-				bitmapbuf[i] |= j;
-				sFreeInodeCount = le32tocpu(e->sb.get()->freeInodeCount);
-				e->sb.get()->freeInodeCount = cputole32(sFreeInodeCount - 1);
-				e->sb.markDirty();
-				e->blockCache.markDirty(bitmap);
-				e->blockCache.release(bitmap);
-				return ino + groupStart + 1;
-			}
-		}
+	bit = findFree(bitmapbuf,0,inodesPerGroup);
+	if(bit == inodesPerGroup) {
+		e->blockCache.release(bitmap);
+		return 0;
 	}
+	mark(bitmapbuf,bit,1,true);
+
+	freeInodeCount = le16tocpu(group->freeInodeCount);
+	group->freeInodeCount = cputole16(freeInodeCount - 1);
+	if(isDir) {
+		uint16_t usedDirCount = le16tocpu(group->usedDirCount);
+		group->usedDirCount = cputole16(usedDirCount + 1);
+	}
+	e->bgs.markDirty();
+	sFreeInodeCount = le32tocpu(e->sb.get()->freeInodeCount);
+	e->sb.get()->freeInodeCount = cputole32(sFreeInodeCount - 1);
+	e->sb.markDirty();
+	e->blockCache.markDirty(bitmap);
 	e->blockCache.release(bitmap);
-	return 0;
+	return groupNo * inodesPerGroup + bit + 1;
 }
 
-block_t Ext2Bitmap::allocBlock(Ext2FileSystem *e,Ext2CInode *inode) {
+block_t Ext2Bitmap::allocBlock(Ext2FileSystem *e,Ext2CInode *inode,block_t goal) {
+	block_t bno;
+	if(inode->resCount > 0 && (goal == 0 || goal == inode->resStart)) {
+		/* the preallocated blocks belong to us, so that we don't need to touch the bitmap */
+		bno = inode->resStart++;
+		inode->resCount--;
+	}
+	else {
+		/* the file doesn't continue at the preallocated blocks, so give them back */
+		discard(e,inode);
+
+		if(goal == 0)
+			goal = inode->allocGoal;
+		if(goal == 0) {
+			uint32_t blocksPerGroup = le32tocpu(e->sb.get()->blocksPerGroup);
+			goal = le32tocpu(e->sb.get()->firstDataBlock) +
+				e->getGroupOfInode(inode->inodeNo) * blocksPerGroup;
+		}
+
+		size_t count = EXT2_PREALLOC_BLOCKS;
+		bno = allocBlocks(e,goal,&count);
+		if(bno != 0 && count > 1) {
+			inode->resStart = bno + 1;
+			inode->resCount = count - 1;
+		}
+	}
+
+	if(bno != 0)
+		inode->allocGoal = bno + 1;
+	return bno;
+}
+
+block_t Ext2Bitmap::allocBlocks(Ext2FileSystem *e,block_t goal,size_t *count) {
 	size_t gcount = e->getBlockGroupCount();
-	block_t block = e->getBlockOfInode(inode->inodeNo);
-	block_t i,group = e->getGroupOfBlock(block);
-	block_t bno = 0;
+	uint32_t first = le32tocpu(e->sb.get()->firstDataBlock);
 	uint32_t blocksPerGroup = le32tocpu(e->sb.get()->blocksPerGroup);
+	size_t max = *count;
+	block_t i,group,bno = 0;
 
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	e->sbLock.lock();
 	if(le32tocpu(e->sb.get()->freeBlockCount) == 0)
 		goto done;
 
-	/* first try to find a block in the block-group of the inode */
-	bno = allocBlockIn(e,group * blocksPerGroup,e->bgs.get(group));
+	if(goal < first || goal >= le32tocpu(e->sb.get()->blockCount))
+		goal = first;
+	group = e->getGroupOfBlock(goal);
+
+	/* first try to find blocks in the block-group of the goal */
+	bno = allocBlocksIn(e,group,(goal - first) % blocksPerGroup,count);
 	if(bno != 0)
 		goto done;
 
 	/* now try the other block-groups */
-	for(i = group + 1; i != group; i = (i + 1) % gcount) {
-		bno = allocBlockIn(e,i * blocksPerGroup,e->bgs.get(i));
+	for(i = (group + 1) % gcount; i != group; i = (i + 1) % gcount) {
+		*count = max;
+		bno = allocBlocksIn(e,i,0,count);
 		if(bno != 0)
 			goto done;
 	}
 
 done:
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	if(bno != 0) {
+		e->allocRuns++;
+		e->allocBlocks += *count;
+		if(bno != goal)
+			e->allocMisses++;
+	}
+	else
+		*count = 0;
+	e->sbLock.unlock();
 	return bno;
 }
 
-int Ext2Bitmap::freeBlock(Ext2FileSystem *e,block_t blockNo) {
+int Ext2Bitmap::freeBlocks(Ext2FileSystem *e,block_t blockNo,size_t count) {
 	block_t group = e->getGroupOfBlock(blockNo);
 	CBlock *bitmap;
-	uint8_t *bitmapbuf;
 	uint16_t freeBlockCount;
 	uint32_t sFreeBlockCount;
 
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	e->sbLock.lock();
 	bitmap = e->blockCache.request(le32tocpu(e->bgs.get(group)->blockBitmap),BlockCache::WRITE);
 	if(bitmap == NULL) {
-		sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+		e->sbLock.unlock();
 		return -1;
 	}
 
 	/* mark free in bitmap */
-	blockNo--;
+	blockNo -= le32tocpu(e->sb.get()->firstDataBlock);
 	blockNo %= le32tocpu(e->sb.get()->blocksPerGroup);
-	bitmapbuf = (uint8_t*)bitmap->buffer;
-	bitmapbuf[blockNo / 8] &= ~(1 << (blockNo % 8));
+	mark((uint8_t*)bitmap->buffer,blockNo,count,false);
 	freeBlockCount = le16tocpu(e->bgs.get(group)->freeBlockCount);
-	e->bgs.get(group)->freeBlockCount = cputole16(freeBlockCount + 1);
+	e->bgs.get(group)->freeBlockCount = cputole16(freeBlockCount + count);
 	e->bgs.markDirty();
 	sFreeBlockCount = le32tocpu(e->sb.get()->freeBlockCount);
-	e->sb.get()->freeBlockCount = cputole32(sFreeBlockCount + 1);
+	e->sb.get()->freeBlockCount = cputole32(sFreeBlockCount + count);
 	e->sb.markDirty();
 	e->blockCache.markDirty(bitmap);
 	e->blockCache.release(bitmap);
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	e->sbLock.unlock();
 	return 0;
 }
 
-block_t Ext2Bitmap::allocBlockIn(Ext2FileSystem *e,block_t groupStart,Ext2BlockGrp *group) {
-	size_t i,j;
-	block_t bno;
+void Ext2Bitmap::discard(Ext2FileSystem *e,Ext2CInode *inode) {
+	if(inode->resCount > 0) {
+		freeBlocks(e,inode->resStart,inode->resCount);
+		inode->resCount = 0;
+	}
+}
+
+block_t Ext2Bitmap::allocBlocksIn(Ext2FileSystem *e,block_t groupNo,size_t start,size_t *count) {
+	Ext2BlockGrp *group = e->bgs.get(groupNo);
+	uint32_t blocksPerGroup = le32tocpu(e->sb.get()->blocksPerGroup);
+	uint32_t blockCount = le32tocpu(e->sb.get()->blockCount);
+	block_t groupStart = le32tocpu(e->sb.get()->firstDataBlock) + groupNo * blocksPerGroup;
+	uint32_t sFreeBlockCount;
+	uint16_t freeBlockCount;
 	CBlock *bitmap;
 	uint8_t *bitmapbuf;
-	uint32_t sFreeBlockCount;
-	uint32_t blockCount = le32tocpu(e->sb.get()->blockCount);
+	size_t end,bit,found;
 	if(le16tocpu(group->freeBlockCount) == 0)
 		return 0;
 
@@ -214,28 +261,68 @@ block_t Ext2Bitmap::allocBlockIn(Ext2FileSystem *e,block_t groupStart,Ext2BlockG
 	if(bitmap == NULL)
 		return 0;
 
-	bno = 0;
+	/* the last block-group might be smaller */
+	end = esc::Util::min<size_t>(blocksPerGroup,blockCount - groupStart);
 	bitmapbuf = (uint8_t*)bitmap->buffer;
-	for(i = 0; i < e->blockSize(); i++) {
-		for(j = 1; j < 256; bno++, j <<= 1) {
-			if(bno >= blockCount) {
-				e->blockCache.release(bitmap);
-				return 0;
-			}
-			if(!(bitmapbuf[i] & j)) {
-				uint16_t freeBlockCount = le16tocpu(group->freeBlockCount);
-				group->freeBlockCount = cputole16(freeBlockCount - 1);
-				e->bgs.markDirty();
-				bitmapbuf[i] |= j;
-				sFreeBlockCount = le32tocpu(e->sb.get()->freeBlockCount);
-				e->sb.get()->freeBlockCount = cputole32(sFreeBlockCount - 1);
-				e->sb.markDirty();
-				e->blockCache.markDirty(bitmap);
-				e->blockCache.release(bitmap);
-				return bno + groupStart + 1;
-			}
+	/* search behind the goal first, so that files grow in one direction */
+	bit = findFree(bitmapbuf,start,end);
+	if(bit == end) {
+		bit = findFree(bitmapbuf,0,start);
+		if(bit == start) {
+			e->blockCache.release(bitmap);
+			return 0;
 		}
 	}
+	found = countFree(bitmapbuf,bit,esc::Util::min(*count,end - bit));
+	mark(bitmapbuf,bit,found,true);
+
+	freeBlockCount = le16tocpu(group->freeBlockCount);
+	group->freeBlockCount = cputole16(freeBlockCount - found);
+	e->bgs.markDirty();
+	sFreeBlockCount = le32tocpu(e->sb.get()->freeBlockCount);
+	e->sb.get()->freeBlockCount = cputole32(sFreeBlockCount - found);
+	e->sb.markDirty();
+	e->blockCache.markDirty(bitmap);
 	e->blockCache.release(bitmap);
-	return 0;
+	*count = found;
+	return groupStart + bit;
+}
+
+size_t Ext2Bitmap::findFree(const uint8_t *bitmap,size_t start,size_t end) {
+	/* the bitmap is stored in little endian, i.e., bit i is in byte i / 8 at position i % 8. by
+	 * reading little endian words, bit i is at position i % 32 in word i / 32 */
+	const uint32_t *words = (const uint32_t*)bitmap;
+	size_t i = start;
+	while(i < end) {
+		uint32_t free = ~le32tocpu(words[i / 32]) & (~0U << (i % 32));
+		if(free) {
+			i = (i & ~(size_t)31) + __builtin_ctz(free);
+			return esc::Util::min(i,end);
+		}
+		i = (i & ~(size_t)31) + 32;
+	}
+	return end;
+}
+
+size_t Ext2Bitmap::countFree(const uint8_t *bitmap,size_t start,size_t max) {
+	const uint32_t *words = (const uint32_t*)bitmap;
+	size_t i = start,end = start + max;
+	while(i < end) {
+		uint32_t used = le32tocpu(words[i / 32]) >> (i % 32);
+		if(used) {
+			i += __builtin_ctz(used);
+			break;
+		}
+		i = (i & ~(size_t)31) + 32;
+	}
+	return esc::Util::min(i,end) - start;
+}
+
+void Ext2Bitmap::mark(uint8_t *bitmap,size_t start,size_t count,bool used) {
+	for(size_t i = start; i < start + count; ++i) {
+		if(used)
+			bitmap[i / 8] |= 1 << (i % 8);
+		else
+			bitmap[i / 8] &= ~(1 << (i % 8));
+	}
 }
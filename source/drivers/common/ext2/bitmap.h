@@ -49,14 +49,28 @@ public:
 	static int freeInode(Ext2FileSystem *e,ino_t ino,bool isDir);
 
 	/**
-	 * Allocates a new block for the given inode. It will be tried to allocate a block in the same
-	 * block-group.
+	 * Allocates a new block for the given inode. The blocks are taken from the inode's
+	 * preallocation, if <goal> is 0 or the next preallocated block. Otherwise, a run of
+	 * EXT2_PREALLOC_BLOCKS blocks is allocated, preferably at <goal>, the block after the last one
+	 * allocated for this inode or in the block-group of the inode, in this order.
 	 *
 	 * @param e the ext2-fs
-	 * @param inode the inode
+	 * @param inode the inode (has to be locked for writing)
+	 * @param goal the preferred block-number (0 = none)
 	 * @return the block-number or 0 if failed
 	 */
-	static block_t allocBlock(Ext2FileSystem *e,Ext2CInode *inode);
+	static block_t allocBlock(Ext2FileSystem *e,Ext2CInode *inode,block_t goal = 0);
+
+	/**
+	 * Allocates a run of up to <*count> consecutive blocks. It will be tried to start at <goal>,
+	 * then behind <goal> and in the block-group of <goal>, and finally in the other block-groups.
+	 *
+	 * @param e the ext2-fs
+	 * @param goal the preferred block-number
+	 * @param count the maximum number of blocks; will be set to the number of allocated ones
+	 * @return the first block-number or 0 if failed
+	 */
+	static block_t allocBlocks(Ext2FileSystem *e,block_t goal,size_t *count);
 
 	/**
 	 * Free's the given block-number
@@ -65,9 +79,45 @@ public:
 	 * @param blockNo the block-number
 	 * @return 0 on success
 	 */
-	static int freeBlock(Ext2FileSystem *e,block_t blockNo);
+	static int freeBlock(Ext2FileSystem *e,block_t blockNo) {
+		return freeBlocks(e,blockNo,1);
+	}
+
+	/**
+	 * Free's the <count> blocks starting at <blockNo>, which have to be in the same block-group.
+	 *
+	 * @param e the ext2-fs
+	 * @param blockNo the first block-number
+	 * @param count the number of blocks
+	 * @return 0 on success
+	 */
+	static int freeBlocks(Ext2FileSystem *e,block_t blockNo,size_t count);
+
+	/**
+	 * Free's the blocks that have been allocated in advance for the given inode
+	 *
+	 * @param e the ext2-fs
+	 * @param inode the inode
+	 */
+	static void discard(Ext2FileSystem *e,Ext2CInode *inode);
 
 private:
-	static ino_t allocInodeIn(Ext2FileSystem *e,block_t groupStart,fs::Ext2BlockGrp *group,bool isDir);
-	static block_t allocBlockIn(Ext2FileSystem *e,block_t groupStart,fs::Ext2BlockGrp *group);
+	static ino_t allocInodeIn(Ext2FileSystem *e,block_t groupNo,bool isDir);
+	static block_t allocBlocksIn(Ext2FileSystem *e,block_t groupNo,size_t start,size_t *count);
+
+	/**
+	 * Searches for the first zero bit in <bitmap> within [<start>, <end>), looking at a complete
+	 * word at once.
+	 *
+	 * @return the bit-index or <end> if there is none
+	 */
+	static size_t findFree(const uint8_t *bitmap,size_t start,size_t end);
+	/**
+	 * @return the number of consecutive zero bits in <bitmap> beginning at <start>, at most <max>
+	 */
+	static size_t countFree(const uint8_t *bitmap,size_t start,size_t max);
+	/**
+	 * Sets (<used> = true) or clears the <count> bits in <bitmap> beginning at <start>
+	 */
+	static void mark(uint8_t *bitmap,size_t start,size_t count,bool used);
 };
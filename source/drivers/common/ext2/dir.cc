@@ -70,6 +70,9 @@ int Ext2Dir::create(Ext2FileSystem *e,User *u,Ext2CInode *dir,const char *name,m
 
 ino_t Ext2Dir::find(Ext2FileSystem *e,Ext2CInode *dir,const char *name,size_t nameLen) {
 	ino_t ino;
+	if(e->dirCache.find(dir->inodeNo,name,nameLen,&ino))
+		return ino;
+
 	size_t size = le32tocpu(dir->inode.size);
 	int res;
 	Ext2DirEntry *buffer = (Ext2DirEntry*)malloc(size);
@@ -82,7 +85,12 @@ ino_t Ext2Dir::find(Ext2FileSystem *e,Ext2CInode *dir,const char *name,size_t na
 		return res;
 	}
 
+	/* large directories are indexed completely, so that we don't need to read them again */
+	if(size >= EXT2_DINDEX_MIN_BLOCKS * e->blockSize())
+		e->dirCache.createIndex(dir->inodeNo,buffer,size);
+
 	ino = findIn(buffer,size,name,nameLen);
+	e->dirCache.insert(dir->inodeNo,name,nameLen,ino);
 	free(buffer);
 	return ino;
 }
@@ -121,6 +129,9 @@ int Ext2Dir::remove(Ext2FileSystem *e,User *u,Ext2CInode *dir,const char *name)
 	ino = Ext2Dir::find(e,dir,name,strlen(name));
 	if(ino < 0)
 		return ino;
+	/* we hold <dir> already; requesting it again (".") or its parent ("..") could deadlock */
+	if(ino == dir->inodeNo || strcmp(name,"..") == 0)
+		return -EINVAL;
 	/* get inode of directory to delete */
 	delIno = e->inodeCache.request(ino,IMODE_WRITE);
 	if(delIno == NULL)
@@ -166,6 +177,8 @@ int Ext2Dir::remove(Ext2FileSystem *e,User *u,Ext2CInode *dir,const char *name)
 	e->inodeCache.release(delIno);
 	/* now remove directory from parent, which will delete it because of no more references */
 	res = Ext2Link::remove(e,u,NULL,dir,name,true);
+	if(res == 0)
+		e->dirCache.purge(ino);
 	free(buffer);
 	return res;
 
@@ -0,0 +1,364 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/endian.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dircache.h"
+
+using namespace fs;
+
+Ext2DirCache::Ext2DirCache(size_t entries,size_t indices)
+		: _hits(), _misses(), _indexHits(), _indexBuilds(), _useCounter(), _entryCount(entries),
+		  _bucketCount(), _entries(new Entry[entries]), _buckets(), _newest(), _oldest(),
+		  _indexCount(indices), _indices(new Index[indices]), _mutex() {
+	/* use a power of two, roughly the number of entries */
+	_bucketCount = 1;
+	while(_bucketCount < entries)
+		_bucketCount *= 2;
+	_buckets = new Entry*[_bucketCount]();
+
+	/* put all entries into the LRU-list; unused ones have an invalid dir */
+	for(size_t i = 0; i < entries; ++i) {
+		Entry *e = _entries + i;
+		e->next = NULL;
+		e->dir = EXT2_BAD_INO;
+		e->newer = i > 0 ? e - 1 : NULL;
+		e->older = i + 1 < entries ? e + 1 : NULL;
+	}
+	_newest = entries ? _entries : NULL;
+	_oldest = entries ? _entries + entries - 1 : NULL;
+
+	for(size_t i = 0; i < indices; ++i) {
+		_indices[i].dir = EXT2_BAD_INO;
+		_indices[i].lastUse = 0;
+	}
+}
+
+Ext2DirCache::~Ext2DirCache() {
+	for(size_t i = 0; i < _indexCount; ++i)
+		destroyIndex(_indices + i);
+	delete[] _indices;
+	delete[] _buckets;
+	delete[] _entries;
+}
+
+uint32_t Ext2DirCache::hash(ino_t dir,const char *name,size_t nameLen) {
+	/* FNV-1a */
+	uint32_t h = 2166136261U ^ dir;
+	for(size_t i = 0; i < nameLen; ++i)
+		h = (h ^ (uint8_t)name[i]) * 16777619U;
+	return h;
+}
+
+bool Ext2DirCache::find(ino_t dir,const char *name,size_t nameLen,ino_t *ino) {
+	uint32_t h = hash(dir,name,nameLen);
+	std::lock_guard<std::mutex> guard(_mutex);
+
+	Entry *e = get(dir,name,nameLen,h);
+	if(e) {
+		_hits++;
+		touch(e);
+		*ino = e->ino;
+		return true;
+	}
+
+	Index *idx = getIndex(dir);
+	if(idx) {
+		IEntry *ie = findIndexed(idx,name,nameLen,h);
+		*ino = ie ? ie->ino : -ENOENT;
+		put(dir,name,nameLen,h,*ino);
+		_indexHits++;
+		return true;
+	}
+
+	_misses++;
+	return false;
+}
+
+void Ext2DirCache::insert(ino_t dir,const char *name,size_t nameLen,ino_t ino) {
+	uint32_t h = hash(dir,name,nameLen);
+	std::lock_guard<std::mutex> guard(_mutex);
+	put(dir,name,nameLen,h,ino);
+}
+
+void Ext2DirCache::createIndex(ino_t dir,const Ext2DirEntry *buffer,size_t bufSize) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	/* somebody else might have been faster */
+	if(getIndex(dir))
+		return;
+
+	/* count the entries and the space for their names */
+	size_t count = 0,names = 0;
+	const Ext2DirEntry *entry = buffer;
+	ssize_t rem = bufSize;
+	while(rem > 0 && le16tocpu(entry->recLen) > 0) {
+		if(le32tocpu(entry->inode) != 0) {
+			count++;
+			names += le16tocpu(entry->nameLen);
+		}
+		rem -= le16tocpu(entry->recLen);
+		entry = (const Ext2DirEntry*)((uintptr_t)entry + le16tocpu(entry->recLen));
+	}
+
+	/* replace the least recently used index */
+	Index *idx = _indices;
+	for(size_t i = 1; i < _indexCount; ++i) {
+		if(_indices[i].lastUse < idx->lastUse)
+			idx = _indices + i;
+	}
+	destroyIndex(idx);
+
+	/* leave space for new entries; if that's exhausted, we rebuild the index */
+	idx->bucketCount = 1;
+	while(idx->bucketCount < count)
+		idx->bucketCount *= 2;
+	idx->buckets = (size_t*)malloc(idx->bucketCount * sizeof(size_t));
+	idx->entrySize = count * 2 + 16;
+	idx->entries = (IEntry*)malloc(idx->entrySize * sizeof(IEntry));
+	idx->poolSize = names * 2 + 256;
+	idx->pool = (char*)malloc(idx->poolSize);
+	if(!idx->buckets || !idx->entries || !idx->pool) {
+		free(idx->pool);
+		free(idx->entries);
+		free(idx->buckets);
+		return;
+	}
+
+	idx->dir = dir;
+	idx->lastUse = ++_useCounter;
+	idx->entryCount = 0;
+	idx->poolCount = 0;
+	idx->dead = 0;
+	for(size_t i = 0; i < idx->bucketCount; ++i)
+		idx->buckets[i] = NO_ENTRY;
+
+	/* add them in reverse order, so that the first one with a name is found first */
+	entry = buffer;
+	rem = bufSize;
+	const Ext2DirEntry **all = (const Ext2DirEntry**)malloc(count * sizeof(Ext2DirEntry*));
+	if(!all) {
+		destroyIndex(idx);
+		return;
+	}
+	for(size_t i = 0; rem > 0 && le16tocpu(entry->recLen) > 0; ) {
+		if(le32tocpu(entry->inode) != 0)
+			all[i++] = entry;
+		rem -= le16tocpu(entry->recLen);
+		entry = (const Ext2DirEntry*)((uintptr_t)entry + le16tocpu(entry->recLen));
+	}
+	for(size_t i = count; i-- > 0; ) {
+		size_t len = le16tocpu(all[i]->nameLen);
+		addIndexed(idx,all[i]->name,len,hash(dir,all[i]->name,len),le32tocpu(all[i]->inode));
+	}
+	free(all);
+	_indexBuilds++;
+}
+
+void Ext2DirCache::link(ino_t dir,const char *name,size_t nameLen,ino_t ino) {
+	uint32_t h = hash(dir,name,nameLen);
+	std::lock_guard<std::mutex> guard(_mutex);
+	put(dir,name,nameLen,h,ino);
+
+	Index *idx = getIndex(dir);
+	if(idx && !addIndexed(idx,name,nameLen,h,ino))
+		destroyIndex(idx);
+}
+
+void Ext2DirCache::unlink(ino_t dir,const char *name,size_t nameLen) {
+	uint32_t h = hash(dir,name,nameLen);
+	std::lock_guard<std::mutex> guard(_mutex);
+	put(dir,name,nameLen,h,-ENOENT);
+
+	Index *idx = getIndex(dir);
+	if(idx) {
+		IEntry *ie = findIndexed(idx,name,nameLen,h);
+		if(ie) {
+			ie->ino = EXT2_BAD_INO;
+			/* rebuild it, if it consists mostly of removed entries */
+			if(++idx->dead > idx->entryCount / 2)
+				destroyIndex(idx);
+		}
+	}
+}
+
+void Ext2DirCache::purge(ino_t dir) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	for(size_t i = 0; i < _entryCount; ++i) {
+		if(_entries[i].dir == dir)
+			remove(_entries + i);
+	}
+
+	Index *idx = getIndex(dir);
+	if(idx)
+		destroyIndex(idx);
+}
+
+void Ext2DirCache::print(FILE *f) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	size_t used = 0,negative = 0,indices = 0;
+	for(size_t i = 0; i < _entryCount; ++i) {
+		if(_entries[i].dir != EXT2_BAD_INO) {
+			used++;
+			if(_entries[i].ino < 0)
+				negative++;
+		}
+	}
+	for(size_t i = 0; i < _indexCount; ++i) {
+		if(_indices[i].dir != EXT2_BAD_INO)
+			indices++;
+	}
+
+	fprintf(f,"\tTotal entries: %zu\n",_entryCount);
+	fprintf(f,"\tUsed entries: %zu\n",used);
+	fprintf(f,"\tNegative entries: %zu\n",negative);
+	fprintf(f,"\tIndexed dirs: %zu of %zu\n",indices,_indexCount);
+	fprintf(f,"\tIndex builds: %zu\n",_indexBuilds);
+	fprintf(f,"\tHits: %zu\n",_hits);
+	fprintf(f,"\tIndex hits: %zu\n",_indexHits);
+	fprintf(f,"\tMisses: %zu\n",_misses);
+}
+
+Ext2DirCache::Entry *Ext2DirCache::get(ino_t dir,const char *name,size_t nameLen,uint32_t h) {
+	for(Entry *e = _buckets[h & (_bucketCount - 1)]; e != NULL; e = e->next) {
+		if(e->hash == h && e->dir == dir && e->nameLen == nameLen &&
+				memcmp(e->name,name,nameLen) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+void Ext2DirCache::put(ino_t dir,const char *name,size_t nameLen,uint32_t h,ino_t ino) {
+	Entry *e = get(dir,name,nameLen,h);
+	if(e == NULL) {
+		if(nameLen > NAME_LEN || _oldest == NULL)
+			return;
+
+		/* reuse the least recently used one */
+		e = _oldest;
+		remove(e);
+		e->hash = h;
+		e->dir = dir;
+		e->nameLen = nameLen;
+		memcpy(e->name,name,nameLen);
+		Entry **bucket = _buckets + (h & (_bucketCount - 1));
+		e->next = *bucket;
+		*bucket = e;
+	}
+	e->ino = ino;
+	touch(e);
+}
+
+void Ext2DirCache::remove(Entry *e) {
+	if(e->dir == EXT2_BAD_INO)
+		return;
+
+	Entry **p = _buckets + (e->hash & (_bucketCount - 1));
+	while(*p != e)
+		p = &(*p)->next;
+	*p = e->next;
+	e->next = NULL;
+	e->dir = EXT2_BAD_INO;
+
+	/* move it to the end of the LRU-list, so that it's reused first */
+	if(e != _oldest) {
+		if(e->newer)
+			e->newer->older = e->older;
+		else
+			_newest = e->older;
+		e->older->newer = e->newer;
+		e->newer = _oldest;
+		e->older = NULL;
+		_oldest->older = e;
+		_oldest = e;
+	}
+}
+
+void Ext2DirCache::touch(Entry *e) {
+	if(e == _newest)
+		return;
+
+	/* remove it from the list */
+	e->newer->older = e->older;
+	if(e->older)
+		e->older->newer = e->newer;
+	else
+		_oldest = e->newer;
+
+	/* put it at the front */
+	e->newer = NULL;
+	e->older = _newest;
+	_newest->newer = e;
+	_newest = e;
+}
+
+Ext2DirCache::Index *Ext2DirCache::getIndex(ino_t dir) {
+	for(size_t i = 0; i < _indexCount; ++i) {
+		if(_indices[i].dir == dir) {
+			_indices[i].lastUse = ++_useCounter;
+			return _indices + i;
+		}
+	}
+	return NULL;
+}
+
+Ext2DirCache::IEntry *Ext2DirCache::findIndexed(Index *idx,const char *name,size_t nameLen,
+		uint32_t h) {
+	size_t i = idx->buckets[h & (idx->bucketCount - 1)];
+	while(i != NO_ENTRY) {
+		IEntry *ie = idx->entries + i;
+		if(ie->hash == h && ie->ino != EXT2_BAD_INO && ie->nameLen == nameLen &&
+				memcmp(idx->pool + ie->name,name,nameLen) == 0)
+			return ie;
+		i = ie->next;
+	}
+	return NULL;
+}
+
+bool Ext2DirCache::addIndexed(Index *idx,const char *name,size_t nameLen,uint32_t h,ino_t ino) {
+	if(idx->entryCount == idx->entrySize || idx->poolCount + nameLen > idx->poolSize)
+		return false;
+
+	IEntry *ie = idx->entries + idx->entryCount;
+	memcpy(idx->pool + idx->poolCount,name,nameLen);
+	ie->hash = h;
+	ie->name = idx->poolCount;
+	ie->nameLen = nameLen;
+	ie->ino = ino;
+
+	size_t *bucket = idx->buckets + (h & (idx->bucketCount - 1));
+	ie->next = *bucket;
+	*bucket = idx->entryCount++;
+	idx->poolCount += nameLen;
+	return true;
+}
+
+void Ext2DirCache::destroyIndex(Index *idx) {
+	if(idx->dir == EXT2_BAD_INO)
+		return;
+
+	free(idx->pool);
+	free(idx->entries);
+	free(idx->buckets);
+	idx->dir = EXT2_BAD_INO;
+}
@@ -0,0 +1,173 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <fs/ext2/ext2.h>
+#include <sys/common.h>
+#include <mutex>
+#include <stdio.h>
+
+class Ext2FileSystem;
+
+/**
+ * The directory-entry-cache maps (directory, name) to inode-numbers, so that path resolution
+ * does not have to read and scan the directories over and over again. It caches negative
+ * results as well, i.e., the knowledge that a name does not exist in a directory. Additionally,
+ * large directories get a hashed index in memory, which contains all of their entries.
+ *
+ * All changes of directories have to be reported via link(), unlink() and purge(). Like the
+ * inode-cache, it can be used by multiple threads simultaneously.
+ */
+class Ext2DirCache {
+	/* longer names are not put into the entry-cache, but they are still indexed */
+	static const size_t NAME_LEN		= 40;
+	static const size_t NO_ENTRY		= (size_t)-1;
+
+	struct Entry {
+		/* the next entry in the hash-chain */
+		Entry *next;
+		/* the LRU-list */
+		Entry *newer;
+		Entry *older;
+		uint32_t hash;
+		ino_t dir;
+		/* the inode-number or -ENOENT */
+		ino_t ino;
+		uint8_t nameLen;
+		char name[NAME_LEN];
+	};
+
+	struct IEntry {
+		uint32_t hash;
+		/* the next entry in the hash-chain or NO_ENTRY */
+		size_t next;
+		/* the offset of the name in the name pool */
+		size_t name;
+		uint16_t nameLen;
+		/* the inode-number or EXT2_BAD_INO if it has been removed */
+		ino_t ino;
+	};
+
+	struct Index {
+		ino_t dir;
+		/* for the LRU replacement */
+		ulong lastUse;
+		size_t bucketCount;
+		size_t *buckets;
+		size_t entryCount;
+		size_t entrySize;
+		size_t dead;
+		IEntry *entries;
+		size_t poolCount;
+		size_t poolSize;
+		char *pool;
+	};
+
+public:
+	/**
+	 * Creates the cache
+	 *
+	 * @param entries the number of entries to cache
+	 * @param indices the number of directories that can be indexed at the same time
+	 */
+	explicit Ext2DirCache(size_t entries,size_t indices);
+	~Ext2DirCache();
+
+	/**
+	 * Looks for the entry <name> in <dir>. If a hashed index exists for <dir>, it knows the
+	 * answer for sure.
+	 *
+	 * @param dir the directory
+	 * @param name the name of the entry
+	 * @param nameLen the length of the name
+	 * @param ino will be set to the inode-number or -ENOENT, if found
+	 * @return true if the result is known
+	 */
+	bool find(ino_t dir,const char *name,size_t nameLen,ino_t *ino);
+
+	/**
+	 * Puts the result of a lookup of <name> in <dir> into the cache.
+	 *
+	 * @param dir the directory
+	 * @param name the name of the entry
+	 * @param nameLen the length of the name
+	 * @param ino the inode-number or -ENOENT if it does not exist
+	 */
+	void insert(ino_t dir,const char *name,size_t nameLen,ino_t ino);
+
+	/**
+	 * Creates a hashed index for <dir> from the given directory-entries.
+	 *
+	 * @param dir the directory
+	 * @param buffer the buffer with all directory-entries
+	 * @param bufSize the size of the buffer
+	 */
+	void createIndex(ino_t dir,const fs::Ext2DirEntry *buffer,size_t bufSize);
+
+	/**
+	 * Reports that <name> has been linked to <ino> in <dir>.
+	 */
+	void link(ino_t dir,const char *name,size_t nameLen,ino_t ino);
+
+	/**
+	 * Reports that <name> has been removed from <dir>.
+	 */
+	void unlink(ino_t dir,const char *name,size_t nameLen);
+
+	/**
+	 * Removes everything that is known about <dir> from the cache, because it has been deleted.
+	 */
+	void purge(ino_t dir);
+
+	/**
+	 * Prints statistics about the cache into the given file
+	 *
+	 * @param f the file
+	 */
+	void print(FILE *f);
+
+private:
+	static uint32_t hash(ino_t dir,const char *name,size_t nameLen);
+
+	Entry *get(ino_t dir,const char *name,size_t nameLen,uint32_t hash);
+	void put(ino_t dir,const char *name,size_t nameLen,uint32_t hash,ino_t ino);
+	void remove(Entry *e);
+	void touch(Entry *e);
+
+	Index *getIndex(ino_t dir);
+	IEntry *findIndexed(Index *idx,const char *name,size_t nameLen,uint32_t hash);
+	bool addIndexed(Index *idx,const char *name,size_t nameLen,uint32_t hash,ino_t ino);
+	void destroyIndex(Index *idx);
+
+	size_t _hits;
+	size_t _misses;
+	size_t _indexHits;
+	size_t _indexBuilds;
+	ulong _useCounter;
+	size_t _entryCount;
+	size_t _bucketCount;
+	Entry *_entries;
+	Entry **_buckets;
+	Entry *_newest;
+	Entry *_oldest;
+	size_t _indexCount;
+	Index *_indices;
+	std::mutex _mutex;
+};
@@ -26,6 +26,7 @@
 #include <sys/proc.h>
 #include <dirent.h>
 #include <errno.h>
+#include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -49,18 +50,100 @@ static void sigTermHndl(int) {
 	fsdev->stop();
 }
 
+static void usage(const char *name) {
+	fprintf(stderr,"Usage: %s [-t <threads>] [-o <options>] <fsPath> <devicePath>\n",name);
+	fprintf(stderr,"    -t <threads>: handle the requests for different files in parallel\n");
+	fprintf(stderr,"                  with <threads> worker threads (0 by default). the\n");
+	fprintf(stderr,"                  disk accesses are still done one after another\n");
+	fprintf(stderr,"    -o <options>: a comma-separated list of:\n");
+	fprintf(stderr,"        strictatime: update the access time on every read (default)\n");
+	fprintf(stderr,"        relatime:    update it only if older than the modification\n");
+	fprintf(stderr,"                     time or at least once per day\n");
+	fprintf(stderr,"        lazyatime:   keep it in memory until the inode is written\n");
+	fprintf(stderr,"                     anyway or the filesystem is synced\n");
+	fprintf(stderr,"        noatime:     never update the access time\n");
+	fprintf(stderr,"        cache=<n>:   use <n> blocks for the block cache (%zu by default)\n",
+		EXT2_BCACHE_SIZE);
+	fprintf(stderr,"        icache=<n>:  cache up to <n> inodes (%zu by default)\n",
+		EXT2_ICACHE_SIZE);
+	fprintf(stderr,"        trace=<f>:   write a trace of all block requests to <f>, which\n");
+	fprintf(stderr,"                     has to be on a different filesystem\n");
+	exit(EXIT_FAILURE);
+}
+
+struct Options {
+	uint atime;
+	size_t cacheBlocks;
+	size_t cacheInodes;
+	const char *trace;
+};
+
+static void parseOptions(const char *name,char *opts,Options *res) {
+	for(char *opt = strtok(opts,","); opt != NULL; opt = strtok(NULL,",")) {
+		if(strcmp(opt,"strictatime") == 0)
+			res->atime = ATIME_STRICT;
+		else if(strcmp(opt,"relatime") == 0)
+			res->atime = ATIME_RELATIVE;
+		else if(strcmp(opt,"lazyatime") == 0)
+			res->atime = ATIME_LAZY;
+		else if(strcmp(opt,"noatime") == 0)
+			res->atime = ATIME_NONE;
+		else if(strncmp(opt,"cache=",6) == 0) {
+			res->cacheBlocks = strtoul(opt + 6,NULL,0);
+			if(res->cacheBlocks == 0)
+				usage(name);
+		}
+		else if(strncmp(opt,"icache=",7) == 0) {
+			res->cacheInodes = strtoul(opt + 7,NULL,0);
+			if(res->cacheInodes == 0)
+				usage(name);
+		}
+		else if(strncmp(opt,"trace=",6) == 0)
+			res->trace = opt + 6;
+		else {
+			fprintf(stderr,"Unknown option '%s'\n",opt);
+			usage(name);
+		}
+	}
+}
+
 int main(int argc,char *argv[]) {
-	if(argc != 3)
-		error("Usage: %s <fsPath> <devicePath>",argv[0]);
+	size_t threads = 0;
+	Options opts = {ATIME_STRICT,EXT2_BCACHE_SIZE,EXT2_ICACHE_SIZE,NULL};
+
+	int opt;
+	while((opt = getopt(argc,argv,"t:o:")) != -1) {
+		switch(opt) {
+			case 't': threads = strtoul(optarg,NULL,0); break;
+			case 'o': parseOptions(argv[0],optarg,&opts); break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if(optind + 2 != argc)
+		usage(argv[0]);
+
+	const char *fsPath = argv[optind];
+	const char *devPath = argv[optind + 1];
 
 	/* the backend has to be a block device */
-	if(!isblock(argv[2]))
-		error("'%s' is neither a block-device nor a regular file",argv[2]);
+	if(!isblock(devPath))
+		error("'%s' is neither a block-device nor a regular file",devPath);
 
 	if(signal(SIGTERM,sigTermHndl) == SIG_ERR)
 		error("Unable to set signal-handler for SIGTERM");
 
-	fsdev = new fs::FSDevice<fs::OpenFile>(new Ext2FileSystem(argv[2]),argv[1]);
+	Ext2FileSystem *fs = new Ext2FileSystem(devPath,opts.atime,opts.cacheBlocks,
+		opts.cacheInodes);
+	if(opts.trace) {
+		FILE *trace = fopen(opts.trace,"w");
+		if(trace == NULL)
+			printe("Unable to open '%s' for writing",opts.trace);
+		else
+			fs->blockCache.setTrace(trace);
+	}
+
+	fsdev = new fs::FSDevice<fs::OpenFile>(fs,fsPath,threads);
 	fsdev->loop();
 	return 0;
 }
@@ -80,13 +163,18 @@ static int open_device(const char *path) {
 	return fd;
 }
 
-Ext2FileSystem::Ext2FileSystem(const char *device)
-		: fd(open_device(device)), sb(this), bgs(this),
-		  inodeCache(this), blockCache(this) {
+Ext2FileSystem::Ext2FileSystem(const char *device,uint atimePolicy,size_t cacheBlocks,
+		size_t cacheInodes)
+		: fd(open_device(device)), atime(atimePolicy), ioLock(), sbLock(),
+		  allocRuns(), allocBlocks(), allocMisses(), sb(this), bgs(this),
+		  inodeCache(this,cacheInodes), blockCache(this,cacheBlocks),
+		  dirCache(EXT2_DCACHE_SIZE,EXT2_DINDEX_COUNT) {
+	blockCache.startFlusher();
 }
 
 Ext2FileSystem::~Ext2FileSystem() {
-	/* write pending changes */
+	/* the flusher uses our device; write the remaining changes ourself */
+	blockCache.stopFlusher();
 	sync();
 	::close(fd);
 }
@@ -140,7 +228,7 @@ ino_t Ext2FileSystem::open(fs::User *u,const char *path,ssize_t *sympos,ino_t ro
 	 * to prevent that somebody else deletes the file while another one uses it. of course, this
 	 * means that we can never have more open files that inode-cache-slots. so, we might have to
 	 * increase that at sometime. */
-	cnode->refs++;
+	inodeCache.ref(cnode);
 	inodeCache.release(cnode);
 
 	/* truncate? */
@@ -158,7 +246,7 @@ ino_t Ext2FileSystem::open(fs::User *u,const char *path,ssize_t *sympos,ino_t ro
 void Ext2FileSystem::close(fs::OpenFile *file) {
 	/* decrease references so that we can remove the cached inode and maybe even delete the file */
 	Ext2CInode *cnode = inodeCache.request(file->ino,IMODE_READ);
-	cnode->refs--;
+	inodeCache.unref(cnode);
 	inodeCache.release(cnode);
 }
 
@@ -209,7 +297,7 @@ int Ext2FileSystem::truncate(fs::OpenFile *file,off_t length) {
 }
 
 ssize_t Ext2FileSystem::read(fs::OpenFile *file,void *buffer,off_t offset,size_t count) {
-	return Ext2File::read(this,file->ino,buffer,offset,count);
+	return Ext2File::read(this,file->ino,buffer,offset,count,&file->ra);
 }
 
 ssize_t Ext2FileSystem::write(fs::OpenFile *file,const void *buffer,off_t offset,size_t count) {
@@ -223,8 +311,17 @@ int Ext2FileSystem::link(fs::OpenFile *dst,fs::OpenFile *dir,const char *name) {
 int Ext2FileSystem::linkIno(ino_t dst,fs::OpenFile *dir,const char *name,bool isdir) {
 	int res;
 	Ext2CInode *cdir,*cdst;
-	cdir = inodeCache.request(dir->ino,IMODE_WRITE);
-	cdst = inodeCache.request(dst,IMODE_WRITE);
+	/* lock both inodes in ascending order to prevent deadlocks with other threads */
+	if(dst == dir->ino)
+		cdir = cdst = inodeCache.request(dst,IMODE_WRITE);
+	else if(dst < dir->ino) {
+		cdst = inodeCache.request(dst,IMODE_WRITE);
+		cdir = inodeCache.request(dir->ino,IMODE_WRITE);
+	}
+	else {
+		cdir = inodeCache.request(dir->ino,IMODE_WRITE);
+		cdst = inodeCache.request(dst,IMODE_WRITE);
+	}
 	if(cdir == NULL || cdst == NULL)
 		res = -ENOBUFS;
 	else if(!isdir && S_ISDIR(le16tocpu(cdst->inode.mode)))
@@ -232,7 +329,8 @@ int Ext2FileSystem::linkIno(ino_t dst,fs::OpenFile *dir,const char *name,bool is
 	else
 		res = Ext2Link::create(this,&dir->user,cdir,cdst,name);
 	inodeCache.release(cdir);
-	inodeCache.release(cdst);
+	if(cdst != cdir)
+		inodeCache.release(cdst);
 	return res;
 }
 
@@ -335,10 +433,16 @@ void Ext2FileSystem::print(FILE *f) {
 	fprintf(f,"Free: %zu bytes\n",le32tocpu(sb.get()->freeBlockCount) * blockSize());
 	fprintf(f,"Mount count: %u\n",le16tocpu(sb.get()->mountCount));
 	fprintf(f,"Max mount count: %u\n",le16tocpu(sb.get()->maxMountCount));
+	fprintf(f,"Block allocation:\n");
+	fprintf(f,"\tRuns: %zu\n",allocRuns);
+	fprintf(f,"\tBlocks: %zu\n",allocBlocks);
+	fprintf(f,"\tRuns not at goal: %zu\n",allocMisses);
 	fprintf(f,"Block cache:\n");
 	blockCache.printStats(f);
 	fprintf(f,"Inode cache:\n");
 	inodeCache.print(f);
+	fprintf(f,"Directory cache:\n");
+	dirCache.print(f);
 }
 
 int Ext2FileSystem::hasPermission(Ext2CInode *cnode,fs::User *u,uint perms) {
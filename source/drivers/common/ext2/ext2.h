@@ -25,24 +25,42 @@
 #include <fs/fsdev.h>
 #include <sys/common.h>
 #include <sys/endian.h>
+#include <mutex>
+#include <time.h>
 
 #include "bgmng.h"
 #include "dir.h"
+#include "dircache.h"
 #include "inodecache.h"
 #include "sbmng.h"
 
 static const size_t DISK_SECTOR_SIZE		= 512;
-static const size_t EXT2_ICACHE_SIZE		= 64;
+static const size_t EXT2_ICACHE_SIZE		= 512;
 static const size_t EXT2_BCACHE_SIZE		= 2048;
-
-static const uint EXT2_SUPERBLOCK_LOCK		= 0xF7180002;
+static const size_t EXT2_DCACHE_SIZE		= 512;
+/* the number of directories that can have a hashed index at the same time */
+static const size_t EXT2_DINDEX_COUNT		= 8;
+/* directories with at least this number of blocks get a hashed index */
+static const size_t EXT2_DINDEX_MIN_BLOCKS	= 4;
+/* the number of blocks that are allocated at once for files that grow */
+static const size_t EXT2_PREALLOC_BLOCKS	= 8;
+/* with ATIME_RELATIVE, the access time is updated at least once per day */
+static const time_t EXT2_RELATIME_SECS		= 24 * 60 * 60;
+
+/* the policies for updating the access time of inodes when they are read */
+enum {
+	ATIME_STRICT,	/* update it on every read */
+	ATIME_RELATIVE,	/* only if older than the modify/create time or EXT2_RELATIME_SECS */
+	ATIME_LAZY,		/* update it in memory; written back with other changes, on eviction or sync */
+	ATIME_NONE,		/* never update it */
+};
 
 class Ext2FileSystem : public fs::FileSystem<fs::OpenFile> {
 public:
 	class Ext2BlockCache : public fs::BlockCache {
 	public:
-		explicit Ext2BlockCache(Ext2FileSystem *fs)
-			: BlockCache(fs->fd,EXT2_BCACHE_SIZE,fs->blockSize()), _fs(fs) {
+		explicit Ext2BlockCache(Ext2FileSystem *fs,size_t blocks)
+			: BlockCache(fs->fd,blocks,fs->blockSize()), _fs(fs) {
 		}
 
 		bool readBlocks(void *buffer,block_t start,size_t blockCount) override;
@@ -52,7 +70,16 @@ public:
 		Ext2FileSystem *_fs;
 	};
 
-	explicit Ext2FileSystem(const char *device);
+	/**
+	 * Creates the filesystem for given device
+	 *
+	 * @param device the path to the device
+	 * @param atimePolicy the policy for access times (ATIME_*)
+	 * @param cacheBlocks the number of blocks in the block cache
+	 * @param cacheInodes the number of inodes in the inode cache
+	 */
+	explicit Ext2FileSystem(const char *device,uint atimePolicy = ATIME_STRICT,
+		size_t cacheBlocks = EXT2_BCACHE_SIZE,size_t cacheInodes = EXT2_ICACHE_SIZE);
 	virtual ~Ext2FileSystem();
 
 	ino_t open(fs::User *u,const char *path,ssize_t *pos,ino_t root,uint flags,mode_t mode,int fd,
@@ -133,17 +160,6 @@ public:
 		return (bytes + blockSize() - 1) / blockSize();
 	}
 
-	/**
-	 * Determines the block of the given inode
-	 *
-	 * @param e the ext2-data
-	 * @param inodeNo the inode-number
-	 * @return the block-number
-	 */
-	block_t getBlockOfInode(ino_t inodeNo) {
-		return (inodeNo - 1) / le32tocpu(sb.get()->inodesPerGroup);
-	}
-
 	/**
 	 * Determines the block-group of the given block
 	 *
@@ -152,7 +168,7 @@ public:
 	 * @return the block-group-number
 	 */
 	block_t getGroupOfBlock(block_t block) {
-		return block / le32tocpu(sb.get()->blocksPerGroup);
+		return (block - le32tocpu(sb.get()->firstDataBlock)) / le32tocpu(sb.get()->blocksPerGroup);
 	}
 
 	/**
@@ -163,7 +179,7 @@ public:
 	 * @return the block-group-number
 	 */
 	block_t getGroupOfInode(ino_t inodeNo) {
-		return inodeNo / le32tocpu(sb.get()->inodesPerGroup);
+		return (inodeNo - 1) / le32tocpu(sb.get()->inodesPerGroup);
 	}
 
 	/**
@@ -208,6 +224,20 @@ public:
 
 	/* the fd for the device */
 	int fd;
+	/* the policy for access times (ATIME_*) */
+	uint atime;
+	/* serializes the accesses to <fd>, because seek and read/write have to be done atomically.
+	 * thus, the worker threads only handle requests in parallel that are served by the caches.
+	 * a lock per block would not help here: the block cache shares its buffer with the disk driver
+	 * via <fd> and the disk driver handles one request at a time anyway */
+	std::mutex ioLock;
+	/* protects the superblock, the blockgroups and the bitmaps */
+	std::mutex sbLock;
+	/* statistics about the block allocation (protected by sbLock): the number of allocated runs
+	 * of blocks, the number of blocks in them and the number of runs not starting at the goal */
+	size_t allocRuns;
+	size_t allocBlocks;
+	size_t allocMisses;
 
 	/* superblock and blockgroups of that ext2-fs */
 	Ext2SBMng sb;
@@ -216,4 +246,5 @@ public:
 	/* caches */
 	Ext2INodeCache inodeCache;
 	Ext2BlockCache blockCache;
+	Ext2DirCache dirCache;
 };
@@ -140,31 +140,33 @@ int Ext2File::truncate(Ext2FileSystem *e,Ext2CInode *cnode,bool del) {
 	return 0;
 }
 
-ssize_t Ext2File::read(Ext2FileSystem *e,ino_t inodeNo,void *buffer,off_t offset,size_t count) {
+ssize_t Ext2File::read(Ext2FileSystem *e,ino_t inodeNo,void *buffer,off_t offset,size_t count,
+		fs::ReadAhead *ra) {
 	Ext2CInode *cnode;
 	ssize_t res;
 
-	/* at first we need the inode */
-	cnode = e->inodeCache.request(inodeNo,IMODE_WRITE);
+	/* at first we need the inode. reading doesn't change it (except for the access time), so
+	 * that multiple readers can access it in parallel */
+	cnode = e->inodeCache.request(inodeNo,IMODE_READ);
 	if(cnode == NULL)
 		return -ENOBUFS;
 
 	/* read */
-	res = readIno(e,cnode,buffer,offset,count);
+	res = readIno(e,cnode,buffer,offset,count,ra);
 	if(res <= 0) {
 		e->inodeCache.release(cnode);
 		return res;
 	}
 
 	/* mark accessed */
-	cnode->inode.accesstime = cputole32(time(NULL));
-	e->inodeCache.markDirty(cnode);
+	e->inodeCache.markAccessed(cnode);
 	e->inodeCache.release(cnode);
 
 	return res;
 }
 
-ssize_t Ext2File::readIno(Ext2FileSystem *e,const Ext2CInode *cnode,void *buffer,off_t offset,size_t count) {
+ssize_t Ext2File::readIno(Ext2FileSystem *e,const Ext2CInode *cnode,void *buffer,off_t offset,
+		size_t count,fs::ReadAhead *ra) {
 	/* nothing left to read? */
 	int32_t inoSize = le32tocpu(cnode->inode.size);
 	if((int32_t)offset < 0 || (int32_t)offset >= inoSize)
@@ -190,6 +192,23 @@ ssize_t Ext2File::readIno(Ext2FileSystem *e,const Ext2CInode *cnode,void *buffer
 		offset %= blockSize;
 		blockCount = (offset + count + blockSize - 1) / blockSize;
 
+		/* load the blocks we need with as few requests as possible and read ahead, if the
+		 * file is read sequentially */
+		block_t raStart = 0;
+		size_t raCount = ra ? ra->access(startBlock,blockCount,&raStart) : 0;
+		if(raCount > 0) {
+			block_t fileBlocks = (inoSize + blockSize - 1) / blockSize;
+			raCount = raStart < fileBlocks ? esc::Util::min(raCount,(size_t)(fileBlocks - raStart)) : 0;
+		}
+		if(raCount > 0 && raStart == startBlock + blockCount)
+			fetchBlocks(e,cnode,startBlock,blockCount + raCount,blockCount);
+		else {
+			if(blockCount > 1)
+				fetchBlocks(e,cnode,startBlock,blockCount,blockCount);
+			if(raCount > 0)
+				fetchBlocks(e,cnode,raStart,raCount,0);
+		}
+
 		/* use the offset in the first block; after the first one the offset is 0 anyway */
 		leftBytes = count;
 		bufWork = (uint8_t*)buffer;
@@ -293,6 +312,35 @@ ssize_t Ext2File::writeIno(Ext2FileSystem *e,Ext2CInode *cnode,const void *buffe
 	return count;
 }
 
+void Ext2File::fetchBlocks(Ext2FileSystem *e,const Ext2CInode *cnode,block_t start,size_t count,
+		size_t demanded) {
+	/* collect extents of blocks that are consecutive on disk */
+	block_t first = 0;
+	size_t i,firstIdx = 0,len = 0;
+	for(i = 0; i < count; i++) {
+		block_t block = Ext2INode::getDataBlock(e,cnode,start + i);
+		if(len > 0 && block == first + len) {
+			len++;
+			continue;
+		}
+
+		if(len > 0) {
+			size_t dem = demanded > firstIdx ? demanded - firstIdx : 0;
+			e->blockCache.prefetch(first,len,dem);
+		}
+		/* stop at holes */
+		if(block == 0)
+			return;
+		first = block;
+		firstIdx = i;
+		len = 1;
+	}
+	if(len > 0) {
+		size_t dem = demanded > firstIdx ? demanded - firstIdx : 0;
+		e->blockCache.prefetch(first,len,dem);
+	}
+}
+
 int Ext2File::freeDIndirBlock(Ext2FileSystem *e,block_t blockNo) {
 	size_t i,count;
 	/* note that we don't need to set the block-numbers to 0 here (-> write), since the whole
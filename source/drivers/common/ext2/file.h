@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <fs/readahead.h>
 #include <sys/common.h>
 
 #include "ext2.h"
@@ -69,9 +70,11 @@ public:
 	 * 	not copied anywhere
 	 * @param offset the offset
 	 * @param count the number of bytes to read
+	 * @param ra the readahead state of the stream (NULL = no readahead)
 	 * @return the number of read bytes
 	 */
-	static ssize_t read(Ext2FileSystem *e,ino_t inodeNo,void *buffer,off_t offset,size_t count);
+	static ssize_t read(Ext2FileSystem *e,ino_t inodeNo,void *buffer,off_t offset,size_t count,
+		fs::ReadAhead *ra = NULL);
 
 	/**
 	 * Reads <count> bytes at <offset> into <buffer> from the given cached inode. It will not
@@ -83,9 +86,11 @@ public:
 	 * 	not copied anywhere
 	 * @param offset the offset
 	 * @param count the number of bytes to read
+	 * @param ra the readahead state of the stream (NULL = no readahead)
 	 * @return the number of read bytes
 	 */
-	static ssize_t readIno(Ext2FileSystem *e,const Ext2CInode *cnode,void *buffer,off_t offset,size_t count);
+	static ssize_t readIno(Ext2FileSystem *e,const Ext2CInode *cnode,void *buffer,off_t offset,
+		size_t count,fs::ReadAhead *ra = NULL);
 
 	/**
 	 * Writes <count> bytes at <offset> from <buffer> to the inode with given number. Will
@@ -114,6 +119,13 @@ public:
 	static ssize_t writeIno(Ext2FileSystem *e,Ext2CInode *cnode,const void *buffer,off_t offset,size_t count);
 
 private:
+	/**
+	 * Loads the data blocks <start> .. <start>+<count>-1 of the given inode into the block cache.
+	 * Blocks that are consecutive on disk are read at once. All blocks behind the first
+	 * <demanded> ones are treated as readahead.
+	 */
+	static void fetchBlocks(Ext2FileSystem *e,const Ext2CInode *cnode,block_t start,size_t count,
+		size_t demanded);
 	/**
 	 * Free's the given doubly-indirect-block
 	 */
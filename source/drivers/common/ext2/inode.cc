@@ -76,24 +76,32 @@ int Ext2INode::create(Ext2FileSystem *e,User *u,Ext2CInode *dirNode,Ext2CInode *
 }
 
 int Ext2INode::chmod(Ext2FileSystem *e,User *u,ino_t inodeNo,mode_t mode) {
+	int res = 0;
 	mode_t oldMode;
 	Ext2CInode *cnode = e->inodeCache.request(inodeNo,IMODE_WRITE);
 	if(cnode == NULL)
 		return -ENOBUFS;
 
-	if(!Permissions::canChmod(u,le16tocpu(cnode->inode.uid)))
-		return -EPERM;
-	if(S_ISLNK(le16tocpu(cnode->inode.mode)))
-		return -ENOTSUP;
+	if(!Permissions::canChmod(u,le16tocpu(cnode->inode.uid))) {
+		res = -EPERM;
+		goto error;
+	}
+	if(S_ISLNK(le16tocpu(cnode->inode.mode))) {
+		res = -ENOTSUP;
+		goto error;
+	}
 
 	oldMode = le16tocpu(cnode->inode.mode);
 	cnode->inode.mode = cputole16((oldMode & ~EXT2_S_PERMS) | (mode & EXT2_S_PERMS));
 	e->inodeCache.markDirty(cnode);
+
+error:
 	e->inodeCache.release(cnode);
-	return 0;
+	return res;
 }
 
 int Ext2INode::chown(Ext2FileSystem *e,User *u,ino_t inodeNo,uid_t uid,gid_t gid) {
+	int res = 0;
 	uid_t oldUid;
 	gid_t oldGid;
 	Ext2CInode *cnode = e->inodeCache.request(inodeNo,IMODE_WRITE);
@@ -102,18 +110,24 @@ int Ext2INode::chown(Ext2FileSystem *e,User *u,ino_t inodeNo,uid_t uid,gid_t gid
 
 	oldUid = le16tocpu(cnode->inode.uid);
 	oldGid = le16tocpu(cnode->inode.gid);
-	if(!Permissions::canChown(u,oldUid,oldGid,uid,gid))
-		return -EPERM;
-	if(S_ISLNK(le16tocpu(cnode->inode.mode)))
-		return -ENOTSUP;
+	if(!Permissions::canChown(u,oldUid,oldGid,uid,gid)) {
+		res = -EPERM;
+		goto error;
+	}
+	if(S_ISLNK(le16tocpu(cnode->inode.mode))) {
+		res = -ENOTSUP;
+		goto error;
+	}
 
 	if(uid != (uid_t)-1)
 		cnode->inode.uid = cputole16(uid);
 	if(gid != (gid_t)-1)
 		cnode->inode.gid = cputole16(gid);
 	e->inodeCache.markDirty(cnode);
+
+error:
 	e->inodeCache.release(cnode);
-	return 0;
+	return res;
 }
 
 int Ext2INode::utime(Ext2FileSystem *e,User *u,ino_t inodeNo,const struct utimbuf *utimes) {
@@ -121,14 +135,16 @@ int Ext2INode::utime(Ext2FileSystem *e,User *u,ino_t inodeNo,const struct utimbu
 	if(cnode == NULL)
 		return -ENOBUFS;
 
+	int res = 0;
 	if(!Permissions::canUtime(u,le16tocpu(cnode->inode.uid)))
-		return -EPERM;
-
-	cnode->inode.accesstime = cputole32(utimes->actime);
-	cnode->inode.modifytime = cputole32(utimes->modtime);
-	e->inodeCache.markDirty(cnode);
+		res = -EPERM;
+	else {
+		cnode->inode.accesstime = cputole32(utimes->actime);
+		cnode->inode.modifytime = cputole32(utimes->modtime);
+		e->inodeCache.markDirty(cnode);
+	}
 	e->inodeCache.release(cnode);
-	return 0;
+	return res;
 }
 
 int Ext2INode::destroy(Ext2FileSystem *e,Ext2CInode *cnode) {
@@ -180,7 +196,9 @@ block_t Ext2INode::accessIndirBlock(Ext2FileSystem *e,Ext2CInode *cnode,block_t
 			if(!req)
 				goto error;
 
-			blockNos[i] = cputole32(Ext2Bitmap::allocBlock(e,cnode));
+			/* try to put it behind its predecessor or the block with block-numbers */
+			block_t goal = i > 0 && blockNos[i - 1] ? le32tocpu(blockNos[i - 1]) : le32tocpu(*indir);
+			blockNos[i] = cputole32(Ext2Bitmap::allocBlock(e,cnode,goal + 1));
 			if(blockNos[i] == 0)
 				goto error;
 
@@ -210,7 +228,9 @@ block_t Ext2INode::doGetDataBlock(Ext2FileSystem *e,Ext2CInode *cnode,block_t bl
 	if(block < EXT2_DIRBLOCK_COUNT) {
 		block_t bno = le32tocpu(cnode->inode.dBlocks[block]);
 		if(req && bno == 0) {
-			bno = Ext2Bitmap::allocBlock(e,cnode);
+			/* try to put it behind its predecessor */
+			block_t goal = block > 0 ? le32tocpu(cnode->inode.dBlocks[block - 1]) : 0;
+			bno = Ext2Bitmap::allocBlock(e,cnode,goal ? goal + 1 : 0);
 			cnode->inode.dBlocks[block] = cputole32(bno);
 			if(bno != 0) {
 				uint32_t blocks = le32tocpu(cnode->inode.blocks);
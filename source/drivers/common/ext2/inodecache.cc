@@ -27,7 +27,9 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "bitmap.h"
 #include "ext2.h"
 #include "file.h"
 #include "inodecache.h"
@@ -35,119 +37,167 @@
 
 using namespace fs;
 
-Ext2INodeCache::Ext2INodeCache(Ext2FileSystem *fs)
-		: _hits(), _misses(), _cache(new Ext2CInode[EXT2_ICACHE_SIZE]), _fs(fs) {
-	size_t i;
-	Ext2CInode *inode = _cache;
-	for(i = 0; i < EXT2_ICACHE_SIZE; i++) {
+Ext2INodeCache::Ext2INodeCache(Ext2FileSystem *fs,size_t size)
+		: _hits(), _misses(), _writebacks(), _blockWrites(), _size(size), _bucketCount(1),
+		  _cache(new Ext2CInode[size]), _buckets(), _newest(), _oldest(), _fs(fs), _mutex(),
+		  _locks(LOCK_COUNT) {
+	/* use a power of two, roughly the number of inodes */
+	while(_bucketCount < size)
+		_bucketCount *= 2;
+	_buckets = new Ext2CInode*[_bucketCount]();
+
+	for(size_t i = 0; i < size; i++) {
+		Ext2CInode *inode = _cache + i;
+		inode->next = NULL;
 		inode->inodeNo = EXT2_BAD_INO;
 		inode->refs = 0;
 		inode->dirty = false;
-		inode++;
+		inode->atimeDirty = false;
+		inode->resCount = 0;
+		lruAdd(inode,false);
 	}
 }
 
 void Ext2INodeCache::flush() {
-	Ext2CInode *inode,*end = _cache + EXT2_ICACHE_SIZE;
+	Ext2CInode *inode,*end = _cache + _size;
+	_mutex.lock();
 	for(inode = _cache; inode < end; inode++) {
-		if(inode->dirty) {
-			sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+		if(inode->inodeNo == EXT2_BAD_INO || !(inode->dirty || inode->atimeDirty))
+			continue;
+
+		/* nobody can use unreferenced inodes while we hold _mutex. thus, we can write them
+		 * together with the others in their block */
+		if(inode->refs == 0)
+			writeBlock(inode);
+		else {
 			acquire(inode,IMODE_READ);
 			write(inode);
-			release(inode);
+			doRelease(inode,false);
+			_writebacks++;
+			_blockWrites++;
 		}
 	}
+	_mutex.unlock();
+}
+
+void Ext2INodeCache::markAccessed(Ext2CInode *inode) {
+	if(_fs->atime == ATIME_NONE || (le32tocpu(inode->inode.flags) & EXT2_NOATIME_FL))
+		return;
+
+	time_t now = time(NULL);
+	if(_fs->atime == ATIME_RELATIVE) {
+		/* only update it if the file has been changed since the last access or the last access
+		 * is too long ago */
+		time_t atime = le32tocpu(inode->inode.accesstime);
+		if(atime > (time_t)le32tocpu(inode->inode.modifytime) &&
+				atime > (time_t)le32tocpu(inode->inode.createtime) &&
+				now - atime < EXT2_RELATIME_SECS)
+			return;
+	}
+
+	/* we might hold the inode only in shared mode. but since all readers store the current time
+	 * and writers exclude us, this doesn't hurt. */
+	inode->inode.accesstime = cputole32(now);
+	if(_fs->atime == ATIME_LAZY)
+		inode->atimeDirty = true;
+	else
+		inode->dirty = true;
+}
+
+void Ext2INodeCache::ref(Ext2CInode *inode) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	inode->refs++;
+}
+
+void Ext2INodeCache::unref(Ext2CInode *inode) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	assert(inode->refs > 1);
+	inode->refs--;
 }
 
 Ext2CInode *Ext2INodeCache::request(ino_t no,uint mode) {
-	/* search for the inode. perhaps it's already in cache */
-	Ext2CInode *startNode = _cache + (no & (EXT2_ICACHE_SIZE - 1));
-	Ext2CInode *iend = _cache + EXT2_ICACHE_SIZE;
-	Ext2CInode *inode;
 	if(no <= EXT2_BAD_INO)
 		return NULL;
 
-	/* tpool_lock the request of an inode */
-	sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+retry:
+	_mutex.lock();
 
-	for(inode = startNode; inode < iend; inode++) {
-		if(inode->inodeNo == no) {
-			acquire(inode,mode);
-			_hits++;
-			return inode;
-		}
-	}
-	/* look in 0 .. startNode; separate it to make the average-case fast */
-	if(inode == iend) {
-		for(inode = _cache; inode < startNode; inode++) {
-			if(inode->inodeNo == no) {
-				acquire(inode,mode);
-				_hits++;
-				return inode;
-			}
-		}
+	/* perhaps it's already in cache */
+	Ext2CInode *inode = lookup(no);
+	if(inode) {
+		_hits++;
+		acquire(inode,mode);
+		return inode;
 	}
 
-	/* ok, not in cache. so we start again at the position to find a usable node */
-	/* if we have to load it from disk anyway I think we can waste a few cycles more
-	 * to reduce the number of cycles in the cache-lookup. therefore
-	 * we don't collect the information in the loops above. */
-	for(inode = startNode; inode < iend; inode++) {
-		if(inode->inodeNo == EXT2_BAD_INO || inode->refs == 0)
-			break;
+	/* ok, not in cache. so replace the least recently used one */
+	inode = _oldest;
+	if(inode == NULL) {
+		_mutex.unlock();
+		printf("NO FREE INODE-CACHE-SLOT! What to to??");
+		return NULL;
 	}
-	if(inode == iend) {
-		for(inode = _cache; inode < startNode; inode++) {
-			if(inode->inodeNo == EXT2_BAD_INO || inode->refs == 0)
-				break;
-		}
 
-		if(inode == startNode) {
-			printf("NO FREE INODE-CACHE-SLOT! What to to??");
-			return NULL;
-		}
+	/* lock it for writing because we have to load it. nobody references it and thus, nobody
+	 * else can hold the lock. take it before others can find it, so that they wait until we're
+	 * done. this only fails if all locks are in use */
+	if(!_locks.tryLock((ulong)inode,LockTable::EXCLUSIVE)) {
+		_mutex.unlock();
+		yield();
+		goto retry;
 	}
 
-	/* write the old inode back, if necessary */
-	if(inode->dirty && inode->inodeNo != EXT2_BAD_INO) {
-		acquire(inode,IMODE_READ);
-		write(inode);
-		doRelease(inode,false);
+	/* write the old inode back, if necessary. nobody references it, so that we can do that
+	 * without locking it. but keep _mutex to prevent that somebody requests it meanwhile.
+	 * this includes a lazily updated access time, because it would be lost otherwise. */
+	if(inode->inodeNo != EXT2_BAD_INO) {
+		if(inode->dirty || inode->atimeDirty)
+			writeBlock(inode);
+		remove(inode);
 	}
 
 	/* build node */
 	inode->inodeNo = no;
 	inode->dirty = false;
-	/* first for writing because we have to load it */
-	acquire(inode,IMODE_WRITE);
+	inode->atimeDirty = false;
+	inode->allocGoal = 0;
+	inode->resCount = 0;
+	insert(inode);
+	_misses++;
+	inode->refs++;
+	lruRemove(inode);
+	_mutex.unlock();
 
 	read(inode);
 
 	/* now use for the requested mode */
-	if(mode != IMODE_WRITE) {
-		doRelease(inode,false);
-		acquire(inode,mode);
-	}
-
-	_misses++;
+	if(!(mode & IMODE_WRITE))
+		_locks.downgrade((ulong)inode);
 	return inode;
 }
 
 void Ext2INodeCache::print(FILE *f) {
+	std::lock_guard<std::mutex> guard(_mutex);
 	float hitrate;
-	size_t used = 0,dirty = 0;
-	Ext2CInode *inode,*end = _cache + EXT2_ICACHE_SIZE;
+	size_t used = 0,dirty = 0,unref = 0;
+	Ext2CInode *inode,*end = _cache + _size;
 	for(inode = _cache; inode < end; inode++) {
-		if(inode->inodeNo != EXT2_BAD_INO)
+		if(inode->inodeNo != EXT2_BAD_INO) {
 			used++;
+			if(inode->refs == 0)
+				unref++;
+		}
 		if(inode->dirty)
 			dirty++;
 	}
-	fprintf(f,"\tTotal entries: %zu\n",EXT2_ICACHE_SIZE);
+	fprintf(f,"\tTotal entries: %zu\n",_size);
 	fprintf(f,"\tUsed entries: %zu\n",used);
+	fprintf(f,"\tUnreferenced entries: %zu\n",unref);
 	fprintf(f,"\tDirty entries: %zu\n",dirty);
 	fprintf(f,"\tHits: %zu\n",_hits);
 	fprintf(f,"\tMisses: %zu\n",_misses);
+	fprintf(f,"\tWritebacks: %zu\n",_writebacks);
+	fprintf(f,"\tBlock updates: %zu\n",_blockWrites);
 	if(_hits == 0)
 		hitrate = 0;
 	else
@@ -155,10 +205,11 @@ void Ext2INodeCache::print(FILE *f) {
 	fprintf(f,"\tHitrate: %.3f%%\n",hitrate);
 }
 
-void Ext2INodeCache::acquire(Ext2CInode *inode,A_UNUSED uint mode) {
-	inode->refs++;
-	sassert(tpool_unlock(ALLOC_LOCK) == 0);
-	sassert(tpool_lock((uint)inode,(mode & IMODE_WRITE) ? LOCK_EXCLUSIVE : 0) == 0);
+void Ext2INodeCache::acquire(Ext2CInode *inode,uint mode) {
+	if(inode->refs++ == 0)
+		lruRemove(inode);
+	_mutex.unlock();
+	_locks.lock((ulong)inode,(mode & IMODE_WRITE) ? LockTable::EXCLUSIVE : LockTable::SHARED);
 }
 
 void Ext2INodeCache::doRelease(Ext2CInode *ino,bool unlockAlloc) {
@@ -167,46 +218,137 @@ void Ext2INodeCache::doRelease(Ext2CInode *ino,bool unlockAlloc) {
 
 	/* don't write dirty blocks back here, because this would lead to too many writes. */
 	/* skipping it until the inode-cache-entry should be reused, is better */
-	sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
-	/* if there are no references and no links anymore, we have to delete the file */
+	_mutex.lock();
 	if(--ino->refs == 0) {
+		/* nobody will write to it anymore, so give the preallocated blocks back */
+		Ext2Bitmap::discard(_fs,ino);
+		/* if there are no references and no links anymore, we have to delete the file */
 		if(ino->inode.linkCount == 0) {
 			Ext2File::remove(_fs,ino);
 			/* ensure that we don't use the cached inode again */
+			remove(ino);
 			ino->inodeNo = EXT2_BAD_INO;
 			ino->dirty = false;
+			ino->atimeDirty = false;
+			/* reuse it first */
+			lruAdd(ino,false);
 		}
+		else
+			lruAdd(ino,true);
 	}
+	_locks.unlock((ulong)ino);
 	if(unlockAlloc)
-		sassert(tpool_unlock(ALLOC_LOCK) == 0);
-	sassert(tpool_unlock((uint)ino) == 0);
+		_mutex.unlock();
 }
 
 void Ext2INodeCache::read(Ext2CInode *inode) {
-	uint32_t inodesPerGroup = le32tocpu(_fs->sb.get()->inodesPerGroup);
-	Ext2BlockGrp *group = _fs->bgs.get((inode->inodeNo - 1) / inodesPerGroup);
-	size_t inodesPerBlock = _fs->blockSize() / sizeof(Ext2Inode);
-	size_t noInGroup = (inode->inodeNo - 1) % inodesPerGroup;
-	block_t blockNo = le32tocpu(group->inodeTable) + noInGroup / inodesPerBlock;
-	size_t inodeInBlock = (inode->inodeNo - 1) % inodesPerBlock;
+	size_t offset;
+	block_t blockNo = blockOf(inode->inodeNo,&offset);
 	CBlock *block = _fs->blockCache.request(blockNo,BlockCache::READ);
 	vassert(block != NULL,"Fetching block %d failed",blockNo);
-	memcpy(&(inode->inode),(uint8_t*)block->buffer + inodeInBlock * sizeof(Ext2Inode),
-			sizeof(Ext2Inode));
+	memcpy(&(inode->inode),(uint8_t*)block->buffer + offset,sizeof(Ext2Inode));
 	_fs->blockCache.release(block);
 }
 
 void Ext2INodeCache::write(Ext2CInode *inode) {
-	uint32_t inodesPerGroup = le32tocpu(_fs->sb.get()->inodesPerGroup);
-	Ext2BlockGrp *group = _fs->bgs.get((inode->inodeNo - 1) / inodesPerGroup);
-	size_t inodesPerBlock = _fs->blockSize() / sizeof(Ext2Inode);
-	size_t noInGroup = (inode->inodeNo - 1) % inodesPerGroup;
-	block_t blockNo = le32tocpu(group->inodeTable) + noInGroup / inodesPerBlock;
-	size_t inodeInBlock = (inode->inodeNo - 1) % inodesPerBlock;
+	size_t offset;
+	block_t blockNo = blockOf(inode->inodeNo,&offset);
+	CBlock *block = _fs->blockCache.request(blockNo,BlockCache::WRITE);
+	vassert(block != NULL,"Fetching block %d failed",blockNo);
+	/* reset the flags before copying, so that concurrent changes by readers are not lost */
+	inode->dirty = false;
+	inode->atimeDirty = false;
+	memcpy((uint8_t*)block->buffer + offset,&(inode->inode),sizeof(Ext2Inode));
+	_fs->blockCache.markDirty(block);
+	_fs->blockCache.release(block);
+}
+
+void Ext2INodeCache::writeBlock(Ext2CInode *inode) {
+	size_t offset;
+	block_t blockNo = blockOf(inode->inodeNo,&offset);
 	CBlock *block = _fs->blockCache.request(blockNo,BlockCache::WRITE);
 	vassert(block != NULL,"Fetching block %d failed",blockNo);
-	memcpy((uint8_t*)block->buffer + inodeInBlock * sizeof(Ext2Inode),&(inode->inode),
-			sizeof(Ext2Inode));
+
+	/* the inodes in this block have consecutive numbers */
+	ino_t inodesPerBlock = _fs->blockSize() / sizeof(Ext2Inode);
+	ino_t first = inode->inodeNo - offset / sizeof(Ext2Inode);
+	for(ino_t i = 0; i < inodesPerBlock; ++i) {
+		Ext2CInode *other = first + i == inode->inodeNo ? inode : lookup(first + i);
+		if(other == NULL || !(other->dirty || other->atimeDirty))
+			continue;
+		if(other != inode && other->refs > 0)
+			continue;
+
+		other->dirty = false;
+		other->atimeDirty = false;
+		memcpy((uint8_t*)block->buffer + i * sizeof(Ext2Inode),&(other->inode),sizeof(Ext2Inode));
+		_writebacks++;
+	}
+
 	_fs->blockCache.markDirty(block);
 	_fs->blockCache.release(block);
+	_blockWrites++;
+}
+
+block_t Ext2INodeCache::blockOf(ino_t no,size_t *offset) {
+	uint32_t inodesPerGroup = le32tocpu(_fs->sb.get()->inodesPerGroup);
+	Ext2BlockGrp *group = _fs->bgs.get((no - 1) / inodesPerGroup);
+	size_t inodesPerBlock = _fs->blockSize() / sizeof(Ext2Inode);
+	size_t noInGroup = (no - 1) % inodesPerGroup;
+	*offset = ((no - 1) % inodesPerBlock) * sizeof(Ext2Inode);
+	return le32tocpu(group->inodeTable) + noInGroup / inodesPerBlock;
+}
+
+Ext2CInode *Ext2INodeCache::lookup(ino_t no) {
+	for(Ext2CInode *inode = _buckets[no & (_bucketCount - 1)]; inode != NULL; inode = inode->next) {
+		if(inode->inodeNo == no)
+			return inode;
+	}
+	return NULL;
+}
+
+void Ext2INodeCache::insert(Ext2CInode *inode) {
+	Ext2CInode **bucket = _buckets + (inode->inodeNo & (_bucketCount - 1));
+	inode->next = *bucket;
+	*bucket = inode;
+}
+
+void Ext2INodeCache::remove(Ext2CInode *inode) {
+	Ext2CInode **p = _buckets + (inode->inodeNo & (_bucketCount - 1));
+	while(*p != inode)
+		p = &(*p)->next;
+	*p = inode->next;
+	inode->next = NULL;
+}
+
+void Ext2INodeCache::lruRemove(Ext2CInode *inode) {
+	if(inode->newer)
+		inode->newer->older = inode->older;
+	else
+		_newest = inode->older;
+	if(inode->older)
+		inode->older->newer = inode->newer;
+	else
+		_oldest = inode->newer;
+}
+
+void Ext2INodeCache::lruAdd(Ext2CInode *inode,bool newest) {
+	if(newest) {
+		inode->newer = NULL;
+		inode->older = _newest;
+		if(_newest)
+			_newest->newer = inode;
+		else
+			_oldest = inode;
+		_newest = inode;
+	}
+	else {
+		inode->older = NULL;
+		inode->newer = _oldest;
+		if(_oldest)
+			_oldest->older = inode;
+		else
+			_newest = inode;
+		_oldest = inode;
+	}
 }
@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <fs/locktable.h>
 #include <sys/common.h>
+#include <mutex>
 #include <stdio.h>
 
 #include "inode.h"
@@ -27,9 +29,21 @@
 class Ext2FileSystem;
 
 struct Ext2CInode {
+	/* the next one in the hash-chain */
+	Ext2CInode *next;
+	/* the LRU-list of unreferenced inodes */
+	Ext2CInode *newer;
+	Ext2CInode *older;
 	ino_t inodeNo;
 	ushort dirty;
 	ushort refs;
+	/* whether the access time has been changed lazily (see ATIME_LAZY) */
+	bool atimeDirty;
+	/* the block that should preferably be allocated next for this inode */
+	block_t allocGoal;
+	/* the blocks that have been allocated in advance for this inode (see EXT2_PREALLOC_BLOCKS) */
+	block_t resStart;
+	uint resCount;
 	fs::Ext2Inode inode;
 };
 
@@ -38,13 +52,25 @@ enum {
 	IMODE_WRITE	= 0x2,
 };
 
+/**
+ * The inode-cache can be used by multiple threads simultaneously. Like the block-cache, it uses
+ * a mutex for the cache-structure and locks each requested inode for the requested mode.
+ * The cached inodes are found via a hashtable. Inodes that are not referenced are kept in a
+ * LRU-list, whose last entry is replaced if an inode is not in the cache.
+ */
 class Ext2INodeCache {
+	static const size_t LOCK_COUNT	= 32;
+
 public:
 	/**
 	 * Inits the inode-cache
+	 *
+	 * @param fs the filesystem
+	 * @param size the number of inodes to cache
 	 */
-	explicit Ext2INodeCache(Ext2FileSystem *fs);
+	explicit Ext2INodeCache(Ext2FileSystem *fs,size_t size);
 	~Ext2INodeCache() {
+		delete[] _buckets;
 		delete[] _cache;
 	}
 
@@ -62,6 +88,14 @@ public:
 		inode->dirty = true;
 	}
 
+	/**
+	 * Updates the access time of the given inode according to the atime policy of the
+	 * filesystem. This is allowed if the inode has been requested with IMODE_READ, too.
+	 *
+	 * @param inode the inode
+	 */
+	void markAccessed(Ext2CInode *inode);
+
 	/**
 	 * Requests the inode with given number. That means if it is in the cache you'll simply get it.
 	 * Otherwise it is fetched from disk and put into the cache. The references of the cache-inode
@@ -83,6 +117,22 @@ public:
 		doRelease((Ext2CInode*)inode,true);
 	}
 
+	/**
+	 * Increases the references of the given inode, so that it stays in the cache even if it
+	 * has been released.
+	 *
+	 * @param inode the inode
+	 */
+	void ref(Ext2CInode *inode);
+
+	/**
+	 * Decreases the references of the given inode again, without removing it from the cache.
+	 * That is, release() has to be called afterwards.
+	 *
+	 * @param inode the inode
+	 */
+	void unref(Ext2CInode *inode);
+
 	/**
 	 * Prints statistics and information about the inode-cache into the givne file
 	 *
@@ -92,12 +142,12 @@ public:
 
 private:
 	/**
-	 * Aquires the tpool_lock for given mode and inode. Assumes that ALLOC_LOCK is acquired and releases
+	 * Aquires the lock for given mode and inode. Assumes that _mutex is acquired and releases
 	 * it at the end.
 	 */
 	void acquire(Ext2CInode *inode,uint mode);
 	/**
-	 * Releases the given inode
+	 * Releases the given inode. Keeps _mutex locked afterwards, if <unlockAlloc> is false.
 	 */
 	void doRelease(Ext2CInode *ino,bool unlockAlloc);
 	/**
@@ -108,9 +158,33 @@ private:
 	 * Writes the inode back to the cached block, which can be written to disk later
 	 */
 	void write(Ext2CInode *inode);
+	/**
+	 * Writes <inode> and all other dirty and unreferenced inodes in the same block back with a
+	 * single block update. <inode> has to be unreferenced or locked and _mutex has to be acquired.
+	 */
+	void writeBlock(Ext2CInode *inode);
+	/**
+	 * Determines the block of the inode table and the position within it for inode <no>.
+	 */
+	block_t blockOf(ino_t no,size_t *offset);
+
+	Ext2CInode *lookup(ino_t no);
+	void insert(Ext2CInode *inode);
+	void remove(Ext2CInode *inode);
+	void lruRemove(Ext2CInode *inode);
+	void lruAdd(Ext2CInode *inode,bool newest);
 
 	size_t _hits;
 	size_t _misses;
+	size_t _writebacks;
+	size_t _blockWrites;
+	size_t _size;
+	size_t _bucketCount;
 	Ext2CInode *_cache;
+	Ext2CInode **_buckets;
+	Ext2CInode *_newest;
+	Ext2CInode *_oldest;
 	Ext2FileSystem *_fs;
+	std::mutex _mutex;
+	fs::LockTable _locks;
 };
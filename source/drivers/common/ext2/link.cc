@@ -96,6 +96,7 @@ int Ext2Link::create(Ext2FileSystem *e,User *u,Ext2CInode *dir,Ext2CInode *cnode
 		return res;
 	}
 	free(buf);
+	e->dirCache.link(dir->inodeNo,name,len,cnode->inodeNo);
 
 	/* increase link-count */
 	cnode->inode.linkCount = cputole16(le16tocpu(cnode->inode.linkCount) + 1);
@@ -154,6 +155,8 @@ int Ext2Link::remove(Ext2FileSystem *e,User *u,Ext2CInode *pdir,Ext2CInode *dir,
 
 			/* check permissions (sticky bit) */
 			if((res = e->canRemove(dir,cnode,u)) < 0) {
+				if(cnode != pdir && cnode != dir)
+					e->inodeCache.release(cnode);
 				free(buf);
 				return res;
 			}
@@ -186,6 +189,7 @@ int Ext2Link::remove(Ext2FileSystem *e,User *u,Ext2CInode *pdir,Ext2CInode *dir,
 		return res;
 	}
 	free(buf);
+	e->dirCache.unlink(dir->inodeNo,name,nameLen);
 
 	/* update inode */
 	if(cnode != NULL) {
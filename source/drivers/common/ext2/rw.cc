@@ -28,6 +28,7 @@
 #include "rw.h"
 
 int Ext2RW::readSectors(Ext2FileSystem *e,void *buffer,uint64_t lba,size_t secCount) {
+	std::lock_guard<std::mutex> guard(e->ioLock);
 	off_t off = seek(e->fd,lba * DISK_SECTOR_SIZE,SEEK_SET);
 	if(off < 0) {
 		printe("Unable to seek to %x",lba * DISK_SECTOR_SIZE);
@@ -44,13 +45,14 @@ int Ext2RW::readSectors(Ext2FileSystem *e,void *buffer,uint64_t lba,size_t secCo
 }
 
 int Ext2RW::writeSectors(Ext2FileSystem *e,const void *buffer,uint64_t lba,size_t secCount) {
+	std::lock_guard<std::mutex> guard(e->ioLock);
 	off_t off = seek(e->fd,lba * DISK_SECTOR_SIZE,SEEK_SET);
 	if(off < 0) {
 		printe("Unable to seek to %x",lba * DISK_SECTOR_SIZE);
 		return off;
 	}
 
-	ssize_t res = write(e->fd,buffer,secCount * DISK_SECTOR_SIZE);
+	ssize_t res = IGNSIGS(write(e->fd,buffer,secCount * DISK_SECTOR_SIZE));
 	if(res != (ssize_t)(secCount * DISK_SECTOR_SIZE)) {
 		printe("Unable to write %d sectors @ %x",secCount,lba * DISK_SECTOR_SIZE);
 		return res;
@@ -53,7 +53,7 @@ Ext2SBMng::Ext2SBMng(Ext2FileSystem *fs) : _sbDirty(false), _fs(fs) {
 void Ext2SBMng::update() {
 	size_t i,count;
 	block_t bno;
-	sassert(tpool_lock(EXT2_SUPERBLOCK_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	_fs->sbLock.lock();
 
 	if(!_sbDirty)
 		goto done;
@@ -82,5 +82,5 @@ void Ext2SBMng::update() {
 	/* now we're in sync */
 	_sbDirty = false;
 done:
-	sassert(tpool_unlock(EXT2_SUPERBLOCK_LOCK) == 0);
+	_fs->sbLock.unlock();
 }
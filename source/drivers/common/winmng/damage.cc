@@ -0,0 +1,136 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <esc/util.h>
+
+#include "damage.h"
+#include "winlist.h"
+
+Damage *Damage::_inst;
+
+Damage::Damage(esc::UI *ui)
+	: _ui(ui), _mutex(), _pending(), _run(true), _rects(), _count(), _frameStart(), _lastFlush(),
+	  _frames(), _added(), _merged(), _updates(), _totalLatency(), _maxLatency(), _totalFlush(),
+	  _maxFlush() {
+	if(usemcrt(&_pending,0) < 0)
+		error("Unable to create semaphore");
+}
+
+bool Damage::clip(gui::Rectangle &r) const {
+	const esc::Screen::Mode &mode = WinList::get().getMode();
+	gpos_t x = r.x(), y = r.y();
+	gsize_t width = r.width(), height = r.height();
+	if(x < 0) {
+		if(-x >= (gpos_t)width)
+			return false;
+		width += x;
+		x = 0;
+	}
+	if(y < 0) {
+		if(-y >= (gpos_t)height)
+			return false;
+		height += y;
+		y = 0;
+	}
+	if(x >= (gpos_t)mode.width || y >= (gpos_t)mode.height)
+		return false;
+
+	r.setPos(x,y);
+	r.setSize(esc::Util::min((gsize_t)mode.width - x,width),
+		esc::Util::min((gsize_t)mode.height - y,height));
+	return !r.empty();
+}
+
+void Damage::add(const gui::Rectangle &r) {
+	gui::Rectangle rect(r);
+	if(!clip(rect))
+		return;
+
+	std::lock_guard<std::mutex> guard(_mutex);
+	_added++;
+	/* the first damage starts a new frame */
+	if(_count == 0) {
+		_frameStart = rdtsc();
+		usemup(&_pending);
+	}
+
+	_merged += gui::merge(_rects,_count,MAX_RECTS,rect);
+}
+
+void Damage::flush() {
+	if(_count == 0)
+		return;
+
+	uint64_t start = rdtsc();
+	{
+		std::lock_guard<std::mutex> guard(WinList::uiMutex);
+		for(size_t i = 0; i < _count; ++i) {
+			/* the mode might have changed in the meantime */
+			if(clip(_rects[i]))
+				_ui->update(_rects[i].x(),_rects[i].y(),_rects[i].width(),_rects[i].height());
+		}
+	}
+	uint64_t end = rdtsc();
+
+	_frames++;
+	_updates += _count;
+	_totalFlush += end - start;
+	_maxFlush = esc::Util::max(_maxFlush,end - start);
+	_totalLatency += end - _frameStart;
+	_maxLatency = esc::Util::max(_maxLatency,end - _frameStart);
+	_lastFlush = end;
+	_count = 0;
+}
+
+void Damage::run() {
+	const uint64_t interval = timetotsc(FRAME_INTERVAL);
+	while(_run) {
+		/* wait until there is something to do */
+		usemdown(&_pending);
+		if(!_run)
+			break;
+
+		/* give the other threads the chance to add more damage to this frame */
+		uint64_t elapsed = rdtsc() - _lastFlush;
+		if(elapsed < interval)
+			usleep(tsctotime(interval - elapsed));
+
+		std::lock_guard<std::mutex> guard(_mutex);
+		flush();
+		/* consume the wakeups we got for this frame; the next damage starts a new one */
+		while(usemtrydown(&_pending))
+			;
+	}
+}
+
+void Damage::print(esc::OStream &os) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	ulong frames = esc::Util::max(_frames,1UL);
+	os << "Frames        : " << _frames << "\n";
+	os << "Damaged rects : " << _added << "\n";
+	os << "Merged rects  : " << _merged << "\n";
+	os << "Updates       : " << _updates << " (" << (_updates / frames) << " per frame)\n";
+	os << "Frame latency : " << tsctotime(_totalLatency / frames) << " us avg, "
+	   << tsctotime(_maxLatency) << " us max\n";
+	os << "Flush time    : " << tsctotime(_totalFlush / frames) << " us avg, "
+	   << tsctotime(_maxFlush) << " us max\n";
+}
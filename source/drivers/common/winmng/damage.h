@@ -0,0 +1,99 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <esc/proto/ui.h>
+#include <esc/stream/ostream.h>
+#include <gui/graphics/rectangle.h>
+#include <sys/common.h>
+#include <sys/sync.h>
+#include <mutex>
+
+/**
+ * Collects the screen areas that have been changed and flushes them to the UI-manager once per
+ * frame. Rectangles that overlap (or are close enough) are merged, so that dragging a window over
+ * many others results in a few update-messages per frame instead of one per repainted piece.
+ */
+class Damage {
+	static const size_t MAX_RECTS		= 16;
+	/* the minimum time between two flushes in microseconds (~60 frames per second) */
+	static const uint FRAME_INTERVAL	= 16666;
+
+	explicit Damage(esc::UI *ui);
+
+public:
+	static void create(esc::UI *ui) {
+		_inst = new Damage(ui);
+	}
+	static Damage &get() {
+		return *_inst;
+	}
+
+	/**
+	 * Adds the given rectangle to the damaged area of the current frame.
+	 *
+	 * @param r the rectangle (in screen coordinates)
+	 */
+	void add(const gui::Rectangle &r);
+
+	/**
+	 * Runs the frame loop, i.e. waits for damage and flushes it at most once per frame interval.
+	 * Returns if stop() has been called.
+	 */
+	void run();
+
+	/**
+	 * Stops the frame loop. May be called from a signal handler.
+	 */
+	void stop() {
+		_run = false;
+		usemup(&_pending);
+	}
+
+	/**
+	 * Prints the frame statistics to given stream.
+	 *
+	 * @param os the output stream
+	 */
+	void print(esc::OStream &os);
+
+private:
+	bool clip(gui::Rectangle &r) const;
+	void flush();
+
+	esc::UI *_ui;
+	std::mutex _mutex;
+	tUserSem _pending;
+	volatile bool _run;
+	gui::Rectangle _rects[MAX_RECTS];
+	size_t _count;
+	uint64_t _frameStart;
+	uint64_t _lastFlush;
+	/* statistics */
+	ulong _frames;
+	ulong _added;
+	ulong _merged;
+	ulong _updates;
+	uint64_t _totalLatency;
+	uint64_t _maxLatency;
+	uint64_t _totalFlush;
+	uint64_t _maxFlush;
+	static Damage *_inst;
+};
@@ -22,11 +22,13 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "damage.h"
 #include "input.h"
 #include "stack.h"
 #include "winlist.h"
 
 std::mutex WinList::winMutex;
+std::mutex WinList::uiMutex;
 gwinid_t WinList::nextId;
 WinList *WinList::_inst;
 
@@ -53,7 +55,11 @@ int WinList::setMode(int id) {
 	/* get mode info */
 	bool found = false;
 	esc::Screen::Mode newmode;
-	std::vector<esc::Screen::Mode> modes = ui->getModes();
+	std::vector<esc::Screen::Mode> modes;
+	{
+		std::lock_guard<std::mutex> uiguard(uiMutex);
+		modes = ui->getModes();
+	}
 	for(auto m : modes) {
 		if(m.id == id) {
 			newmode = m;
@@ -72,7 +78,10 @@ int WinList::setMode(int id) {
 		std::unique_ptr<esc::FrameBuffer> newfb(
 			new esc::FrameBuffer(newmode,esc::Screen::MODE_TYPE_GUI));
 		::print("Setting mode %d: %zux%zux%u",newmode.id,newmode.width,newmode.height,newmode.bitsPerPixel);
-		ui->setMode(esc::Screen::MODE_TYPE_GUI,newmode.id,newfb->fd(),true);
+		{
+			std::lock_guard<std::mutex> uiguard(uiMutex);
+			ui->setMode(esc::Screen::MODE_TYPE_GUI,newmode.id,newfb->fd(),true);
+		}
 
 		mode = newmode;
 		fb = newfb.release();
@@ -84,7 +93,10 @@ int WinList::setMode(int id) {
 		::printe("%s",e.what());
 		::print("Restoring old framebuffer and mode");
 		fb = new esc::FrameBuffer(mode,esc::Screen::MODE_TYPE_GUI);
-		ui->setMode(esc::Screen::MODE_TYPE_GUI,mode.id,fb->fd(),true);
+		{
+			std::lock_guard<std::mutex> uiguard(uiMutex);
+			ui->setMode(esc::Screen::MODE_TYPE_GUI,mode.id,fb->fd(),true);
+		}
 		/* we have to repaint everything */
 		for(auto w = windows.begin(); w != windows.end(); ++w)
 			update(&*w,gui::Rectangle(gui::Pos(0,0),w->getSize()));
@@ -473,14 +485,7 @@ void WinList::copyRegion(char *mem,const gui::Rectangle &r,gwinid_t id) {
 }
 
 void WinList::notifyUimng(const gui::Rectangle &r) {
-	gpos_t x = r.x();
-	gsize_t width = r.width();
-	if(x < 0) {
-		width += x;
-		x = 0;
-	}
-	ui->update(x,r.y(),esc::Util::min((gsize_t)mode.width - x,width),
-		esc::Util::min((gsize_t)mode.height - r.y(),r.height()));
+	Damage::get().add(r);
 }
 
 void WinList::print(esc::OStream &os) {
@@ -98,6 +98,7 @@ public:
 	 * @param cursor the cursor to use
 	 */
 	void setCursor(const gui::Pos &pos,uint cursor) {
+		std::lock_guard<std::mutex> guard(uiMutex);
 		ui->setCursor(pos.x,pos.y,cursor);
 	}
 
@@ -221,7 +222,8 @@ public:
 	}
 
 	/**
-	 * Notifies the UI-manager that the given rectangle has changed.
+	 * Notifies the UI-manager that the given rectangle has changed. The rectangle is added to the
+	 * damaged area of the current frame, which is flushed by the frame thread.
 	 *
 	 * @param r the rectangle
 	 */
@@ -281,4 +283,12 @@ private:
 	static std::mutex winMutex;
 	static gwinid_t nextId;
 	static WinList *_inst;
+
+public:
+	/**
+	 * Protects the esc::UI object, which is used by the main thread, the input thread and the
+	 * frame thread. Its IPCStream has only one buffer, so that the messages would get mixed up
+	 * otherwise. Only hold it for the UI call itself and don't acquire other locks meanwhile.
+	 */
+	static std::mutex uiMutex;
 };
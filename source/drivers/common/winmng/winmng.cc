@@ -18,6 +18,7 @@
  */
 
 #include <esc/ipc/clientdevice.h>
+#include <esc/ipc/filedev.h>
 #include <esc/proto/ui.h>
 #include <esc/proto/winmng.h>
 #include <sys/common.h>
@@ -33,6 +34,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "damage.h"
 #include "input.h"
 #include "listener.h"
 #include "preview.h"
@@ -161,7 +163,11 @@ public:
 		size_t n;
 		is >> n;
 
-		std::vector<Screen::Mode> modes = ui->getModes();
+		std::vector<Screen::Mode> modes;
+		{
+			std::lock_guard<std::mutex> guard(WinList::uiMutex);
+			modes = ui->getModes();
+		}
 		if(n == 0) {
 			size_t count = 0;
 			for(auto m = modes.begin(); m != modes.end(); ++m) {
@@ -209,14 +215,21 @@ public:
 	}
 
 	void getKeymap(IPCStream &is) {
-		std::string keymap = ui->getKeymap();
+		std::string keymap;
+		{
+			std::lock_guard<std::mutex> guard(WinList::uiMutex);
+			keymap = ui->getKeymap();
+		}
 		is << errcode_t(0) << CString(keymap.c_str(),keymap.length()) << Reply();
 	}
 
 	void setKeymap(IPCStream &is) {
 		CStringBuf<MAX_PATH_LEN> path;
 		is >> path;
-		ui->setKeymap(std::string(path.str()));
+		{
+			std::lock_guard<std::mutex> guard(WinList::uiMutex);
+			ui->setKeymap(std::string(path.str()));
+		}
 		is << errcode_t(0) << Reply();
 	}
 
@@ -264,13 +277,29 @@ public:
 	}
 };
 
+class FramesFileDevice : public FileDevice {
+public:
+	explicit FramesFileDevice(const char *path,mode_t mode) : FileDevice(path,mode) {
+	}
+
+	virtual std::string handleRead() {
+		OStringStream os;
+		Damage::get().print(os);
+		return os.str();
+	}
+};
+
 static WinMngEventDevice *evdev;
 static WinMngDevice *windev;
+static FramesFileDevice *framesdev;
 static volatile bool run = true;
 
 static void sighdl(int) {
 	evdev->stop();
 	windev->stop();
+	if(framesdev)
+		framesdev->stop();
+	Damage::get().stop();
 	run = false;
 	signal(SIGINT,sighdl);
 }
@@ -284,6 +313,23 @@ static int eventThread(void *) {
 	return 0;
 }
 
+static int frameThread(void *) {
+	if(signal(SIGINT,sighdl) == SIG_ERR)
+		error("Unable to set signal handler");
+
+	Damage::get().run();
+	return 0;
+}
+
+static int framesFileThread(void *) {
+	if(signal(SIGINT,sighdl) == SIG_ERR)
+		error("Unable to set signal handler");
+
+	framesdev = new FramesFileDevice("/sys/winmng-frames",0444);
+	framesdev->loop();
+	return 0;
+}
+
 static int inputThread(void *) {
 	if(signal(SIGINT,sighdl) == SIG_ERR)
 		error("Unable to set signal handler");
@@ -343,6 +389,7 @@ int main(int argc,char *argv[]) {
 	UIEvents *uiev = new UIEvents(*ui);
 
 	esc::Screen::Mode mode = ui->findGraphicsMode(atoi(argv[1]),atoi(argv[2]),DEF_BPP);
+	Damage::create(ui);
 	WinList::create(windev->id(),ui,mode.id);
 
 	/* start helper modules */
@@ -355,6 +402,10 @@ int main(int argc,char *argv[]) {
 		error("Unable to start input thread");
 	if(startthread(eventThread,&evdev) < 0)
 		error("Unable to start thread for the event-channel");
+	if(startthread(frameThread,NULL) < 0)
+		error("Unable to start frame thread");
+	if(startthread(framesFileThread,NULL) < 0)
+		error("Unable to start thread for the frame statistics");
 
 	windev->loop();
 
@@ -21,6 +21,7 @@
 #include <sys/common.h>
 #include <sys/debug.h>
 #include <sys/proc.h>
+#include <esc/util.h>
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,27 +32,48 @@
 
 static bool ata_setupCommand(sATADevice *device,uint64_t lba,size_t secCount,uint cmd);
 static uint ata_getCommand(sATADevice *device,uint op);
+static bool ata_isDMACommand(uint cmd);
+static void ata_setupPRDT(sATAController *ctrl,void *buffer,const uintptr_t *phys,size_t size);
 
-bool ata_readWrite(sATADevice *device,uint op,void *buffer,uint64_t lba,size_t secSize,
-		size_t secCount) {
+bool ata_readWrite(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,uint64_t lba,
+		size_t secSize,size_t secCount) {
 	uint cmd = ata_getCommand(device,op);
-	if(!ata_setupCommand(device,lba,secCount,cmd))
-		return false;
+	/* the PRDs need word-aligned addresses */
+	if((uintptr_t)buffer & 1)
+		phys = NULL;
+
+	size_t max = ata_maxSectors(device,cmd,phys != NULL,secSize);
+	size_t pageOff = (uintptr_t)buffer & (PAGE_SIZE - 1);
+	size_t done = 0;
+	while(done < secCount) {
+		size_t count = esc::Util::min(secCount - done,max);
+		void *buf = (char*)buffer + done * secSize;
+		const uintptr_t *bufPhys = phys ? phys + (pageOff + done * secSize) / PAGE_SIZE : NULL;
 
-	switch(cmd) {
-		case COMMAND_PACKET:
-		case COMMAND_READ_SEC:
-		case COMMAND_READ_SEC_EXT:
-		case COMMAND_WRITE_SEC:
-		case COMMAND_WRITE_SEC_EXT:
-			return ata_transferPIO(device,op,buffer,secSize,secCount,true);
-		case COMMAND_READ_DMA:
-		case COMMAND_READ_DMA_EXT:
-		case COMMAND_WRITE_DMA:
-		case COMMAND_WRITE_DMA_EXT:
-			return ata_transferDMA(device,op,buffer,secSize,secCount);
+		if(!ata_setupCommand(device,lba + done,count,cmd))
+			return false;
+
+		bool res = false;
+		switch(cmd) {
+			case COMMAND_PACKET:
+			case COMMAND_READ_SEC:
+			case COMMAND_READ_SEC_EXT:
+			case COMMAND_WRITE_SEC:
+			case COMMAND_WRITE_SEC_EXT:
+				res = ata_transferPIO(device,op,buf,secSize,count,true);
+				break;
+			case COMMAND_READ_DMA:
+			case COMMAND_READ_DMA_EXT:
+			case COMMAND_WRITE_DMA:
+			case COMMAND_WRITE_DMA_EXT:
+				res = ata_transferDMA(device,op,buf,bufPhys,secSize,count);
+				break;
+		}
+		if(!res)
+			return false;
+		done += count;
 	}
-	return false;
+	return true;
 }
 
 bool ata_transferPIO(sATADevice *device,uint op,void *buffer,size_t secSize,
@@ -90,16 +112,15 @@ bool ata_transferPIO(sATADevice *device,uint op,void *buffer,size_t secSize,
 	return true;
 }
 
-bool ata_transferDMA(sATADevice *device,uint op,void *buffer,size_t secSize,size_t secCount) {
+bool ata_transferDMA(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,size_t secSize,
+		size_t secCount) {
 	sATAController* ctrl = device->ctrl;
 	uint8_t status;
 	size_t size = secCount * secSize;
 	int res;
 
 	/* setup PRDT */
-	ctrl->dma_prdt_virt->buffer = (uint32_t)(uintptr_t)ctrl->dma_buf_phys;
-	ctrl->dma_prdt_virt->byteCount = size;
-	ctrl->dma_prdt_virt->last = 1;
+	ata_setupPRDT(ctrl,buffer,phys,size);
 
 	/* stop running transfers */
 	ATA_PR2("Stopping running transfers");
@@ -111,9 +132,8 @@ bool ata_transferDMA(sATADevice *device,uint op,void *buffer,size_t secSize,size
 	ATA_PR2("Setting PRDT");
 	ctrl_outbmrl(ctrl,BMR_REG_PRDT,reinterpret_cast<uintptr_t>(ctrl->dma_prdt_phys));
 
-	/* write data to buffer, if we should write */
-	/* TODO we should use the buffer directly when reading from the client */
-	if(op == OP_WRITE || op == OP_PACKET)
+	/* write data to the bounce buffer, if we should write */
+	if(phys == NULL && (op == OP_WRITE || op == OP_PACKET))
 		memcpy(ctrl->dma_buf_virt,buffer,size);
 
 	/* it seems to be necessary to read those ports here */
@@ -144,12 +164,44 @@ bool ata_transferDMA(sATADevice *device,uint op,void *buffer,size_t secSize,size
 
 	ctrl_inbmrb(ctrl,BMR_REG_STATUS);
 	ctrl_outbmrb(ctrl,BMR_REG_COMMAND,0);
-	/* copy data when reading */
-	if(op == OP_READ)
+	/* copy data from the bounce buffer when reading */
+	if(phys == NULL && op == OP_READ)
 		memcpy(buffer,ctrl->dma_buf_virt,size);
 	return true;
 }
 
+static void ata_setupPRDT(sATAController *ctrl,void *buffer,const uintptr_t *phys,size_t size) {
+	sPRD *prd = ctrl->dma_prdt_virt;
+	if(phys == NULL) {
+		prd->buffer = (uint32_t)(uintptr_t)ctrl->dma_buf_phys;
+		prd->byteCount = size;
+		prd->last = 1;
+		return;
+	}
+
+	/* build one PRD for each physically contiguous part of the buffer. a PRD may not cross a
+	 * 64K boundary, which also limits its size to 64K (a byteCount of 0 means 64K). */
+	size_t off = (uintptr_t)buffer & (PAGE_SIZE - 1);
+	size_t len = 0;
+	prd--;
+	for(; size > 0; phys++) {
+		uintptr_t addr = *phys + off;
+		size_t amount = esc::Util::min(size,PAGE_SIZE - off);
+		if(len > 0 && prd->buffer + len == addr && (addr & 0xFFFF) != 0)
+			len += amount;
+		else {
+			prd++;
+			prd->buffer = addr;
+			prd->last = 0;
+			len = amount;
+		}
+		prd->byteCount = len;
+		size -= amount;
+		off = 0;
+	}
+	prd->last = 1;
+}
+
 static bool ata_setupCommand(sATADevice *device,uint64_t lba,size_t secCount,uint cmd) {
 	sATAController *ctrl = device->ctrl;
 	uint8_t devValue;
@@ -220,6 +272,24 @@ static bool ata_setupCommand(sATADevice *device,uint64_t lba,size_t secCount,uin
 	return true;
 }
 
+static bool ata_isDMACommand(uint cmd) {
+	return cmd == COMMAND_READ_DMA || cmd == COMMAND_READ_DMA_EXT ||
+		cmd == COMMAND_WRITE_DMA || cmd == COMMAND_WRITE_DMA_EXT;
+}
+
+size_t ata_maxSectors(sATADevice *device,uint cmd,bool direct,size_t secSize) {
+	/* the sector-count register has 8 bits with LBA28 and 16 bits with LBA48. we don't use 0,
+	 * which would stand for 256 and 65536, respectively. */
+	size_t max = device->info.features.lba48 ? 0xFFFF : 0xFF;
+	if(ata_isDMACommand(cmd)) {
+		/* without bounce buffer, every page might need its own PRD, plus one for an unaligned
+		 * start of the buffer */
+		size_t bytes = direct ? (PRD_COUNT - 1) * PAGE_SIZE : DMA_BUF_SIZE;
+		max = esc::Util::min(max,bytes / secSize);
+	}
+	return max;
+}
+
 static uint ata_getCommand(sATADevice *device,uint op) {
 	static uint commands[4][2] = {
 		{COMMAND_READ_SEC,COMMAND_READ_SEC_EXT},
@@ -31,18 +31,21 @@
 #define ATA_LOG(fmt,...)	print(fmt,## __VA_ARGS__);
 
 /**
- * Reads or writes from/to an ATA-device
+ * Reads or writes from/to an ATA-device. Requests that exceed the limits of a single command are
+ * split into multiple commands.
  *
  * @param device the device
  * @param op the operation: OP_READ, OP_WRITE or OP_PACKET
  * @param buffer the buffer to write to
+ * @param phys the physical addresses of the pages of <buffer>, beginning with the page that
+ *  contains <buffer>, to use DMA directly (NULL = use the bounce buffer)
  * @param lba the block-address to start at
  * @param secSize the size of a sector
  * @param secCount number of sectors
  * @return true on success
  */
-bool ata_readWrite(sATADevice *device,uint op,void *buffer,uint64_t lba,size_t secSize,
-		size_t secCount);
+bool ata_readWrite(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,uint64_t lba,
+		size_t secSize,size_t secCount);
 
 /**
  * Performs a PIO-transfer
@@ -59,13 +62,29 @@ bool ata_transferPIO(sATADevice *device,uint op,void *buffer,size_t secSize,size
 		bool waitFirst);
 
 /**
- * Performs a DMA-transfer
+ * Determines the maximum number of sectors that can be transferred with one command, which is
+ * limited by the sector-count register and, for DMA, by the number of PRDs.
+ *
+ * @param device the device
+ * @param cmd the command (COMMAND_*)
+ * @param direct whether the transfer goes directly to the buffer, i.e., without bounce buffer
+ * @param secSize the size of a sector
+ * @return the number of sectors
+ */
+size_t ata_maxSectors(sATADevice *device,uint cmd,bool direct,size_t secSize);
+
+/**
+ * Performs a DMA-transfer. If <phys> is given, the device transfers the data from/to <buffer>
+ * directly. Otherwise, the bounce buffer of the controller is used, so that at most DMA_BUF_SIZE
+ * bytes can be transferred.
  *
  * @param device the device
  * @param op the operation: OP_READ, OP_WRITE or OP_PACKET
  * @param buffer the buffer to write to
+ * @param phys the physical addresses of the pages of <buffer> (NULL = use the bounce buffer)
  * @param secSize the size of a sector
  * @param secCount number of sectors
  * @return true if successfull
  */
-bool ata_transferDMA(sATADevice *device,uint op,void *buffer,size_t secSize,size_t secCount);
+bool ata_transferDMA(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,size_t secSize,
+		size_t secCount);
@@ -47,11 +47,13 @@ using namespace esc;
 
 class ATAPartitionDevice;
 
-static const size_t MAX_RW_SIZE		= 4096;
+static const size_t MAX_RW_SIZE		= DMA_BUF_SIZE;
 static const int RETRY_COUNT		= 3;
 
-static ulong handleRead(sATADevice *device,sPartition *part,uint16_t *buf,uint offset,uint count);
-static ulong handleWrite(sATADevice *device,sPartition *part,uint16_t *buf,uint offset,uint count);
+static ulong handleRead(sATADevice *device,sPartition *part,uint16_t *buf,const uintptr_t *phys,
+	uint offset,uint count);
+static ulong handleWrite(sATADevice *device,sPartition *part,uint16_t *buf,const uintptr_t *phys,
+	uint offset,uint count);
 static void initDrives(void);
 static void createVFSEntry(sATADevice *device,sPartition *part,const char *name);
 
@@ -62,7 +64,57 @@ static ATAPartitionDevice *devs[DEVICE_COUNT * PARTITION_COUNT];
  * may not have more memory and can't do anything about it */
 static uint16_t buffer[MAX_RW_SIZE / sizeof(uint16_t)];
 
-class ATAPartitionDevice : public ClientDevice<> {
+/**
+ * A client that knows the physical addresses of its shared memory, so that we can let the device
+ * transfer the data directly from/to it.
+ */
+class ATAClient : public Client {
+public:
+	explicit ATAClient(int f) : Client(f), _phys() {
+	}
+	virtual ~ATAClient() {
+		free(_phys);
+	}
+
+	/**
+	 * @return the physical addresses of all pages of the shared memory or NULL if unknown
+	 */
+	const uintptr_t *phys() const {
+		return _phys;
+	}
+
+	/**
+	 * Determines the physical addresses of the shared memory. This requires that it is locked.
+	 */
+	void initPhys() {
+		size_t pages = (sharedmem()->size + PAGE_SIZE - 1) / PAGE_SIZE;
+		_phys = (uintptr_t*)malloc(pages * sizeof(uintptr_t));
+		if(_phys == NULL)
+			return;
+
+		bool usable = virt2phys(shm(),pages,_phys) == 0;
+		/* the PRDs can only address the first 4G */
+		for(size_t i = 0; usable && i < pages; ++i)
+			usable = ((uint64_t)_phys[i] >> 32) == 0;
+		if(!usable) {
+			free(_phys);
+			_phys = NULL;
+		}
+	}
+
+	/**
+	 * @return true if <count> bytes at <offset> are within the shared memory
+	 */
+	bool inShm(size_t offset,size_t count) const {
+		size_t size = sharedmem()->size;
+		return offset <= size && count <= size - offset;
+	}
+
+private:
+	uintptr_t *_phys;
+};
+
+class ATAPartitionDevice : public ClientDevice<ATAClient> {
 public:
 	explicit ATAPartitionDevice(uint dev,uint part,const char *name,mode_t mode)
 		: ClientDevice(name,mode,DEV_TYPE_BLOCK,
@@ -79,7 +131,7 @@ public:
 	}
 
 	void delegate(IPCStream &is) {
-		Client *c = (*this)[is.fd()];
+		ATAClient *c = (*this)[is.fd()];
 		DevDelegate::Request r;
 		is >> r;
 		assert(c->shm() == NULL && !is.error());
@@ -89,8 +141,12 @@ public:
 		 * MAP_NOSWAP to let it fail if there is not enough memory instead of starting
 		 * to swap (which would cause a deadlock, because we're doing that). */
 		int res = -EINVAL;
-		if(r.arg == DEL_ARG_SHFILE)
+		if(r.arg == DEL_ARG_SHFILE) {
 			res = joinshm(c,r.nfd,MAP_POPULATE | MAP_NOSWAP | MAP_LOCKED);
+			/* since it's locked, the physical memory can't change and we can use it for DMA */
+			if(res == 0)
+				c->initPhys();
+		}
 		is << DevDelegate::Response(res) << Reply();
 	}
 
@@ -99,8 +155,18 @@ public:
 		is >> r;
 		assert(!is.error());
 
-		uint16_t *buf = r.shmemoff == -1 ? buffer : (uint16_t*)(*this)[is.fd()]->shm() + (r.shmemoff >> 1);
-		size_t res = handleRead(_ataDev,_part,buf,r.offset,r.count);
+		uint16_t *buf = buffer;
+		const uintptr_t *phys = NULL;
+		if(r.shmemoff != -1) {
+			ATAClient *c = (*this)[is.fd()];
+			if(!c->shm() || !c->inShm(r.shmemoff,roundCount(r.count))) {
+				is << FileRead::Response::error(-EINVAL) << Reply();
+				return;
+			}
+			buf = (uint16_t*)(c->shm() + r.shmemoff);
+			phys = c->phys() ? c->phys() + r.shmemoff / PAGE_SIZE : NULL;
+		}
+		size_t res = handleRead(_ataDev,_part,buf,phys,r.offset,r.count);
 
 		is << FileRead::Response::success(res) << Reply();
 		if(r.shmemoff == -1 && res > 0)
@@ -114,8 +180,18 @@ public:
 			is >> ReceiveData(buffer,sizeof(buffer));
 		assert(!is.error());
 
-		uint16_t *buf = r.shmemoff == -1 ? buffer : (uint16_t*)(*this)[is.fd()]->shm() + (r.shmemoff >> 1);
-		size_t res = handleWrite(_ataDev,_part,buf,r.offset,r.count);
+		uint16_t *buf = buffer;
+		const uintptr_t *phys = NULL;
+		if(r.shmemoff != -1) {
+			ATAClient *c = (*this)[is.fd()];
+			if(!c->shm() || !c->inShm(r.shmemoff,r.count)) {
+				is << FileWrite::Response::error(-EINVAL) << Reply();
+				return;
+			}
+			buf = (uint16_t*)(c->shm() + r.shmemoff);
+			phys = c->phys() ? c->phys() + r.shmemoff / PAGE_SIZE : NULL;
+		}
+		size_t res = handleWrite(_ataDev,_part,buf,phys,r.offset,r.count);
 
 		is << FileWrite::Response::success(res) << Reply();
 	}
@@ -125,6 +201,10 @@ public:
 	}
 
 private:
+	size_t roundCount(size_t count) const {
+		return esc::Util::round_up(count,_ataDev->secSize);
+	}
+
 	sATADevice *_ataDev;
 	sPartition *_part;
 };
@@ -190,7 +270,8 @@ int main(int argc,char **argv) {
 	return EXIT_SUCCESS;
 }
 
-static ulong handleRead(sATADevice *ataDev,sPartition *part,uint16_t *buf,uint offset,uint count) {
+static ulong handleRead(sATADevice *ataDev,sPartition *part,uint16_t *buf,const uintptr_t *phys,
+		uint offset,uint count) {
 	/* we have to check whether it is at least one sector. otherwise ATA can't
 	 * handle the request */
 	if(offset + count <= part->size * ataDev->secSize && offset + count > offset) {
@@ -202,7 +283,7 @@ static ulong handleRead(sATADevice *ataDev,sPartition *part,uint16_t *buf,uint o
 			for(i = 0; i < RETRY_COUNT; i++) {
 				if(i > 0)
 					ATA_LOG("Read failed; retry %d",i);
-				if(ataDev->rwHandler(ataDev,OP_READ,buf,
+				if(ataDev->rwHandler(ataDev,OP_READ,buf,phys,
 						offset / ataDev->secSize + part->start,
 						ataDev->secSize,rcount / ataDev->secSize)) {
 					return count;
@@ -217,7 +298,8 @@ static ulong handleRead(sATADevice *ataDev,sPartition *part,uint16_t *buf,uint o
 	return 0;
 }
 
-static ulong handleWrite(sATADevice *ataDev,sPartition *part,uint16_t *buf,uint offset,uint count) {
+static ulong handleWrite(sATADevice *ataDev,sPartition *part,uint16_t *buf,const uintptr_t *phys,
+		uint offset,uint count) {
 	if(offset + count <= part->size * ataDev->secSize && offset + count > offset) {
 		if(buf != buffer || count <= MAX_RW_SIZE) {
 			int i;
@@ -225,7 +307,7 @@ static ulong handleWrite(sATADevice *ataDev,sPartition *part,uint16_t *buf,uint
 			for(i = 0; i < RETRY_COUNT; i++) {
 				if(i > 0)
 					ATA_LOG("Write failed; retry %d",i);
-				if(ataDev->rwHandler(ataDev,OP_WRITE,buf,
+				if(ataDev->rwHandler(ataDev,OP_WRITE,buf,phys,
 						offset / ataDev->secSize + part->start,
 						ataDev->secSize,count / ataDev->secSize)) {
 					return count;
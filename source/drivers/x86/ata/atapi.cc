@@ -20,13 +20,15 @@
 #include <sys/arch/x86/ports.h>
 #include <sys/common.h>
 #include <sys/proc.h>
+#include <esc/util.h>
 
 #include "ata.h"
 #include "atapi.h"
 #include "controller.h"
 #include "device.h"
 
-static bool atapi_request(sATADevice *device,uint8_t *cmd,void *buffer,size_t bufSize);
+static bool atapi_request(sATADevice *device,uint8_t *cmd,void *buffer,const uintptr_t *phys,
+		size_t bufSize);
 
 void atapi_softReset(sATADevice *device) {
 	int i = 1000000;
@@ -42,54 +44,78 @@ void atapi_softReset(sATADevice *device) {
 	ctrl_wait(device->ctrl);
 }
 
-bool atapi_read(sATADevice *device,uint op,void *buffer,uint64_t lba,A_UNUSED size_t secSize,
-		size_t secCount) {
-	uint8_t cmd[] = {SCSI_CMD_READ_SECTORS_EXT,0,0,0,0,0,0,0,0,0,0,0};
-	if(!device->info.features.lba48)
-		cmd[0] = SCSI_CMD_READ_SECTORS;
+bool atapi_read(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,uint64_t lba,
+		A_UNUSED size_t secSize,size_t secCount) {
 	/* no writing here ;) */
 	if(op != OP_READ)
 		return false;
 	if(secCount == 0)
 		return false;
-	if(cmd[0] == SCSI_CMD_READ_SECTORS_EXT) {
-		cmd[6] = (secCount >> 24) & 0xFF;
-		cmd[7] = (secCount >> 16) & 0xFF;
-		cmd[8] = (secCount >> 8) & 0xFF;
-		cmd[9] = (secCount >> 0) & 0xFF;
-	}
-	else {
-		cmd[7] = (secCount >> 8) & 0xFF;
-		cmd[8] = (secCount >> 0) & 0xFF;
+	/* the PRDs need word-aligned addresses */
+	if((uintptr_t)buffer & 1)
+		phys = NULL;
+
+	/* split the request like ata_readWrite does, so that the PRDT is large enough. READ(10) has
+	 * only a 16-bit sector count */
+	size_t max = device->info.features.lba48 ? secCount : 0xFFFF;
+	if(device->ctrl->useDma && device->info.capabilities.DMA)
+		max = esc::Util::min(max,ata_maxSectors(device,COMMAND_READ_DMA,phys != NULL,device->secSize));
+	size_t pageOff = (uintptr_t)buffer & (PAGE_SIZE - 1);
+	size_t done = 0;
+	while(done < secCount) {
+		size_t count = esc::Util::min(secCount - done,max);
+		void *buf = (char*)buffer + done * device->secSize;
+		const uintptr_t *bufPhys = phys ? phys + (pageOff + done * device->secSize) / PAGE_SIZE : NULL;
+		uint64_t start = lba + done;
+
+		uint8_t cmd[] = {SCSI_CMD_READ_SECTORS_EXT,0,0,0,0,0,0,0,0,0,0,0};
+		if(!device->info.features.lba48)
+			cmd[0] = SCSI_CMD_READ_SECTORS;
+		if(cmd[0] == SCSI_CMD_READ_SECTORS_EXT) {
+			cmd[6] = (count >> 24) & 0xFF;
+			cmd[7] = (count >> 16) & 0xFF;
+			cmd[8] = (count >> 8) & 0xFF;
+			cmd[9] = (count >> 0) & 0xFF;
+		}
+		else {
+			cmd[7] = (count >> 8) & 0xFF;
+			cmd[8] = (count >> 0) & 0xFF;
+		}
+		cmd[2] = (start >> 24) & 0xFF;
+		cmd[3] = (start >> 16) & 0xFF;
+		cmd[4] = (start >> 8) & 0xFF;
+		cmd[5] = (start >> 0) & 0xFF;
+		if(!atapi_request(device,cmd,buf,bufPhys,count * device->secSize))
+			return false;
+		done += count;
 	}
-	cmd[2] = (lba >> 24) & 0xFF;
-	cmd[3] = (lba >> 16) & 0xFF;
-	cmd[4] = (lba >> 8) & 0xFF;
-	cmd[5] = (lba >> 0) & 0xFF;
-	return atapi_request(device,cmd,buffer,secCount * device->secSize);
+	return true;
 }
 
 size_t atapi_getCapacity(sATADevice *device) {
 	uint8_t resp[8];
 	uint8_t cmd[] = {SCSI_CMD_READ_CAPACITY,0,0,0,0,0,0,0,0,0,0,0};
-	bool res = atapi_request(device,cmd,resp,8);
+	bool res = atapi_request(device,cmd,resp,NULL,8);
 	if(!res)
 		return 0;
 	return (resp[0] << 24) | (resp[1] << 16) | (resp[2] << 8) | (resp[3] << 0);
 }
 
-static bool atapi_request(sATADevice *device,uint8_t *cmd,void *buffer,size_t bufSize) {
+static bool atapi_request(sATADevice *device,uint8_t *cmd,void *buffer,const uintptr_t *phys,
+		size_t bufSize) {
 	int res;
 	size_t size;
 	sATAController *ctrl = device->ctrl;
 
 	/* send PACKET command to drive */
-	if(!ata_readWrite(device,OP_PACKET,cmd,0xFFFF00,12,1))
+	if(!ata_readWrite(device,OP_PACKET,cmd,NULL,0xFFFF00,12,1))
 		return false;
 
 	/* now transfer the data */
-	if(ctrl->useDma && device->info.capabilities.DMA)
-		return ata_transferDMA(device,OP_READ,buffer,device->secSize,bufSize / device->secSize);
+	if(ctrl->useDma && device->info.capabilities.DMA) {
+		return ata_transferDMA(device,OP_READ,buffer,phys,device->secSize,
+			bufSize / device->secSize);
+	}
 
 	/* ok, no DMA, so wait first until the drive is ready */
 	res = ctrl_waitUntil(ctrl,ATAPI_TRANSFER_TIMEOUT,ATAPI_TRANSFER_SLEEPTIME,
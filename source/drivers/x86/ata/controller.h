@@ -57,6 +57,9 @@ static const size_t DEVICE_COUNT	= 4;
 
 static const int CTRL_IRQ_BASE		= 14;
 
+/* the size of the bounce buffer for DMA */
+static const size_t DMA_BUF_SIZE	= 64 * 1024;
+
 /**
  * Inits the controllers
  *
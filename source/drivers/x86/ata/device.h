@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <sys/arch.h>
 #include <sys/common.h>
 #include <sys/irq.h>
 
@@ -285,8 +286,8 @@ typedef struct {
 
 typedef struct sATAController sATAController;
 typedef struct sATADevice sATADevice;
-typedef bool (*fReadWrite)(sATADevice *device,uint op,void *buffer,uint64_t lba,size_t secSize,
-		size_t secCount);
+typedef bool (*fReadWrite)(sATADevice *device,uint op,void *buffer,const uintptr_t *phys,
+		uint64_t lba,size_t secSize,size_t secCount);
 
 struct sATADevice {
 	/* the identifier; 0-3; bit0 set means slave */
@@ -315,6 +316,9 @@ typedef struct {
 	uint16_t last : 1;
 } A_PACKED sPRD;
 
+/* the PRDT occupies one page */
+static const size_t PRD_COUNT		= PAGE_SIZE / sizeof(sPRD);
+
 /* the controller is declared here, because otherwise device.h needs controller.h and the other way
  * around */
 struct sATAController {
@@ -327,8 +331,10 @@ struct sATAController {
 	uint16_t bmrBase;
 	int irq;
 	int irqsem;
+	/* the PRDT with PRD_COUNT entries */
 	sPRD *dma_prdt_phys;
 	sPRD *dma_prdt_virt;
+	/* the bounce buffer for transfers that can't be done directly */
 	void *dma_buf_phys;
 	void *dma_buf_virt;
 	sATADevice devices[2];
@@ -0,0 +1,474 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <impl/hashtable/hashtableiterator.h>
+#include <bits/c++config.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+namespace std {
+	/**
+	 * Gets the key of the elements of unordered_map
+	 */
+	template<class Pair>
+	struct hashtable_first {
+		const typename Pair::first_type &operator()(const Pair &p) const {
+			return p.first;
+		}
+	};
+	/**
+	 * Gets the key of the elements of unordered_set
+	 */
+	template<class Key>
+	struct hashtable_identity {
+		const Key &operator()(const Key &k) const {
+			return k;
+		}
+	};
+
+	/**
+	 * An open-addressing hashtable with linear probing, which is used for the implementation of
+	 * unordered_map and unordered_set. The elements are stored in a single array of slots.
+	 * Additionally, there is an array with one control byte per slot, which stores whether the
+	 * slot is empty, deleted or used. For used slots, it holds 7 bits of the hash, so that we
+	 * only have to compare keys if these bits match. Thus, a lookup usually touches one or two
+	 * cachelines of control bytes and a single slot.
+	 *
+	 * Erased elements leave a tombstone behind, so that erase keeps iterators to all other
+	 * elements valid. Inserts invalidate all iterators, if the table needs to be rehashed.
+	 * The slots are raw memory and the elements are only constructed in used slots. Thus, Value
+	 * needs neither a default-constructor nor an assignment-operator (e.g., pair<const Key,T>).
+	 *
+	 * @param Key the key type
+	 * @param Value the stored type (the key for sets, the pair of key and value for maps)
+	 * @param KeyOf the functor to get the key of a Value
+	 * @param Hash the hash functor
+	 * @param Pred the functor that tests two keys for equality
+	 */
+	template<class Key,class Value,class KeyOf,class Hash,class Pred>
+	class hashtable {
+		static const size_t MIN_BUCKETS		= 8;
+
+	public:
+		typedef Key key_type;
+		typedef Value value_type;
+		typedef Hash hasher;
+		typedef Pred key_equal;
+		typedef hashtable_iterator<Value> iterator;
+		typedef const_hashtable_iterator<Value> const_iterator;
+		typedef size_t size_type;
+		typedef long difference_type;
+
+		/**
+		 * Creates an empty table with at least <n> buckets
+		 */
+		explicit hashtable(size_type n,const Hash &hf,const Pred &eql)
+			: _hash(hf), _eq(eql), _count(0), _deleted(0), _buckets(0), _shift(0), _growAt(0),
+			  _maxLoad(0.75f), _ctrl(empty_ctrl()), _slots(nullptr) {
+			if(n > 0)
+				rehash(n);
+		}
+		/**
+		 * Copy-constructor
+		 */
+		hashtable(const hashtable &h)
+			: _hash(h._hash), _eq(h._eq), _count(0), _deleted(0), _buckets(0), _shift(0),
+			  _growAt(0), _maxLoad(h._maxLoad), _ctrl(empty_ctrl()), _slots(nullptr) {
+			copy_from(h);
+		}
+		/**
+		 * Move-constructor
+		 */
+		hashtable(hashtable &&h)
+			: _hash(h._hash), _eq(h._eq), _count(0), _deleted(0), _buckets(0), _shift(0),
+			  _growAt(0), _maxLoad(h._maxLoad), _ctrl(empty_ctrl()), _slots(nullptr) {
+			swap(h);
+		}
+		/**
+		 * Assignment-operator
+		 */
+		hashtable &operator =(const hashtable &h) {
+			if(&h != this) {
+				destroy();
+				_hash = h._hash;
+				_eq = h._eq;
+				_maxLoad = h._maxLoad;
+				copy_from(h);
+			}
+			return *this;
+		}
+		/**
+		 * Destructor
+		 */
+		~hashtable() {
+			destroy();
+		}
+
+		iterator begin() {
+			size_type i = first_used(0);
+			return iterator(_ctrl + i,_slots + i);
+		}
+		const_iterator begin() const {
+			size_type i = first_used(0);
+			return const_iterator(_ctrl + i,_slots + i);
+		}
+		iterator end() {
+			return iterator(_ctrl + _buckets,_slots + _buckets);
+		}
+		const_iterator end() const {
+			return const_iterator(_ctrl + _buckets,_slots + _buckets);
+		}
+
+		bool empty() const {
+			return _count == 0;
+		}
+		size_type size() const {
+			return _count;
+		}
+		size_type max_size() const {
+			return numeric_limits<size_type>::max() / sizeof(Value);
+		}
+
+		hasher hash_function() const {
+			return _hash;
+		}
+		key_equal key_eq() const {
+			return _eq;
+		}
+
+		/**
+		 * @return the number of slots
+		 */
+		size_type bucket_count() const {
+			return _buckets;
+		}
+		/**
+		 * @return the current ratio of elements and slots
+		 */
+		float load_factor() const {
+			return _buckets ? static_cast<float>(_count) / _buckets : 0;
+		}
+		/**
+		 * @return the ratio of elements and slots at which the table grows
+		 */
+		float max_load_factor() const {
+			return _maxLoad;
+		}
+		/**
+		 * Sets the ratio of elements and slots at which the table grows. Since we need at least
+		 * one empty slot, the value is limited to 0.95.
+		 */
+		void max_load_factor(float z) {
+			_maxLoad = std::max(0.1f,std::min(z,0.95f));
+			_growAt = grow_limit(_buckets);
+		}
+		/**
+		 * Resizes the table to at least <n> slots, but at least to the number of slots required
+		 * for the current elements. This removes all tombstones.
+		 */
+		void rehash(size_type n) {
+			n = std::max(n,static_cast<size_type>(_count / _maxLoad) + 1);
+			size_type buckets = MIN_BUCKETS;
+			while(buckets < n)
+				buckets *= 2;
+			resize(buckets);
+		}
+		/**
+		 * Reserves space for at least <n> elements without rehashing.
+		 */
+		void reserve(size_type n) {
+			if(n > _growAt)
+				rehash(static_cast<size_type>(n / _maxLoad) + 1);
+		}
+
+		/**
+		 * Searches for the given key
+		 *
+		 * @param k the key
+		 * @return the iterator for the element or end()
+		 */
+		iterator find(const Key &k) {
+			size_type i = find_slot(k);
+			return iterator(_ctrl + i,_slots + i);
+		}
+		const_iterator find(const Key &k) const {
+			size_type i = find_slot(k);
+			return const_iterator(_ctrl + i,_slots + i);
+		}
+
+		/**
+		 * Inserts <v>, if there is no element with the same key yet.
+		 *
+		 * @param v the value
+		 * @return the iterator for the element with that key and whether it has been inserted
+		 */
+		pair<iterator,bool> insert(const Value &v) {
+			const Key &k = KeyOf()(v);
+			if(_count + _deleted >= _growAt) {
+				// check that it's not present yet, so that we don't grow unnecessarily
+				size_type i = find_slot(k);
+				if(i != _buckets)
+					return make_pair(iterator(_ctrl + i,_slots + i),false);
+				grow();
+			}
+
+			size_t h = hash(k);
+			uint8_t tag = tag_of(h);
+			size_type mask = _buckets - 1;
+			size_type i = h >> _shift;
+			size_type free = _buckets;
+			while(_ctrl[i] != HT_EMPTY) {
+				if(_ctrl[i] == tag && _eq(KeyOf()(_slots[i]),k))
+					return make_pair(iterator(_ctrl + i,_slots + i),false);
+				// remember the first tombstone to reuse it
+				if(_ctrl[i] == HT_DELETED && free == _buckets)
+					free = i;
+				i = (i + 1) & mask;
+			}
+
+			if(free != _buckets) {
+				i = free;
+				_deleted--;
+			}
+			_ctrl[i] = tag;
+			new (_slots + i) Value(v);
+			_count++;
+			return make_pair(iterator(_ctrl + i,_slots + i),true);
+		}
+
+		/**
+		 * Removes the element at <it>
+		 *
+		 * @param it the position
+		 * @return the iterator for the next element
+		 */
+		iterator erase(const_iterator it) {
+			size_type i = it._slot - _slots;
+			clear_slot(i);
+			iterator next(_ctrl + i,_slots + i);
+			return ++next;
+		}
+		/**
+		 * Removes the elements in the range [<first> .. <last>)
+		 *
+		 * @param first the beginning (inclusive)
+		 * @param last the end (exclusive)
+		 * @return the iterator for <last>
+		 */
+		iterator erase(const_iterator first,const_iterator last) {
+			while(first != last)
+				erase(first++);
+			size_type i = last._slot - _slots;
+			return iterator(_ctrl + i,_slots + i);
+		}
+		/**
+		 * Removes the element with key <k>
+		 *
+		 * @param k the key
+		 * @return the number of removed elements
+		 */
+		size_type erase(const Key &k) {
+			size_type i = find_slot(k);
+			if(i == _buckets)
+				return 0;
+			clear_slot(i);
+			return 1;
+		}
+
+		/**
+		 * Removes all elements, but keeps the slots
+		 */
+		void clear() {
+			destroy_all();
+			if(_buckets)
+				memset(_ctrl,HT_EMPTY,_buckets);
+			_count = 0;
+			_deleted = 0;
+		}
+
+		void swap(hashtable &h) {
+			std::swap(_hash,h._hash);
+			std::swap(_eq,h._eq);
+			std::swap(_count,h._count);
+			std::swap(_deleted,h._deleted);
+			std::swap(_buckets,h._buckets);
+			std::swap(_shift,h._shift);
+			std::swap(_growAt,h._growAt);
+			std::swap(_maxLoad,h._maxLoad);
+			std::swap(_ctrl,h._ctrl);
+			std::swap(_slots,h._slots);
+		}
+
+	private:
+		static uint8_t *empty_ctrl() {
+			// all empty tables share the sentinel so that begin() == end() without allocations
+			static uint8_t sentinel = HT_SENTINEL;
+			return &sentinel;
+		}
+
+		/**
+		 * Scrambles the hash with Fibonacci hashing. Only the upper bits of the product are well
+		 * mixed, so that the slot index is taken from the upper bits and the tag from the 7 bits
+		 * below them (see tag_of).
+		 */
+		size_t hash(const Key &k) const {
+			size_t h = _hash(k);
+			if(sizeof(size_t) == 8)
+				return h * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+			return h * static_cast<size_t>(0x9E3779B9UL);
+		}
+		/**
+		 * @return the tag for the control byte, i.e. the 7 bits of <h> below the slot index
+		 */
+		uint8_t tag_of(size_t h) const {
+			// only for huge tables there are less than 7 bits left below the index
+			return (h >> (_shift > 7 ? _shift - 7 : 0)) & 0x7F;
+		}
+		size_type grow_limit(size_type buckets) const {
+			// keep at least one slot empty to terminate the probing
+			return std::min(static_cast<size_type>(buckets * _maxLoad),buckets - 1);
+		}
+		size_type first_used(size_type i) const {
+			while(i < _buckets && (_ctrl[i] & HT_EMPTY))
+				i++;
+			return i;
+		}
+
+		size_type find_slot(const Key &k) const {
+			if(_count == 0)
+				return _buckets;
+
+			size_t h = hash(k);
+			uint8_t tag = tag_of(h);
+			size_type mask = _buckets - 1;
+			size_type i = h >> _shift;
+			while(_ctrl[i] != HT_EMPTY) {
+				if(_ctrl[i] == tag && _eq(KeyOf()(_slots[i]),k))
+					return i;
+				i = (i + 1) & mask;
+			}
+			return _buckets;
+		}
+		void clear_slot(size_type i) {
+			// if the next slot is empty, no probe sequence continues behind this slot
+			if(_ctrl[(i + 1) & (_buckets - 1)] == HT_EMPTY)
+				_ctrl[i] = HT_EMPTY;
+			else {
+				_ctrl[i] = HT_DELETED;
+				_deleted++;
+			}
+			_slots[i].~Value();
+			_count--;
+		}
+
+		void grow() {
+			// if many slots are tombstones, get rid of them instead of growing the table
+			if(_buckets == 0)
+				resize(MIN_BUCKETS);
+			else if(_deleted > _count / 2)
+				resize(_buckets);
+			else
+				resize(_buckets * 2);
+		}
+		void resize(size_type buckets) {
+			uint8_t *oldCtrl = _ctrl;
+			Value *oldSlots = _slots;
+			size_type oldBuckets = _buckets;
+
+			_ctrl = new uint8_t[buckets + 1];
+			memset(_ctrl,HT_EMPTY,buckets);
+			_ctrl[buckets] = HT_SENTINEL;
+			_slots = static_cast<Value*>(::operator new(buckets * sizeof(Value)));
+			_buckets = buckets;
+			_shift = sizeof(size_t) * 8;
+			for(size_type b = buckets; b > 1; b >>= 1)
+				_shift--;
+			_growAt = grow_limit(buckets);
+			_deleted = 0;
+
+			// move all elements to their new position; they are all different
+			size_type mask = buckets - 1;
+			for(size_type j = 0; j < oldBuckets; ++j) {
+				if(oldCtrl[j] & HT_EMPTY)
+					continue;
+
+				size_t h = hash(KeyOf()(oldSlots[j]));
+				size_type i = h >> _shift;
+				while(_ctrl[i] != HT_EMPTY)
+					i = (i + 1) & mask;
+				_ctrl[i] = tag_of(h);
+				new (_slots + i) Value(move(oldSlots[j]));
+				oldSlots[j].~Value();
+			}
+
+			if(oldSlots) {
+				delete[] oldCtrl;
+				::operator delete(oldSlots);
+			}
+		}
+
+		void copy_from(const hashtable &h) {
+			if(h._count > 0) {
+				rehash(static_cast<size_type>(h._count / _maxLoad) + 1);
+				for(const_iterator it = h.begin(); it != h.end(); ++it)
+					insert(*it);
+			}
+		}
+		void destroy_all() {
+			for(size_type i = 0; i < _buckets; ++i) {
+				if(!(_ctrl[i] & HT_EMPTY))
+					_slots[i].~Value();
+			}
+		}
+		void destroy() {
+			if(_slots) {
+				destroy_all();
+				delete[] _ctrl;
+				::operator delete(_slots);
+			}
+			_ctrl = empty_ctrl();
+			_slots = nullptr;
+			_buckets = 0;
+			_shift = 0;
+			_growAt = 0;
+			_count = 0;
+			_deleted = 0;
+		}
+
+		Hash _hash;
+		Pred _eq;
+		size_type _count;
+		size_type _deleted;
+		size_type _buckets;
+		size_type _shift;
+		size_type _growAt;
+		float _maxLoad;
+		uint8_t *_ctrl;
+		Value *_slots;
+	};
+}
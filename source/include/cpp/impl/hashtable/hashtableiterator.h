@@ -0,0 +1,135 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <stdint.h>
+
+namespace std {
+	template<class Key,class Value,class KeyOf,class Hash,class Pred>
+	class hashtable;
+
+	/**
+	 * The control bytes of the hashtable slots. Used slots store 7 bits of the hash, i.e., the
+	 * highest bit is clear. The sentinel behind the last slot stops iterators.
+	 */
+	enum {
+		HT_EMPTY		= 0x80,
+		HT_DELETED		= 0xFE,
+		HT_SENTINEL		= 0xFF,
+	};
+
+	template<class Value>
+	class hashtable_iterator : public iterator<forward_iterator_tag,Value> {
+		template<class Key,class Value1,class KeyOf,class Hash,class Pred>
+		friend class hashtable;
+		template<class Value1>
+		friend class const_hashtable_iterator;
+	public:
+		hashtable_iterator()
+			: _ctrl(nullptr), _slot(nullptr) {
+		}
+		hashtable_iterator(const uint8_t *ctrl,Value *slot)
+			: _ctrl(ctrl), _slot(slot) {
+		}
+		~hashtable_iterator() {
+		}
+
+		Value& operator *() const {
+			return *_slot;
+		}
+		Value* operator ->() const {
+			return _slot;
+		}
+		hashtable_iterator& operator ++() {
+			// skip unused slots; the sentinel is not "unused"
+			do {
+				_ctrl++;
+				_slot++;
+			}
+			while((*_ctrl & HT_EMPTY) && *_ctrl != HT_SENTINEL);
+			return *this;
+		}
+		hashtable_iterator operator ++(int) {
+			hashtable_iterator<Value> tmp(*this);
+			operator++();
+			return tmp;
+		}
+		bool operator ==(const hashtable_iterator<Value>& rhs) const {
+			return _slot == rhs._slot;
+		}
+		bool operator !=(const hashtable_iterator<Value>& rhs) const {
+			return _slot != rhs._slot;
+		}
+
+	private:
+		const uint8_t *_ctrl;
+		Value *_slot;
+	};
+
+	// === const-iterator ===
+	template<class Value>
+	class const_hashtable_iterator : public iterator<forward_iterator_tag,Value> {
+		template<class Key,class Value1,class KeyOf,class Hash,class Pred>
+		friend class hashtable;
+	public:
+		const_hashtable_iterator()
+			: _ctrl(nullptr), _slot(nullptr) {
+		}
+		const_hashtable_iterator(const uint8_t *ctrl,const Value *slot)
+			: _ctrl(ctrl), _slot(slot) {
+		}
+		const_hashtable_iterator(const hashtable_iterator<Value> &it)
+			: _ctrl(it._ctrl), _slot(it._slot) {
+		}
+		~const_hashtable_iterator() {
+		}
+
+		const Value& operator *() const {
+			return *_slot;
+		}
+		const Value* operator ->() const {
+			return _slot;
+		}
+		const_hashtable_iterator& operator ++() {
+			do {
+				_ctrl++;
+				_slot++;
+			}
+			while((*_ctrl & HT_EMPTY) && *_ctrl != HT_SENTINEL);
+			return *this;
+		}
+		const_hashtable_iterator operator ++(int) {
+			const_hashtable_iterator<Value> tmp(*this);
+			operator++();
+			return tmp;
+		}
+		bool operator ==(const const_hashtable_iterator<Value>& rhs) const {
+			return _slot == rhs._slot;
+		}
+		bool operator !=(const const_hashtable_iterator<Value>& rhs) const {
+			return _slot != rhs._slot;
+		}
+
+	private:
+		const uint8_t *_ctrl;
+		const Value *_slot;
+	};
+}
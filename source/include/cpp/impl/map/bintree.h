@@ -29,7 +29,7 @@
 #include <stddef.h>
 #include <utility>
 
-// Note: algorithms are based on http://en.wikipedia.org/wiki/Binary_search_tree
+// Note: algorithms are based on http://en.wikipedia.org/wiki/Red%E2%80%93black_tree
 
 namespace std {
 	template<class Key,class T,class Cmp>
@@ -40,8 +40,9 @@ namespace std {
 	class const_bintree_iterator;
 
 	/**
-	 * A binary search tree with sorted keys (defined by the compare-object). This is used for
-	 * the map-implementation.
+	 * A red-black tree with sorted keys (defined by the compare-object). This is used for the
+	 * map-implementation. Additionally, all nodes are kept in a doubly linked list in ascending
+	 * order, which is used for iteration.
 	 */
 	template<class Key,class T,class Cmp = less<Key> >
 	class bintree {
@@ -97,7 +98,7 @@ namespace std {
 			_head.next(&_foot);
 			_foot.prev(&_head);
 			for(const_iterator it = c.begin(); it != c.end(); ++it)
-				insert(it->first,it->second);
+				insert(end(),it->first,it->second);
 		}
 		/**
 		 * Assignment-operator
@@ -106,7 +107,7 @@ namespace std {
 			clear();
 			_cmp = c._cmp;
 			for(const_iterator it = c.begin(); it != c.end(); ++it)
-				insert(it->first,it->second);
+				insert(end(),it->first,it->second);
 			return *this;
 		}
 		/**
@@ -209,15 +210,37 @@ namespace std {
 		 * @return a iterator, pointing to the inserted element
 		 */
 		iterator insert(const Key& k,const T& v,bool replace = true) {
-			return do_insert(_head.right(),k,v,replace);
+			bintree_node<Key,T,Cmp>* node = _head.right();
+			bintree_node<Key,T,Cmp>* parent = nullptr;
+			bool left = false;
+			while(node != nullptr) {
+				parent = node;
+				// less?
+				if(_cmp(k,node->key())) {
+					left = true;
+					node = node->left();
+				}
+				else if(_cmp(node->key(),k)) {
+					left = false;
+					node = node->right();
+				}
+				// equal, so just replace the value
+				else {
+					if(replace)
+						node->value(v);
+					return iterator(node);
+				}
+			}
+			return do_insert(parent,left,k,v);
 		}
 		iterator insert(const pair<Key,T>& p,bool replace = true) {
 			return insert(p.first,p.second,replace);
 		}
 		/**
 		 * Inserts the key <k> with value <v> into the tree and gives the insert-algorithm a hint
-		 * with <pos>. I.e. it tries to start at this node, if possible, which can speed up
-		 * the insert a lot.
+		 * with <pos>. If <k> belongs directly in front of <pos>, it is inserted there without
+		 * searching, which makes e.g. appending with end() as hint a constant-time operation
+		 * (apart from rebalancing).
 		 *
 		 * @param pos the position where to start
 		 * @param k the key
@@ -227,15 +250,18 @@ namespace std {
 		 */
 		iterator insert(iterator pos,const Key& k,const T& v,bool replace = true) {
 			bintree_node<Key,T,Cmp>* node = pos.node();
-			// head and foot are not allowed
-			if(node == &_head || node == &_foot)
-				node = _head.right();
-			else {
-				// while the parent is less than k, move upwards
-				while(node->parent() && _cmp(k,node->parent()->key()))
-					node = node->parent();
+			if(node != &_head) {
+				bintree_node<Key,T,Cmp>* before = node->prev();
+				if((node == &_foot || _cmp(k,node->key())) &&
+						(before == &_head || _cmp(before->key(),k))) {
+					// if <node> has a left child, <before> is the maximum in that subtree. thus,
+					// either <node> has no left child or <before> has no right child.
+					if(node != &_foot && !node->left())
+						return do_insert(node,true,k,v);
+					return do_insert(before != &_head ? before : nullptr,false,k,v);
+				}
 			}
-			return do_insert(node,k,v,replace);
+			return insert(k,v,replace);
 		}
 
 		/**
@@ -250,10 +276,10 @@ namespace std {
 				// less?
 				if(_cmp(k,node->key()))
 					node = node->left();
-				else if(k == node->key())
-					return iterator(node);
-				else
+				else if(_cmp(node->key(),k))
 					node = node->right();
+				else
+					return iterator(node);
 			}
 			// not found
 			return end();
@@ -271,21 +297,19 @@ namespace std {
 		 */
 		iterator lower_bound(const key_type &x) {
 			bintree_node<Key,T,Cmp>* node = _head.right();
+			bintree_node<Key,T,Cmp>* res = &_foot;
 			while(node != nullptr) {
-				if(_cmp(x,node->key())) {
-					if(!node->left() || !_cmp(x,node->left()->key()))
-						return iterator(node);
+				if(!_cmp(node->key(),x)) {
+					res = node;
 					node = node->left();
 				}
-				else if(x == node->key())
-					return iterator(node);
 				else
 					node = node->right();
 			}
-			return end();
+			return iterator(res);
 		}
 		const_iterator lower_bound(const key_type &x) const {
-			iterator it = lower_bound(x);
+			iterator it = const_cast<bintree*>(this)->lower_bound(x);
 			return const_iterator(it.node());
 		}
 		/**
@@ -296,21 +320,19 @@ namespace std {
 		 */
 		iterator upper_bound(const key_type &x) {
 			bintree_node<Key,T,Cmp>* node = _head.right();
+			bintree_node<Key,T,Cmp>* res = &_foot;
 			while(node != nullptr) {
 				if(_cmp(x,node->key())) {
-					if(!node->left() || !_cmp(x,node->left()->key()))
-						return iterator(node);
+					res = node;
 					node = node->left();
 				}
-				else if(x == node->key())
-					return iterator(node->next());
 				else
 					node = node->right();
 			}
-			return end();
+			return iterator(res);
 		}
 		const_iterator upper_bound(const key_type &x) const {
-			iterator it = upper_bound(x);
+			iterator it = const_cast<bintree*>(this)->upper_bound(x);
 			return const_iterator(it.node());
 		}
 
@@ -321,13 +343,14 @@ namespace std {
 		 * @return true if erased
 		 */
 		bool erase(const Key& k) {
-			// don't even try it when _elCount is 0
-			if(_elCount > 0)
-				return do_erase(_head.right(),k);
-			return false;
+			iterator it = find(k);
+			if(it == end())
+				return false;
+			do_erase(it.node());
+			return true;
 		}
 		/**
-		 * Removes the element at given position
+		 * Removes the element at given position. Iterators to other elements stay valid.
 		 *
 		 * @param it the iterator that points to the element to erase
 		 */
@@ -342,16 +365,8 @@ namespace std {
 		 * @param last the end of the range (exclusive)
 		 */
 		void erase(iterator first,iterator last) {
-			/* note that we have to run to the node each time because deleted nodes might be reused for
-			 * other nodes. that is, we can't simply iterator through the sequence and delete every
-			 * node. doing so might free nodes twice. */
-			difference_type i = distance(begin(),first);
-			difference_type num = distance(first,last);
-			while(num-- > 0) {
-				iterator it = begin();
-				advance(it,i);
-				do_erase(it.node());
-			}
+			while(first != last)
+				erase(first++);
 		}
 		/**
 		 * Removes all elements from the tree
@@ -369,146 +384,257 @@ namespace std {
 			_foot.prev(&_head);
 		}
 
+		/**
+		 * @return the number of nodes on the longest path from the root to a leaf (mainly for
+		 *  testing purposes)
+		 */
+		size_type depth() const {
+			return depth(_head.right());
+		}
+
 	private:
 		/**
-		 * Does the actual inserting, starting at <node>
+		 * Creates a node for <k> and <v> as the left or right child of <parent> and rebalances
+		 * the tree afterwards.
 		 *
-		 * @param node the start-node
+		 * @param parent the parent-node (nullptr if the tree is empty)
+		 * @param left whether to make it the left child
 		 * @param k the key
 		 * @param v the value
-		 * @param replace whether to replace existing elements
 		 * @return the insert-position
 		 */
-		iterator do_insert(bintree_node<Key,T,Cmp>* node,const Key& k,const T& v,bool replace) {
-			bool left = false;
-			bintree_node<Key,T,Cmp>* prev = node ? node->parent() : nullptr;
-			while(node != nullptr) {
-				prev = node;
-				// less?
-				if(_cmp(k,node->key())) {
-					left = true;
-					node = node->left();
-				}
-				// equal, so just replace the value
-				else if(k == node->key()) {
-					if(replace)
-						node->value(v);
-					return iterator(node);
-				}
-				else {
-					left = false;
-					node = node->right();
-				}
-			}
-
-			// node is null, so create a new node
-			node = new bintree_node<Key,T,Cmp>(k,nullptr,nullptr);
+		iterator do_insert(bintree_node<Key,T,Cmp>* parent,bool left,const Key& k,const T& v) {
+			bintree_node<Key,T,Cmp>* node = new bintree_node<Key,T,Cmp>(k,nullptr,nullptr);
 			node->value(v);
-			if(!prev)
-				prev = &_head;
-			node->parent(prev);
+			node->parent(parent);
+			node->red(true);
 
 			// insert into tree
-			if(left)
-				prev->left(node);
+			if(!parent)
+				_head.right(node);
+			else if(left)
+				parent->left(node);
 			else
-				prev->right(node);
+				parent->right(node);
 
 			// insert into sequence
-			// note that its always directly behind or before the found node when we want to keep
+			// note that its always directly behind or before the parent when we want to keep
 			// the keys in ascending order!
-			if(left) {
-				// insert before prev
-				prev->prev()->next(node);
-				node->prev(prev->prev());
-				prev->prev(node);
-				node->next(prev);
-			}
-			else {
-				// insert behind prev
-				node->next(prev->next());
-				node->prev(prev);
-				prev->next()->prev(node);
-				prev->next(node);
-			}
+			bintree_node<Key,T,Cmp>* next = parent ? (left ? parent : parent->next()) : &_foot;
+			bintree_node<Key,T,Cmp>* prev = next->prev();
+			node->prev(prev);
+			node->next(next);
+			prev->next(node);
+			next->prev(node);
 
+			insert_fixup(node);
 			_elCount++;
 			return iterator(node);
 		}
 		/**
-		 * Finds the node with the minimum key in the subtree of <n>.
+		 * Restores the red-black properties after <n> has been inserted.
 		 *
-		 * @param n the node
-		 * @return the node with the minimum key
-		 */
-		bintree_node<Key,T,Cmp>* find_min(bintree_node<Key,T,Cmp>* n) {
-			bintree_node<Key,T,Cmp>* current = n;
-			while(current->left())
-				current = current->left();
-			return current;
+		 * @param n the inserted node
+		 */
+		void insert_fixup(bintree_node<Key,T,Cmp>* n) {
+			// as long as we have two red nodes in a row. note that the parent is red, so that
+			// it's not the root and thus, the grandparent exists
+			while(n->parent() && n->parent()->red()) {
+				bintree_node<Key,T,Cmp>* p = n->parent();
+				bintree_node<Key,T,Cmp>* g = p->parent();
+				bintree_node<Key,T,Cmp>* u = p == g->left() ? g->right() : g->left();
+				// red uncle: recolor and continue with the grandparent
+				if(u && u->red()) {
+					p->red(false);
+					u->red(false);
+					g->red(true);
+					n = g;
+					continue;
+				}
+
+				// black uncle: rotate <n> to the outside, if necessary, and rotate the grandparent
+				if(p == g->left()) {
+					if(n == p->right()) {
+						rotate_left(p);
+						p = n;
+					}
+					rotate_right(g);
+				}
+				else {
+					if(n == p->left()) {
+						rotate_right(p);
+						p = n;
+					}
+					rotate_left(g);
+				}
+				p->red(false);
+				g->red(true);
+				break;
+			}
+			_head.right()->red(false);
 		}
 		/**
-		 * Replaces <n> with <newnode>. Deletes <n> when done
+		 * Removes the given node
 		 *
 		 * @param n the node
-		 * @param newnode the new node
 		 */
-		void replace_in_parent(bintree_node<Key,T,Cmp>* n,bintree_node<Key,T,Cmp>* newnode) {
-			bintree_node<Key,T,Cmp>* parent = n->parent();
+		void do_erase(bintree_node<Key,T,Cmp>* n) {
+			bintree_node<Key,T,Cmp>* child;
+			bintree_node<Key,T,Cmp>* parent;
+			bool removedRed = n->red();
+			if(!n->left() || !n->right()) {
+				child = n->left() ? n->left() : n->right();
+				parent = n->parent();
+				replace_in_parent(n,child);
+			}
+			else {
+				// move the successor, which has no left child, to the position of <n>
+				bintree_node<Key,T,Cmp>* succ = n->next();
+				removedRed = succ->red();
+				child = succ->right();
+				if(succ->parent() == n)
+					parent = succ;
+				else {
+					parent = succ->parent();
+					replace_in_parent(succ,child);
+					succ->right(n->right());
+					succ->right()->parent(succ);
+				}
+				replace_in_parent(n,succ);
+				succ->left(n->left());
+				succ->left()->parent(succ);
+				succ->red(n->red());
+			}
+
 			// erase out of the sequence
 			n->prev()->next(n->next());
 			n->next()->prev(n->prev());
-			// replace in parent
-			if(parent) {
-				if(n == parent->left())
-					parent->left(newnode);
-				else
-					parent->right(newnode);
-			}
-			if(newnode)
-				newnode->parent(parent);
 			delete n;
+			_elCount--;
+
+			// if we removed a black node, the paths through <child> lack a black node
+			if(!removedRed)
+				erase_fixup(child,parent);
 		}
 		/**
-		 * The recursive erase-method
+		 * Restores the red-black properties after a black node has been removed above <n>.
 		 *
-		 * @param n the current node
-		 * @param k the key to erase
-		 */
-		bool do_erase(bintree_node<Key,T,Cmp>* n,const Key& k) {
-			if(n) {
-				if(_cmp(k,n->key()))
-					return do_erase(n->left(),k);
-				else if(k != n->key())
-					return do_erase(n->right(),k);
+		 * @param n the node that replaced the removed node (may be nullptr)
+		 * @param parent the parent of <n>
+		 */
+		void erase_fixup(bintree_node<Key,T,Cmp>* n,bintree_node<Key,T,Cmp>* parent) {
+			while(n != _head.right() && (!n || !n->red())) {
+				// since the paths through <n> lack a black node, the sibling exists
+				if(n == parent->left()) {
+					bintree_node<Key,T,Cmp>* s = parent->right();
+					if(s->red()) {
+						s->red(false);
+						parent->red(true);
+						rotate_left(parent);
+						s = parent->right();
+					}
+					if(!is_red(s->left()) && !is_red(s->right())) {
+						s->red(true);
+						n = parent;
+						parent = n->parent();
+					}
+					else {
+						if(!is_red(s->right())) {
+							s->left()->red(false);
+							s->red(true);
+							rotate_right(s);
+							s = parent->right();
+						}
+						s->red(parent->red());
+						parent->red(false);
+						s->right()->red(false);
+						rotate_left(parent);
+						n = _head.right();
+					}
+				}
 				else {
-					do_erase(n);
-					return true;
+					bintree_node<Key,T,Cmp>* s = parent->left();
+					if(s->red()) {
+						s->red(false);
+						parent->red(true);
+						rotate_right(parent);
+						s = parent->left();
+					}
+					if(!is_red(s->left()) && !is_red(s->right())) {
+						s->red(true);
+						n = parent;
+						parent = n->parent();
+					}
+					else {
+						if(!is_red(s->left())) {
+							s->right()->red(false);
+							s->red(true);
+							rotate_left(s);
+							s = parent->left();
+						}
+						s->red(parent->red());
+						parent->red(false);
+						s->left()->red(false);
+						rotate_right(parent);
+						n = _head.right();
+					}
 				}
 			}
-			return false;
+			if(n)
+				n->red(false);
 		}
 		/**
-		 * Removes the given node
+		 * Rotates the subtree of <n> to the left, i.e., its right child takes its place.
 		 *
 		 * @param n the node
 		 */
-		void do_erase(bintree_node<Key,T,Cmp>* n) {
-			if(n->left() && n->right()) {
-				bintree_node<Key,T,Cmp>* successor = find_min(n->right());
-				n->key(successor->key());
-				n->value(successor->value());
-				replace_in_parent(successor,successor->right());
-			}
-			else if(n->left() || n->right()) {
-				if(n->left())
-					replace_in_parent(n,n->left());
-				else
-					replace_in_parent(n,n->right());
-			}
+		void rotate_left(bintree_node<Key,T,Cmp>* n) {
+			bintree_node<Key,T,Cmp>* r = n->right();
+			n->right(r->left());
+			if(r->left())
+				r->left()->parent(n);
+			replace_in_parent(n,r);
+			r->left(n);
+			n->parent(r);
+		}
+		/**
+		 * Rotates the subtree of <n> to the right, i.e., its left child takes its place.
+		 *
+		 * @param n the node
+		 */
+		void rotate_right(bintree_node<Key,T,Cmp>* n) {
+			bintree_node<Key,T,Cmp>* l = n->left();
+			n->left(l->right());
+			if(l->right())
+				l->right()->parent(n);
+			replace_in_parent(n,l);
+			l->right(n);
+			n->parent(l);
+		}
+		/**
+		 * Replaces <n> with <newnode> in the parent of <n> (or as the root).
+		 *
+		 * @param n the node
+		 * @param newnode the new node (may be nullptr)
+		 */
+		void replace_in_parent(bintree_node<Key,T,Cmp>* n,bintree_node<Key,T,Cmp>* newnode) {
+			bintree_node<Key,T,Cmp>* parent = n->parent();
+			if(!parent)
+				_head.right(newnode);
+			else if(n == parent->left())
+				parent->left(newnode);
 			else
-				replace_in_parent(n,nullptr);
-			_elCount--;
+				parent->right(newnode);
+			if(newnode)
+				newnode->parent(parent);
+		}
+		static bool is_red(const bintree_node<Key,T,Cmp>* n) {
+			return n && n->red();
+		}
+		static size_type depth(const bintree_node<Key,T,Cmp>* n) {
+			if(!n)
+				return 0;
+			return 1 + max(depth(n->left()),depth(n->right()));
 		}
 
 	private:
@@ -28,15 +28,15 @@ namespace std {
 	public:
 		bintree_node()
 			: _prev(nullptr), _next(nullptr), _parent(nullptr), _left(nullptr), _right(nullptr),
-			  _data(make_pair<Key,T>(Key(),T())) {
+			  _red(false), _data(make_pair<Key,T>(Key(),T())) {
 		}
 		bintree_node(const Key& k,bintree_node* l,bintree_node* r)
 			: _prev(nullptr), _next(nullptr), _parent(nullptr), _left(l), _right(r),
-			  _data(make_pair<Key,T>(k,T())) {
+			  _red(false), _data(make_pair<Key,T>(k,T())) {
 		}
 		bintree_node(const bintree_node& c)
 			: _prev(c._prev), _next(c._next), _parent(c._parent), _left(c._left),
-			  _right(c._right), _data(c._data) {
+			  _right(c._right), _red(c._red), _data(c._data) {
 		}
 		bintree_node& operator =(const bintree_node& c) {
 			_prev = c._prev;
@@ -44,6 +44,7 @@ namespace std {
 			_parent = c._parent;
 			_left = c._left;
 			_right = c._right;
+			_red = c._red;
 			_data = c._data;
 			return *this;
 		}
@@ -82,6 +83,13 @@ namespace std {
 			_right = r;
 		}
 
+		bool red() const {
+			return _red;
+		}
+		void red(bool r) {
+			_red = r;
+		}
+
 		const pair<Key,T> &data() const {
 			return _data;
 		}
@@ -104,6 +112,7 @@ namespace std {
 		bintree_node* _parent;
 		bintree_node* _left;
 		bintree_node* _right;
+		bool _red;
 		pair<Key,T> _data;
 	};
 }
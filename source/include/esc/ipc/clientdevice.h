@@ -30,6 +30,7 @@
 #include <limits.h>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 namespace esc {
 
@@ -92,7 +93,7 @@ private:
  */
 template<class C = Client>
 class ClientDevice : public Device {
-	typedef std::map<int,C*> map_type;
+	typedef std::unordered_map<int,C*> map_type;
 	typedef typename map_type::iterator iterator;
 
 public:
@@ -129,6 +130,7 @@ public:
 	 * @return the client with given file-descriptor
 	 */
 	C *operator[](int fd) {
+		std::lock_guard<std::mutex> guard(_mutex);
 		typename map_type::iterator it = _clients.find(fd);
 		return it != _clients.end() ? it->second : NULL;
 	}
@@ -143,6 +145,7 @@ public:
 	 * @throws if the client does not exist
 	 */
 	C *get(int fd) {
+		std::lock_guard<std::mutex> guard(_mutex);
 		typename map_type::iterator it = _clients.find(fd);
 		if(it == _clients.end())
 			VTHROWE("No client with id " << fd,-ENOTFOUND);
@@ -23,7 +23,7 @@
 #include <sys/common.h>
 #include <sys/driver.h>
 #include <functor.h>
-#include <map>
+#include <unordered_map>
 #include <sstream>
 
 namespace esc {
@@ -43,7 +43,7 @@ public:
 		handler_type *func;
 		bool reply;
 	};
-	typedef std::map<msgid_t,Handler> oplist_type;
+	typedef std::unordered_map<msgid_t,Handler> oplist_type;
 
 	/**
 	 * Creates the device at given path
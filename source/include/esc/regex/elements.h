@@ -18,6 +18,7 @@
  */
 
 #include <esc/regex/regex.h>
+#include <esc/regex/program.h>
 
 namespace esc {
 
@@ -71,18 +72,16 @@ public:
 	explicit CharElement(char c) : Regex::Element(CHAR),_c(c) {
 	}
 
-	virtual bool match(Regex::Result *,Regex::Input &in) const override {
-		char cur = in.peek();
-		char c = _c;
-		if(in.flags() & Regex::CASE_INSENSITIVE) {
-			cur = tolower(cur);
-			c = tolower(c);
+	virtual void compile(Regex::Program &prog) const override {
+		Regex::Program::Class cls;
+		for(int v = 0; v < 256; ++v) {
+			char c = static_cast<char>(v);
+			if(c == _c)
+				cls.exact.set(v);
+			if(tolower(c) == tolower(_c))
+				cls.folded.set(v);
 		}
-		if(c == cur) {
-			in.take();
-			return true;
-		}
-		return false;
+		prog.emitClass(cls);
 	}
 
 	virtual void print(esc::OStream &os,int) const override {
@@ -99,20 +98,20 @@ public:
 		explicit Range(char _begin,char _end) : Element(CHARCLASS_RANGE), begin(_begin),end(_end) {
 		}
 
-		virtual bool match(Regex::Result *,Regex::Input &in) const override {
-			char c = in.peek();
-			char b = begin;
-			char e = end;
-			if(in.flags() & Regex::CASE_INSENSITIVE) {
-				c = tolower(c);
-				b = tolower(b);
-				e = tolower(e);
-			}
-			if(c >= b && c <= e) {
-				in.take();
-				return true;
+		virtual void compile(Regex::Program &prog) const override {
+			Regex::Program::Class cls;
+			add(cls);
+			prog.emitClass(cls);
+		}
+
+		void add(Regex::Program::Class &cls) const {
+			for(int v = 0; v < 256; ++v) {
+				char c = static_cast<char>(v);
+				if(c >= begin && c <= end)
+					cls.exact.set(v);
+				if(tolower(c) >= tolower(begin) && tolower(c) <= tolower(end))
+					cls.folded.set(v);
 			}
-			return false;
 		}
 
 		virtual void print(esc::OStream &os,int) const override {
@@ -133,20 +132,26 @@ public:
 		delete _elems;
 	}
 
-	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
-		if(!in.done()) {
-			bool matched = inRanges(res,in);
-			if(matched && _negate) {
-				in.put();
-				return false;
-			}
-			if(!matched && _negate) {
-				in.take();
-				return true;
-			}
-			return matched;
+	virtual void compile(Regex::Program &prog) const override {
+		Regex::Program::Class cls;
+		add(cls);
+		prog.emitClass(cls);
+	}
+
+	void add(Regex::Program::Class &cls) const {
+		Regex::Program::Class own;
+		for(auto &e : *_elems) {
+			if(e->type() == CHARCLASS_RANGE)
+				static_cast<const Range*>(e)->add(own);
+			else
+				static_cast<const CharClassElement*>(e)->add(own);
+		}
+		if(_negate) {
+			own.exact.invert();
+			own.folded.invert();
 		}
-		return false;
+		cls.exact.add(own.exact);
+		cls.folded.add(own.folded);
 	}
 
 	virtual void print(esc::OStream &os,int) const override {
@@ -159,14 +164,6 @@ public:
 	}
 
 private:
-	bool inRanges(Regex::Result *res,Regex::Input &in) const {
-		for(auto &e : *_elems) {
-			if(e->match(res,in))
-				return true;
-		}
-		return false;
-	}
-
 	bool _negate;
 	const ElementList *_elems;
 };
@@ -176,12 +173,11 @@ public:
 	explicit DotElement() : Regex::Element(DOT) {
 	}
 
-	virtual bool match(Regex::Result *,Regex::Input &in) const override {
-		if(!in.done()) {
-			in.take();
-			return true;
-		}
-		return false;
+	virtual void compile(Regex::Program &prog) const override {
+		Regex::Program::Class cls;
+		cls.exact.invert();
+		cls.folded.invert();
+		prog.emitClass(cls);
 	}
 
 	virtual void print(esc::OStream &os,int) const override {
@@ -191,6 +187,10 @@ public:
 
 class RepeatElement : public Regex::Element {
 public:
+	static const int INFINITE	= 1 << 30;
+	/* the element is compiled once per count, so that we can't allow arbitrary bounds */
+	static const int MAX_COUNT	= 1000;
+
 	explicit RepeatElement(Regex::Element *e,int min,int max)
 		: Regex::Element(REPEAT),_e(e),_min(min),_max(max) {
 	}
@@ -198,14 +198,26 @@ public:
 		delete _e;
 	}
 
-	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
-		int num = 0;
-		while(_e->match(res,in)) {
-			num++;
-			if(num >= _max)
-				return true;
+	virtual void compile(Regex::Program &prog) const override {
+		for(int i = 0; i < _min; ++i)
+			_e->compile(prog);
+
+		if(_max >= INFINITE) {
+			uint split = prog.emit(Regex::Program::SPLIT);
+			_e->compile(prog);
+			prog.emit(Regex::Program::JMP,split);
+			prog.patch(split,split + 1,prog.pc());
+		}
+		else {
+			// every optional copy may skip all following ones
+			std::vector<uint> splits;
+			for(int i = _min; i < _max; ++i) {
+				splits.push_back(prog.emit(Regex::Program::SPLIT));
+				_e->compile(prog);
+			}
+			for(auto split : splits)
+				prog.patch(split,split + 1,prog.pc());
 		}
-		return num >= _min;
 	}
 
 	virtual void print(esc::OStream &os,int indent) const override {
@@ -228,12 +240,23 @@ public:
 		delete _list;
 	}
 
-	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
-		for(auto &e : *_list) {
-			if(e->match(res,in))
-				return true;
+	virtual void compile(Regex::Program &prog) const override {
+		// the parser appends the first alternative at the end; give it the highest priority
+		std::vector<const Regex::Element*> alts;
+		alts.push_back(*(_list->end() - 1));
+		for(auto it = _list->begin(); it != _list->end() - 1; ++it)
+			alts.push_back(*it);
+
+		std::vector<uint> jmps;
+		for(size_t i = 0; i < alts.size() - 1; ++i) {
+			uint split = prog.emit(Regex::Program::SPLIT);
+			alts[i]->compile(prog);
+			jmps.push_back(prog.emit(Regex::Program::JMP));
+			prog.patch(split,split + 1,prog.pc());
 		}
-		return false;
+		alts.back()->compile(prog);
+		for(auto jmp : jmps)
+			prog.patch(jmp,prog.pc());
 	}
 
 	virtual void print(esc::OStream &os,int indent) const override {
@@ -253,26 +276,11 @@ public:
 		delete _list;
 	}
 
-	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
-		if(_list->empty())
-			return in.done();
-
-		if(res) {
-			size_t begin = in.pos();
-			for(auto &e : *_list) {
-				if(!e->match(res,in))
-					return false;
-			}
-			size_t end = in.pos();
-			res->set(_list->id(),in.substr(begin,end - begin));
-		}
-		else {
-			for(auto &e : *_list) {
-				if(!e->match(NULL,in))
-					return false;
-			}
-		}
-		return true;
+	virtual void compile(Regex::Program &prog) const override {
+		prog.emit(Regex::Program::SAVE,_list->id() * 2);
+		for(auto &e : *_list)
+			e->compile(prog);
+		prog.emit(Regex::Program::SAVE,_list->id() * 2 + 1);
 	}
 
 	virtual void print(esc::OStream &os,int indent) const override {
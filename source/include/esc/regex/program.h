@@ -0,0 +1,222 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#pragma once
+
+#include <esc/regex/regex.h>
+#include <sys/common.h>
+#include <string.h>
+#include <stdexcept>
+#include <vector>
+#include <string>
+
+namespace esc {
+
+/**
+ * The compiled form of a pattern: a program for a Thompson-NFA. It is executed in two ways:
+ * by a lazily constructed DFA, which tells whether the string matches, and by a Pike-VM, which
+ * simulates the NFA with capture groups. Both run in linear time with respect to the length of
+ * the string. The DFA states are cached; if the cache grows too large, it is flushed. Since the
+ * cache is updated by the const matching functions without locking, a program must not be used
+ * by multiple threads at once.
+ */
+class Regex::Program {
+public:
+	static const size_t MAX_DFA_STATES	= 512;
+	/* limits the program size, because nested repeats multiply it */
+	static const size_t MAX_INSTS		= 1 << 14;
+
+	enum Op {
+		CLASS,		/* consume a character of the given class */
+		SPLIT,		/* continue at x and y, preferring x */
+		JMP,		/* continue at x */
+		SAVE,		/* store the current position in the given slot */
+		EOL,		/* continue only at the end of the string */
+		MATCH
+	};
+
+	struct Inst {
+		Op op;
+		uint x;
+		uint y;
+	};
+
+	/**
+	 * A set of characters
+	 */
+	class CharSet {
+	public:
+		explicit CharSet() : _bits() {
+		}
+
+		bool test(uint8_t c) const {
+			return _bits[c / 32] & (1U << (c % 32));
+		}
+		void set(uint8_t c) {
+			_bits[c / 32] |= 1U << (c % 32);
+		}
+		void add(const CharSet &s) {
+			for(size_t i = 0; i < ARRAY_SIZE(_bits); ++i)
+				_bits[i] |= s._bits[i];
+		}
+		void invert() {
+			for(size_t i = 0; i < ARRAY_SIZE(_bits); ++i)
+				_bits[i] = ~_bits[i];
+		}
+
+		/**
+		 * @return the character, if the set consists of exactly one character, or -1
+		 */
+		int single() const;
+
+	private:
+		uint32_t _bits[256 / 32];
+	};
+
+	/**
+	 * A character class with the characters to match with and without CASE_INSENSITIVE.
+	 */
+	struct Class {
+		CharSet exact;
+		CharSet folded;
+	};
+
+	/**
+	 * Compiles the given AST into a program.
+	 *
+	 * @param root the root element
+	 * @param flags the pattern flags (REGEX_FLAG_*)
+	 * @param groups the number of groups
+	 * @throws runtime_error if the program gets too large
+	 */
+	explicit Program(const Element *root,int flags,size_t groups);
+	~Program();
+
+	Program(const Program&) = delete;
+	Program &operator=(const Program&) = delete;
+
+	/**
+	 * @return the number of groups
+	 */
+	size_t groups() const {
+		return _groups;
+	}
+	/**
+	 * @return the address of the next instruction
+	 */
+	uint pc() const {
+		return _insts.size();
+	}
+	/**
+	 * Appends the given instruction.
+	 *
+	 * @return the address of it
+	 * @throws runtime_error if the program gets too large
+	 */
+	uint emit(Op op,uint x = 0,uint y = 0) {
+		if(_insts.size() >= MAX_INSTS)
+			throw std::runtime_error("Pattern too large");
+		Inst inst = {op,x,y};
+		_insts.push_back(inst);
+		return _insts.size() - 1;
+	}
+	/**
+	 * Sets the targets of the instruction at <pc>.
+	 */
+	void patch(uint pc,uint x,uint y = 0) {
+		_insts[pc].x = x;
+		_insts[pc].y = y;
+	}
+	/**
+	 * Appends an instruction to match a character of class <cls>.
+	 */
+	uint emitClass(const Class &cls) {
+		_classes.push_back(cls);
+		return emit(CLASS,_classes.size() - 1);
+	}
+
+	/**
+	 * Tests whether the program matches the complete string <str>.
+	 *
+	 * @param str the string
+	 * @param flags the matching flags
+	 * @return true if so
+	 */
+	bool matches(const std::string &str,uint flags) const;
+
+	/**
+	 * Searches for the leftmost match in <str>. If <res> is not NULL, the groups are stored
+	 * in <res>.
+	 *
+	 * @param str the string
+	 * @param flags the matching flags
+	 * @param res the result (may be NULL)
+	 * @return true if a match was found
+	 */
+	bool search(const std::string &str,uint flags,Result *res) const;
+
+private:
+	struct DState {
+		std::vector<uint> pcs;
+		uint hash;
+		int chain;
+		bool accept;
+		bool acceptEnd;
+		DState *next[256];
+	};
+
+	struct DFA {
+		explicit DFA() : states(), buckets(), start() {
+		}
+
+		std::vector<DState*> states;
+		std::vector<int> buckets;
+		DState *start;
+	};
+
+	struct Threads;
+
+	const CharSet &charset(uint cls,uint flags) const {
+		return flags & CASE_INSENSITIVE ? _classes[cls].folded : _classes[cls].exact;
+	}
+	size_t findPrefix(const std::string &str,size_t pos,uint flags) const;
+	void computePrefix(std::string &prefix,bool folded) const;
+
+	void closure(std::vector<uint> &pcs,std::vector<bool> &seen,uint pc,bool atEnd) const;
+	DFA &dfa(uint flags,bool anchored) const;
+	DState *addState(DFA &dfa,std::vector<uint> &pcs) const;
+	DState *step(DFA &dfa,DState *state,uint8_t c,uint flags,bool anchored) const;
+	void flush(DFA &dfa) const;
+	bool runDFA(const std::string &str,size_t pos,uint flags,bool anchored,bool search) const;
+
+	void addThread(Threads &list,uint pc,ssize_t *caps,size_t pos,size_t len) const;
+	bool runPike(const std::string &str,size_t pos,uint flags,bool anchored,Result *res) const;
+
+	int _flags;
+	size_t _groups;
+	std::vector<Inst> _insts;
+	std::vector<Class> _classes;
+	std::string _prefix;
+	std::string _foldedPrefix;
+	/* one for each combination of CASE_INSENSITIVE and anchored. not thread-safe (see above) */
+	mutable DFA _dfas[4];
+};
+
+}
@@ -36,11 +36,15 @@ namespace esc {
  * - repetition: *, + and ?
  * - character classes: [ ] and [^ ]
  * - choices: |
+ *
+ * The patterns are compiled to a program for a Thompson-NFA, which is executed by a lazily built
+ * DFA and, if the groups are needed, by a Pike-VM. Thus, matching and searching takes linear time
+ * with respect to the length of the string.
  */
 class Regex {
 public:
 	class Result;
-	class Input;
+	class Program;
 
 	static const size_t MAX_GROUP_NESTING		= 16;
 
@@ -86,7 +90,7 @@ public:
 			return _type;
 		}
 
-		virtual bool match(Result *res,Input &in) const = 0;
+		virtual void compile(Program &prog) const = 0;
 		virtual void print(esc::OStream &os,int indent) const = 0;
 
 		friend esc::OStream &operator<<(esc::OStream &os,const Element &e) {
@@ -98,53 +102,12 @@ public:
 		Type _type;
 	};
 
-	/**
-	 * Represents the string that should be matched against a regex.
-	 */
-	class Input {
-	public:
-		explicit Input(const std::string &str,size_t pos = 0,uint flags = NONE)
-			: _pos(pos),_str(str),_flags(flags) {
-		}
-
-		uint flags() const {
-			return _flags;
-		}
-		std::string substr(size_t begin,size_t length) const {
-			return _str.substr(begin,length);
-		}
-		size_t pos() const {
-			return _pos;
-		}
-		bool done() const {
-			return _pos == _str.length();
-		}
-		char peek() const {
-			if(_pos < _str.length())
-				return _str[_pos];
-			return '\0';
-		}
-		void take() {
-			assert(_pos < _str.length());
-			_pos++;
-		}
-		void put() {
-			assert(_pos > 0);
-			_pos--;
-		}
-
-	private:
-		size_t _pos;
-		const std::string &_str;
-		uint _flags;
-	};
-
 	/**
 	 * Captures the result of a match/search.
 	 */
 	class Result {
-		friend class GroupElement;
 		friend class Regex;
+		friend class Program;
 
 	public:
 		explicit Result() : _success(false), _matches() {
@@ -185,26 +148,32 @@ public:
 	};
 
 	/**
-	 * Represents a pattern that can be used for matching, searching and replacing.
+	 * Represents a pattern that can be used for matching, searching and replacing. Note that
+	 * patterns must not be used by multiple threads at once, because the program caches the DFA
+	 * states during matching.
 	 */
 	class Pattern {
 	public:
-		explicit Pattern(Element *root,int flags) : _flags(flags),_root(root) {
-		}
+		explicit Pattern(Element *root,int flags,size_t groups);
 		Pattern(const Pattern&) = delete;
 		Pattern &operator=(const Pattern&) = delete;
-		Pattern(Pattern &&p) : _root(p._root) {
+		Pattern(Pattern &&p) : _flags(p._flags), _root(p._root), _prog(p._prog) {
 			p._root = NULL;
+			p._prog = NULL;
 		}
 		Pattern &operator=(Pattern &&p) {
 			if(&p != this) {
+				destroy();
+				_flags = p._flags;
 				_root = p._root;
+				_prog = p._prog;
 				p._root = NULL;
+				p._prog = NULL;
 			}
 			return *this;
 		}
 		virtual ~Pattern() {
-			delete _root;
+			destroy();
 		}
 
 		int flags() const {
@@ -213,12 +182,18 @@ public:
 		const Element *root() const {
 			return _root;
 		}
+		const Program &program() const {
+			return *_prog;
+		}
 
 		friend esc::OStream &operator<<(esc::OStream &os,const Pattern &p);
 
 	private:
+		void destroy();
+
 		int _flags;
 		Element *_root;
+		Program *_prog;
 	};
 
 	/**
@@ -227,7 +202,7 @@ public:
 	 *
 	 * @param regex the regular expression
 	 * @return the pattern
-	 * @throws runtime_error if <regex> is ill-formed
+	 * @throws runtime_error if <regex> is ill-formed or too large
 	 */
 	static Pattern compile(const std::string &regex);
 
@@ -305,9 +280,6 @@ public:
 	 */
 	static std::string replace(const Pattern &pattern,const std::string &str,
 		const std::string &repl,uint flags = NONE);
-
-private:
-	static Regex::Result test(const Pattern &p,const std::string &str,size_t pos,uint flags);
 };
 
 }
@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <fs/locktable.h>
 #include <sys/common.h>
+#include <mutex>
 #include <stdio.h>
 
 namespace fs {
@@ -28,16 +30,58 @@ namespace fs {
 struct CBlock {
 	CBlock *prev;
 	CBlock *next;
-	CBlock *hnext;
 	size_t blockNo;
 	ushort dirty;
 	ushort refs;
-	/* NULL indicates an unused entry */
+	/* the flusher-tick at which the block became dirty */
+	ulong dirtyTick;
+	/* the list the block is in (BlockCache::LIST_*) */
+	uchar list;
+	/* whether it has been read ahead and not been requested yet */
+	bool readahead;
+	/* whether loading it failed; it is removed as soon as nobody references it anymore */
+	bool invalid;
+	/* NULL indicates a ghost entry, which only remembers that the block has been evicted */
 	void *buffer;
 };
 
+/**
+ * The block-cache can be used by multiple threads simultaneously. The cache-structure itself is
+ * protected by a mutex, while each requested block is locked for the requested mode. That is,
+ * multiple threads can read from a block in parallel, but writing requires exclusive access.
+ *
+ * The blocks are replaced according to 2Q: a block that is not in the cache is put into the
+ * probation-list, which is a FIFO. If it is evicted from there, it is remembered in the
+ * ghost-list. If it is requested again while it is still remembered, it is put into the
+ * protected-list, which is managed as LRU. This way, blocks that are used frequently (e.g.,
+ * bitmaps, inode tables and indirect blocks) survive a scan through lots of blocks that are used
+ * only once.
+ *
+ * Dirty blocks are written back in the background by a flusher thread, if started via
+ * startFlusher(). It writes the oldest dirty blocks as soon as too many blocks are dirty and
+ * blocks that have been dirty for too long. Thus, evicting a block does usually not require to
+ * write it synchronously.
+ */
 class BlockCache {
-	static const size_t HASH_SIZE	= 256;
+	/* a doubly linked list of blocks from the newest to the oldest one */
+	struct BlockList {
+		CBlock *newest;
+		CBlock *oldest;
+		size_t count;
+
+		void append(CBlock *b);
+		void remove(CBlock *b);
+	};
+
+	static const size_t LOCK_COUNT	= 64;
+	/* the maximum number of blocks that are read at once */
+	static const size_t MAX_BULK	= 32;
+	/* the maximum number of blocks the flusher collects at once */
+	static const size_t WB_BATCH	= 128;
+	/* the flusher runs every FLUSH_INTERVAL microseconds */
+	static const uint FLUSH_INTERVAL	= 100 * 1000;
+	/* the number of flusher-ticks after which a dirty block is written back */
+	static const ulong DIRTY_MAX_AGE	= 30;
 
 public:
 	enum {
@@ -45,17 +89,27 @@ public:
 		WRITE	= 0x2,
 	};
 
+	enum {
+		LIST_FREE,			/* unused blocks */
+		LIST_PROBATION,		/* blocks that have been used once recently (FIFO) */
+		LIST_PROTECTED,		/* blocks that have been used multiple times (LRU) */
+		LIST_GHOST,			/* ghost entries of recently evicted probation blocks (FIFO) */
+		LIST_GHOSTFREE,		/* unused ghost entries */
+		LIST_COUNT
+	};
+
 	/**
 	 * Inits the block-cache
 	 *
-	 * @param fd the file descriptor for the disk device
+	 * @param fd the file descriptor for the disk device (-1 = don't share the buffer)
 	 * @param blocks the number of blocks in the cache
 	 * @param bsize the block size
 	 */
 	explicit BlockCache(int fd,size_t blocks,size_t bsize);
 
 	/**
-	 * Destroyes the given cache
+	 * Destroyes the given cache. Note that the flusher has to be stopped before, because it
+	 * uses writeBlocks() of the subclass.
 	 */
 	~BlockCache();
 
@@ -85,13 +139,21 @@ public:
 	void flush();
 
 	/**
-	 * Marks the given block as dirty
+	 * Starts the flusher thread that writes back dirty blocks in the background
+	 */
+	void startFlusher();
+
+	/**
+	 * Stops the flusher thread and waits until it has terminated, if it is running.
+	 */
+	void stopFlusher();
+
+	/**
+	 * Marks the given block as dirty. The block has to be locked for writing.
 	 *
 	 * @param b the block
 	 */
-	void markDirty(CBlock *b) {
-		b->dirty = true;
-	}
+	void markDirty(CBlock *b);
 
 	/**
 	 * Creates a new block-cache-entry for given block-number. Does not read the contents from disk!
@@ -126,6 +188,30 @@ public:
 		doRelease(b,true);
 	}
 
+	/**
+	 * Loads the blocks <start> .. <start>+<count>-1 into the cache, as far as they aren't
+	 * already present. Consecutive missing blocks are read from disk at once. All blocks
+	 * behind the first <demanded> ones are considered to be read ahead, which is used to
+	 * determine the readahead hitrate.
+	 *
+	 * @param start the first block
+	 * @param count the number of blocks
+	 * @param demanded the number of blocks that have actually been requested
+	 */
+	void prefetch(block_t start,size_t count,size_t demanded);
+
+	/**
+	 * Starts to write a trace of all requests to <f>, or stops it, if <f> is NULL. Every line
+	 * describes one request: "r <block>", "w <block>", "c <block>" for request() with READ and
+	 * WRITE and create(), respectively, and "p <start> <count> <demanded>" for prefetch().
+	 *
+	 * @param f the file to write the trace to
+	 */
+	void setTrace(FILE *f) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		_trace = f;
+	}
+
 	/**
 	 * Prints statistics about the given blockcache to the given file
 	 *
@@ -144,33 +230,121 @@ public:
 
 private:
 	/**
-	 * Aquires the tpool_lock, depending on <mode>, for the given block
+	 * Increases the references of the given block, releases _mutex and acquires the lock for the
+	 * block, depending on <mode>. Assumes that _mutex is held.
 	 */
 	void acquire(CBlock *b,uint mode);
 	/**
-	 * Releases the tpool_lock for given block
+	 * Releases the lock for given block and decreases its references. Keeps _mutex locked
+	 * afterwards, if <unlockAlloc> is false.
 	 */
 	void doRelease(CBlock *b,bool unlockAlloc);
+	/**
+	 * Searches for the given block in the cache. Assumes that _mutex is held.
+	 */
+	CBlock *find(block_t blockNo);
+	/**
+	 * Reads the given locked blocks, that are consecutive on disk, from disk
+	 */
+	bool readBulk(CBlock **blocks,block_t start,size_t count);
 	/**
 	 * Requests the given block and reads it from disk if desired
 	 */
 	CBlock *doRequest(block_t blockNo,bool doRead,uint mode);
 	/**
-	 * Fetches a block-cache-entry
+	 * Searches for the given block or ghost entry in the hashmap. Assumes that _mutex is held.
+	 */
+	CBlock *lookup(block_t blockNo);
+	/**
+	 * Returns the hashmap index for given block number
+	 */
+	size_t hash(block_t blockNo) const {
+		return (uint32_t)(blockNo * 0x9E3779B1) >> _hashShift;
+	}
+	/**
+	 * Inserts the given block into the hashmap. Assumes that _mutex is held.
+	 */
+	void insertIntoHash(CBlock *block);
+	/**
+	 * Removes the given block from the hashmap. Assumes that _mutex is held.
+	 */
+	void removeFromHash(CBlock *block);
+	/**
+	 * Moves <block> from its current list to the new end of list <list>
+	 */
+	void moveTo(CBlock *block,uchar list) {
+		_lists[block->list].remove(block);
+		_lists[list].append(block);
+		block->list = list;
+	}
+	/**
+	 * Remembers the given block number in the ghost-list. Assumes that _mutex is held.
+	 */
+	void addGhost(size_t blockNo);
+	/**
+	 * Determines the block to evict from list <list>. Assumes that _mutex is held.
+	 */
+	CBlock *victim(uchar list);
+	/**
+	 * Removes the given unreferenced block from the cache and puts it into the freelist.
+	 * Assumes that _mutex is held.
+	 */
+	void invalidate(CBlock *block);
+	/**
+	 * Fetches a block-cache-entry. Assumes that _mutex is held.
 	 */
 	CBlock *getBlock(block_t blockNo);
+	/**
+	 * Writes back the oldest dirty blocks. At least <needed> blocks are written, if there are
+	 * that many, plus all blocks that have been dirty for DIRTY_MAX_AGE ticks. If <all> is true,
+	 * all dirty blocks are written. Consecutive blocks are written at once. Stops early if no
+	 * block of a batch could be written, because the failed ones are dirty again.
+	 */
+	void writeback(size_t needed,bool all);
+	/**
+	 * Writes the given referenced blocks, that are consecutive on disk, to disk. If that fails,
+	 * the blocks are marked dirty again.
+	 *
+	 * @return true if the blocks have been written
+	 */
+	bool writeRun(CBlock **blocks,size_t count);
+	/**
+	 * The entry point of the flusher thread
+	 */
+	static int flusherThread(void *arg);
 
 	size_t _blockCacheSize;
 	size_t _blockSize;
+	/* the max. number of blocks in the probation-list, if we need to evict one */
+	size_t _probationSize;
+	size_t _ghostCount;
+	/* open addressing with linear probing; the size is a power of two */
 	CBlock **_hashmap;
-	CBlock *_oldestBlock;
-	CBlock *_newestBlock;
-	CBlock *_freeBlocks;
+	size_t _hashSize;
+	uint _hashShift;
+	BlockList _lists[LIST_COUNT];
 	CBlock *_blockCache;
 	void *_blockmem;
+	void *_bulkmem;
+	void *_wbmem;
 	int _blockfd;
 	ulong _hits;
 	ulong _misses;
+	ulong _raBlocks;
+	ulong _raHits;
+	ulong _ghostHits;
+	size_t _dirtyCount;
+	ulong _ticks;
+	ulong _wbRequests;
+	ulong _wbBlocks;
+	ulong _syncEvictions;
+	int _flusher;
+	volatile bool _flusherRun;
+	FILE *_trace;
+	std::mutex _mutex;
+	std::mutex _bulkMutex;
+	std::mutex _wbMutex;
+	LockTable _locks;
 };
 
 }
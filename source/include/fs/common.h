@@ -21,9 +21,6 @@
 
 #include <sys/common.h>
 
-#define tpool_lock(...)		0
-#define tpool_unlock(...)	0
-
 namespace fs {
 
 static const uid_t KERNEL_UID	= -1;
@@ -22,9 +22,14 @@
 #include <esc/ipc/clientdevice.h>
 #include <esc/proto/fs.h>
 #include <fs/common.h>
+#include <fs/readahead.h>
 #include <sys/common.h>
+#include <sys/proc.h>
 #include <sys/stat.h>
+#include <sys/thread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 namespace fs {
 
@@ -32,21 +37,29 @@ template<class F>
 class FileSystem;
 
 struct OpenFile : public esc::Client {
-	explicit OpenFile(int fd) : Client(fd), ino() {
+	explicit OpenFile(int fd) : Client(fd), ino(), ra() {
 	}
-	explicit OpenFile(int fd,const fs::User &u,ino_t _ino) : Client(fd), user(u), ino(_ino) {
+	explicit OpenFile(int fd,const fs::User &u,ino_t _ino) : Client(fd), user(u), ino(_ino), ra() {
 	}
 
 	fs::User user;
 	ino_t ino;
+	fs::ReadAhead ra;
 };
 
 template<class F>
 class FSDevice : public esc::ClientDevice<F> {
 public:
-	explicit FSDevice(FileSystem<F> *fs,const char *fsDev)
+	/**
+	 * Creates the fs-device
+	 *
+	 * @param fs the filesystem
+	 * @param fsDev the path of the device to create
+	 * @param threads the number of worker threads to use (0 = handle all requests in loop())
+	 */
+	explicit FSDevice(FileSystem<F> *fs,const char *fsDev,size_t threads = 0)
 		: esc::ClientDevice<F>(fsDev,0700,DEV_TYPE_FS,DEV_OPEN | DEV_READ | DEV_WRITE | DEV_CLOSE | DEV_DELEGATE),
-		  _fs(fs), _clients(0) {
+		  _fs(fs), _clients(0), _threads(threads), _workers(new int[threads]) {
 		this->set(MSG_FILE_OPEN,std::make_memfun(this,&FSDevice::devopen));
 		this->set(MSG_FILE_CLOSE,std::make_memfun(this,&FSDevice::devclose),false);
 		this->set(MSG_FS_OPEN,std::make_memfun(this,&FSDevice::open));
@@ -69,25 +82,34 @@ public:
 
 	virtual ~FSDevice() {
 		_fs->sync();
+		delete[] _workers;
 	}
 
+	/**
+	 * Handles the requests until the device is stopped. If worker threads should be used, they
+	 * are started first. The channels of opened files are distributed among them by the inode
+	 * number, so that requests for different files are handled in parallel, while all requests
+	 * for one file are handled by the same thread. The remaining requests (e.g., opening files)
+	 * are handled by the calling thread. Note that the filesystem might still serialize parts of
+	 * the work (e.g., ext2 does all disk accesses one after another).
+	 * Before returning, the workers finish their pending requests and are joined.
+	 */
 	void loop() {
-		ulong buf[IPC_DEF_SIZE / sizeof(ulong)];
-		while(1) {
-			msgid_t mid;
-			int fd = getwork(this->id(),&mid,buf,sizeof(buf),this->isStopped() ? GW_NOBLOCK : 0);
-			if(EXPECT_FALSE(fd < 0)) {
-				if(fd != -EINTR) {
-					/* no requests anymore and we should shutdown? */
-					if(this->isStopped())
-						break;
-					printe("getwork failed");
-				}
-				continue;
-			}
+		for(size_t i = 0; i < _threads; ++i) {
+			_workers[i] = startthread(workerThread,this);
+			if(_workers[i] < 0)
+				VTHROWE("Unable to start worker thread",_workers[i]);
+		}
 
-			esc::IPCStream is(fd,buf,sizeof(buf),mid);
-			this->handleMsg(mid,is);
+		dispatch();
+
+		/* the workers might wait for requests; interrupt them, so that they notice that we're
+		 * stopped. they handle the remaining requests for their files before they terminate */
+		if(_threads > 0)
+			kill(getpid(),SIGUSR1);
+		for(size_t i = 0; i < _threads; ++i) {
+			while(join(_workers[i]) == -EINTR)
+				;
 		}
 	}
 
@@ -113,6 +135,9 @@ public:
 		res.ino = _fs->open(&r.u,path,&res.sympos,r.root,r.flags,mode,is.fd(),&file);
 		if(res.ino >= 0) {
 			this->add(is.fd(),file);
+			/* let the corresponding worker handle all further requests for this file */
+			if(_threads > 0)
+				::bindto(is.fd(),_workers[res.ino % _threads]);
 			is << esc::FileOpen::Response::success(res) << esc::Reply();
 		}
 		else
@@ -281,6 +306,37 @@ public:
 	}
 
 private:
+	static void sigusr1(int) {
+	}
+
+	static int workerThread(void *arg) {
+		/* the handler is only used to interrupt getwork when the device is stopped */
+		if(signal(SIGUSR1,sigusr1) == SIG_ERR)
+			error("Unable to set signal handler");
+		static_cast<FSDevice*>(arg)->dispatch();
+		return 0;
+	}
+
+	void dispatch() {
+		ulong buf[IPC_DEF_SIZE / sizeof(ulong)];
+		while(1) {
+			msgid_t mid;
+			int fd = getwork(this->id(),&mid,buf,sizeof(buf),this->isStopped() ? GW_NOBLOCK : 0);
+			if(EXPECT_FALSE(fd < 0)) {
+				if(fd != -EINTR) {
+					/* no requests anymore and we should shutdown? */
+					if(this->isStopped())
+						break;
+					printe("getwork failed");
+				}
+				continue;
+			}
+
+			esc::IPCStream is(fd,buf,sizeof(buf),mid);
+			this->handleMsg(mid,is);
+		}
+	}
+
 	void handleInfoRead(esc::IPCStream &is,const esc::FileRead::Request &r) {
 		FILE *str = fopendyn();
 		char *data = NULL;
@@ -308,6 +364,8 @@ private:
 
 	FileSystem<F> *_fs;
 	size_t _clients;
+	size_t _threads;
+	int *_workers;
 };
 
 }
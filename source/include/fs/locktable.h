@@ -0,0 +1,108 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+#include <mutex>
+
+namespace fs {
+
+/**
+ * A table of readers-writer-locks that are identified by arbitrary keys (e.g., the address of a
+ * cached inode or block). Since the number of kernel-semaphores per process is limited, we can't
+ * give every cached object its own lock. Instead, a key occupies an entry of the table only as
+ * long as somebody holds or waits for its lock. Readers are never blocked by other readers, so
+ * that a thread may acquire the same key multiple times in shared mode.
+ */
+class LockTable {
+	struct Entry {
+		ulong key;
+		/* the number of threads that hold or wait for the lock */
+		size_t refs;
+		/* the number of threads that are blocked on <sem> */
+		size_t waits;
+		/* > 0: number of readers, -1: locked exclusively, 0: unlocked */
+		int state;
+		int sem;
+	};
+
+public:
+	enum {
+		SHARED		= 0,
+		EXCLUSIVE	= 1,
+	};
+
+	/**
+	 * Creates a lock-table with given number of entries
+	 *
+	 * @param size the maximum number of keys that can be locked simultaneously
+	 * @throws if the semaphores could not be created
+	 */
+	explicit LockTable(size_t size);
+	/**
+	 * Destroys the table
+	 */
+	~LockTable();
+
+	LockTable(const LockTable&) = delete;
+	LockTable &operator=(const LockTable&) = delete;
+
+	/**
+	 * Acquires the lock for <key>, either SHARED or EXCLUSIVE.
+	 *
+	 * @param key the key
+	 * @param mode the mode (SHARED or EXCLUSIVE)
+	 */
+	void lock(ulong key,uint mode);
+
+	/**
+	 * Tries to acquire the lock for <key> without blocking.
+	 *
+	 * @param key the key
+	 * @param mode the mode (SHARED or EXCLUSIVE)
+	 * @return true if the lock has been acquired
+	 */
+	bool tryLock(ulong key,uint mode);
+
+	/**
+	 * Releases the lock for <key>, that has been acquired in either mode before.
+	 *
+	 * @param key the key
+	 */
+	void unlock(ulong key);
+
+	/**
+	 * Converts the exclusive lock for <key> into a shared lock without releasing it inbetween.
+	 *
+	 * @param key the key
+	 */
+	void downgrade(ulong key);
+
+private:
+	Entry *find(ulong key);
+	Entry *get(ulong key);
+	void wakeup(Entry *e);
+
+	std::mutex _mutex;
+	size_t _size;
+	Entry *_entries;
+};
+
+}
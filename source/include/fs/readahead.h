@@ -0,0 +1,79 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <esc/util.h>
+#include <sys/common.h>
+
+namespace fs {
+
+/**
+ * The readahead state of a stream of reads (e.g., an open file). It detects sequential accesses
+ * and determines which blocks should be read ahead. The window starts with MIN_WINDOW blocks and
+ * is doubled every time it is used up by sequential accesses, up to MAX_WINDOW blocks. A
+ * non-sequential access stops the readahead until the stream is sequential again.
+ */
+struct ReadAhead {
+	static const size_t MIN_WINDOW	= 4;
+	static const size_t MAX_WINDOW	= 64;
+
+	explicit ReadAhead() : next(), end(), window() {
+	}
+
+	/**
+	 * Records the access of the blocks <start> .. <start>+<count>-1 and determines which blocks
+	 * should be read ahead.
+	 *
+	 * @param start the first (logical) block that is accessed
+	 * @param count the number of accessed blocks
+	 * @param raStart will be set to the first block to read ahead
+	 * @return the number of blocks to read ahead (0 = none)
+	 */
+	size_t access(block_t start,size_t count,block_t *raStart) {
+		block_t reqEnd = start + count;
+		if(start != next) {
+			next = end = reqEnd;
+			window = 0;
+			return 0;
+		}
+
+		next = reqEnd;
+		if(end < reqEnd)
+			end = reqEnd;
+		/* as long as more than the half of the window is still ahead, there is nothing to do */
+		if(window > 0 && end - reqEnd > window / 2)
+			return 0;
+
+		window = window == 0 ? MIN_WINDOW : esc::Util::min(window * 2,MAX_WINDOW);
+		*raStart = end;
+		size_t n = reqEnd + window - end;
+		end += n;
+		return n;
+	}
+
+	/* the block we expect to be accessed next */
+	block_t next;
+	/* the end of the area that has been read ahead */
+	block_t end;
+	/* the current window size in blocks */
+	size_t window;
+};
+
+}
@@ -41,7 +41,13 @@ namespace gui {
 			return std::min<gsize_t>(str.length(),width / charWidth);
 		}
 		bool isPixelSet(char c,gpos_t x,gpos_t y) const {
-			return _font[(uchar)c * charHeight + y] & (1 << (charWidth - x - 1));
+			return getRow(c,y) & (1 << (charWidth - x - 1));
+		}
+		/**
+		 * @return the bitmask for row <y> of <c>; the most significant bit is the leftmost pixel
+		 */
+		uint8_t getRow(char c,gpos_t y) const {
+			return _font[(uchar)c * charHeight + y];
 		}
 
 	private:
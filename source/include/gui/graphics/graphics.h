@@ -30,6 +30,7 @@
 #include <sys/common.h>
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
 
 namespace gui {
 	/**
@@ -333,9 +334,7 @@ namespace gui {
 		 */
 		void doSetPixel(gpos_t x,gpos_t y) {
 			gcoldepth_t bpp = Application::getInstance()->getColorDepth();
-			size_t bytespp = bpp / 8;
-			gsize_t bwidth = _buf->getSize().width;
-			uint8_t *addr = getPixels() + ((_off.y + y) * bwidth + (_off.x + x)) * bytespp;
+			uint8_t *addr = getPixelAddr(x,y,bpp / 8);
 
 			switch(bpp) {
 				case 16:
@@ -359,6 +358,21 @@ namespace gui {
 		void updateMinMax(const Pos &pos) {
 			_buf->updateDirty(Pos(_off.x,_off.y) + pos);
 		}
+		/**
+		 * Adds the rectangle spanned by the two given corners to the dirty region
+		 */
+		void updateMinMax(const Pos &p1,const Pos &p2) {
+			Pos pos(std::min(p1.x,p2.x),std::min(p1.y,p2.y));
+			Size size(abs(p2.x - p1.x) + 1,abs(p2.y - p1.y) + 1);
+			_buf->updateDirty(Rectangle(Pos(_off.x,_off.y) + pos,size));
+		}
+		/**
+		 * @return the address of the given pixel in the buffer
+		 */
+		uint8_t *getPixelAddr(gpos_t x,gpos_t y,size_t bytespp) {
+			gsize_t bwidth = _buf->getSize().width;
+			return getPixels() + ((_off.y + y) * bwidth + (_off.x + x)) * bytespp;
+		}
 		/**
 		 * Requests an update for the dirty region
 		 */
@@ -40,6 +40,9 @@ namespace gui {
 		friend class Graphics;
 		friend class UIElement;
 
+		// the maximum number of dirty rectangles; if more are added, they are merged
+		static const size_t MAX_DIRTY	= 8;
+
 	public:
 		/**
 		 * Constructor
@@ -49,8 +52,8 @@ namespace gui {
 		 * @param height height of the window
 		 */
 		GraphicsBuffer(Window *win,const Pos &pos,const Size &size)
-			: _win(win), _pos(pos), _size(size), _minx(0),_miny(0),
-			  _maxx(size.width - 1), _maxy(size.height - 1), _pixels(nullptr) {
+			: _win(win), _pos(pos), _size(size), _dirty(), _dirtyCount(1), _pixels(nullptr) {
+			_dirty[0] = Rectangle(Pos(0,0),size);
 		}
 		/**
 		 * Destructor
@@ -121,35 +124,35 @@ namespace gui {
 		 */
 		void freeBuffer();
 		/**
-		 * @return the dirty rectangle
+		 * @return the number of dirty rectangles
+		 */
+		size_t getDirtyCount() const {
+			return _dirtyCount;
+		}
+		/**
+		 * @param i the index
+		 * @return the dirty rectangle with given index
 		 */
-		Rectangle getDirtyRect() {
-			if(_minx > _maxx)
-				return Rectangle();
-			return Rectangle(Pos(_minx,_miny),Size(_maxx - _minx + 1,_maxy - _miny + 1));
+		const Rectangle &getDirtyRect(size_t i) const {
+			return _dirty[i];
 		}
 		/**
 		 * Marks everything clean
 		 */
 		void resetDirty() {
-			_minx = _size.width - 1;
-			_maxx = 0;
-			_miny = _size.height - 1;
-			_maxy = 0;
+			_dirtyCount = 0;
 		}
 		/**
 		 * Adds the given position to the dirty region
 		 */
 		void updateDirty(const Pos &pos) {
-			if(pos.x > _maxx)
-				_maxx = pos.x;
-			if(pos.x < _minx)
-				_minx = pos.x;
-			if(pos.y > _maxy)
-				_maxy = pos.y;
-			if(pos.y < _miny)
-				_miny = pos.y;
+			updateDirty(Rectangle(pos,Size(1,1)));
 		}
+		/**
+		 * Adds the given rectangle to the dirty region. It is merged with the existing rectangles
+		 * if that doesn't waste too much or if there is no free slot anymore.
+		 */
+		void updateDirty(const Rectangle &r);
 
 	private:
 		// the window instance the buffer belongs to
@@ -159,7 +162,8 @@ namespace gui {
 		// size of the window
 		Size _size;
 		// dirty region
-		gpos_t _minx,_miny,_maxx,_maxy;
+		Rectangle _dirty[MAX_DIRTY];
+		size_t _dirtyCount;
 		// buffer for this window; controls use this, too (don't have their own)
 		uint8_t *_pixels;
 	};
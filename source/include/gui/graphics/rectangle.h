@@ -31,6 +31,14 @@ namespace gui {
 	Rectangle unify(const Rectangle &r1,const Rectangle &r2);
 	Rectangle intersection(const Rectangle &r1,const Rectangle &r2);
 	std::vector<Rectangle> substraction(const Rectangle &r1,const Rectangle &r2);
+	/**
+	 * Adds <r> to the <count> rectangles in <rects>, which has space for <max> rectangles. <r> is
+	 * merged with all rectangles where the union consists of at most 25% clean pixels. If there is
+	 * no free slot afterwards, it is merged with the rectangle that grows the least.
+	 *
+	 * @return the number of merges that have been done
+	 */
+	size_t merge(Rectangle *rects,size_t &count,size_t max,const Rectangle &r);
 
 	class Rectangle {
 		friend Rectangle unify(const Rectangle &r1,const Rectangle &r2);
@@ -83,6 +91,10 @@ namespace gui {
 			_size = s;
 		}
 
+		size_t area() const {
+			return (size_t)_size.width * _size.height;
+		}
+
 		bool empty() const {
 			return _size.empty();
 		}
@@ -0,0 +1,86 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <gui/graphics/color.h>
+#include <sys/common.h>
+
+namespace gui {
+	/**
+	 * Kernels that operate on a span of pixels within one row of a pixel buffer. They are
+	 * specialized for the individual color depths and use SSE2 if the compiler is allowed to.
+	 * Graphics uses them instead of writing one pixel at a time.
+	 */
+	class Span {
+		Span() = delete;
+
+	public:
+		/**
+		 * Sets <count> pixels at <dst> to <col>.
+		 *
+		 * @param dst the address of the first pixel
+		 * @param col the color in the format of the current mode
+		 * @param count the number of pixels
+		 * @param bpp the color depth (16, 24 or 32)
+		 */
+		static void fill(uint8_t *dst,Color::color_type col,size_t count,gcoldepth_t bpp) {
+			switch(bpp) {
+				case 16:
+					fill16(reinterpret_cast<uint16_t*>(dst),col,count);
+					break;
+				case 24:
+					fill24(dst,col,count);
+					break;
+				case 32:
+					fill32(reinterpret_cast<uint32_t*>(dst),col,count);
+					break;
+			}
+		}
+
+		/**
+		 * Copies <count> pixels from <src> to <dst>. The areas must not overlap.
+		 *
+		 * @param dst the destination
+		 * @param src the source
+		 * @param count the number of pixels
+		 * @param bpp the color depth
+		 */
+		static void copy(uint8_t *dst,const uint8_t *src,size_t count,gcoldepth_t bpp) {
+			copyBytes(dst,src,count * (bpp / 8));
+		}
+
+		/**
+		 * Sets the pixels at <dst> to <col>, for which the corresponding bit in <bits> is set. The
+		 * most significant bit belongs to the first pixel. This is used to draw a row of a glyph.
+		 *
+		 * @param dst the address of the first pixel
+		 * @param bits the bitmask
+		 * @param count the number of pixels to consider (at most 8)
+		 * @param col the color in the format of the current mode
+		 * @param bpp the color depth
+		 */
+		static void mask(uint8_t *dst,uint8_t bits,size_t count,Color::color_type col,gcoldepth_t bpp);
+
+		static void fill16(uint16_t *dst,uint16_t col,size_t count);
+		static void fill24(uint8_t *dst,Color::color_type col,size_t count);
+		static void fill32(uint32_t *dst,uint32_t col,size_t count);
+		static void copyBytes(uint8_t *dst,const uint8_t *src,size_t count);
+	};
+}
@@ -30,6 +30,7 @@ enum {
 	CONF_CPU_COUNT				= 6,
 	CONF_TICKS_PER_SEC			= 8,
 	CONF_LOG_SYSCALLS			= 12,
+	CONF_FAULT_AROUND			= 13,	/* pages that are demand-loaded at once */
 	CONF_ROOT_DEVICE			= 32,	/* string */
 	CONF_SWAP_DEVICE			= 33,	/* string */
 };
@@ -113,6 +113,21 @@ static inline int mattr(uintptr_t phys,size_t bytes,int attr) {
 	return syscall3(SYSCALL_MATTR,phys,bytes,attr);
 }
 
+/**
+ * Determines the physical addresses of the <pages> pages beginning with the page that contains
+ * <virt>. The pages have to belong to a locked region (see mlock() and MAP_LOCKED), because
+ * otherwise the physical memory could change at any time. This can be used by drivers to let
+ * devices access the memory directly via DMA.
+ *
+ * @param virt the virtual address
+ * @param pages the number of pages
+ * @param phys the array of <pages> entries that will receive the physical addresses
+ * @return 0 on success
+ */
+static inline int virt2phys(const void *virt,size_t pages,uintptr_t *phys) {
+	return syscall3(SYSCALL_VIRT2PHYS,(ulong)virt,pages,(ulong)phys);
+}
+
 /**
  * Changes the protection of the region denoted by the given address.
  *
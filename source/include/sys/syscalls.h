@@ -114,6 +114,9 @@ enum {
 	SYSCALL_UTIME,
 	SYSCALL_TRUNCATE,
 	SYSCALL_SYMLINK,
+	SYSCALL_SETAFFINITY,
+	SYSCALL_VIRT2PHYS,
+	SYSCALL_PIPE,
 #	ifdef __x86__
 	SYSCALL_REQIOPORTS,
 	SYSCALL_RELIOPORTS,
@@ -73,6 +73,17 @@ static inline void yield(void) {
 	syscall0(SYSCALL_YIELD);
 }
 
+/**
+ * Sets the CPUs the thread <tid> is allowed to run on. The thread has to belong to the own process.
+ *
+ * @param tid the thread-id
+ * @param mask the CPU mask (bit n = CPU n)
+ * @return 0 on success
+ */
+static inline int setaffinity(tid_t tid,ulong mask) {
+	return syscall2(SYSCALL_SETAFFINITY,tid,mask);
+}
+
 /**
  * Notifies the thread in <usecs> microseconds via signal (SIGALRM).
  *
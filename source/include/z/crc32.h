@@ -24,7 +24,9 @@
 namespace z {
 
 /**
- * Computes the Cyclic Redundancy Check.
+ * Computes the Cyclic Redundancy Check. It uses the slicing-by-8 algorithm, which processes 8 bytes
+ * per step with 8 lookup tables, and, on x86_64, the PCLMULQDQ instruction to fold the data 64 bytes
+ * at a time, if the CPU supports it.
  */
 class CRC32 {
 public:
@@ -57,8 +59,31 @@ public:
 	 */
 	type update(type crc,const void *buf,size_t len);
 
+	/**
+	 * Combines the CRCs of two consecutive blocks of data. That is, if <crc1> is the CRC of A and
+	 * <crc2> is the CRC of B, the result is the CRC of A followed by B. This allows to compute the
+	 * CRCs of multiple parts in parallel.
+	 *
+	 * @param crc1 the CRC of the first block
+	 * @param crc2 the CRC of the second block
+	 * @param len2 the length of the second block
+	 * @return the CRC of both blocks
+	 */
+	static type combine(type crc1,type crc2,uint64_t len2);
+
 private:
-	type _table[256];
+	static void init();
+	static type update_slice8(type c,const uint8_t *buf,size_t len);
+#if defined(__x86_64__)
+	static type update_pclmul(type c,const uint8_t *buf,size_t len);
+#endif
+	static type multmodp(type a,type b);
+	static type x2nmodp(uint64_t n,uint k);
+
+	static bool _init;
+	static bool _pclmul;
+	static type _table[8][256];
+	static type _x2n[32];
 };
 
 }
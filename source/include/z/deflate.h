@@ -26,6 +26,7 @@
 #include <z/deflatebase.h>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 
 namespace z {
 
@@ -69,6 +70,22 @@ public:
 	 * @return the next byte
 	 */
 	virtual uint8_t get() = 0;
+
+	/**
+	 * Reads up to <count> bytes into <buffer>. The default implementation reads byte by byte
+	 * via get().
+	 *
+	 * @param buffer the buffer to read into
+	 * @param count the maximum number of bytes
+	 * @return the number of read bytes (0 if the end has been reached)
+	 */
+	virtual size_t read(void *buffer,size_t count) {
+		uint8_t *buf = static_cast<uint8_t*>(buffer);
+		size_t total = 0;
+		while(total < count && cached() > 0)
+			buf[total++] = get();
+		return total;
+	}
 };
 
 /**
@@ -85,6 +102,19 @@ public:
 	 * @param c the character to write
 	 */
 	virtual void put(uint8_t c) = 0;
+
+	/**
+	 * Writes <count> bytes from <buffer> to the drain. The default implementation writes byte by
+	 * byte via put().
+	 *
+	 * @param buffer the data
+	 * @param count the number of bytes
+	 */
+	virtual void write(const void *buffer,size_t count) {
+		const uint8_t *buf = static_cast<const uint8_t*>(buffer);
+		while(count-- > 0)
+			put(*buf++);
+	}
 };
 
 /**
@@ -132,6 +162,21 @@ public:
 		_total++;
 		return _cache[_pos++];
 	}
+	virtual size_t read(void *buffer,size_t count) {
+		uint8_t *buf = static_cast<uint8_t*>(buffer);
+		size_t total = 0;
+		while(total < count) {
+			load();
+			size_t amount = std::min(count - total,_cached - _pos);
+			if(amount == 0)
+				break;
+			memcpy(buf + total,_cache + _pos,amount);
+			_pos += amount;
+			total += amount;
+		}
+		_total += total;
+		return total;
+	}
 
 private:
 	void load() {
@@ -173,27 +218,88 @@ public:
 	virtual void put(uint8_t c) {
 		_os.write(c);
 	}
+	virtual void write(const void *buffer,size_t count) {
+		_os.write(buffer,count);
+	}
 
 private:
 	esc::OStream &_os;
 };
 
 /**
- * The encoder part of the deflate compression algorithm.
+ * The encoder part of the deflate compression algorithm. It searches for matches within a 32 KiB
+ * window using hash chains of the 3-byte prefixes and, depending on the level, lazy matching. The
+ * found literals and matches are collected and emitted as a stored, fixed or dynamic huffman block,
+ * whatever is the smallest.
  */
 class Deflate : public DeflateBase {
+	static const size_t WSIZE			= 32 * 1024;
+	static const size_t WMASK			= WSIZE - 1;
+	static const uint HASH_BITS			= 15;
+	static const size_t HASH_SIZE		= 1 << HASH_BITS;
+	static const uint HASH_SHIFT		= (HASH_BITS + 2) / 3;
+	static const uint MIN_MATCH			= 3;
+	static const uint MAX_MATCH			= 258;
+	/* the minimum lookahead (except at the end of the input) to be able to find a match */
+	static const size_t MIN_LOOKAHEAD	= MAX_MATCH + MIN_MATCH + 1;
+	/* the maximum distance of matches, so that we can always keep MIN_LOOKAHEAD bytes */
+	static const size_t MAX_DIST		= WSIZE - MIN_LOOKAHEAD;
+	/* matches of length 3 are discarded if they are that far away */
+	static const size_t TOO_FAR			= 4096;
+	/* the number of literals/matches per block */
+	static const size_t SYM_COUNT		= 16 * 1024;
+	static const size_t OUT_SIZE		= 4096;
+
+	static const uint LIT_CODES			= 288;
+	static const uint DIST_CODES		= 30;
+	static const uint CL_CODES			= 19;
+	static const uint MAX_BITS			= 15;
+	static const uint MAX_CL_BITS		= 7;
+
+	/* the parameters for a compression level */
+	struct Config {
+		uint16_t good;	/* reduce the search, if we have a match of this length */
+		uint16_t lazy;	/* don't search lazily beyond this length (greedy: max insert length) */
+		uint16_t nice;	/* stop searching, if we have a match of this length */
+		uint16_t chain;	/* the maximum number of entries of the hash chain to look at */
+		bool lazymatch;	/* whether lazy matching is used */
+	};
+
 	struct Tree {
-		unsigned int litbase[4];
-		unsigned int length[4];
-		unsigned int codebase[4];
+		uint32_t freq[LIT_CODES];
+		uint16_t code[LIT_CODES];	/* the bit-reversed codes */
+		uint8_t len[LIT_CODES];
+	};
+
+	struct State {
+		uint8_t window[2 * WSIZE];
+		uint16_t prev[WSIZE];		/* previous position with the same hash */
+		uint16_t head[HASH_SIZE];	/* most recent position for each hash */
+		uint16_t symdist[SYM_COUNT];	/* distance of the match or 0 for literals */
+		uint8_t symlen[SYM_COUNT];	/* the literal or the match length - MIN_MATCH */
+		uint8_t out[OUT_SIZE];
+		Tree ltree;
+		Tree dtree;
+		Tree cltree;
 	};
 
 	struct Data {
 		DeflateSource *source;
-		unsigned int tag;
-		unsigned int bitcount;
-
 		DeflateDrain *drain;
+		const Config *cfg;
+
+		uint64_t bitbuf;
+		uint bitcount;
+		size_t outpos;
+
+		size_t strstart;		/* the current position in the window */
+		size_t lookahead;		/* the number of valid bytes at strstart */
+		ssize_t blockstart;		/* the window position where the current block started */
+		size_t matchstart;
+		uint prevlength;
+		uint inshash;
+		bool eof;
+		size_t symcount;
 	};
 
 	enum {
@@ -201,42 +307,76 @@ class Deflate : public DeflateBase {
 		FAILED	= -1
 	};
 
+	enum BlockType {
+		BT_STORED	= 0,
+		BT_FIXED	= 1,
+		BT_DYNAMIC	= 2
+	};
+
 public:
 	enum Level {
 		NONE	= 0,
-		FIXED	= 1,
-		DYN		= 2
+		FASTEST	= 1,
+		DEFAULT	= 6,
+		BEST	= 9
 	};
 
 	/**
 	 * Constructor
 	 */
 	explicit Deflate();
+	/**
+	 * Destructor
+	 */
+	~Deflate();
+
+	/* no cloning */
+	Deflate(const Deflate&) = delete;
+	Deflate &operator=(const Deflate&) = delete;
 
 	/**
 	 * Compresses the data in <source> into <drain>.
 	 *
 	 * @param drain the destination
 	 * @param source the source
-	 * @param compr the compression level
+	 * @param compr the compression level (NONE .. BEST)
 	 * @return 0 on success or -1 on error
 	 */
 	int compress(DeflateDrain *drain,DeflateSource *source,int compr);
 
 private:
 	void flush(Data *d);
-	void writebit(Data *d,int bit);
-	void write_bits(Data *d,unsigned int bits,int num);
-	void write_bits_reverse(Data *d,unsigned int bits,unsigned int num);
-	void write_symbol(Data *d,Tree *t,unsigned int sym);
-	void write_int(Data *d,Tree *t,unsigned short *base,unsigned char *bits,unsigned int value,int add);
-	void write_symbol_chain(Data *d,Tree *lt,Tree *dt,unsigned int len,unsigned int dist);
-
-	void deflate_fixed_block(Data *d);
-	void deflate_uncompressed_block(Data *d);
-
-	Tree sltree;
-	Tree sdtree;
+	void put_byte(Data *d,uint8_t c);
+	void put_bits(Data *d,uint bits,uint num);
+	void align(Data *d);
+
+	static void build_tree(Tree *t,uint num,uint maxbits);
+	static void build_codes(Tree *t,uint num);
+
+	void fill_window(Data *d);
+	uint insert_string(Data *d,size_t pos);
+	uint longest_match(Data *d,uint cur);
+
+	bool tally_lit(Data *d,uint8_t c);
+	bool tally_match(Data *d,uint dist,uint len);
+
+	uint encode_lengths(Data *d,uint hlit,uint hdist,uint16_t *syms);
+	void compress_block(Data *d,const Tree *lt,const Tree *dt);
+	void stored_block(Data *d,const uint8_t *buf,size_t len,bool last);
+	void flush_block(Data *d,bool last);
+
+	void deflate_stored(Data *d);
+	void deflate_fast(Data *d);
+	void deflate_slow(Data *d);
+
+	State *_state;
+	Tree _fltree;
+	Tree _fdtree;
+	uint8_t _lcode[MAX_MATCH - MIN_MATCH + 1];
+	uint8_t _dcode[512];
+
+	static const Config configs[];
+	static const unsigned char clcidx[];
 };
 
 }
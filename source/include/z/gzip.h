@@ -43,6 +43,11 @@ struct GZipHeader {
 		MDEFLATE	= 8
 	};
 
+	enum XFlags {
+		XFSLOW		= 1 << 1,	/* maximum compression */
+		XFFAST		= 1 << 2,	/* fastest compression */
+	};
+
 	/**
 	 * Constructor. Creates a new GZip header, that can be written to a file, for example.
 	 *
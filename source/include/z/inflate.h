@@ -26,6 +26,7 @@
 #include <z/deflatebase.h>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 
 namespace z {
 
@@ -72,6 +73,19 @@ public:
 	 * @param c the character to write
 	 */
 	virtual void put(uint8_t c) = 0;
+
+	/**
+	 * Appends <len> bytes, starting <off> bytes ago, to the drain. Note that the regions might
+	 * overlap (off < len), in which case the already copied bytes are repeated. The default
+	 * implementation copies byte by byte via get() and put().
+	 *
+	 * @param off the offset (at most 32*1024)
+	 * @param len the number of bytes to copy
+	 */
+	virtual void copy(size_t off,size_t len) {
+		while(len-- > 0)
+			put(get(off));
+	}
 };
 
 /**
@@ -125,6 +139,23 @@ public:
 			_checksum = _crc.update(_checksum,_buf,BUF_SIZE);
 	}
 
+	virtual void copy(size_t off,size_t len) {
+		assert(off > 0 && off <= BUF_SIZE);
+		while(len > 0) {
+			// copy as much as possible without wrapping around in the source or destination
+			size_t src = (_wpos - off) % BUF_SIZE;
+			size_t amount = std::min(len,BUF_SIZE - std::max(_wpos,src));
+			for(size_t i = 0; i < amount; ++i)
+				_buf[_wpos + i] = _buf[src + i];
+			_os.write(_buf + _wpos,amount);
+
+			_wpos = (_wpos + amount) % BUF_SIZE;
+			if(_wpos == 0)
+				_checksum = _crc.update(_checksum,_buf,BUF_SIZE);
+			len -= amount;
+		}
+	}
+
 private:
 	CRC32 _crc;
 	CRC32::type _checksum;
@@ -172,27 +203,75 @@ public:
 			_buffer[_pos++] = c;
 	}
 
+	virtual void copy(size_t off,size_t len) {
+		assert(off > 0 && off <= _pos);
+		len = std::min(len,_size - _pos);
+		uint8_t *dst = _buffer + _pos;
+		const uint8_t *src = dst - off;
+		_pos += len;
+
+		// if the regions are at least a word apart, we can copy word-wise. the overlapping at the
+		// end does not matter, because we copy from front to back
+		if(off >= sizeof(ulong)) {
+			for(; len >= sizeof(ulong); len -= sizeof(ulong)) {
+				ulong w;
+				memcpy(&w,src,sizeof(w));
+				memcpy(dst,&w,sizeof(w));
+				src += sizeof(ulong);
+				dst += sizeof(ulong);
+			}
+		}
+		while(len-- > 0)
+			*dst++ = *src++;
+	}
+
 private:
 	uint8_t *_buffer;
 	size_t _size;
 	size_t _pos;
 };
 
+/**
+ * The decoder part of the deflate compression algorithm. Instead of walking the huffman codes bit
+ * by bit, it decodes each symbol with at most two table lookups: a primary table, indexed by the
+ * next LIT_BITS or DIST_BITS bits, and subtables for the longer codes. The bits are collected in
+ * a 64-bit buffer.
+ */
 class Inflate : public DeflateBase {
-	struct Tree {
-		unsigned short table[16];  /* table of code length counts */
-		unsigned short trans[288]; /* code -> symbol translation table */
+	/* the maximum length of a huffman code */
+	static const uint MAX_BITS		= 15;
+	/* the number of bits used to index the primary tables */
+	static const uint LIT_BITS		= 10;
+	static const uint DIST_BITS		= 9;
+	static const uint CODE_BITS		= 7;
+	/* the number of table entries, including the subtables. these are upper bounds for all
+	 * complete codes with the corresponding number of symbols */
+	static const size_t LIT_ENTRIES		= (1 << LIT_BITS) + 1536;
+	static const size_t DIST_ENTRIES	= (1 << DIST_BITS) + 512;
+	static const size_t CODE_ENTRIES	= 1 << CODE_BITS;
+
+	/* a table entry consists of the symbol (or the offset of the subtable) in bits 0..15, the
+	 * code length (or the number of index bits of the subtable) in bits 16..23 and the SUB flag.
+	 * zero denotes an invalid entry. */
+	enum {
+		ENT_SUB		= 1 << 24,
+	};
+
+	struct Tables {
+		uint32_t flit[LIT_ENTRIES];		/* fixed length/symbol table */
+		uint32_t fdist[DIST_ENTRIES];	/* fixed distance table */
+		uint32_t lit[LIT_ENTRIES];		/* dynamic length/symbol table */
+		uint32_t dist[DIST_ENTRIES];	/* dynamic distance table */
+		uint32_t codes[CODE_ENTRIES];	/* code length table */
 	};
 
 	struct Data {
 		InflateSource *source;
-		unsigned int tag;
-		unsigned int bitcount;
+		uint64_t bitbuf;
+		uint bitcount;
 
 		InflateDrain *drain;
-
-		Tree ltree; /* dynamic length/symbol tree */
-		Tree dtree; /* dynamic distance tree */
+		size_t written;
 	};
 
 	enum {
@@ -205,9 +284,18 @@ public:
 	 * Constructor
 	 */
 	explicit Inflate();
+	/**
+	 * Destructor
+	 */
+	~Inflate();
+
+	/* no cloning */
+	Inflate(const Inflate&) = delete;
+	Inflate &operator=(const Inflate&) = delete;
 
 	/**
-	 * Uncompresses the data in <source> into <drain>.
+	 * Uncompresses the data in <source> into <drain>. Note that it reads exactly the bytes of the
+	 * compressed data from <source>, so that a trailer can be read afterwards.
 	 *
 	 * @param drain the destination
 	 * @param source the source
@@ -216,27 +304,28 @@ public:
 	int uncompress(InflateDrain *drain,InflateSource *source);
 
 private:
-	void build_fixed_trees(Tree *lt,Tree *dt);
-	void build_tree(Tree *t,const unsigned char *lengths,unsigned int num);
+	static bool build_table(uint32_t *table,size_t size,uint bits,const uint8_t *lengths,uint num);
 
-	void flush(Data *d);
-	void writebit(Data *d,int bit);
-	void write_bits(Data *d,unsigned int bits,int num);
-
-	int getbit(Data *d);
-	unsigned int read_bits(Data *d,int num,int base);
-	int decode_symbol(Data *d,Tree *t);
-	void decode_trees(Data *d,Tree *lt,Tree *dt);
+	static void fetch(Data *d) {
+		d->bitbuf |= static_cast<uint64_t>(d->source->get()) << d->bitcount;
+		d->bitcount += 8;
+	}
+	static void consume(Data *d,uint num) {
+		d->bitbuf >>= num;
+		d->bitcount -= num;
+	}
 
-	int deflate_uncompressed_block(Data *d);
+	uint read_bits(Data *d,uint num,uint base);
+	uint8_t read_byte(Data *d);
+	int decode_symbol(Data *d,const uint32_t *table,uint bits);
+	int decode_trees(Data *d,uint32_t *lt,uint32_t *dt);
 
-	int inflate_block_data(Data *d,Tree *lt,Tree *dt);
+	int inflate_block_data(Data *d,const uint32_t *lt,const uint32_t *dt);
 	int inflate_uncompressed_block(Data *d);
 	int inflate_fixed_block(Data *d);
 	int inflate_dynamic_block(Data *d);
 
-	Tree sltree; /* fixed length/symbol tree */
-	Tree sdtree; /* fixed distance tree */
+	Tables *_tables;
 
 	/* special ordering of code length codes */
 	static const unsigned char clcidx[];
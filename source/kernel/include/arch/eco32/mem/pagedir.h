@@ -102,6 +102,11 @@ inline void PageDirBase::removeAccess(A_UNUSED frameno_t frame) {
 	/* nothing to do */
 }
 
+inline bool PageDirBase::testAndClearAccessed(A_UNUSED uintptr_t virt) {
+	/* the TLB doesn't record accesses */
+	return false;
+}
+
 inline bool PageDirBase::isPresent(uintptr_t virt) const {
 	const PageDir *pdir = static_cast<const PageDir*>(this);
 	return pdir->pts.isPresent(virt);
@@ -36,6 +36,13 @@ public:
 		return kstackFrame;
 	}
 
+	/**
+	 * @return true if the thread is currently switched out by some CPU (never on uniprocessors)
+	 */
+	bool isSwitching() const {
+		return false;
+	}
+
 private:
 	static void startup() asm("thread_startup");
 	static bool save(ThreadRegs *saveArea) asm("thread_save");
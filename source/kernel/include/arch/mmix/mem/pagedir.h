@@ -110,6 +110,11 @@ inline bool PageDirBase::isInUserSpace(uintptr_t virt,size_t count) {
 	return virt + count <= DIR_MAP_AREA && virt + count >= virt;
 }
 
+inline bool PageDirBase::testAndClearAccessed(A_UNUSED uintptr_t virt) {
+	/* the TLB doesn't record accesses */
+	return false;
+}
+
 inline bool PageDirBase::isPresent(uintptr_t virt) const {
 	const PageDir *pdir = static_cast<const PageDir*>(this);
 	uint64_t pte = pdir->getPTE(virt);
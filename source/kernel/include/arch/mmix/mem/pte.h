@@ -37,6 +37,8 @@
 #define PTE_NOTSUPER				0
 #define PTE_GLOBAL					0
 #define PTE_NO_EXEC					0
+/* the TLB doesn't record accesses */
+#define PTE_ACCESSED				0
 
 /*
  * PTE:
@@ -48,6 +48,13 @@ public:
 		return kstackFrame;
 	}
 
+	/**
+	 * @return true if the thread is currently switched out by some CPU (never on uniprocessors)
+	 */
+	bool isSwitching() const {
+		return false;
+	}
+
 	void makeIdle() {
 		flags |= T_IDLE;
 	}
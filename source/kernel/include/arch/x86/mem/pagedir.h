@@ -135,6 +135,11 @@ inline void PageDirBase::removeAccess(frameno_t frame) {
 		PageDir::unmapFromTemp();
 }
 
+inline bool PageDirBase::testAndClearAccessed(uintptr_t virt) {
+	PageDir *pdir = static_cast<PageDir*>(this);
+	return pdir->pts.testAndClearAccessed(virt);
+}
+
 inline bool PageDirBase::isPresent(uintptr_t virt) const {
 	const PageDir *pdir = static_cast<const PageDir*>(this);
 	return pdir->pts.isPresent(virt);
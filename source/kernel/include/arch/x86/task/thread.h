@@ -27,7 +27,8 @@
 class Thread : public ThreadBase {
 	friend class ThreadBase;
 
-	Thread(Proc *p,uint8_t flags) : ThreadBase(p,flags), kernelStack(), fpuState(), fpuSem(0) {
+	Thread(Proc *p,uint8_t flags)
+		: ThreadBase(p,flags), kernelStack(), fpuState(), fpuSem(0), switchLock() {
 	}
 
 public:
@@ -52,6 +53,14 @@ public:
 		return fpuSem;
 	}
 
+	/**
+	 * @return true if the thread is currently switched out by some CPU, i.e. its state is not
+	 *  completely saved yet and it can therefore not be resumed by another CPU
+	 */
+	bool isSwitching() const {
+		return switchLock.isLocked();
+	}
+
 private:
 	static void startup() asm("thread_startup");
 	static bool save(ThreadRegs *saveArea) asm("thread_save");
@@ -62,6 +71,8 @@ private:
 	/* FPU-state; initially NULL */
 	FPU::XState *fpuState;
 	BaseSem fpuSem;
+	/* held by the CPU that switches away from this thread until its state is saved */
+	SpinLock switchLock;
 };
 
 inline Thread *ThreadBase::getRunning() {
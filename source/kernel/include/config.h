@@ -24,6 +24,9 @@
 class Config {
 	static const size_t MAX_BPNAME_LEN		= 16;
 	static const size_t MAX_BPVAL_LEN		= 32;
+	/* the default and maximum number of pages that are demand-loaded at once */
+	static const size_t DEF_FAULT_AROUND	= 8;
+	static const size_t MAX_FAULT_AROUND	= 32;
 
 public:
 	enum {
@@ -40,6 +43,7 @@ public:
 		FORCE_PIC		= 10,
 		ACCURATE_CPU	= 11,
 		LOG_SYSCALLS	= 12,
+		FAULT_AROUND	= 13,
 		ROOT_DEVICE		= 32,
 		SWAP_DEVICE		= 33,
 	};
@@ -72,6 +76,7 @@ private:
 	static void set(const char *name,const char *value);
 
 	static uint32_t flags;
+	static size_t faultAround;
 	static char rootDev[];
 	static char swapDev[];
 };
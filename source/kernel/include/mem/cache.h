@@ -33,9 +33,33 @@ class Cache {
 		size_t totalObjs;
 		size_t freeObjs;
 		void *freeList;
+		size_t magSize;
+	};
+
+	/* the max. number of objects per magazine */
+	static const size_t MAG_SIZE	= 32;
+
+	/**
+	 * A magazine caches free objects of one size-class for one CPU. Thus, most allocations and
+	 * frees can be handled without touching the shared freelists and therefore without the global
+	 * lock. The lock of a magazine is only contended if a thread is moved to a different CPU in the
+	 * middle of an operation.
+	 */
+	struct Magazine {
+		SpinLock lock;
+		size_t count;
+		ulong hits;
+		ulong misses;
+		void *objs[MAG_SIZE];
 	};
 
 public:
+	/**
+	 * Creates the per-CPU magazines. Until then, all requests are served from the shared
+	 * freelists. Has to be called as soon as the number of CPUs is known.
+	 */
+	static void initMagazines();
+
 	/**
 	 * Allocates <size> bytes from the cache
 	 *
@@ -98,6 +122,13 @@ public:
 	 */
 	static void print(OStream &os);
 
+	/**
+	 * Prints the hits and misses of the per-CPU magazines for each size-class
+	 *
+	 * @param os the output-stream
+	 */
+	static void printStats(OStream &os);
+
 	#if DEBUGGING
 	/**
 	 * Enables/disables "allocate and free" prints
@@ -113,10 +144,14 @@ private:
 	static size_t totalObjSize(size_t sz);
 	static void printBar(OStream &os,size_t mem,size_t maxMem,size_t total,size_t free);
 	static void *get(Entry *c,size_t i);
+	static ulong *pop(Entry *c);
+	static bool refill(Entry *c,Magazine *m);
+	static void flush(Entry *c,Magazine *m);
 
 #if DEBUGGING
 	static bool aafEnabled;
 #endif
 	static SpinLock lock;
 	static Entry caches[];
+	static Magazine *mags;
 };
@@ -19,22 +19,16 @@
 
 #pragma once
 
-#include <esc/col/slist.h>
 #include <task/proc.h>
 #include <common.h>
 
+/**
+ * Keeps track of the frames that are shared copy-on-write. The number of users of a frame is
+ * stored in the frame-metadata of PhysMem, so that all operations are O(1) and don't need a lock.
+ */
 class CopyOnWrite {
 	CopyOnWrite() = delete;
 
-	struct Entry : public esc::SListItem {
-		explicit Entry(frameno_t frameNo) : esc::SListItem(), frameNumber(frameNo), refCount(0) {
-		}
-		frameno_t frameNumber;
-		size_t refCount;
-	};
-
-	static const size_t HEAP_SIZE	= 64;
-
 public:
 	/**
 	 * Handles a pagefault for given address. Assumes that the pagefault was caused by a write access
@@ -64,22 +58,19 @@ public:
 	static size_t remove(frameno_t frameNo,bool *foundOther);
 
 	/**
-	 * Note that this is intended for debugging or similar only! (not very efficient)
-	 *
 	 * @return the number of different frames that are in the cow-list
 	 */
-	static size_t getFrmCount();
+	static size_t getFrmCount() {
+		return frameCount;
+	}
 
 	/**
-	 * Prints the cow-list
+	 * Prints the cow-list. Note that this is intended for debugging only (not very efficient)!
 	 *
 	 * @param os the output-stream
 	 */
 	static void print(OStream &os);
 
 private:
-	static Entry *getByFrame(frameno_t frameNo,bool dec);
-
-	static esc::SList<Entry> frames[];
-	static SpinLock lock;
+	static size_t frameCount;
 };
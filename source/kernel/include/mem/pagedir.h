@@ -181,6 +181,15 @@ public:
 	 */
 	frameno_t getFrameNo(uintptr_t virt) const;
 
+	/**
+	 * Determines whether the given page has been accessed since the last call and clears the
+	 * accessed-bit. On architectures without such a bit, false is returned.
+	 *
+	 * @param virt the virtual address
+	 * @return true if it has been accessed
+	 */
+	bool testAndClearAccessed(uintptr_t virt);
+
 	/**
 	 * Clones <count> pages at <virtSrc> to <virtDst> from <this> into <dst>. That means
 	 * the flags and frames are copied. Additionally, if <share> is false all present pages will
@@ -22,6 +22,7 @@
 #include <mem/physmem.h>
 #include <mem/layout.h>
 #include <assert.h>
+#include <atomic.h>
 #include <common.h>
 #include <cppsupport.h>
 
@@ -221,6 +222,23 @@ public:
 		return PTE_FRAMENO(*pte) + (virt - base) / PAGE_SIZE;
 	}
 
+	/**
+	 * Determines whether the given page has been accessed since the last call and clears the
+	 * accessed-bit. Note that we don't flush the TLB, so that the CPU might not notice further
+	 * accesses until the entry is evicted from the TLB. That's good enough to find cold pages.
+	 *
+	 * @param virt the virtual address
+	 * @return true if it has been accessed
+	 */
+	bool testAndClearAccessed(uintptr_t virt) {
+		uintptr_t base = virt;
+		pte_t *pte = getPTE(virt,&base);
+		if(!pte || !(*pte & PTE_ACCESSED))
+			return false;
+		Atomic::fetch_and_and(pte,~PTE_ACCESSED);
+		return true;
+	}
+
 	/**
 	 * Clones <count> pages at <virtSrc> to <virtDst> from <this> into <dst>. That means
 	 * the flags and frames are copied. Additionally, if <share> is false all present pages will
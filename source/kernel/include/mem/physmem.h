@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <assert.h>
+#include <atomic.h>
 #include <common.h>
 #include <lockguard.h>
 #include <spinlock.h>
@@ -56,6 +58,19 @@ class PhysMem {
 		frameno_t *frames;
 	};
 
+	/* the metadata we store for every frame */
+	struct FrameInfo {
+		/* the number of users of the frame if it's shared copy-on-write */
+		uint32_t refs;
+		/* FRM_* */
+		uint32_t flags;
+	};
+
+	enum {
+		/* the frame has been accessed during the last round of the swapper's clock */
+		FRM_ACTIVE	= 1 << 0,
+	};
+
 	static const size_t BITS_PER_BMWORD				= sizeof(tBitmap) * 8;
 	static const ulong KERNEL_MEM_PERCENT			= 20;
 	static const ulong KERNEL_MEM_MIN				= 750;
@@ -176,6 +191,13 @@ public:
 	 */
 	static bool reserve(size_t frameCount,bool swap);
 
+	/**
+	 * Gives back <frameCount> frames that have been announced with reserve(), but not allocated.
+	 *
+	 * @param frameCount the number of frames
+	 */
+	static void unreserve(size_t frameCount);
+
 	/**
 	 * Allocates one frame. Assumes that it is available. You should announce it with reserve()
 	 * first!
@@ -193,6 +215,66 @@ public:
 	 */
 	static void free(frameno_t frame,FrameType type);
 
+	/**
+	 * Hands the given frames, that have been allocated as KERN, over to userspace. That is, they
+	 * are no longer charged to the kernel and will be freed as USR frames later.
+	 *
+	 * @param frames the frame-numbers
+	 * @param count the number of frames
+	 */
+	static void giveToUser(const frameno_t *frames,size_t count);
+
+	/**
+	 * Atomically adds <value> to the reference-count of the given frame.
+	 *
+	 * @param frame the frame-number
+	 * @param value the value to add (may be negative)
+	 * @return the old reference-count
+	 */
+	static uint32_t addRef(frameno_t frame,int32_t value) {
+		vassert(frame < infoFrames,"Frame %#x is not managed",frame);
+		return Atomic::fetch_and_add(&frameInfo[frame].refs,value);
+	}
+
+	/**
+	 * @param frame the frame-number
+	 * @return the reference-count of the given frame
+	 */
+	static uint32_t getRefs(frameno_t frame) {
+		vassert(frame < infoFrames,"Frame %#x is not managed",frame);
+		return frameInfo[frame].refs;
+	}
+
+	/**
+	 * @param frame the frame-number
+	 * @return true if the frame is on the active list, i.e., has recently been accessed
+	 */
+	static bool isActive(frameno_t frame) {
+		vassert(frame < infoFrames,"Frame %#x is not managed",frame);
+		return frameInfo[frame].flags & FRM_ACTIVE;
+	}
+
+	/**
+	 * Moves the given frame to the active or inactive list. This is only done by the swapper.
+	 *
+	 * @param frame the frame-number
+	 * @param active whether it should be active
+	 */
+	static void setActive(frameno_t frame,bool active) {
+		vassert(frame < infoFrames,"Frame %#x is not managed",frame);
+		if(active)
+			frameInfo[frame].flags |= FRM_ACTIVE;
+		else
+			frameInfo[frame].flags &= ~FRM_ACTIVE;
+	}
+
+	/**
+	 * @return the number of frames for which we store metadata
+	 */
+	static size_t getInfoFrames() {
+		return infoFrames;
+	}
+
 	/**
 	 * Swaps the page with given address for the current process in
 	 *
@@ -263,9 +345,14 @@ private:
 
 	static bool initialized;
 
+	/* the metadata for all frames up to the end of the usable memory, indexed by frame-number */
+	static FrameInfo *frameInfo;
+	static size_t infoFrames;
+
 	/* for swapping */
 	static size_t swappedOut;
 	static size_t swappedIn;
+	static uint64_t refaultAge;	/* sum of the swap-ages of all swapped in pages */
 	static bool swapEnabled;
 	static bool swapping;
 	static Thread *swapperThread;
@@ -153,6 +153,36 @@ public:
 		timestamp = ts;
 	}
 
+	/**
+	 * @return the page at which the swapper continues to look for a page to swap out
+	 */
+	size_t getClockHand() const {
+		return clockHand;
+	}
+	void setClockHand(size_t page) {
+		clockHand = page;
+	}
+
+	/**
+	 * @return the number of page-faults that demand-loaded pages from the file
+	 */
+	size_t getDemandLoads() const {
+		return demandLoads;
+	}
+	/**
+	 * @return the number of page-faults that have been saved by loading more than one page
+	 */
+	size_t getSavedFaults() const {
+		return savedFaults;
+	}
+	/**
+	 * Records a page-fault that demand-loaded <pages> pages from the file
+	 */
+	void addDemandLoad(size_t pages) {
+		demandLoads++;
+		savedFaults += pages - 1;
+	}
+
 	/**
 	 * @return the flags of the given page
 	 */
@@ -255,6 +285,9 @@ private:
 	size_t loadCount;
 	size_t byteCount;
 	uint64_t timestamp;
+	size_t clockHand;
+	size_t demandLoads;
+	size_t savedFaults;
 	size_t pfSize;			/* size of pageFlags */
 	ulong *pageFlags;		/* flags for each page; upper bits: swap-block, if swapped */
 	esc::ISList<VirtMem*> vms;
@@ -30,6 +30,7 @@ class SwapMap {
 
 	struct Block {
 		uint refCount;
+		ulong stamp;	/* the value of <allocs> when the block has been allocated */
 		Block *next;
 	};
 
@@ -51,6 +52,15 @@ public:
 	 */
 	static ulong alloc();
 
+	/**
+	 * Determines the number of blocks that have been allocated after the given one, i.e., how many
+	 * other pages have been swapped out since the page in the given block.
+	 *
+	 * @param block the block-number
+	 * @return the age of the block
+	 */
+	static ulong getAge(ulong block);
+
 	/**
 	 * Increases the references of the given block
 	 *
@@ -97,6 +107,7 @@ private:
 	static size_t freeBlocks;
 	static Block *swapBlocks;
 	static Block *freeList;
+	static ulong allocs;
 	static SpinLock lock;
 };
 
@@ -106,6 +117,12 @@ inline void SwapMap::incRefs(ulong block) {
 	swapBlocks[block].refCount++;
 }
 
+inline ulong SwapMap::getAge(ulong block) {
+	LockGuard<SpinLock> g(&lock);
+	assert(block < totalBlocks && swapBlocks[block].refCount > 0);
+	return allocs - swapBlocks[block].stamp;
+}
+
 inline bool SwapMap::isUsed(ulong block) {
 	LockGuard<SpinLock> g(&lock);
 	assert(block < totalBlocks);
@@ -95,9 +95,10 @@ public:
 	 * @param file the file to write to
 	 * @param t the thread that wants to swap the page in (and has reserved the frame to do so)
 	 * @param addr the address of the page to swap in
+	 * @param age will be set to the number of pages that have been swapped out after this one
 	 * @return true on success
 	 */
-	static bool swapIn(OpenFile *file,Thread *t,uintptr_t addr);
+	static bool swapIn(OpenFile *file,Thread *t,uintptr_t addr,ulong *age);
 
 	/**
 	 * Sets the timestamp for all regions that are used by the given thread
@@ -215,6 +216,16 @@ public:
 	 */
 	int lockall();
 
+	/**
+	 * Determines the physical address of <addr>. This is only supported for locked regions,
+	 * because the frame of other pages might change at any time.
+	 *
+	 * @param addr the virtual address
+	 * @param phys will be set to the physical address
+	 * @return 0 on success
+	 */
+	int getPhysAddr(uintptr_t addr,uintptr_t *phys);
+
 	/**
 	 * This is a helper-function for determining the real memory-usage of all processes. It counts
 	 * the number of present frames in all regions of the given process and divides them for each
@@ -281,6 +292,20 @@ public:
 	 */
 	int unmap(uintptr_t virt);
 
+	/**
+	 * Replaces the frames of the <count> pages starting at <addr> with the given ones, which have
+	 * to be PhysMem::KERN frames. This is only possible for present pages that are owned by this
+	 * process, i.e. that belong to a private, writable and anonymous region. It stops at the first
+	 * page that does not fulfill that. The old frames are given back as PhysMem::KERN frames.
+	 * Note that this virtmem has to be the current one.
+	 *
+	 * @param addr the page-aligned virtual address
+	 * @param frames the new frames
+	 * @param count the number of pages
+	 * @return the number of replaced pages (starting at <addr>)
+	 */
+	size_t replaceFrames(uintptr_t addr,const frameno_t *frames,size_t count);
+
 	/**
 	 * Joins virtmem <dst> to the region <rno> of this virtmem. This can only be used for shared-
 	 * memory!
@@ -387,7 +412,8 @@ private:
 	}
 
 	static Region *getLRURegion();
-	static ssize_t getPgIdxForSwap(const Region *reg);
+	static ssize_t getPgIdxForSwap(Region *reg);
+	static bool isAccessed(Region *reg,size_t index);
 	static void setSwappedOut(Region *reg,size_t index);
 	static void setSwappedIn(Region *reg,size_t index,frameno_t frameNo);
 
@@ -398,7 +424,8 @@ private:
 	void doUnmap(VMRegion *vm);
 	size_t doGrow(VMRegion *vm,ssize_t amount);
 	int demandLoad(VMRegion *vm,uintptr_t addr);
-	int loadFromFile(VMRegion *vm,uintptr_t addr,size_t loadCount);
+	int loadFromFile(VMRegion *vm,uintptr_t addr,size_t pages);
+	void mapPage(VMRegion *vm,uintptr_t addr,frameno_t frame);
 	uintptr_t findFreeStack(size_t byteCount,ulong rflags);
 	bool isOccupied(uintptr_t start,uintptr_t end) const;
 	uintptr_t getFirstUsableAddr() const;
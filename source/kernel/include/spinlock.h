@@ -32,6 +32,13 @@ public:
 	bool tryDown();
 	void up();
 
+	/**
+	 * @return true if the lock is currently held by somebody
+	 */
+	bool isLocked() const {
+		return *const_cast<volatile const uint*>(&lock) != 0;
+	}
+
 private:
 	uint lock;
 };
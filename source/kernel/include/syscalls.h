@@ -129,6 +129,7 @@ private:
 
 	// io
 	static int open(Thread *t,IntrptStackFrame *stack);
+	static int pipe(Thread *t,IntrptStackFrame *stack);
 	static int fcntl(Thread *t,IntrptStackFrame *stack);
 	static int tell(Thread *t,IntrptStackFrame *stack);
 	static int seek(Thread *t,IntrptStackFrame *stack);
@@ -170,6 +171,7 @@ private:
 	static int munmap(Thread *t,IntrptStackFrame *stack);
 	static int mmapphys(Thread *t,IntrptStackFrame *stack);
 	static int mattr(Thread *t,IntrptStackFrame *stack);
+	static int virt2phys(Thread *t,IntrptStackFrame *stack);
 	static int mlock(Thread *t,IntrptStackFrame *stack);
 	static int mlockall(Thread *t,IntrptStackFrame *stack);
 
@@ -200,6 +202,7 @@ private:
 	static int sleep(Thread *t,IntrptStackFrame *stack);
 	static int yield(Thread *t,IntrptStackFrame *stack);
 	static int join(Thread *t,IntrptStackFrame *stack);
+	static int setaffinity(Thread *t,IntrptStackFrame *stack);
 	static int semcrt(Thread *t,IntrptStackFrame *stack);
 	static int semcrtirq(Thread *t,IntrptStackFrame *stack);
 	static int semop(Thread *t,IntrptStackFrame *stack);
@@ -36,7 +36,9 @@ enum {
 	EV_SWAP_FREE,
 	EV_THREAD_DIED,
 	EV_CHILD_DIED,
-	EV_COUNT = EV_CHILD_DIED,
+	EV_PIPE_DATA,
+	EV_PIPE_SPACE,
+	EV_COUNT = EV_PIPE_SPACE,
 };
 
 class Thread;
@@ -56,7 +58,8 @@ public:
 	static void init();
 
 	/**
-	 * Lets <tid> wait for the given event and object
+	 * Lets <tid> wait for the given event and object. The thread is put into the wait-queue for
+	 * this pair, so that wakeup() only needs to look at the threads that wait for the same object.
 	 *
 	 * @param t the thread
 	 * @param event the event to wait for
@@ -74,11 +77,20 @@ public:
 	static void wakeup(uint event,evobj_t object,bool all = true);
 
 	/**
-	 * @return the current ready-mask. 1 bit per priority.
+	 * @param cpu the CPU
+	 * @return the current ready-mask of the given CPU. 1 bit per priority.
+	 */
+	static ulong getReadyMask(cpuid_t cpu);
+
+	/**
+	 * Sets the CPUs the given thread is allowed to run on. If the thread is not allowed to run on
+	 * its current CPU anymore, it is moved to another run-queue.
+	 *
+	 * @param t the thread
+	 * @param mask the CPU mask (1 bit per CPU)
+	 * @return 0 on success
 	 */
-	static ulong getReadyMask() {
-		return readyMask;
-	}
+	static int setAffinity(Thread *t,ulong mask);
 
 	/**
 	 * Blocks the given thread
@@ -115,6 +127,12 @@ public:
 	static const char *getEventName(uint event);
 
 private:
+	struct RunQueue;
+	struct WaitQueue;
+
+	/* the number of wait-queues in the hashtable (has to be a power of 2) */
+	static const size_t WAIT_QUEUE_COUNT	= 256;
+
 	/**
 	 * Adds the given thread as an idle-thread to the scheduler
 	 *
@@ -140,14 +158,17 @@ private:
 	static void adjustPrio(Thread *t,uint64_t total);
 
 	/**
-	 * Appends the given thread on the ready-queue and sets the state to Thread::READY
+	 * Appends the given thread on the ready-queue and sets the state to Thread::READY. Expects
+	 * that the thread has been locked via lockThread().
 	 *
+	 * @param rq the run-queue of <t> (locked)
 	 * @param t the thread
+	 * @return the locked run-queue that <t> belongs to now
 	 */
-	static void setReady(Thread *t);
+	static RunQueue *setReady(RunQueue *rq,Thread *t);
 
 	/**
-	 * Sets the thread in the blocked-state
+	 * Sets the thread in the blocked-state. Expects that its run-queue is locked.
 	 *
 	 * @param t the thread
 	 */
@@ -160,28 +181,79 @@ private:
 	 */
 	static void removeThread(Thread *t);
 
-	static void enqueue(Thread *t);
-	static void dequeue(Thread *t);
+	/**
+	 * Locks the run-queue the given thread currently belongs to
+	 *
+	 * @param t the thread
+	 * @return the locked run-queue
+	 */
+	static RunQueue *lockRQ(Thread *t);
+
+	/**
+	 * Locks the wait-queue the given thread currently waits in (if any) and its run-queue. As long
+	 * as both are locked, the event of the thread can't change.
+	 *
+	 * @param t the thread
+	 * @param wq will be set to the locked wait-queue or NULL if the thread does not wait
+	 * @return the locked run-queue
+	 */
+	static RunQueue *lockThread(Thread *t,WaitQueue **wq);
+
+	/**
+	 * @param event the event
+	 * @param object the object
+	 * @return the wait-queue for the given event and object
+	 */
+	static WaitQueue *getWaitQueue(uint event,evobj_t object);
+
+	/**
+	 * Wakes up the threads in <wq> that wait for exactly <event> and <object>.
+	 *
+	 * @param wq the wait-queue
+	 * @param event the event
+	 * @param object the object
+	 * @param all if true, all are waked up, otherwise only the first one
+	 * @return true if a thread has been waked up
+	 */
+	static bool wakeupIn(WaitQueue *wq,uint event,evobj_t object,bool all);
+
+	/**
+	 * Picks the thread with the highest priority from <rq> that is allowed to run on <cpu>. The
+	 * thread <old> is only chosen if there is no other one.
+	 *
+	 * @param rq the run-queue (locked)
+	 * @param cpu the CPU that wants to run the thread
+	 * @param old the thread to avoid (may be NULL)
+	 * @return the thread (dequeued) or NULL
+	 */
+	static Thread *pick(RunQueue *rq,cpuid_t cpu,Thread *old);
+
+	/**
+	 * Tries to steal a thread that may run on <cpu> from the run-queues of the other CPUs.
+	 *
+	 * @param cpu the CPU (its run-queue is locked)
+	 * @return the stolen thread or NULL
+	 */
+	static Thread *steal(cpuid_t cpu);
+
+	/**
+	 * Moves <t>, which is not in any queue, to a CPU it is allowed to run on, if necessary.
+	 *
+	 * @param rq the current run-queue of <t> (locked)
+	 * @param t the thread
+	 * @return the locked run-queue that <t> belongs to now
+	 */
+	static RunQueue *migrate(RunQueue *rq,Thread *t);
+
+	static void enqueue(RunQueue *rq,Thread *t);
+	static void dequeue(RunQueue *rq,Thread *t);
 	static void removeFromEventlist(Thread *t);
 	static bool setReadyState(Thread *t);
 	static void print(OStream &os,esc::DList<Thread> *q);
 
+	/* protects the idle-threads */
 	static SpinLock lock;
-	static ulong readyMask;
-	static esc::DList<Thread> rdyQueues[];
-	static esc::DList<Thread> evlists[EV_COUNT];
-	static size_t rdyCount;
+	static RunQueue *rqs;
+	static WaitQueue waitQueues[];
 	static Thread **idleThreads;
 };
-
-inline void Sched::block(Thread *t) {
-	assert(t != NULL);
-	LockGuard<SpinLock> g(&lock);
-	setBlocked(t);
-}
-
-inline void Sched::unblock(Thread *t) {
-	assert(t != NULL);
-	LockGuard<SpinLock> g(&lock);
-	setReady(t);
-}
@@ -131,6 +131,13 @@ public:
 	 */
 	static void wakeupCPU();
 
+	/**
+	 * Wakes up CPU <id>, if it is idling, so that it can run a thread
+	 *
+	 * @param id the CPU-id
+	 */
+	static void wakeupCPU(cpuid_t id);
+
 	/**
 	 * If there is any CPU that uses the given pagedir, it is flushed
 	 *
@@ -286,6 +286,20 @@ public:
 		this->cpu = cpu;
 	}
 
+	/**
+	 * @return the CPUs this thread is allowed to run on (1 bit per CPU)
+	 */
+	ulong getAffinity() const {
+		return affinity;
+	}
+	/**
+	 * @param cpu the CPU
+	 * @return true if this thread is allowed to run on the given CPU
+	 */
+	bool isAllowedOn(cpuid_t cpu) const {
+		return cpu >= sizeof(ulong) * 8 || (affinity & (1UL << cpu));
+	}
+
 	/**
 	 * @return the stack region with given number
 	 */
@@ -314,7 +328,7 @@ public:
 	 * @return true if so
 	 */
 	bool haveHigherPrio() {
-		ulong mask = Sched::getReadyMask();
+		ulong mask = Sched::getReadyMask(cpu);
 		return mask & ~((1UL << (priority + 1)) - 1);
 	}
 
@@ -438,6 +452,15 @@ public:
 	 */
 	bool reserveFrames(size_t count,bool swap = true);
 
+	/**
+	 * Tries to reserve <count> additional frames for this thread without swapping. In contrast to
+	 * reserveFrames(), the already reserved frames are kept if not enough memory is available.
+	 *
+	 * @param count the number of frames to reserve
+	 * @return the number of frames that have been reserved
+	 */
+	size_t tryReserveFrames(size_t count);
+
 	/**
 	 * Removes one frame from the collection of frames of this thread. This will always succeed,
 	 * because the function assumes that you have called reserveFrames() previously.
@@ -572,6 +595,10 @@ protected:
 	/* the next state it will receive on context-switch */
 	uint8_t newState;
 	cpuid_t cpu;
+	/* the CPU whose run-queue this thread belongs to */
+	cpuid_t rqCPU;
+	/* the CPUs this thread may run on */
+	ulong affinity;
 	/* the stack-region(s) for this thread */
 	VMRegion *stackRegions[STACK_REG_COUNT];
 	/* thread-directory in VFS */
@@ -29,7 +29,10 @@ class VFSChannel : public VFSNode {
 	friend class VFSDevice;
 
 	struct Message : public esc::SListItem {
-		static const size_t MAX_SIZE	= 256 * 1024;
+		static const size_t MAX_SIZE		= 256 * 1024;
+		/* messages of at least this size are transferred in frames instead of in the message. if
+		 * the receiver uses a page-aligned buffer, the frames are mapped into it */
+		static const size_t PAGED_SIZE		= 4 * PAGE_SIZE;
 
 		static void *operator new(size_t size, size_t msgSize) {
 			return Cache::alloc(size + msgSize);
@@ -38,11 +41,46 @@ class VFSChannel : public VFSNode {
 			Cache::free(ptr);
 		}
 
-		explicit Message(size_t _length) : esc::SListItem(), id(), length(_length) {
+		/**
+		 * Creates a message with <length> bytes, that are put into frames
+		 *
+		 * @param length the number of bytes
+		 * @return the message or NULL if there are not enough frames
+		 */
+		static Message *createPaged(size_t length);
+
+		explicit Message(size_t _length,bool _paged = false)
+			: esc::SListItem(), id(), length(_length), paged(_paged) {
+		}
+		~Message();
+
+		/**
+		 * @return the frames of a paged message
+		 */
+		frameno_t *frames() {
+			return reinterpret_cast<frameno_t*>(this + 1);
 		}
 
+		/**
+		 * Copies the data at <src> into this message
+		 *
+		 * @param src the data
+		 * @return 0 on success
+		 */
+		int read(USER const void *src);
+
+		/**
+		 * Copies the data of this message to <dst>. For paged messages, the frames are mapped into
+		 * the current process instead, as far as possible.
+		 *
+		 * @param dst the destination
+		 * @return 0 on success
+		 */
+		int write(USER void *dst);
+
 		msgid_t id;
 		size_t length;
+		bool paged;
 	};
 
 public:
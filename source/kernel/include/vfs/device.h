@@ -117,6 +117,7 @@ private:
 	int getClientFd(tid_t tid);
 
 	static uint buildMode(uint type);
+	static VFSChannel::Message *createMsg(USER const void *data,size_t size);
 	static VFSChannel::Message *getMsg(esc::SList<VFSChannel::Message> *list,msgid_t mid,ushort flags);
 
 	/* the process that receives the file descriptors */
@@ -0,0 +1,65 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <vfs/node.h>
+#include <common.h>
+#include <mutex.h>
+
+/**
+ * A pipe with a ring buffer in kernel memory. Writers copy directly from their buffer into the ring
+ * and readers directly from the ring into their buffer. The pipe is destroyed as soon as both ends
+ * have been closed.
+ */
+class VFSPipe : public VFSNode {
+public:
+	static const size_t BUF_SIZE	= 64 * 1024;
+
+	/**
+	 * Creates a new pipe in <parent>
+	 *
+	 * @param u the user
+	 * @param parent the parent-node
+	 * @param success whether the constructor succeeded (is expected to be true before the call!)
+	 */
+	explicit VFSPipe(const fs::User &u,VFSNode *parent,bool &success);
+
+	virtual ssize_t open(const fs::User &u,const char *path,ssize_t *sympos,ino_t root,uint flags,
+		int msgid,mode_t mode) override;
+	virtual ssize_t getSize() override;
+	virtual off_t seek(off_t position,off_t offset,uint whence) const override;
+	virtual ssize_t read(OpenFile *file,void *buffer,off_t offset,size_t count) override;
+	virtual ssize_t write(OpenFile *file,const void *buffer,off_t offset,size_t count) override;
+	virtual void close(OpenFile *file,int msgid) override;
+	virtual void print(OStream &os) const override;
+
+protected:
+	virtual void invalidate() override;
+
+private:
+	uint8_t *data;
+	/* the position to read from and the number of bytes in the ring */
+	size_t rdpos;
+	size_t used;
+	/* the number of open ends */
+	uint readers;
+	uint writers;
+	Mutex lock;
+};
@@ -146,6 +146,17 @@ public:
 	 */
 	static int openFileDesc(pid_t pid,uint8_t mntperms,ushort flags,const VFSNode *node,ino_t nodeNo,dev_t devNo);
 
+	/**
+	 * Creates a new pipe for process <pid> below /sys/pipe and opens both ends of it. The data is
+	 * copied directly between the user buffers and the ring of the pipe.
+	 *
+	 * @param pid the process-id
+	 * @param readFile will be set to the read-end
+	 * @param writeFile will be set to the write-end
+	 * @return 0 on success
+	 */
+	static int createPipe(pid_t pid,OpenFile **readFile,OpenFile **writeFile);
+
 	/**
 	 * Closes the given file descriptor for process <pid>.
 	 *
@@ -219,4 +230,5 @@ private:
 	static VFSNode *devNode;
 	static VFSNode *tmpNode;
 	static VFSNode *mountsNode;
+	static VFSNode *pipesNode;
 };
@@ -24,7 +24,8 @@
 #include <task/thread.h>
 #include <common.h>
 
-static SpinLock switchLock;
+/* there is no thread to switch away from in initialSwitch(), but thread_resume() wants a lock */
+static SpinLock initLock;
 
 int ThreadBase::initArch(Thread *t) {
 	t->kernelStack = t->getProc()->getPageDir()->createKernelStack();
@@ -125,7 +126,7 @@ void ThreadBase::finishThreadStart(A_UNUSED Thread *t,Thread *nt,const void *arg
 }
 
 void Thread::initialSwitch() {
-	switchLock.down();
+	initLock.down();
 	cpuid_t cpu = GDT::getCPUId();
 	Thread *cur = Sched::perform(NULL,cpu);
 	cur->stats.schedCount++;
@@ -135,14 +136,14 @@ void Thread::initialSwitch() {
 	cur->setCPU(cpu);
 	FPU::lockFPU();
 	cur->stats.cycleStart = CPU::rdtsc();
-	Thread::resume(cur->getProc()->getPageDir()->getPhysAddr(),&cur->saveArea,&switchLock,true);
+	Thread::resume(cur->getProc()->getPageDir()->getPhysAddr(),&cur->saveArea,&initLock,true);
 }
 
 void ThreadBase::doSwitch() {
 	Thread *old = Thread::getRunning();
 	/* lock this, because Sched::perform() may make us ready and we can't be chosen by another CPU
 	 * until we've really switched the thread (kernelstack, ...) */
-	switchLock.down();
+	old->switchLock.down();
 
 	/* update runtime-stats */
 	uint64_t cycles = CPU::rdtsc();
@@ -177,12 +178,12 @@ void ThreadBase::doSwitch() {
 			n->stats.cycleStart = CPU::rdtsc();
 			uintptr_t pdir = n->getProc()->getPageDir()->getPhysAddr();
 			bool chgpdir = n->getProc() != old->getProc();
-			Thread::resume(pdir,&n->saveArea,&switchLock,chgpdir);
+			Thread::resume(pdir,&n->saveArea,&old->switchLock,chgpdir);
 		}
 	}
 	else {
 		SMP::schedule(cpu,n,cycles);
 		n->stats.cycleStart = CPU::rdtsc();
-		switchLock.up();
+		old->switchLock.up();
 	}
 }
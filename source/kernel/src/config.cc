@@ -25,9 +25,11 @@
 #include <config.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 uint32_t Config::flags = (1 << Config::SMP) | (1 << Config::LOG);
+size_t Config::faultAround = DEF_FAULT_AROUND;
 char Config::rootDev[MAX_BPVAL_LEN + 1] = "";
 char Config::swapDev[MAX_BPVAL_LEN + 1] = "";
 
@@ -82,6 +84,9 @@ long Config::get(int id) {
 		case TICKS_PER_SEC:
 			res = CPU::getSpeed();
 			break;
+		case FAULT_AROUND:
+			res = faultAround;
+			break;
 		case LOG:
 		case LOG_TO_VGA:
 		case LINE_BY_LINE:
@@ -120,4 +125,9 @@ void Config::set(const char *name,const char *value) {
 		flags |= 1 << ACCURATE_CPU;
 	else if(strcmp(name,"logsysc") == 0)
 		flags |= 1 << LOG_SYSCALLS;
+	else if(strcmp(name,"faultaround") == 0) {
+		/* 0 and 1 disable it */
+		faultAround = esc::Util::max<size_t>(strtoul(value,NULL,0),1);
+		faultAround = esc::Util::min(faultAround,MAX_FAULT_AROUND);
+	}
 }
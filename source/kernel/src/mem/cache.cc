@@ -17,9 +17,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <esc/util.h>
 #include <mem/cache.h>
 #include <mem/kheap.h>
 #include <mem/pagedir.h>
+#include <task/smp.h>
 #include <assert.h>
 #include <common.h>
 #include <log.h>
@@ -36,25 +38,41 @@
 #define MIN_OBJ_COUNT		8
 #define SIZE_THRESHOLD		128
 #define HEAP_THRESHOLD		512
+/* the max. number of bytes that a magazine should cache */
+#define MAG_BYTES			16384
 
 SpinLock Cache::lock;
+Cache::Magazine *Cache::mags = NULL;
 Cache::Entry Cache::caches[] = {
-	{16,0,0,NULL},
-	{32,0,0,NULL},
-	{64,0,0,NULL},
-	{128,0,0,NULL},
-	{256,0,0,NULL},
-	{512,0,0,NULL},
-	{1024,0,0,NULL},
-	{2048,0,0,NULL},
-	{4096,0,0,NULL},
-	{8192,0,0,NULL},
-	{16384,0,0,NULL},
+	{16,0,0,NULL,0},
+	{32,0,0,NULL,0},
+	{64,0,0,NULL,0},
+	{128,0,0,NULL,0},
+	{256,0,0,NULL,0},
+	{512,0,0,NULL,0},
+	{1024,0,0,NULL,0},
+	{2048,0,0,NULL,0},
+	{4096,0,0,NULL,0},
+	{8192,0,0,NULL,0},
+	{16384,0,0,NULL,0},
 };
 #if DEBUGGING
 bool Cache::aafEnabled = false;
 #endif
 
+void Cache::initMagazines() {
+	for(size_t i = 0; i < ARRAY_SIZE(caches); i++) {
+		caches[i].magSize = esc::Util::min(MAG_SIZE,MAG_BYTES / caches[i].objSize);
+		caches[i].magSize = esc::Util::max(caches[i].magSize,static_cast<size_t>(2));
+	}
+
+	/* an all-zero magazine is an empty one */
+	Magazine *m = (Magazine*)calloc(SMP::getCPUCount() * ARRAY_SIZE(caches),sizeof(Magazine));
+	if(!m)
+		Util::panic("Unable to allocate cache magazines");
+	mags = m;
+}
+
 size_t Cache::totalObjSize(size_t sz) {
 	/* ensure that all objects are 16 bytes aligned, thus, use 16 bytes before and behind. */
 	return sz + sizeof(uint64_t) * 4;
@@ -140,8 +158,18 @@ void Cache::free(void *p) {
 	/* check guard */
 	assert(area[(objSize / sizeof(ulong)) + (16 / sizeof(ulong))] == GUARD_MAGIC);
 
-	/* put on freelist */
 	Entry *c = caches + area[0];
+	if(EXPECT_TRUE(mags)) {
+		/* put it into our magazine; if that's full, give half of it back to the freelist */
+		Magazine *m = mags + SMP::getCurId() * ARRAY_SIZE(caches) + area[0];
+		LockGuard<SpinLock> g(&m->lock);
+		if(EXPECT_FALSE(m->count == c->magSize))
+			flush(c,m);
+		m->objs[m->count++] = area;
+		return;
+	}
+
+	/* put on freelist */
 	LockGuard<SpinLock> g(&lock);
 	area[0] = (ulong)c->freeList;
 	c->freeList = area;
@@ -157,8 +185,15 @@ size_t Cache::getOccMem() {
 
 size_t Cache::getUsedMem() {
 	size_t count = 0;
-	for(size_t i = 0; i < ARRAY_SIZE(caches); i++)
-		count += (caches[i].totalObjs - caches[i].freeObjs) * totalObjSize(caches[i].objSize);
+	for(size_t i = 0; i < ARRAY_SIZE(caches); i++) {
+		size_t used = caches[i].totalObjs - caches[i].freeObjs;
+		/* the objects in the magazines are free as well */
+		if(mags) {
+			for(size_t cpu = 0; cpu < SMP::getCPUCount(); ++cpu)
+				used -= mags[cpu * ARRAY_SIZE(caches) + i].count;
+		}
+		count += used * totalObjSize(caches[i].objSize);
+	}
 	return count;
 }
 
@@ -179,6 +214,25 @@ void Cache::print(OStream &os) {
 	}
 }
 
+void Cache::printStats(OStream &os) {
+	os.writef("%-6s %6s %6s %12s %12s %6s\n","Size","Total","Cached","Hits","Misses","Rate");
+	for(size_t i = 0; i < ARRAY_SIZE(caches); i++) {
+		ulong hits = 0,misses = 0;
+		size_t cached = 0;
+		if(mags) {
+			for(size_t cpu = 0; cpu < SMP::getCPUCount(); ++cpu) {
+				Magazine *m = mags + cpu * ARRAY_SIZE(caches) + i;
+				hits += m->hits;
+				misses += m->misses;
+				cached += m->count;
+			}
+		}
+		ulong total = hits + misses;
+		os.writef("%-6zu %6zu %6zu %12lu %12lu %5lu%%\n",caches[i].objSize,caches[i].totalObjs,
+			cached,hits,misses,total ? (hits * 100) / total : 0);
+	}
+}
+
 void Cache::printBar(OStream &os,size_t mem,size_t maxMem,size_t total,size_t free) {
 	size_t memTotal = maxMem == 0 ? 0 : (VID_COLS * mem) / maxMem;
 	size_t full = total == 0 ? 0 : (memTotal * (total - free)) / total;
@@ -192,7 +246,56 @@ void Cache::printBar(OStream &os,size_t mem,size_t maxMem,size_t total,size_t fr
 }
 
 void *Cache::get(Entry *c,size_t i) {
+	ulong *area;
+	if(EXPECT_TRUE(mags)) {
+		Magazine *m = mags + SMP::getCurId() * ARRAY_SIZE(caches) + i;
+		LockGuard<SpinLock> g(&m->lock);
+		if(EXPECT_FALSE(m->count == 0)) {
+			m->misses++;
+			if(!refill(c,m))
+				return NULL;
+		}
+		else
+			m->hits++;
+		area = (ulong*)m->objs[--m->count];
+	}
+	else {
+		LockGuard<SpinLock> g(&lock);
+		area = pop(c);
+		if(area == NULL)
+			return NULL;
+	}
+
+	/* store size and put guards in front and behind the area */
+	area[0] = i;
+	area[1] = GUARD_MAGIC;
+	area[(c->objSize / sizeof(ulong)) + (16 / sizeof(ulong))] = GUARD_MAGIC;
+	return (void*)((uintptr_t)area + 16);
+}
+
+bool Cache::refill(Entry *c,Magazine *m) {
+	/* fill the magazine only half, so that the following frees don't have to flush it */
+	LockGuard<SpinLock> g(&lock);
+	while(m->count < c->magSize / 2) {
+		ulong *area = pop(c);
+		if(area == NULL)
+			return m->count > 0;
+		m->objs[m->count++] = area;
+	}
+	return true;
+}
+
+void Cache::flush(Entry *c,Magazine *m) {
 	LockGuard<SpinLock> g(&lock);
+	while(m->count > c->magSize / 2) {
+		ulong *area = (ulong*)m->objs[--m->count];
+		area[0] = (ulong)c->freeList;
+		c->freeList = area;
+		c->freeObjs++;
+	}
+}
+
+ulong *Cache::pop(Entry *c) {
 	if(!c->freeList) {
 		size_t pageCount = BYTES_2_PAGES(MIN_OBJ_COUNT * c->objSize);
 		size_t bytes = pageCount * PAGE_SIZE;
@@ -220,11 +323,6 @@ void *Cache::get(Entry *c,size_t i) {
 	/* get first from freelist */
 	ulong *area = (ulong*)c->freeList;
 	c->freeList = (void*)area[0];
-
-	/* store size and put guards in front and behind the area */
-	area[0] = i;
-	area[1] = GUARD_MAGIC;
-	area[(c->objSize / sizeof(ulong)) + (16 / sizeof(ulong))] = GUARD_MAGIC;
 	c->freeObjs--;
-	return (void*)((uintptr_t)area + 16);
+	return area;
 }
@@ -18,99 +18,69 @@
  */
 
 #include <esc/util.h>
-#include <mem/cache.h>
 #include <mem/copyonwrite.h>
 #include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <task/proc.h>
 #include <assert.h>
+#include <atomic.h>
 #include <common.h>
-#include <spinlock.h>
 #include <string.h>
 #include <util.h>
 #include <video.h>
 
-esc::SList<CopyOnWrite::Entry> CopyOnWrite::frames[HEAP_SIZE];
-SpinLock CopyOnWrite::lock;
+size_t CopyOnWrite::frameCount = 0;
 
 size_t CopyOnWrite::pagefault(uintptr_t address,frameno_t frameNumber) {
-	LockGuard<SpinLock> g(&lock);
-	/* find the cow-entry */
-	Entry *cow = getByFrame(frameNumber,true);
-	vassert(cow != NULL,"No COW entry for frame %#x and address %p",frameNumber,address);
+	uint32_t refs = PhysMem::getRefs(frameNumber);
+	vassert(refs > 0,"No COW entry for frame %#x and address %p",frameNumber,address);
 
-	/* if there is another process who wants to get the frame, we make a copy for us */
-	/* otherwise we keep the frame for ourself */
-	if(cow->refCount == 0) {
+	/* if we're the last user, we keep the frame for ourself. nobody else can add a reference in
+	 * the meantime, because that would require a user of the frame that clones it */
+	if(refs == 1) {
+		PhysMem::addRef(frameNumber,-1);
+		Atomic::fetch_and_add(&frameCount,-1);
 		PageTables::NoAllocator noalloc;
 		PageDir::mapToCur(address,1,noalloc,PG_PRESENT | PG_WRITABLE);
+		return 1;
 	}
-	else {
-		PageTables::UAllocator ualloc;
-		/* can't fail, we've already allocated the frame */
-		PageDir::mapToCur(address,1,ualloc,PG_PRESENT | PG_WRITABLE);
-	}
 
-	/* copy? */
-	if(cow->refCount > 0)
-		PageDir::copyFromFrame(frameNumber,(void*)(esc::Util::round_page_dn(address)));
-	else
-		delete cow;
+	/* otherwise we make a copy for us. keep our reference until the copy is done, so that the
+	 * other users can't take the frame in the meantime and change it */
+	PageTables::UAllocator ualloc;
+	/* can't fail, we've already allocated the frame */
+	PageDir::mapToCur(address,1,ualloc,PG_PRESENT | PG_WRITABLE);
+	PageDir::copyFromFrame(frameNumber,(void*)(esc::Util::round_page_dn(address)));
+
+	/* if all others have released it in the meantime, it's up to us to free it */
+	if(PhysMem::addRef(frameNumber,-1) == 1) {
+		Atomic::fetch_and_add(&frameCount,-1);
+		PhysMem::free(frameNumber,PhysMem::USR);
+	}
 	return 1;
 }
 
 bool CopyOnWrite::add(frameno_t frameNo) {
-	LockGuard<SpinLock> g(&lock);
-	Entry *cow = getByFrame(frameNo,false);
-	if(!cow) {
-		cow = new Entry(frameNo);
-		if(cow == NULL)
-			return false;
-		frames[frameNo % HEAP_SIZE].append(cow);
-	}
-	cow->refCount++;
+	if(PhysMem::addRef(frameNo,1) == 0)
+		Atomic::fetch_and_add(&frameCount,1);
 	return true;
 }
 
 size_t CopyOnWrite::remove(frameno_t frameNo,bool *foundOther) {
-	LockGuard<SpinLock> g(&lock);
-	/* find the cow-entry */
-	Entry *cow = getByFrame(frameNo,true);
-	vassert(cow != NULL,"For frameNo %#x",frameNo);
+	uint32_t refs = PhysMem::addRef(frameNo,-1);
+	vassert(refs > 0,"For frameNo %#x",frameNo);
 
-	*foundOther = cow->refCount > 0;
-	if(cow->refCount == 0)
-		delete cow;
+	*foundOther = refs > 1;
+	if(refs == 1)
+		Atomic::fetch_and_add(&frameCount,-1);
 	return 1;
 }
 
-size_t CopyOnWrite::getFrmCount() {
-	LockGuard<SpinLock> g(&lock);
-	size_t count = 0;
-	for(size_t i = 0; i < HEAP_SIZE; i++)
-		count += frames[i].length();
-	return count;
-}
-
 void CopyOnWrite::print(OStream &os) {
 	os.writef("COW-Frames: (%zu frames)\n",getFrmCount());
-	for(size_t i = 0; i < HEAP_SIZE; i++) {
-		os.writef("\t%zu:\n",i);
-		for(auto it = frames[i].cbegin(); it != frames[i].cend(); ++it)
-			os.writef("\t\t%#x (%zu refs)\n",it->frameNumber,it->refCount);
-	}
-}
-
-CopyOnWrite::Entry *CopyOnWrite::getByFrame(frameno_t frameNo,bool dec) {
-	esc::SList<Entry> *list = frames + (frameNo % HEAP_SIZE);
-	Entry *p = NULL;
-	for(auto it = list->begin(); it != list->end(); p = &*it, ++it) {
-		if(it->frameNumber == frameNo) {
-			if(dec) {
-				if(--it->refCount == 0)
-					list->removeAt(p,&*it);
-			}
-			return &*it;
-		}
+	for(size_t i = 0; i < PhysMem::getInfoFrames(); i++) {
+		uint32_t refs = PhysMem::getRefs(i);
+		if(refs > 0)
+			os.writef("\t%#x (%u refs)\n",i,refs);
 	}
-	return NULL;
 }
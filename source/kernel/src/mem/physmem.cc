@@ -65,9 +65,13 @@ SpinLock PhysMem::defLock;
 
 bool PhysMem::initialized = false;
 
+PhysMem::FrameInfo *PhysMem::frameInfo;
+size_t PhysMem::infoFrames = 0;
+
 /* for swapping */
 size_t PhysMem::swappedOut = 0;
 size_t PhysMem::swappedIn = 0;
+uint64_t PhysMem::refaultAge = 0;
 bool PhysMem::swapEnabled = false;
 bool PhysMem::swapping = false;
 Thread *PhysMem::swapperThread = NULL;
@@ -111,6 +115,7 @@ void PhysMem::init() {
 				end = PHYS_MEM_END;
 			}
 			PhysMemAreas::add((uintptr_t)info->mmap[i].baseAddr,end);
+			infoFrames = esc::Util::max(infoFrames,(size_t)(end / PAGE_SIZE));
 		}
 	}
 	totalMem = PhysMemAreas::getAvailable();
@@ -164,6 +169,10 @@ void PhysMem::init() {
 		upper.frames = upper.begin;
 	}
 
+	/* the frame metadata has to be allocated before the memory is put on the stack, too */
+	frameInfo = (FrameInfo*)PageDir::makeAccessible(0,BYTES_2_PAGES(infoFrames * sizeof(FrameInfo)));
+	memclear(frameInfo,infoFrames * sizeof(FrameInfo));
+
 	/* now mark the remaining memory as free on stack */
 	for(const PhysMemAreas::MemArea *area = PhysMemAreas::get(); area != NULL; area = area->next)
 		markRangeUsed(area->addr,area->addr + area->size,false);
@@ -277,6 +286,12 @@ bool PhysMem::reserve(size_t frameCount,bool swap) {
 	return true;
 }
 
+void PhysMem::unreserve(size_t frameCount) {
+	LockGuard<SpinLock> g(&defLock);
+	assert(uframes >= frameCount);
+	uframes -= frameCount;
+}
+
 frameno_t PhysMem::allocFrame(bool forceLower) {
 	/* prefer lower pages */
 	if(!forceLower && (size_t)(lower.frames - lower.begin) <= kframes) {
@@ -337,6 +352,9 @@ frameno_t PhysMem::allocate(FrameType type) {
 					assert(uframes > 0);
 					uframes--;
 					frame = allocFrame(false);
+					/* new frames start on the inactive list */
+					if(frame != INVALID_FRAME)
+						frameInfo[frame].flags = 0;
 				}
 				break;
 		}
@@ -355,6 +373,14 @@ void PhysMem::free(frameno_t frame,FrameType type) {
 	markUsed(frame,false);
 }
 
+void PhysMem::giveToUser(const frameno_t *frames,size_t count) {
+	LockGuard<SpinLock> g(&defLock);
+	kframes += count;
+	/* like new user frames, they start on the inactive list */
+	for(size_t i = 0; i < count; ++i)
+		frameInfo[frames[i]].flags = 0;
+}
+
 int PhysMem::swapIn(uintptr_t addr) {
 	if(!swapEnabled)
 		return -EFAULT;
@@ -461,8 +487,11 @@ void PhysMem::swapper() {
 			swapping = true;
 			defLock.up();
 
-			if(VirtMem::swapIn(swapFile,job->thread,job->addr))
+			ulong age;
+			if(VirtMem::swapIn(swapFile,job->thread,job->addr,&age)) {
+				refaultAge += age;
 				swappedIn++;
+			}
 
 			defLock.down();
 			job->thread->unblock();
@@ -498,6 +527,9 @@ void PhysMem::print(OStream &os) {
 	os.writef("UFrames: %zu\n",getFreeDef() - (cframes + kframes));
 	os.writef("Swapped out: %zu\n",swappedOut);
 	os.writef("Swapped in: %zu\n",swappedIn);
+	/* every swap-in is a refault of a page that we've evicted */
+	os.writef("Refault rate: %zu%% (avg. %Lu evictions later)\n",
+		swappedOut ? (swappedIn * 100) / swappedOut : 0,swappedIn ? refaultAge / swappedIn : 0);
 	os.writef("\n");
 	os.writef("Swap-in-jobs:\n");
 	for(SwapInJob *job = siJobList; job != NULL; job = job->next) {
@@ -34,6 +34,7 @@ size_t SwapMap::totalBlocks = 0;
 size_t SwapMap::freeBlocks = 0;
 SwapMap::Block *SwapMap::swapBlocks = NULL;
 SwapMap::Block *SwapMap::freeList = NULL;
+ulong SwapMap::allocs = 0;
 SpinLock SwapMap::lock;
 
 bool SwapMap::init(size_t swapSize) {
@@ -62,6 +63,7 @@ ulong SwapMap::alloc() {
 	Block *block = freeList;
 	freeList = freeList->next;
 	block->refCount = 1;
+	block->stamp = allocs++;
 	freeBlocks--;
 	return block - swapBlocks;
 }
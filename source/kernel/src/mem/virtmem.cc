@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <config.h>
 #include <esc/util.h>
 #include <mem/cache.h>
 #include <mem/copyonwrite.h>
@@ -269,6 +270,49 @@ errProc:
 	return res;
 }
 
+size_t VirtMem::replaceFrames(uintptr_t addr,const frameno_t *frames,size_t count) {
+	assert((addr & (PAGE_SIZE - 1)) == 0);
+	acquire();
+	VMRegion *vmreg = regtree.getByAddr(addr);
+	if(vmreg == NULL) {
+		release();
+		return 0;
+	}
+
+	size_t i = 0;
+	vmreg->reg->acquire();
+	ulong rflags = vmreg->reg->getFlags();
+	if((rflags & (RF_SHAREABLE | RF_NOFREE)) || !(rflags & RF_WRITABLE) || vmreg->reg->getFile())
+		goto done;
+
+	{
+		uint mapFlags = PG_PRESENT | PG_WRITABLE;
+		if(rflags & RF_EXECUTABLE)
+			mapFlags |= PG_EXECUTABLE;
+		size_t first = (addr - vmreg->virt()) / PAGE_SIZE;
+		count = esc::Util::min(count,BYTES_2_PAGES(vmreg->reg->getByteCount()) - first);
+		for(; i < count; ++i) {
+			/* copy-on-write, swapped or not yet loaded pages are not ours (yet) */
+			uintptr_t virt = addr + i * PAGE_SIZE;
+			if(vmreg->reg->getPageFlags(first + i) != 0 || !getPageDir()->isPresent(virt))
+				break;
+
+			frameno_t old = getPageDir()->getFrameNo(virt);
+			PageTables::RangeAllocator alloc(frames[i]);
+			/* can't fail because the page-table is present */
+			sassert(getPageDir()->map(virt,1,alloc,mapFlags) == 0);
+			PhysMem::free(old,PhysMem::USR);
+		}
+		/* the new frames have been taken from the kernel, but belong to the user now */
+		PhysMem::giveToUser(frames,i);
+	}
+
+done:
+	vmreg->reg->release();
+	release();
+	return i;
+}
+
 int VirtMem::protect(uintptr_t addr,ulong flags) {
 	size_t pgcount;
 	int res = -EPERM;
@@ -344,6 +388,26 @@ int VirtMem::lockall() {
 	return res;
 }
 
+int VirtMem::getPhysAddr(uintptr_t addr,uintptr_t *phys) {
+	int res = -ENXIO;
+	acquire();
+	VMRegion *vm = regtree.getByAddr(addr);
+	if(vm != NULL) {
+		vm->reg->acquire();
+		if(!(vm->reg->getFlags() & RF_LOCKED))
+			res = -EINVAL;
+		else if(!getPageDir()->isPresent(addr))
+			res = -EFAULT;
+		else {
+			*phys = getPageDir()->getFrameNo(addr) * PAGE_SIZE + (addr & (PAGE_SIZE - 1));
+			res = 0;
+		}
+		vm->reg->release();
+	}
+	release();
+	return res;
+}
+
 int VirtMem::lockRegion(VMRegion *vm,int flags) {
 	Thread *t = Thread::getRunning();
 	int res = 0;
@@ -444,7 +508,7 @@ void VirtMem::swapOut(OpenFile *file,size_t count) {
 	}
 }
 
-bool VirtMem::swapIn(OpenFile *file,Thread *t,uintptr_t addr) {
+bool VirtMem::swapIn(OpenFile *file,Thread *t,uintptr_t addr,ulong *age) {
 	VMRegion *vmreg = t->getProc()->getVM()->regtree.getByAddr(addr);
 	if(!vmreg)
 		return false;
@@ -457,6 +521,7 @@ bool VirtMem::swapIn(OpenFile *file,Thread *t,uintptr_t addr) {
 		return false;
 
 	ulong block = vmreg->reg->getSwapBlock(index);
+	*age = SwapMap::getAge(block);
 
 	/* read into buffer (note that we can use the same for swap-in and swap-out because its both
 	 * done by the swapper-thread) */
@@ -477,6 +542,9 @@ bool VirtMem::swapIn(OpenFile *file,Thread *t,uintptr_t addr) {
 	Log::get().writef("\n");
 #endif
 
+	/* we have just needed it, so it's part of the working set */
+	PhysMem::setActive(frame,true);
+
 	/* mark as not-swapped and map into all affected processes */
 	setSwappedIn(vmreg->reg,index,frame);
 	/* free swap-block */
@@ -573,11 +641,8 @@ int VirtMem::doPagefault(uintptr_t addr,VMRegion *vm,bool write) {
 	size_t page = (addr - vm->virt()) / PAGE_SIZE;
 	ulong flags = vm->reg->getPageFlags(page);
 	addr &= ~(PAGE_SIZE - 1);
-	if(flags & PF_DEMANDLOAD) {
+	if(flags & PF_DEMANDLOAD)
 		res = demandLoad(vm,addr);
-		if(res == 0)
-			vm->reg->setPageFlags(page,flags & ~PF_DEMANDLOAD);
-	}
 	else if(flags & PF_SWAPPED)
 		res = PhysMem::swapIn(addr);
 	else if(flags & PF_COPYONWRITE) {
@@ -891,16 +956,17 @@ int VirtMem::cloneAll(VirtMem *dst) {
 					goto errorRem;
 			}
 
-			/* now copy the pages */
+			/* now copy the pages. physical memory that has been mapped explicitly is shared as
+			 * well, because copying it makes no sense and it is not managed by PhysMem */
 			size_t pageCount = BYTES_2_PAGES(nvm->reg->getByteCount());
-			ssize_t res = getPageDir()->clone(dst->getPageDir(),vm->virt(),nvm->virt(),pageCount,
-					vm->reg->getFlags() & RF_SHAREABLE);
+			bool share = vm->reg->getFlags() & (RF_SHAREABLE | RF_NOFREE);
+			ssize_t res = getPageDir()->clone(dst->getPageDir(),vm->virt(),nvm->virt(),pageCount,share);
 			if(res < 0)
 				goto errorFreeArea;
 			dst->addOwn(res);
 
 			/* update stats */
-			if(vm->reg->getFlags() & RF_SHAREABLE) {
+			if(share) {
 				size_t sw,cow;
 				dst->addShared(nvm->reg->pageCount(&sw,&cow));
 				dst->addSwap(sw);
@@ -1207,102 +1273,97 @@ void VirtMem::print(OStream &os) const {
 }
 
 int VirtMem::demandLoad(VMRegion *vm,uintptr_t addr) {
-	int res;
-
-	/* calculate the number of bytes to load and zero */
-	size_t loadCount = 0, zeroCount;
-	if(addr - vm->virt() < vm->reg->getLoadCount())
-		loadCount = esc::Util::min((size_t)PAGE_SIZE,vm->reg->getLoadCount() - (addr - vm->virt()));
-	zeroCount = esc::Util::min((size_t)PAGE_SIZE,vm->reg->getByteCount() - (addr - vm->virt())) - loadCount;
-
-	/* load from file */
-	if(loadCount)
-		res = loadFromFile(vm,addr,loadCount);
-	else
-		res = 0;
+	Region *reg = vm->reg;
+	size_t page = (addr - vm->virt()) / PAGE_SIZE;
 
-	/* zero the rest, if necessary */
-	if(res == 0 && zeroCount) {
+	/* pages that are not backed by the file are simply zeroed */
+	if(addr - vm->virt() >= reg->getLoadCount()) {
+		size_t zeroCount = esc::Util::min((size_t)PAGE_SIZE,reg->getByteCount() - (addr - vm->virt()));
 		/* do the memclear before the mapping to ensure that it's ready when the first CPU sees it */
-		frameno_t frame = loadCount ? Proc::getCurPageDir()->getFrameNo(addr)
-									: Thread::getRunning()->getFrame();
+		frameno_t frame = Thread::getRunning()->getFrame();
 		uintptr_t frameAddr = PageDir::getAccess(frame);
-		memclear((void*)(frameAddr + loadCount),zeroCount);
+		memclear((void*)frameAddr,zeroCount);
 		PageDir::removeAccess(frame);
-		/* if the pages weren't present so far, map them into every process that has this region */
-		if(!loadCount) {
-			uint mapFlags = PG_PRESENT;
-			if(vm->reg->getFlags() & RF_WRITABLE)
-				mapFlags |= PG_WRITABLE;
-			/* this doesn't seem to make a lot of sense but is necessary for initloader */
-			if(vm->reg->getFlags() & RF_EXECUTABLE)
-				mapFlags |= PG_EXECUTABLE;
-			for(auto mp = vm->reg->vmbegin(); mp != vm->reg->vmend(); ++mp) {
-				/* the region may be mapped to a different virtual address */
-				PageTables::RangeAllocator alloc(frame);
-				VMRegion *mpreg = (*mp)->regtree.getByReg(vm->reg);
-				/* can't fail */
-				sassert((*mp)->getPageDir()->map(mpreg->virt() + (addr - vm->virt()),1,alloc,mapFlags) == 0);
-				if(vm->reg->getFlags() & RF_SHAREABLE)
-					(*mp)->addShared(1);
-				else
-					(*mp)->addOwn(1);
-			}
+		mapPage(vm,addr,frame);
+		reg->setPageFlags(page,reg->getPageFlags(page) & ~PF_DEMANDLOAD);
+		return 0;
+	}
+
+	/* determine the aligned window around the faulting page that we load at once. we only take
+	 * the contiguous run of not yet loaded pages that are backed by the file, because the others
+	 * are either present already or don't need a read */
+	size_t window = Config::get(Config::FAULT_AROUND);
+	size_t loadPages = (reg->getLoadCount() + PAGE_SIZE - 1) / PAGE_SIZE;
+	size_t start = page - page % window;
+	size_t end = esc::Util::min(start + window,loadPages);
+	size_t first = page, last = page + 1;
+	while(first > start && (reg->getPageFlags(first - 1) & PF_DEMANDLOAD))
+		first--;
+	while(last < end && (reg->getPageFlags(last) & PF_DEMANDLOAD))
+		last++;
+
+	/* the caller has reserved one frame for us; try to get the others without swapping. if there
+	 * is not enough memory, shrink the run around the faulting page to the frames we got. note that
+	 * we may not leave the run, because the pages outside are present, swapped out or COW. */
+	if(last - first > 1) {
+		size_t extra = Thread::getRunning()->tryReserveFrames(last - first - 1);
+		if(extra < last - first - 1) {
+			size_t after = esc::Util::min(extra,last - page - 1);
+			last = page + 1 + after;
+			first = page - esc::Util::min(extra - after,page - first);
 		}
 	}
-	return res;
+	return loadFromFile(vm,vm->virt() + first * PAGE_SIZE,last - first);
 }
 
-int VirtMem::loadFromFile(VMRegion *vm,uintptr_t addr,size_t loadCount) {
-	uint mapFlags;
-	frameno_t frame;
+int VirtMem::loadFromFile(VMRegion *vm,uintptr_t addr,size_t pages) {
+	Region *reg = vm->reg;
+	size_t first = (addr - vm->virt()) / PAGE_SIZE;
+	size_t loadCount = esc::Util::min(pages * PAGE_SIZE,reg->getLoadCount() - (addr - vm->virt()));
 	void *tempBuf;
 	/* note that we currently ignore that the file might have changed in the meantime */
 	ssize_t err;
-	off_t pos = vm->reg->getOffset() + (addr - vm->virt());
-	if((err = vm->reg->getFile()->seek(pos,SEEK_SET)) < 0)
+	off_t pos = reg->getOffset() + (addr - vm->virt());
+	if((err = reg->getFile()->seek(pos,SEEK_SET)) < 0)
 		goto error;
 
-	/* first read into a temp-buffer because we can't mark the page as present until
-	 * its read from disk. and we can't use a temporary mapping when switching
+	/* first read into a temp-buffer because we can't mark the pages as present until
+	 * they're read from disk. and we can't use a temporary mapping when switching
 	 * threads. */
-	tempBuf = Cache::alloc(PAGE_SIZE);
+	tempBuf = Cache::alloc(pages * PAGE_SIZE);
 	if(tempBuf == NULL) {
 		err = -ENOMEM;
 		goto error;
 	}
-	err = vm->reg->getFile()->read(tempBuf,loadCount);
+	err = reg->getFile()->read(tempBuf,loadCount);
 	if(err != (ssize_t)loadCount) {
 		if(err >= 0)
 			err = -ENOMEM;
 		goto errorFree;
 	}
 
-	/* copy into frame */
-	frame = PageDir::demandLoad(tempBuf,loadCount,vm->reg->getFlags());
+	for(size_t i = 0; i < pages; i++) {
+		uintptr_t pageAddr = addr + i * PAGE_SIZE;
+		size_t off = i * PAGE_SIZE;
+		size_t pageLoad = esc::Util::min((size_t)PAGE_SIZE,loadCount - off);
+		size_t zeroCount = esc::Util::min((size_t)PAGE_SIZE,reg->getByteCount() - (pageAddr - vm->virt()));
+		zeroCount -= pageLoad;
+
+		/* copy into frame and zero the rest, if necessary */
+		frameno_t frame = PageDir::demandLoad((char*)tempBuf + off,pageLoad,reg->getFlags());
+		if(zeroCount) {
+			uintptr_t frameAddr = PageDir::getAccess(frame);
+			memclear((void*)(frameAddr + pageLoad),zeroCount);
+			PageDir::removeAccess(frame);
+		}
+
+		mapPage(vm,pageAddr,frame);
+		reg->setPageFlags(first + i,reg->getPageFlags(first + i) & ~PF_DEMANDLOAD);
+	}
+	reg->addDemandLoad(pages);
 
 	/* free resources not needed anymore */
 	Cache::free(tempBuf);
-
-	/* map into all pagedirs */
-	{
-		mapFlags = PG_PRESENT;
-		if(vm->reg->getFlags() & RF_WRITABLE)
-			mapFlags |= PG_WRITABLE;
-		if(vm->reg->getFlags() & RF_EXECUTABLE)
-			mapFlags |= PG_EXECUTABLE;
-		for(auto mp = vm->reg->vmbegin(); mp != vm->reg->vmend(); ++mp) {
-			PageTables::RangeAllocator alloc(frame);
-			/* the region may be mapped to a different virtual address */
-			VMRegion *mpreg = (*mp)->regtree.getByReg(vm->reg);
-			/* can't fail */
-			sassert((*mp)->getPageDir()->map(mpreg->virt() + (addr - vm->virt()),1,alloc,mapFlags) == 0);
-			if(vm->reg->getFlags() & RF_SHAREABLE)
-				(*mp)->addShared(1);
-			else
-				(*mp)->addOwn(1);
-		}
-	}
 	return 0;
 
 errorFree:
@@ -1313,6 +1374,27 @@ error:
 	return err;
 }
 
+void VirtMem::mapPage(VMRegion *vm,uintptr_t addr,frameno_t frame) {
+	uint mapFlags = PG_PRESENT;
+	if(vm->reg->getFlags() & RF_WRITABLE)
+		mapFlags |= PG_WRITABLE;
+	/* this doesn't seem to make a lot of sense but is necessary for initloader */
+	if(vm->reg->getFlags() & RF_EXECUTABLE)
+		mapFlags |= PG_EXECUTABLE;
+	/* map it into every process that has this region */
+	for(auto mp = vm->reg->vmbegin(); mp != vm->reg->vmend(); ++mp) {
+		PageTables::RangeAllocator alloc(frame);
+		/* the region may be mapped to a different virtual address */
+		VMRegion *mpreg = (*mp)->regtree.getByReg(vm->reg);
+		/* can't fail */
+		sassert((*mp)->getPageDir()->map(mpreg->virt() + (addr - vm->virt()),1,alloc,mapFlags) == 0);
+		if(vm->reg->getFlags() & RF_SHAREABLE)
+			(*mp)->addShared(1);
+		else
+			(*mp)->addOwn(1);
+	}
+}
+
 Region *VirtMem::getLRURegion() {
 	Region *lru = NULL;
 	uint64_t ts = (uint64_t)-1;
@@ -1357,23 +1439,47 @@ Region *VirtMem::getLRURegion() {
 	return lru;
 }
 
-ssize_t VirtMem::getPgIdxForSwap(const Region *reg) {
+ssize_t VirtMem::getPgIdxForSwap(Region *reg) {
 	size_t pages = BYTES_2_PAGES(reg->getByteCount());
-	size_t count = 0;
-	for(size_t i = 0; i < pages; i++) {
-		if(!(reg->getPageFlags(i) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD)))
-			count++;
-	}
-	if(count > 0) {
-		size_t index = Util::rand() % count;
-		for(size_t i = 0; i < pages; i++) {
-			if(!(reg->getPageFlags(i) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD))) {
-				if(index-- == 0)
-					return i;
-			}
+	ssize_t fallback = -1;
+	/* second-chance clock: pages that have been accessed move to the active list, active pages
+	 * that haven't been accessed since the last round move to the inactive list and inactive ones
+	 * are swapped out. a page that has just been accessed needs three rounds: one to clear the
+	 * accessed bit, one to deactivate it and one to select it. if all pages are in use all the
+	 * time, take the first candidate we've seen. */
+	size_t index = reg->getClockHand() % esc::Util::max(pages,(size_t)1);
+	for(size_t i = 0; i < pages * 3; i++, index = (index + 1) % pages) {
+		if(reg->getPageFlags(index) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD))
+			continue;
+
+		if(fallback == -1)
+			fallback = index;
+		VirtMem *vm = *reg->vmbegin();
+		VMRegion *vmreg = vm->regtree.getByReg(reg);
+		frameno_t frame = vm->getPageDir()->getFrameNo(vmreg->virt() + index * PAGE_SIZE);
+		if(isAccessed(reg,index))
+			PhysMem::setActive(frame,true);
+		else if(PhysMem::isActive(frame))
+			PhysMem::setActive(frame,false);
+		else {
+			reg->setClockHand(index + 1);
+			return index;
 		}
 	}
-	return -1;
+	if(fallback != -1)
+		reg->setClockHand(fallback + 1);
+	return fallback;
+}
+
+bool VirtMem::isAccessed(Region *reg,size_t index) {
+	/* clear the bit in all page-directories, so that we can detect further accesses */
+	bool res = false;
+	for(auto mp = reg->vmbegin(); mp != reg->vmend(); ++mp) {
+		VMRegion *mpreg = (*mp)->regtree.getByReg(reg);
+		if((*mp)->getPageDir()->testAndClearAccessed(mpreg->virt() + index * PAGE_SIZE))
+			res = true;
+	}
+	return res;
 }
 
 void VirtMem::setSwappedOut(Region *reg,size_t index) {
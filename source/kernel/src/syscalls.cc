@@ -123,6 +123,9 @@ const Syscalls::handler_func Syscalls::syscalls[] = {
 	utime,
 	truncate,
 	symlink,
+	setaffinity,
+	virt2phys,
+	pipe,
 #if defined(__x86__)
 	reqports,
 	relports,
@@ -68,6 +68,47 @@ int Syscalls::open(Thread *t,IntrptStackFrame *stack) {
 	SYSC_SUCCESS(stack,fd);
 }
 
+int Syscalls::pipe(Thread *t,IntrptStackFrame *stack) {
+	int *readFd = (int*)SYSC_ARG1(stack);
+	int *writeFd = (int*)SYSC_ARG2(stack);
+	Proc *p = t->getProc();
+	if(EXPECT_FALSE(!PageDir::isInUserSpace((uintptr_t)readFd,sizeof(int)) ||
+			!PageDir::isInUserSpace((uintptr_t)writeFd,sizeof(int))))
+		SYSC_ERROR(stack,-EFAULT);
+
+	OpenFile *rfile,*wfile;
+	int rfd,wfd;
+	int res = VFS::createPipe(p->getPid(),&rfile,&wfile);
+	if(EXPECT_FALSE(res < 0))
+		SYSC_ERROR(stack,res);
+
+	/* assoc fds with the files */
+	rfd = FileDesc::assoc(p,rfile);
+	if(EXPECT_FALSE(rfd < 0)) {
+		res = rfd;
+		goto errorRead;
+	}
+	wfd = FileDesc::assoc(p,wfile);
+	if(EXPECT_FALSE(wfd < 0)) {
+		res = wfd;
+		goto errorWrite;
+	}
+
+	if(EXPECT_FALSE((res = UserAccess::writeVar(readFd,rfd)) < 0 ||
+			(res = UserAccess::writeVar(writeFd,wfd)) < 0)) {
+		FileDesc::unassoc(p,wfd);
+		goto errorWrite;
+	}
+	SYSC_SUCCESS(stack,0);
+
+errorWrite:
+	FileDesc::unassoc(p,rfd);
+errorRead:
+	wfile->close();
+	rfile->close();
+	SYSC_ERROR(stack,res);
+}
+
 int Syscalls::fcntl(Thread *t,IntrptStackFrame *stack) {
 	int fd = (int)SYSC_ARG1(stack);
 	uint cmd = SYSC_ARG2(stack);
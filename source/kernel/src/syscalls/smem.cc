@@ -167,6 +167,28 @@ int Syscalls::mlockall(Thread *t,IntrptStackFrame *stack) {
 	SYSC_RESULT(stack,res);
 }
 
+int Syscalls::virt2phys(Thread *t,IntrptStackFrame *stack) {
+	uintptr_t virt = (uintptr_t)SYSC_ARG1(stack);
+	size_t pages = SYSC_ARG2(stack);
+	uintptr_t *phys = (uintptr_t*)SYSC_ARG3(stack);
+
+	if(EXPECT_FALSE(pages == 0 || pages > BYTES_2_PAGES(~(size_t)0 / sizeof(uintptr_t))))
+		SYSC_ERROR(stack,-EINVAL);
+	if(EXPECT_FALSE(!PageDir::isInUserSpace((uintptr_t)phys,pages * sizeof(uintptr_t))))
+		SYSC_ERROR(stack,-EFAULT);
+
+	virt &= ~(PAGE_SIZE - 1);
+	for(size_t i = 0; i < pages; ++i) {
+		uintptr_t addr;
+		int res = t->getProc()->getVM()->getPhysAddr(virt + i * PAGE_SIZE,&addr);
+		if(EXPECT_FALSE(res < 0))
+			SYSC_ERROR(stack,res);
+		if(EXPECT_FALSE(UserAccess::writeVar(phys + i,addr) < 0))
+			SYSC_ERROR(stack,-EFAULT);
+	}
+	SYSC_SUCCESS(stack,0);
+}
+
 int Syscalls::mattr(A_UNUSED Thread *t,IntrptStackFrame *stack) {
 	uintptr_t phys = (uintptr_t)SYSC_ARG1(stack);
 	size_t bytes = SYSC_ARG2(stack);
@@ -113,6 +113,26 @@ int Syscalls::join(Thread *t,IntrptStackFrame *stack) {
 	SYSC_RESULT(stack,res);
 }
 
+int Syscalls::setaffinity(Thread *t,IntrptStackFrame *stack) {
+	tid_t tid = (tid_t)SYSC_ARG1(stack);
+	ulong mask = SYSC_ARG2(stack);
+
+	/* just threads from the own process */
+	if(EXPECT_FALSE(!t->isSameProcess(tid)))
+		SYSC_ERROR(stack,-EINVAL);
+
+	Thread *at = Thread::getRef(tid);
+	if(EXPECT_FALSE(at == NULL))
+		SYSC_ERROR(stack,-EINVAL);
+	int res = Sched::setAffinity(at,mask);
+	Thread::relRef(at);
+
+	/* if we are not allowed to run here anymore, leave the CPU immediately */
+	if(res == 0 && at == t && !t->isAllowedOn(t->getCPU()))
+		Thread::switchAway();
+	SYSC_RESULT(stack,res);
+}
+
 int Syscalls::semcrtirq(Thread *t,IntrptStackFrame *stack) {
 	char kname[32];
 	int fd = (int)SYSC_ARG1(stack);
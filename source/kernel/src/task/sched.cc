@@ -41,20 +41,46 @@
  * the beginning and end. Therefore we can dequeue the first, prepend, append and remove a thread
  * in O(1). Additionally the number of threads is limited by the kernel-heap (i.e. we don't need
  * a static storage of nodes for the linked list; we use the threads itself)
+ *
+ * Every CPU has its own run-queue with its own lock, so that context-switches on different CPUs
+ * don't contend with each other. A thread belongs to exactly one run-queue (Thread::rqCPU), whose
+ * lock protects the state of the thread. If a CPU has nothing to do, it steals a thread from the
+ * run-queue of another CPU.
+ *
+ * Threads that wait for an event are put into a wait-queue, chosen by hashing the event and the
+ * object. Thus, wakeup() only has to walk over the threads that wait for the same object (plus
+ * some collisions) instead of all threads that wait for the event. Each wait-queue has its own
+ * lock, which always has to be acquired before a run-queue lock. The event of a thread is only
+ * changed while holding both its wait-queue lock and its run-queue lock.
  */
 
+struct Sched::RunQueue {
+	SpinLock lock;
+	ulong readyMask;
+	size_t count;
+	/* number of threads this CPU has stolen from others */
+	ulong steals;
+	esc::DList<Thread> queues[MAX_PRIO + 1];
+};
+
+struct Sched::WaitQueue {
+	SpinLock lock;
+	esc::DList<Thread> list;
+};
+
 SpinLock Sched::lock;
-ulong Sched::readyMask = 0;
-esc::DList<Thread> Sched::rdyQueues[MAX_PRIO + 1];
-esc::DList<Thread> Sched::evlists[EV_COUNT];
-size_t Sched::rdyCount;
+Sched::RunQueue *Sched::rqs;
+Sched::WaitQueue Sched::waitQueues[WAIT_QUEUE_COUNT];
 Thread **Sched::idleThreads;
 
 void Sched::init() {
 	idleThreads = (Thread**)Cache::calloc(SMP::getCPUCount(),sizeof(Thread*));
 	if(!idleThreads)
 		Util::panic("Unable to allocate idle-threads array");
-	rdyCount = 0;
+	/* an all-zero run-queue is an empty one */
+	rqs = (RunQueue*)Cache::calloc(SMP::getCPUCount(),sizeof(RunQueue));
+	if(!rqs)
+		Util::panic("Unable to allocate run-queues");
 }
 
 void Sched::addIdleThread(Thread *t) {
@@ -67,23 +93,171 @@ void Sched::addIdleThread(Thread *t) {
 	}
 }
 
-void Sched::enqueue(Thread *t) {
+ulong Sched::getReadyMask(cpuid_t cpu) {
+	return rqs[cpu].readyMask;
+}
+
+void Sched::block(Thread *t) {
+	assert(t != NULL);
+	RunQueue *rq = lockRQ(t);
+	setBlocked(t);
+	rq->lock.up();
+}
+
+int Sched::setAffinity(Thread *t,ulong mask) {
+	size_t count = SMP::getCPUCount();
+	if(count < sizeof(ulong) * 8 && (mask & ((1UL << count) - 1)) == 0)
+		return -EINVAL;
+
+	RunQueue *rq = lockRQ(t);
+	t->affinity = mask;
+	if(!t->isAllowedOn(t->rqCPU)) {
+		/* if it's ready, put it into another queue. if it's running, perform() will do that when
+		 * switching away from it. otherwise, setReady() will do that */
+		if(t->getState() == Thread::READY) {
+			dequeue(rq,t);
+			rq = migrate(rq,t);
+			enqueue(rq,t);
+		}
+	}
+	rq->lock.up();
+	return 0;
+}
+
+Sched::RunQueue *Sched::lockRQ(Thread *t) {
+	while(true) {
+		/* the thread may be moved to another run-queue in the meantime; this can only be done
+		 * while holding the lock of its current run-queue */
+		RunQueue *rq = rqs + *(volatile cpuid_t*)&t->rqCPU;
+		rq->lock.down();
+		if(EXPECT_TRUE(rqs + t->rqCPU == rq))
+			return rq;
+		rq->lock.up();
+	}
+}
+
+Sched::RunQueue *Sched::lockThread(Thread *t,WaitQueue **wq) {
+	while(true) {
+		uint event = *(volatile uint*)&t->event;
+		evobj_t object = *(volatile evobj_t*)&t->evobject;
+		*wq = event ? getWaitQueue(event,object) : NULL;
+		if(*wq)
+			(*wq)->lock.down();
+		RunQueue *rq = lockRQ(t);
+		if(EXPECT_TRUE(t->event == event && t->evobject == object))
+			return rq;
+		rq->lock.up();
+		if(*wq)
+			(*wq)->lock.up();
+	}
+}
+
+Sched::WaitQueue *Sched::getWaitQueue(uint event,evobj_t object) {
+	/* the objects are pointers to kernel-objects in most cases; the lowest bits don't tell much */
+	ulong hash = (object >> 4) ^ (object >> 12) ^ (event * 0x9E3779B1UL);
+	return waitQueues + (hash & (WAIT_QUEUE_COUNT - 1));
+}
+
+Sched::RunQueue *Sched::migrate(RunQueue *rq,Thread *t) {
+	if(EXPECT_TRUE(t->isAllowedOn(t->rqCPU)))
+		return rq;
+
+	/* we hold already a run-queue lock, thus we can only try to get the other lock. if that fails,
+	 * we keep the thread in the current queue and let another CPU steal it */
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		if(t->isAllowedOn(i) && rqs[i].lock.tryDown()) {
+			t->rqCPU = i;
+			rq->lock.up();
+			return rqs + i;
+		}
+	}
+	return rq;
+}
+
+void Sched::enqueue(RunQueue *rq,Thread *t) {
 	uint8_t prio = t->getPriority();
-	rdyQueues[prio].append(t);
-	readyMask |= 1UL << prio;
-	rdyCount++;
+	rq->queues[prio].append(t);
+	rq->readyMask |= 1UL << prio;
+	rq->count++;
 }
 
-void Sched::dequeue(Thread *t) {
+void Sched::dequeue(RunQueue *rq,Thread *t) {
 	uint8_t prio = t->getPriority();
-	rdyQueues[prio].remove(t);
-	if(rdyQueues[prio].length() == 0)
-		readyMask &= ~(1UL << prio);
-	rdyCount--;
+	rq->queues[prio].remove(t);
+	if(rq->queues[prio].length() == 0)
+		rq->readyMask &= ~(1UL << prio);
+	rq->count--;
+}
+
+Thread *Sched::pick(RunQueue *rq,cpuid_t cpu,Thread *old) {
+	for(ssize_t i = MAX_PRIO; i >= 0; i--) {
+		if(!(rq->readyMask & (1UL << i)))
+			continue;
+
+		for(auto it = rq->queues[i].begin(); it != rq->queues[i].end(); ++it) {
+			/* if its the old thread again and we have more ready threads, don't take this one
+			 * again. because we assume that Thread::switchAway() has been called for a reason.
+			 * therefore, it should be better to take a thread with a lower priority than taking
+			 * the same again */
+			/* threads that are still being switched out by another CPU can't be run yet */
+			if(&*it != old && it->isAllowedOn(cpu) && !it->isSwitching()) {
+				dequeue(rq,&*it);
+				return &*it;
+			}
+		}
+	}
+
+	if(old && old->getState() == Thread::READY && old->rqCPU == cpu && old->isAllowedOn(cpu)) {
+		dequeue(rq,old);
+		return old;
+	}
+	return NULL;
+}
+
+Thread *Sched::steal(cpuid_t cpu) {
+	size_t count = SMP::getCPUCount();
+	for(size_t i = 1; i < count; ++i) {
+		RunQueue *victim = rqs + (cpu + i) % count;
+		/* don't bother if there is nothing to steal. and we can't wait for the lock, because we
+		 * already hold our own one */
+		if(victim->count == 0 || !victim->lock.tryDown())
+			continue;
+
+		Thread *t = pick(victim,cpu,NULL);
+		if(t)
+			t->rqCPU = cpu;
+		victim->lock.up();
+		if(t) {
+			rqs[cpu].steals++;
+			return t;
+		}
+	}
+	return NULL;
 }
 
 Thread *Sched::perform(Thread *old,cpuid_t cpu) {
-	LockGuard<SpinLock> g(&lock);
+	RunQueue *rq = rqs + cpu;
+	/* if the old thread has a signal, we might need to remove it from an event-list. otherwise,
+	 * the event-lock is not required, because if a signal arrives afterwards, the sender will
+	 * unblock the thread and thereby remove it from the event-list */
+	bool sigs = old && !(old->getFlags() & T_IDLE) && old->getNewState() != Thread::ZOMBIE &&
+		old->hasSignal();
+	bool move = false;
+	WaitQueue *wq = NULL;
+	if(EXPECT_FALSE(sigs)) {
+		/* the running thread always belongs to the run-queue of its CPU */
+		sassert(lockThread(old,&wq) == rq);
+		/* removeThread might have made it a zombie before we got the lock. in this case, it
+		 * has already been removed from the event-list and must not become ready again */
+		if(EXPECT_FALSE(old->getNewState() == Thread::ZOMBIE)) {
+			sigs = false;
+			if(wq)
+				wq->lock.up();
+		}
+	}
+	else
+		rq->lock.down();
+
 	/* give the old thread a new state */
 	if(old) {
 		if(old->getFlags() & T_IDLE)
@@ -93,40 +267,34 @@ Thread *Sched::perform(Thread *old,cpuid_t cpu) {
 
 			/* we have to check for a signal here, because otherwise we might miss it */
 			/* (scenario: cpu0 unblocks t1 for signal, cpu1 runs t1 and blocks itself) */
-			if(old->getNewState() != Thread::ZOMBIE && old->hasSignal()) {
+			if(EXPECT_FALSE(sigs)) {
 				/* we have to reset the newstate in this case and remove us from event */
 				old->setNewState(Thread::READY);
 				old->waitstart = 0;
 				removeFromEventlist(old);
+				rq->lock.up();
+				if(wq)
+					wq->lock.up();
 				return old;
 			}
 
 			old->setState(old->getNewState());
 			if(old->getNewState() == Thread::READY) {
 				assert(old->event == 0);
-				enqueue(old);
+				/* if it is not allowed to run here anymore, move it away afterwards */
+				if(EXPECT_TRUE(old->isAllowedOn(cpu)))
+					enqueue(rq,old);
+				else
+					move = true;
 			}
 		}
 	}
 
-	/* get new thread */
-	Thread *t;
-	for(ssize_t i = MAX_PRIO; i >= 0; i--) {
-		t = rdyQueues[i].removeFirst();
-		if(t) {
-			/* if its the old thread again and we have more ready threads, don't take this one again.
-			 * because we assume that Thread::switchAway() has been called for a reason. therefore, it
-			 * should be better to take a thread with a lower priority than taking the same again */
-			if(rdyCount > 1 && t == old) {
-				rdyQueues[i].append(t);
-				continue;
-			}
-			if(rdyQueues[i].length() == 0)
-				readyMask &= ~(1UL << i);
-			rdyCount--;
-			break;
-		}
-	}
+	/* get new thread; if we have nothing to do, try to help other CPUs */
+	Thread *t = pick(rq,cpu,old);
+	if(t == NULL && SMP::getCPUCount() > 1)
+		t = steal(cpu);
+
 	if(t == NULL) {
 		/* choose an idle-thread */
 		t = idleThreads[cpu];
@@ -138,13 +306,18 @@ Thread *Sched::perform(Thread *old,cpuid_t cpu) {
 	}
 
 	/* if there is another thread ready, check if we have another cpu that we can start for it */
-	if(rdyCount > 0)
+	if(rq->count > 0)
 		SMP::wakeupCPU();
+	if(EXPECT_FALSE(move)) {
+		rq = migrate(rq,old);
+		enqueue(rq,old);
+	}
+	rq->lock.up();
 	return t;
 }
 
 void Sched::adjustPrio(Thread *t,uint64_t total) {
-	LockGuard<SpinLock> g(&lock);
+	RunQueue *rq = lockRQ(t);
 	/* if it is still blocked, add the time to the blocked time */
 	if(t->waitstart > 0) {
 		uint64_t now = CPU::rdtsc();
@@ -175,10 +348,10 @@ void Sched::adjustPrio(Thread *t,uint64_t total) {
 	if(t->stats.blocked < BAD_BLOCK_TIME(total)) {
 		if(t->getPriority() > 0) {
 			if(t->getState() == Thread::READY)
-				dequeue(t);
+				dequeue(rq,t);
 			t->setPriority(t->getPriority() - 1);
 			if(t->getState() == Thread::READY)
-				enqueue(t);
+				enqueue(rq,t);
 		}
 		t->prioGoodCnt = 0;
 	}
@@ -188,10 +361,10 @@ void Sched::adjustPrio(Thread *t,uint64_t total) {
 			/* but don't do that immediately, but only if it happened multiple times */
 			if(++t->prioGoodCnt == PRIO_FORGIVE_CNT) {
 				if(t->getState() == Thread::READY)
-					dequeue(t);
+					dequeue(rq,t);
 				t->setPriority(t->getPriority() + 1);
 				if(t->getState() == Thread::READY)
-					enqueue(t);
+					enqueue(rq,t);
 				t->prioGoodCnt = 0;
 			}
 		}
@@ -199,46 +372,74 @@ void Sched::adjustPrio(Thread *t,uint64_t total) {
 
 	/* reset blocked time */
 	t->stats.blocked = 0;
+	rq->lock.up();
 }
 
 void Sched::wait(Thread *t,uint event,evobj_t object) {
-	LockGuard<SpinLock> g(&lock);
 	assert(t->event == 0);
 	assert(Thread::getRunning() == t);
+	WaitQueue *wq = event ? getWaitQueue(event,object) : NULL;
+	if(wq)
+		wq->lock.down();
+	RunQueue *rq = lockRQ(t);
 	t->event = event;
 	t->evobject = object;
 	setBlocked(t);
-	if(event)
-		evlists[event - 1].append(t);
+	if(wq)
+		wq->list.append(t);
+	rq->lock.up();
+	if(wq)
+		wq->lock.up();
 }
 
 void Sched::wakeup(uint event,evobj_t object,bool all) {
 	assert(event >= 1 && event <= EV_COUNT);
-	esc::DList<Thread> *list = evlists + event - 1;
-	LockGuard<SpinLock> g(&lock);
-	for(auto it = list->begin(); it != list->end(); ) {
+	bool found = wakeupIn(getWaitQueue(event,object),event,object,all);
+	/* threads that wait for object 0 are interested in all objects */
+	if(object != 0 && (all || !found))
+		wakeupIn(getWaitQueue(event,0),event,0,all);
+}
+
+bool Sched::wakeupIn(WaitQueue *wq,uint event,evobj_t object,bool all) {
+	bool found = false;
+	LockGuard<SpinLock> g(&wq->lock);
+	for(auto it = wq->list.begin(); it != wq->list.end(); ) {
 		auto old = it++;
-		assert(old->event == event);
-		if(old->evobject == 0 || old->evobject == object) {
+		/* skip the threads that just collide in the hashtable */
+		if(old->event == event && old->evobject == object) {
+			RunQueue *rq = lockRQ(&*old);
 			removeFromEventlist(&*old);
-			setReady(&*old);
+			rq = setReady(rq,&*old);
+			rq->lock.up();
+			found = true;
 			if(!all)
 				break;
 		}
 	}
+	return found;
+}
+
+void Sched::unblock(Thread *t) {
+	assert(t != NULL);
+	WaitQueue *wq;
+	RunQueue *rq = lockThread(t,&wq);
+	rq = setReady(rq,t);
+	rq->lock.up();
+	if(wq)
+		wq->lock.up();
 }
 
 void Sched::removeFromEventlist(Thread *t) {
 	if(t->event) {
 		/* important: remove it first from the event-list and set event to 0 */
-		evlists[t->event - 1].remove(t);
+		getWaitQueue(t->event,t->evobject)->list.remove(t);
 		t->event = 0;
 	}
 }
 
-void Sched::setReady(Thread *t) {
+Sched::RunQueue *Sched::setReady(RunQueue *rq,Thread *t) {
 	if(t->getFlags() & T_IDLE)
-		return;
+		return rq;
 
 	if(t->waitstart > 0) {
 		t->stats.blocked += CPU::rdtsc() - t->waitstart;
@@ -251,8 +452,12 @@ void Sched::setReady(Thread *t) {
 	}
 	else if(setReadyState(t)) {
 		assert(t->event == 0);
-		enqueue(t);
+		rq = migrate(rq,t);
+		enqueue(rq,t);
+		/* if its CPU has nothing to do, let it run the thread */
+		SMP::wakeupCPU(t->rqCPU);
 	}
+	return rq;
 }
 
 void Sched::setBlocked(Thread *t) {
@@ -265,7 +470,7 @@ void Sched::setBlocked(Thread *t) {
 			break;
 		case Thread::READY:
 			t->setState(Thread::BLOCKED);
-			dequeue(t);
+			dequeue(rqs + t->rqCPU,t);
 			break;
 		default:
 			vassert(false,"Invalid state for setBlocked (%d)",t->getState());
@@ -275,7 +480,8 @@ void Sched::setBlocked(Thread *t) {
 }
 
 void Sched::removeThread(Thread *t) {
-	LockGuard<SpinLock> g(&lock);
+	WaitQueue *wq;
+	RunQueue *rq = lockThread(t,&wq);
 	switch(t->getState()) {
 		case Thread::RUNNING:
 			break;
@@ -283,7 +489,7 @@ void Sched::removeThread(Thread *t) {
 			removeFromEventlist(t);
 			break;
 		case Thread::READY:
-			dequeue(t);
+			dequeue(rq,t);
 			break;
 		default:
 			/* TODO threads can die during swap, right? */
@@ -291,6 +497,9 @@ void Sched::removeThread(Thread *t) {
 			break;
 	}
 	t->setNewState(Thread::ZOMBIE);
+	rq->lock.up();
+	if(wq)
+		wq->lock.up();
 }
 
 bool Sched::setReadyState(Thread *t) {
@@ -310,26 +519,33 @@ bool Sched::setReadyState(Thread *t) {
 }
 
 void Sched::print(OStream &os) {
-	os.writef("Ready queues:\n");
-	for(size_t i = 0; i < ARRAY_SIZE(rdyQueues); i++) {
-		os.writef("\t[%d]:\n",i);
-		print(os,rdyQueues + i);
-		os.writef("\n");
+	for(size_t c = 0; c < SMP::getCPUCount(); c++) {
+		RunQueue *rq = rqs + c;
+		os.writef("CPU %zu (%zu ready, %lu steals):\n",c,rq->count,rq->steals);
+		for(size_t i = 0; i < ARRAY_SIZE(rq->queues); i++) {
+			os.writef("\t[%d]:\n",i);
+			print(os,rq->queues + i);
+			os.writef("\n");
+		}
 	}
 }
 
 void Sched::printEventLists(OStream &os) {
 	os.writef("Eventlists:\n");
 	for(size_t e = 0; e < EV_COUNT; e++) {
-		esc::DList<Thread> *list = evlists + e;
 		os.writef("\t%s:\n",getEventName(e + 1));
-		for(auto t = list->cbegin(); t != list->cend(); ++t) {
-			os.writef("\t\tthread=%d (%d:%s), object=%x",
+		for(size_t i = 0; i < WAIT_QUEUE_COUNT; i++) {
+			esc::DList<Thread> *list = &waitQueues[i].list;
+			for(auto t = list->cbegin(); t != list->cend(); ++t) {
+				if(t->event != e + 1)
+					continue;
+				os.writef("\t\tthread=%d (%d:%s), object=%x",
 					t->getTid(),t->getProc()->getPid(),t->getProc()->getProgram(),t->evobject);
-			ino_t nodeNo = ((VFSNode*)t->evobject)->getNo();
-			if(VFSNode::isValid(nodeNo))
-				os.writef("(%s)",((VFSNode*)t->evobject)->getPath());
-			os.writef("\n");
+				ino_t nodeNo = ((VFSNode*)t->evobject)->getNo();
+				if(VFSNode::isValid(nodeNo))
+					os.writef("(%s)",((VFSNode*)t->evobject)->getPath());
+				os.writef("\n");
+			}
 		}
 	}
 }
@@ -344,6 +560,8 @@ const char *Sched::getEventName(uint event) {
 		"SWAP_FREE",
 		"THREAD_DIED",
 		"CHILD_DIED",
+		"PIPE_DATA",
+		"PIPE_SPACE",
 	};
 	return names[event - 1];
 }
@@ -40,6 +40,7 @@ void SMPBase::init() {
 		addCPU(true,0,true);
 		setId(0,0);
 	}
+	Cache::initMagazines();
 }
 
 void SMPBase::disable() {
@@ -105,6 +106,14 @@ void SMPBase::wakeupCPU() {
 	}
 }
 
+void SMPBase::wakeupCPU(cpuid_t id) {
+	if(cpuCount > 1 && id != getCurId()) {
+		CPU *cpu = cpus[id];
+		if(cpu->ready && (!cpu->thread || (cpu->thread->getFlags() & T_IDLE)))
+			sendIPI(id,IPI_WORK);
+	}
+}
+
 void SMPBase::flushTLB(PageDir *pdir) {
 	if(!cpus || cpuCount == 1)
 		return;
@@ -38,7 +38,8 @@ void Terminator::start() {
 
 		/* better do that unlocked; we might block on a mutex */
 		lock.up();
-		while(dt->getState() != Thread::ZOMBIE)
+		/* wait until the CPU that executed it has switched away from it */
+		while(dt->getState() != Thread::ZOMBIE || dt->isSwitching())
 			Thread::switchAway();
 		Proc::killThread(dt);
 		lock.down();
@@ -72,7 +72,7 @@ void ThreadBase::relRef(const Thread *t) {
 ThreadBase::ThreadBase(Proc *p,uint8_t flags)
 	: esc::DListItem(), tid(), refs(1), proc(p), sigHandler(), sigmask(), event(), evobject(),
 	  waitstart(), prioGoodCnt(), flags(flags), priority(MAX_PRIO), state(BLOCKED), newState(READY),
-	  cpu(), stackRegions(), threadDir(), threadListItem(static_cast<Thread*>(this)),
+	  cpu(), rqCPU(), affinity(~0UL), stackRegions(), threadDir(), threadListItem(static_cast<Thread*>(this)),
 	  signalListItem(static_cast<Thread*>(this)), reqFrames(), stats() {
 	stats.cycleStart = CPU::rdtsc();
 	stats.signal = SIG_COUNT;
@@ -195,6 +195,22 @@ bool ThreadBase::reserveFrames(size_t count,bool swap) {
 	return true;
 }
 
+size_t ThreadBase::tryReserveFrames(size_t count) {
+	if(count == 0 || !PhysMem::reserve(count,false))
+		return 0;
+	size_t res = 0;
+	for(; res < count; res++) {
+		frameno_t frm = PhysMem::allocate(PhysMem::USR);
+		if(frm == PhysMem::INVALID_FRAME)
+			break;
+		reqFrames.append(frm);
+	}
+	/* don't keep the reservation for the frames we didn't get */
+	if(res < count)
+		PhysMem::unreserve(count - res);
+	return res;
+}
+
 int ThreadBase::create(Thread *src,Thread **dst,Proc *p,uint8_t tflags,bool cloneProc) {
 	int err = -ENOMEM;
 	Thread *t = new Thread(p,tflags);
@@ -214,6 +230,10 @@ int ThreadBase::create(Thread *src,Thread **dst,Proc *p,uint8_t tflags,bool clon
 		t->priority = p->getPriority();
 	}
 
+	/* start on the CPU of the creator; idle CPUs will steal it, if necessary */
+	t->rqCPU = src->rqCPU;
+	t->affinity = src->affinity;
+
 	/* we don't want to destroy the process first because we have a pointer to it */
 	Proc::getRef(p->getPid());
 
@@ -322,6 +342,7 @@ void ThreadBase::print(OStream &os) const {
 	os.writef("\n");
 	Signals::print(static_cast<const Thread*>(this),os);
 	os.writef("LastCPU = %d\n",cpu);
+	os.writef("Affinity = %#lx\n",affinity);
 	for(size_t i = 0; i < STACK_REG_COUNT; i++) {
 		os.writef("stackRegion%zu = %p",i,stackRegions[i] ? stackRegions[i]->virt() : 0);
 		if(i + 1 < STACK_REG_COUNT)
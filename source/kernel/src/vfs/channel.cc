@@ -21,6 +21,8 @@
 #include <esc/proto/file.h>
 #include <esc/proto/device.h>
 #include <mem/cache.h>
+#include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <mem/useraccess.h>
 #include <mem/virtmem.h>
 #include <sys/messages.h>
@@ -40,6 +42,81 @@
 #include <string.h>
 #include <video.h>
 
+VFSChannel::Message *VFSChannel::Message::createPaged(size_t length) {
+	size_t pages = BYTES_2_PAGES(length);
+	Message *msg = new (pages * sizeof(frameno_t)) Message(length,true);
+	if(EXPECT_FALSE(msg == NULL))
+		return NULL;
+
+	/* take kernel-frames, because these are always accessible without a temporary mapping */
+	frameno_t *frames = msg->frames();
+	for(size_t i = 0; i < pages; ++i) {
+		frames[i] = PhysMem::allocate(PhysMem::KERN);
+		if(EXPECT_FALSE(frames[i] == PhysMem::INVALID_FRAME)) {
+			msg->length = i * PAGE_SIZE;
+			delete msg;
+			return NULL;
+		}
+	}
+	return msg;
+}
+
+VFSChannel::Message::~Message() {
+	if(paged) {
+		frameno_t *frms = frames();
+		for(size_t i = 0; i < BYTES_2_PAGES(length); ++i) {
+			if(frms[i] != PhysMem::INVALID_FRAME)
+				PhysMem::free(frms[i],PhysMem::KERN);
+		}
+	}
+}
+
+int VFSChannel::Message::read(USER const void *src) {
+	if(!paged)
+		return UserAccess::read(this + 1,src,length);
+
+	frameno_t *frms = frames();
+	const uint8_t *data = reinterpret_cast<const uint8_t*>(src);
+	for(size_t off = 0; off < length; off += PAGE_SIZE) {
+		size_t amount = esc::Util::min(length - off,(size_t)PAGE_SIZE);
+		frameno_t frame = frms[off / PAGE_SIZE];
+		int res = UserAccess::read(reinterpret_cast<void*>(PageDir::getAccess(frame)),data + off,amount);
+		PageDir::removeAccess(frame);
+		if(EXPECT_FALSE(res < 0))
+			return res;
+	}
+	return 0;
+}
+
+int VFSChannel::Message::write(USER void *dst) {
+	if(!paged)
+		return UserAccess::write(dst,this + 1,length);
+
+	/* map as many full pages as possible into the receiver. this requires the same offset
+	 * within the page, which we can only achieve with page-aligned buffers */
+	frameno_t *frms = frames();
+	uintptr_t addr = reinterpret_cast<uintptr_t>(dst);
+	size_t flipped = 0;
+	if((addr & (PAGE_SIZE - 1)) == 0 && PageDir::isInUserSpace(addr,length)) {
+		Proc *p = Proc::getByPid(Proc::getRunning());
+		flipped = p->getVM()->replaceFrames(addr,frms,length / PAGE_SIZE);
+		for(size_t i = 0; i < flipped; ++i)
+			frms[i] = PhysMem::INVALID_FRAME;
+	}
+
+	/* copy the rest */
+	uint8_t *data = reinterpret_cast<uint8_t*>(dst);
+	for(size_t off = flipped * PAGE_SIZE; off < length; off += PAGE_SIZE) {
+		size_t amount = esc::Util::min(length - off,(size_t)PAGE_SIZE);
+		frameno_t frame = frms[off / PAGE_SIZE];
+		int res = UserAccess::write(data + off,reinterpret_cast<void*>(PageDir::getAccess(frame)),amount);
+		PageDir::removeAccess(frame);
+		if(EXPECT_FALSE(res < 0))
+			return res;
+	}
+	return 0;
+}
+
 VFSChannel::VFSChannel(const fs::User &u,VFSNode *p,bool &success)
 		/* permissions are basically irrelevant here since the userland can't open a channel directly. */
 		/* but in order to allow devices to be created by non-root users, give permissions for everyone */
@@ -192,12 +192,12 @@ int VFSDevice::send(VFSChannel *chan,ushort flags,msgid_t id,USER const void *da
 		list = &chan->sendList;
 
 	/* create message and copy data to it */
-	msg1 = new (size1) VFSChannel::Message(size1);
+	msg1 = createMsg(data1,size1);
 	if(EXPECT_FALSE(msg1 == NULL))
 		return -ENOMEM;
 
 	if(EXPECT_TRUE(data1)) {
-		if(EXPECT_FALSE((res = UserAccess::read(msg1 + 1,data1,size1)) < 0))
+		if(EXPECT_FALSE((res = msg1->read(data1)) < 0))
 			goto errorMsg1;
 	}
 
@@ -207,13 +207,13 @@ int VFSDevice::send(VFSChannel *chan,ushort flags,msgid_t id,USER const void *da
 			goto errorMsg1;
 		}
 
-		msg2 = new (size2) VFSChannel::Message(size2);
+		msg2 = createMsg(data2,size2);
 		if(EXPECT_FALSE(msg2 == NULL)) {
 			res = -ENOMEM;
 			goto errorMsg1;
 		}
 
-		if(EXPECT_FALSE((res = UserAccess::read(msg2 + 1,data2,size2)) < 0))
+		if(EXPECT_FALSE((res = msg2->read(data2)) < 0))
 			goto errorMsg2;
 	}
 
@@ -344,8 +344,10 @@ ssize_t VFSDevice::receive(VFSChannel *chan,ushort flags,msgid_t *id,USER void *
 
 	/* copy data and id */
 	if(EXPECT_TRUE(data)) {
-		if(EXPECT_FALSE((res = UserAccess::write(data,msg + 1,msg->length)) < 0))
+		if(EXPECT_FALSE((res = msg->write(data)) < 0)) {
+			delete msg;
 			return res;
+		}
 	}
 	if(EXPECT_TRUE(id))
 		*id = msg->id;
@@ -355,6 +357,17 @@ ssize_t VFSDevice::receive(VFSChannel *chan,ushort flags,msgid_t *id,USER void *
 	return res;
 }
 
+VFSChannel::Message *VFSDevice::createMsg(USER const void *data,size_t size) {
+	/* large messages are put into frames, so that the receiver can take them over */
+	if(data && size >= VFSChannel::Message::PAGED_SIZE) {
+		VFSChannel::Message *msg = VFSChannel::Message::createPaged(size);
+		if(EXPECT_TRUE(msg != NULL))
+			return msg;
+		/* if there are not enough kernel-frames, try it with the heap */
+	}
+	return new (size) VFSChannel::Message(size);
+}
+
 VFSChannel::Message *VFSDevice::getMsg(esc::SList<VFSChannel::Message> *list,msgid_t mid,ushort flags) {
 	/* drivers get always the first message */
 	if(flags & VFS_DEVICE)
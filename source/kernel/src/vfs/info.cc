@@ -50,6 +50,7 @@ void VFSInfo::init(VFSNode *sysNode) {
 	VFSNode::release(createObj<MemUsageFile>(kern,sysNode));
 	VFSNode::release(createObj<CPUFile>(kern,sysNode));
 	VFSNode::release(createObj<StatsFile>(kern,sysNode));
+	VFSNode::release(createObj<CacheFile>(kern,sysNode));
 }
 
 void VFSInfo::traceReadCallback(VFSNode *node,size_t *dataSize,void **buffer) {
@@ -256,6 +257,13 @@ void VFSInfo::memUsageReadCallback(A_UNUSED VFSNode *node,size_t *dataSize,void
 	*dataSize = os.getLength();
 }
 
+void VFSInfo::cacheReadCallback(A_UNUSED VFSNode *node,size_t *dataSize,void **buffer) {
+	OStringStream os;
+	Cache::printStats(os);
+	*buffer = os.keepString();
+	*dataSize = os.getLength();
+}
+
 void VFSInfo::regionsReadCallback(VFSNode *node,size_t *dataSize,void **buffer) {
 	Proc *p = getProc(node,dataSize,buffer);
 	if(!p)
@@ -0,0 +1,180 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/useraccess.h>
+#include <task/sched.h>
+#include <task/thread.h>
+#include <vfs/node.h>
+#include <vfs/openfile.h>
+#include <vfs/pipe.h>
+#include <common.h>
+#include <errno.h>
+#include <mutex.h>
+#include <ostream.h>
+
+VFSPipe::VFSPipe(const fs::User &u,VFSNode *p,bool &success)
+		: VFSNode(u,generateId(),S_IFCHR | 0600,success), data(), rdpos(), used(),
+		  readers(1), writers(1), lock() {
+	if(!success)
+		return;
+
+	data = (uint8_t*)Cache::alloc(BUF_SIZE);
+	if(data == NULL) {
+		success = false;
+		return;
+	}
+	append(p);
+}
+
+void VFSPipe::invalidate() {
+	Cache::free(data);
+	data = NULL;
+}
+
+ssize_t VFSPipe::open(A_UNUSED const fs::User &u,A_UNUSED const char *path,A_UNUSED ssize_t *sympos,
+		A_UNUSED ino_t root,A_UNUSED uint flags,A_UNUSED int msgid,A_UNUSED mode_t mode) {
+	/* the ends are only created by VFS::createPipe */
+	return -EACCES;
+}
+
+ssize_t VFSPipe::getSize() {
+	return used;
+}
+
+off_t VFSPipe::seek(A_UNUSED off_t position,A_UNUSED off_t offset,A_UNUSED uint whence) const {
+	return -ESPIPE;
+}
+
+ssize_t VFSPipe::read(OpenFile *file,USER void *buffer,A_UNUSED off_t offset,size_t count) {
+	Thread *t = Thread::getRunning();
+	uint8_t *buf = reinterpret_cast<uint8_t*>(buffer);
+
+	lock.down();
+	while(used == 0) {
+		/* if there is no writer anymore, we're at EOF */
+		if(writers == 0) {
+			lock.up();
+			return 0;
+		}
+		if(file->getFlags() & VFS_NOBLOCK) {
+			lock.up();
+			return -EWOULDBLOCK;
+		}
+
+		t->wait(EV_PIPE_DATA,(evobj_t)this);
+		lock.up();
+
+		Thread::switchAway();
+		if(EXPECT_FALSE(t->hasSignal()))
+			return -EINTR;
+		lock.down();
+	}
+
+	/* copy directly from the ring into the buffer; this is at most two parts */
+	size_t amount = esc::Util::min(count,used);
+	size_t first = esc::Util::min(amount,BUF_SIZE - rdpos);
+	int res = UserAccess::write(buf,data + rdpos,first);
+	if(res == 0 && amount > first)
+		res = UserAccess::write(buf + first,data,amount - first);
+	if(EXPECT_TRUE(res == 0)) {
+		rdpos = (rdpos + amount) % BUF_SIZE;
+		used -= amount;
+	}
+	lock.up();
+
+	if(EXPECT_FALSE(res < 0))
+		return res;
+	Sched::wakeup(EV_PIPE_SPACE,(evobj_t)this);
+	return amount;
+}
+
+ssize_t VFSPipe::write(OpenFile *file,USER const void *buffer,A_UNUSED off_t offset,size_t count) {
+	Thread *t = Thread::getRunning();
+	const uint8_t *buf = reinterpret_cast<const uint8_t*>(buffer);
+	size_t done = 0;
+
+	lock.down();
+	while(done < count) {
+		/* nobody will ever read that */
+		if(readers == 0) {
+			lock.up();
+			return done > 0 ? (ssize_t)done : -EPIPE;
+		}
+
+		if(used == BUF_SIZE) {
+			if(file->getFlags() & VFS_NOBLOCK) {
+				lock.up();
+				return done > 0 ? (ssize_t)done : -EWOULDBLOCK;
+			}
+
+			t->wait(EV_PIPE_SPACE,(evobj_t)this);
+			lock.up();
+
+			Thread::switchAway();
+			if(EXPECT_FALSE(t->hasSignal()))
+				return done > 0 ? (ssize_t)done : -EINTR;
+			lock.down();
+			continue;
+		}
+
+		/* copy as much as fits behind the data in the ring */
+		size_t wrpos = (rdpos + used) % BUF_SIZE;
+		size_t amount = esc::Util::min(count - done,BUF_SIZE - used);
+		amount = esc::Util::min(amount,BUF_SIZE - wrpos);
+		int res = UserAccess::read(data + wrpos,buf + done,amount);
+		if(EXPECT_FALSE(res < 0)) {
+			lock.up();
+			return done > 0 ? (ssize_t)done : res;
+		}
+		used += amount;
+		done += amount;
+
+		/* let the readers start with it */
+		Sched::wakeup(EV_PIPE_DATA,(evobj_t)this);
+	}
+	lock.up();
+	return done;
+}
+
+void VFSPipe::close(OpenFile *file,A_UNUSED int msgid) {
+	bool last;
+	{
+		LockGuard<Mutex> g(&lock);
+		if(file->getFlags() & VFS_READ)
+			readers--;
+		else
+			writers--;
+		last = readers == 0 && writers == 0;
+	}
+
+	/* the other end gets EOF or EPIPE now */
+	Sched::wakeup(EV_PIPE_DATA,(evobj_t)this);
+	Sched::wakeup(EV_PIPE_SPACE,(evobj_t)this);
+
+	unref();
+	/* if both ends are closed, remove it from the tree, which releases the last reference */
+	if(last)
+		destroy();
+}
+
+void VFSPipe::print(OStream &os) const {
+	os.writef("Pipe '%s': used=%zu rdpos=%zu readers=%u writers=%u\n",
+		getPath(),used,rdpos,readers,writers);
+}
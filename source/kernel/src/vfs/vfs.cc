@@ -35,6 +35,7 @@
 #include <vfs/info.h>
 #include <vfs/node.h>
 #include <vfs/openfile.h>
+#include <vfs/pipe.h>
 #include <vfs/vfs.h>
 #include <assert.h>
 #include <common.h>
@@ -50,6 +51,7 @@ VFSNode *VFS::procsNode;
 VFSNode *VFS::devNode;
 VFSNode *VFS::tmpNode;
 VFSNode *VFS::mountsNode;
+VFSNode *VFS::pipesNode;
 
 void VFS::init() {
 	VFSNode *root,*sys;
@@ -65,6 +67,7 @@ void VFS::init() {
 	 *   |   |- pid
 	 *   |       \- self
 	 *   |   |- proc
+	 *   |   |- pipe
 	 *   |   \- mount
 	 *   |- dev
 	 *   \- tmp
@@ -82,6 +85,8 @@ void VFS::init() {
 	VFSNode::release(createObj<VFSDir>(kern,sys,(char*)"irq",DIR_DEF_MODE));
 	mountsNode = createObj<VFSDir>(kern,sys,(char*)"mount",DIR_DEF_MODE);
 	VFSNode::release(mountsNode);
+	pipesNode = createObj<VFSDir>(kern,sys,(char*)"pipe",S_IFDIR | 0777);
+	VFSNode::release(pipesNode);
 	devNode = createObj<VFSDir>(kern,root,(char*)"dev",DIR_DEF_MODE);
 	/* the user should be able to create devices as well */
 	/* TODO: maybe we should organize that differently */
@@ -353,6 +358,42 @@ errorProc:
 	return res;
 }
 
+int VFS::createPipe(pid_t pid,OpenFile **readFile,OpenFile **writeFile) {
+	const uint rwx = VFS_READ | VFS_WRITE | VFS_EXEC;
+	int res;
+
+	Proc *p = Proc::getRef(pid);
+	if(!p)
+		return -EDESTROYED;
+
+	fs::User user(p->getUid(),p->getGid());
+	user.groupCount = Groups::get(pid,user.gids,fs::MAX_GROUPS);
+	Proc::relRef(p);
+
+	VFSPipe *pipe = createObj<VFSPipe>(user,pipesNode);
+	if(!pipe)
+		return -ENOMEM;
+
+	res = openFile(user,rwx,VFS_READ,pipe,pipe->getNo(),VFS_DEV_NO,readFile);
+	if(res < 0)
+		goto errorRead;
+	res = openFile(user,rwx,VFS_WRITE,pipe,pipe->getNo(),VFS_DEV_NO,writeFile);
+	if(res < 0)
+		goto errorWrite;
+
+	/* the open files hold the references now */
+	VFSNode::release(pipe);
+	return 0;
+
+errorWrite:
+	/* this drops the reader and thus the reference of the read-end */
+	(*readFile)->close();
+errorRead:
+	pipe->destroy();
+	VFSNode::release(pipe);
+	return res;
+}
+
 void VFS::closeFileDesc(pid_t pid,int fd) {
 	Proc *p = Proc::getRef(pid);
 	if(p) {
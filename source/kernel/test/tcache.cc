@@ -0,0 +1,168 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/util.h>
+#include <mem/cache.h>
+#include <sys/test.h>
+#include <task/proc.h>
+#include <task/sched.h>
+#include <task/smp.h>
+#include <task/thread.h>
+#include <common.h>
+#include <spinlock.h>
+
+#include "testutils.h"
+
+/* forward declarations */
+static void test_cache();
+static void test_cache_sizes();
+#ifndef __mmix__
+static void test_cache_storm();
+#endif
+
+/* our test-module */
+sTestModule tModCache = {
+	"Cache",
+	&test_cache
+};
+
+static const size_t sizes[] = {1,16,17,100,128,250,1000,2048,4000,8192,16384};
+
+static void test_cache() {
+	test_cache_sizes();
+	/* see tsched.cc */
+#ifndef __mmix__
+	test_cache_storm();
+#endif
+}
+
+static bool test_fill(uint8_t *p,size_t size,uint8_t value) {
+	for(size_t i = 0; i < size; ++i)
+		p[i] = value;
+	for(size_t i = 0; i < size; ++i) {
+		if(p[i] != value)
+			return false;
+	}
+	return true;
+}
+
+static void test_cache_sizes() {
+	uint8_t *ptrs[ARRAY_SIZE(sizes)];
+	test_caseStart("Allocating and freeing all size-classes");
+
+	checkMemoryBefore(false);
+	/* do it multiple times to go through the magazines and the shared freelists */
+	for(size_t j = 0; j < 100; ++j) {
+		for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+			ptrs[i] = (uint8_t*)Cache::alloc(sizes[i]);
+			test_assertTrue(ptrs[i] != NULL);
+			test_assertTrue(test_fill(ptrs[i],sizes[i],i));
+		}
+		for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+			for(size_t x = 0; x < sizes[i]; ++x) {
+				if(ptrs[i][x] != i) {
+					test_assertUInt(ptrs[i][x],i);
+					break;
+				}
+			}
+			Cache::free(ptrs[i]);
+		}
+	}
+	checkMemoryAfter(false);
+
+	test_caseSucceeded();
+}
+
+#ifndef __mmix__
+static const size_t MAX_THREADS = 64;
+static const size_t OBJS_PER_THREAD = 64;
+static const size_t STORM_ROUNDS = 200;
+
+static SpinLock stormLock;
+static void *shared[OBJS_PER_THREAD];
+static size_t sharedCount = 0;
+static volatile size_t stormErrors = 0;
+
+static void thread_storm() {
+	static size_t nextCPU = 0;
+	uint8_t *objs[OBJS_PER_THREAD];
+	Thread *t = Thread::getRunning();
+	uint8_t value = t->getTid();
+
+	/* distribute the threads over all CPUs */
+	{
+		LockGuard<SpinLock> g(&stormLock);
+		Sched::setAffinity(t,1UL << (nextCPU++ % SMP::getCPUCount()));
+	}
+	Thread::switchAway();
+
+	for(size_t r = 0; r < STORM_ROUNDS; ++r) {
+		size_t size = sizes[(r + value) % ARRAY_SIZE(sizes)];
+		for(size_t i = 0; i < OBJS_PER_THREAD; ++i) {
+			objs[i] = (uint8_t*)Cache::alloc(size);
+			if(!objs[i] || !test_fill(objs[i],size,value))
+				stormErrors++;
+		}
+		for(size_t i = 0; i < OBJS_PER_THREAD; ++i) {
+			bool valid = true;
+			for(size_t x = 0; objs[i] && x < size; ++x)
+				valid &= objs[i][x] == value;
+			if(!valid)
+				stormErrors++;
+
+			/* exchange some objects with the other threads, so that we free objects that have been
+			 * allocated on a different CPU */
+			if(i % 4 == 0) {
+				void *other = NULL;
+				{
+					LockGuard<SpinLock> g(&stormLock);
+					if(sharedCount == OBJS_PER_THREAD)
+						other = shared[--sharedCount];
+					shared[sharedCount++] = objs[i];
+				}
+				Cache::free(other);
+			}
+			else
+				Cache::free(objs[i]);
+		}
+		if(r % 16 == 0)
+			Thread::switchAway();
+	}
+	Proc::terminateThread(0);
+}
+
+static void test_cache_storm() {
+	size_t count = esc::Util::min(SMP::getCPUCount() * 2,MAX_THREADS);
+	int tids[MAX_THREADS];
+	test_caseStart("Alloc/free storm with %zu threads on %zu CPUs",count,SMP::getCPUCount());
+
+	for(size_t i = 0; i < count; ++i) {
+		tids[i] = Proc::startThread((uintptr_t)&thread_storm,0,NULL);
+		test_assertTrue(tids[i] >= 0);
+	}
+	for(size_t i = 0; i < count; ++i)
+		Proc::join(tids[i]);
+	test_assertSize(stormErrors,0);
+
+	while(sharedCount > 0)
+		Cache::free(shared[--sharedCount]);
+
+	test_caseSucceeded();
+}
+#endif
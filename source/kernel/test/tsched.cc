@@ -18,11 +18,19 @@
  */
 
 #include <sys/test.h>
+#include <task/proc.h>
 #include <task/sched.h>
+#include <task/smp.h>
+#include <task/thread.h>
 #include <common.h>
+#include <errno.h>
 
 /* forward declarations */
 static void test_sched();
+#ifndef __mmix__
+static void test_yield();
+static void test_affinity();
+#endif
 
 /* our test-module */
 sTestModule tModSched = {
@@ -31,71 +39,80 @@ sTestModule tModSched = {
 };
 
 static void test_sched() {
-	/* TODO implement for threads */
-#if 0
-	Proc *x = (Proc*)Proc::getByPid(Proc::getFreePid());
-	Proc *rand[5] = {x + 1,x,x + 4,x + 2,x + 3};
-	size_t i;
-	bool res = true;
-	/* not relevant here */
-	Proc *p = (Proc*)x, *pp;
+	/* doesn't work on mmix since we would have to leave the kernel and enter it again in order to
+	 * get a new kernel-stack */
+#ifndef __mmix__
+	test_yield();
+	test_affinity();
+#endif
+}
+
+#ifndef __mmix__
+static const size_t THREAD_COUNT = 8;
+static const size_t YIELD_COUNT = 100;
 
-	test_caseStart("Enqueuing - dequeuing");
-	/* enqueue */
-	for(i = 0; i < PROC_COUNT - 1; i++) {
-		sched_setReady(p++);
+static SpinLock cntLock;
+static size_t yieldcnt = 0;
+static volatile cpuid_t targetCPU;
+static volatile cpuid_t ranOnCPU;
+static volatile int affinityRes;
+
+static void thread_yield() {
+	for(size_t i = 0; i < YIELD_COUNT; ++i) {
+		Thread::switchAway();
+		LockGuard<SpinLock> g(&cntLock);
+		yieldcnt++;
 	}
-	/* dequeue */
-	pp = (Proc*)x;
-	while((p = sched_dequeueReady()) != NULL) {
-		p->state = Thread::UNUSED;
-		if(p != pp) {
-			res = false;
-			break;
-		}
-		pp++;
+	Proc::terminateThread(0);
+}
+
+static void thread_pinned() {
+	Thread *t = Thread::getRunning();
+	affinityRes = Sched::setAffinity(t,1UL << targetCPU);
+	/* leave the CPU, if we're not allowed to stay here */
+	for(size_t i = 0; i < YIELD_COUNT && t->getCPU() != targetCPU; ++i)
+		Thread::switchAway();
+	ranOnCPU = t->getCPU();
+	Proc::terminateThread(0);
+}
+
+static void test_yield() {
+	int tids[THREAD_COUNT];
+	test_caseStart("Yielding threads on %zu CPUs",SMP::getCPUCount());
+
+	/* all threads have to make progress, regardless of the run-queue they end up in */
+	for(size_t i = 0; i < THREAD_COUNT; ++i) {
+		tids[i] = Proc::startThread((uintptr_t)&thread_yield,0,NULL);
+		test_assertTrue(tids[i] >= 0);
 	}
-	if(res)
-		test_caseSucceeded();
-	else
-		test_caseFailed("Got process 0x%x, expected 0x%x",p,pp);
+	for(size_t i = 0; i < THREAD_COUNT; ++i)
+		Proc::join(tids[i]);
+	test_assertSize(yieldcnt,THREAD_COUNT * YIELD_COUNT);
+
+	test_caseSucceeded();
+}
 
-	/* second test */
-	res = true;
-	test_caseStart("Dequeue specific processes (opposite order)");
-	/* enqueue some processes */
-	p = (Proc*)x;
-	for(i = 0; i < 5; i++)
-		sched_setReady(p++);
-	/* dequeue */
-	p--;
-	for(i = 4; i >= 0; i--) {
-		res = res && sched_dequeueReadyProc(p);
-		res = res && !sched_dequeueReadyProc(p);
-		p->state = Thread::UNUSED;
-		p--;
+static void test_affinity() {
+	test_caseStart("Pinning threads to CPUs");
+
+	for(size_t c = 0; c < SMP::getCPUCount() && c < sizeof(ulong) * 8; ++c) {
+		targetCPU = c;
+		ranOnCPU = -1;
+		int tid = Proc::startThread((uintptr_t)&thread_pinned,0,NULL);
+		test_assertTrue(tid >= 0);
+		Proc::join(tid);
+		test_assertInt(affinityRes,0);
+		test_assertUInt(ranOnCPU,c);
 	}
-	if(res)
-		test_caseSucceeded();
-	else
-		test_caseFailed("");
 
-	/* third test */
-	res = true;
-	test_caseStart("Dequeue specific processes (random order)");
-	/* enqueue some processes */
-	p = (Proc*)x;
-	for(i = 0; i < 5; i++)
-		sched_setReady(p++);
-	/* dequeue */
-	for(i = 0; i < 5; i++) {
-		res = res && sched_dequeueReadyProc(rand[i]);
-		res = res && !sched_dequeueReadyProc(rand[i]);
-		rand[i]->state = Thread::UNUSED;
+	/* a mask without any existing CPU is invalid */
+	Thread *t = Thread::getRunning();
+	if(SMP::getCPUCount() < sizeof(ulong) * 8) {
+		ulong old = t->getAffinity();
+		test_assertInt(Sched::setAffinity(t,1UL << SMP::getCPUCount()),-EINVAL);
+		test_assertULInt(t->getAffinity(),old);
 	}
-	if(res)
-		test_caseSucceeded();
-	else
-		test_caseFailed("");
-#endif
+
+	test_caseSucceeded();
 }
+#endif
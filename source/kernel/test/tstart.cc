@@ -41,6 +41,7 @@ extern sTestModule tModProc;
 extern sTestModule tModKHeap;
 extern sTestModule tModRegion;
 extern sTestModule tModSched;
+extern sTestModule tModCache;
 extern sTestModule tModVFSn;
 extern sTestModule tModSwapMap;
 extern sTestModule tModVmm;
@@ -77,6 +78,7 @@ void unittest_run() {
 	test_register(&tModKHeap);
 	test_register(&tModRegion);
 	test_register(&tModSched);
+	test_register(&tModCache);
 	test_register(&tModVFSn);
 	test_register(&tModSwapMap);
 	test_register(&tModVmm);
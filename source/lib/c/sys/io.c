@@ -253,17 +253,7 @@ int fsymlink(const char *target,int fd,const char *name) {
 }
 
 int pipe(int *readFd,int *writeFd) {
-	int fd = open("/dev/pipe",O_WRONLY);
-	if(fd < 0)
-		return fd;
-	*writeFd = fd;
-	*readFd = obtain(fd,0);
-	if(*readFd < 0) {
-		close(fd);
-		errno = *readFd;
-		return *readFd;
-	}
-	return 0;
+	return syscall2(SYSCALL_PIPE,(ulong)readFd,(ulong)writeFd);
 }
 
 int createbuf(size_t size,void **mem,int flags) {
@@ -128,6 +128,9 @@ const struct Syscall syscalls[] = {
 	{"utime",			"%d,%p"						},
 	{"truncate",		"%d,%u"						},
 	{"symlink",			"%s,%d,%s"					},
+	{"setaffinity",		"%d,%x"						},
+	{"virt2phys",		"%p,%x,%p"					},
+	{"pipe",			"%p,%p"						},
 #if defined(__x86__)
 	{"reqports",   		"%d,%d"						},
 	{"relports",    	"%d,%d"						},
@@ -59,6 +59,9 @@ void *pattern_createRepeat(void *e,int min,int max) {
 		yyerror("Unable to repeat a repeat-element");
 	if(min < 0 || max <= 0 || max < min)
 		yyerror("Invalid repeat specification");
+	else if(min > RepeatElement::MAX_COUNT ||
+			(max != RepeatElement::INFINITE && max > RepeatElement::MAX_COUNT))
+		yyerror("Repeat count too large");
 	return new RepeatElement(el,min,max);
 }
 
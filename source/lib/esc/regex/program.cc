@@ -0,0 +1,412 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#include <esc/regex/program.h>
+#include <algorithm>
+#include <string.h>
+
+#include "pattern.h"
+
+namespace esc {
+
+/**
+ * The threads of the Pike-VM, stored in a sparse set indexed by the program counter. Each thread
+ * has its own capture slots.
+ */
+struct Regex::Program::Threads {
+	struct Frame {
+		uint pc;
+		int slot;
+		ssize_t old;
+	};
+
+	explicit Threads(size_t insts,size_t slots)
+		: count(), dense(insts), sparse(insts), caps(insts * slots), stack() {
+	}
+
+	bool contains(uint pc) const {
+		uint i = sparse[pc];
+		return i < count && dense[i] == pc;
+	}
+	ssize_t *add(uint pc,size_t slots) {
+		sparse[pc] = count;
+		dense[count] = pc;
+		return &caps[count++ * slots];
+	}
+
+	size_t count;
+	std::vector<uint> dense;
+	std::vector<uint> sparse;
+	std::vector<ssize_t> caps;
+	std::vector<Frame> stack;
+};
+
+int Regex::Program::CharSet::single() const {
+	int c = -1;
+	for(size_t i = 0; i < 256; ++i) {
+		if(test(i)) {
+			if(c != -1)
+				return -1;
+			c = i;
+		}
+	}
+	return c;
+}
+
+Regex::Program::Program(const Element *root,int flags,size_t groups)
+		: _flags(flags), _groups(groups), _insts(), _classes(), _prefix(), _foldedPrefix(), _dfas() {
+	root->compile(*this);
+	if(_flags & REGEX_FLAG_END)
+		emit(EOL);
+	emit(MATCH);
+
+	computePrefix(_prefix,false);
+	computePrefix(_foldedPrefix,true);
+}
+
+Regex::Program::~Program() {
+	for(size_t i = 0; i < ARRAY_SIZE(_dfas); ++i)
+		flush(_dfas[i]);
+}
+
+void Regex::Program::computePrefix(std::string &prefix,bool folded) const {
+	// walk along the instructions that every match has to pass, as long as they are single chars
+	for(uint pc = 0; pc < _insts.size(); ++pc) {
+		const Inst &inst = _insts[pc];
+		if(inst.op == SAVE)
+			continue;
+		if(inst.op != CLASS)
+			break;
+
+		int c = folded ? _classes[inst.x].folded.single() : _classes[inst.x].exact.single();
+		if(c == -1)
+			break;
+		prefix += static_cast<char>(c);
+	}
+}
+
+size_t Regex::Program::findPrefix(const std::string &str,size_t pos,uint flags) const {
+	const std::string &prefix = (flags & CASE_INSENSITIVE) ? _foldedPrefix : _prefix;
+	if(prefix.empty() || pos >= str.length())
+		return pos;
+
+	const char *begin = str.c_str();
+	const void *res;
+	if(prefix.length() == 1)
+		res = memchr(begin + pos,prefix[0],str.length() - pos);
+	else
+		res = memmem(begin + pos,str.length() - pos,prefix.c_str(),prefix.length());
+	if(!res)
+		return std::string::npos;
+	return static_cast<const char*>(res) - begin;
+}
+
+void Regex::Program::closure(std::vector<uint> &pcs,std::vector<bool> &seen,uint pc,bool atEnd) const {
+	std::vector<uint> stack;
+	stack.push_back(pc);
+	while(!stack.empty()) {
+		pc = stack.back();
+		stack.pop_back();
+		if(seen[pc])
+			continue;
+		seen[pc] = true;
+
+		const Inst &inst = _insts[pc];
+		switch(inst.op) {
+			case JMP:
+				stack.push_back(inst.x);
+				break;
+			case SPLIT:
+				stack.push_back(inst.y);
+				stack.push_back(inst.x);
+				break;
+			case SAVE:
+				stack.push_back(pc + 1);
+				break;
+			case EOL:
+				if(atEnd)
+					stack.push_back(pc + 1);
+				else
+					pcs.push_back(pc);
+				break;
+			case CLASS:
+			case MATCH:
+				pcs.push_back(pc);
+				break;
+		}
+	}
+}
+
+Regex::Program::DFA &Regex::Program::dfa(uint flags,bool anchored) const {
+	DFA &d = _dfas[((flags & CASE_INSENSITIVE) ? 1 : 0) | (anchored ? 2 : 0)];
+	if(d.start == NULL) {
+		d.buckets.assign(MAX_DFA_STATES,-1);
+		std::vector<uint> pcs;
+		std::vector<bool> seen(_insts.size(),false);
+		closure(pcs,seen,0,false);
+		d.start = addState(d,pcs);
+	}
+	return d;
+}
+
+Regex::Program::DState *Regex::Program::addState(DFA &dfa,std::vector<uint> &pcs) const {
+	std::sort(pcs.begin(),pcs.end());
+	uint hash = pcs.size();
+	for(size_t i = 0; i < pcs.size(); ++i)
+		hash = hash * 31 + pcs[i];
+
+	int *bucket = &dfa.buckets[hash % dfa.buckets.size()];
+	for(int s = *bucket; s != -1; s = dfa.states[s]->chain) {
+		DState *st = dfa.states[s];
+		if(st->hash == hash && st->pcs.size() == pcs.size() &&
+				(pcs.empty() || memcmp(st->pcs.data(),pcs.data(),pcs.size() * sizeof(uint)) == 0))
+			return dfa.states[s];
+	}
+
+	DState *st = new DState();
+	st->accept = false;
+	st->acceptEnd = false;
+	std::vector<bool> seen(_insts.size(),false);
+	std::vector<uint> end;
+	for(size_t i = 0; i < pcs.size(); ++i) {
+		if(_insts[pcs[i]].op == MATCH)
+			st->accept = true;
+		// if we are at the end of the string, EOL lets us continue
+		else if(_insts[pcs[i]].op == EOL)
+			closure(end,seen,pcs[i] + 1,true);
+	}
+	st->acceptEnd = st->accept;
+	for(size_t i = 0; i < end.size(); ++i) {
+		if(_insts[end[i]].op == MATCH)
+			st->acceptEnd = true;
+	}
+
+	st->pcs = pcs;
+	st->hash = hash;
+	st->chain = *bucket;
+	for(size_t i = 0; i < ARRAY_SIZE(st->next); ++i)
+		st->next[i] = NULL;
+	dfa.states.push_back(st);
+	*bucket = dfa.states.size() - 1;
+	return st;
+}
+
+Regex::Program::DState *Regex::Program::step(DFA &dfa,DState *state,uint8_t c,uint flags,
+		bool anchored) const {
+	if(state->next[c])
+		return state->next[c];
+
+	std::vector<uint> pcs;
+	std::vector<bool> seen(_insts.size(),false);
+	const std::vector<uint> &cur = state->pcs;
+	for(size_t i = 0; i < cur.size(); ++i) {
+		const Inst &inst = _insts[cur[i]];
+		if(inst.op == CLASS && charset(inst.x,flags).test(c))
+			closure(pcs,seen,cur[i] + 1,false);
+	}
+	// in unanchored mode, a new match can start at every position
+	if(!anchored)
+		closure(pcs,seen,0,false);
+
+	// if the cache is full, throw it away and start again. this keeps the memory bounded,
+	// even for patterns that have exponentially many DFA states.
+	if(dfa.states.size() >= MAX_DFA_STATES) {
+		flush(dfa);
+		this->dfa(flags,anchored);
+		return addState(dfa,pcs);
+	}
+
+	state->next[c] = addState(dfa,pcs);
+	return state->next[c];
+}
+
+void Regex::Program::flush(DFA &dfa) const {
+	for(size_t i = 0; i < dfa.states.size(); ++i)
+		delete dfa.states[i];
+	dfa.states.clear();
+	dfa.buckets.clear();
+	dfa.start = NULL;
+}
+
+bool Regex::Program::runDFA(const std::string &str,size_t pos,uint flags,bool anchored,
+		bool search) const {
+	DFA &d = dfa(flags,anchored);
+	const uint8_t *s = reinterpret_cast<const uint8_t*>(str.c_str());
+	size_t len = str.length();
+	bool prefix = !((flags & CASE_INSENSITIVE) ? _foldedPrefix : _prefix).empty();
+	DState *state = d.start;
+	while(pos < len) {
+		if(search && state->accept)
+			return true;
+		if(state->pcs.empty())
+			return false;
+
+		// no match in progress? skip to the next occurrence of the literal prefix
+		if(prefix && !anchored && state == d.start) {
+			pos = findPrefix(str,pos,flags);
+			if(pos == std::string::npos)
+				return false;
+			if(pos == len)
+				break;
+		}
+
+		DState *next = state->next[s[pos]];
+		state = next ? next : step(d,state,s[pos],flags,anchored);
+		pos++;
+	}
+	return state->acceptEnd;
+}
+
+void Regex::Program::addThread(Threads &list,uint pc,ssize_t *caps,size_t pos,size_t len) const {
+	size_t slots = _groups * 2;
+	Threads::Frame first = {pc,-1,0};
+	list.stack.push_back(first);
+	while(!list.stack.empty()) {
+		Threads::Frame f = list.stack.back();
+		list.stack.pop_back();
+		// restore the slot that has been overwritten by a SAVE
+		if(f.slot != -1) {
+			caps[f.slot] = f.old;
+			continue;
+		}
+		if(list.contains(f.pc))
+			continue;
+
+		ssize_t *tcaps = list.add(f.pc,slots);
+		const Inst &inst = _insts[f.pc];
+		switch(inst.op) {
+			case JMP: {
+				Threads::Frame next = {inst.x,-1,0};
+				list.stack.push_back(next);
+			}
+			break;
+
+			case SPLIT: {
+				// push y first to visit x first, which gives x the higher priority
+				Threads::Frame next1 = {inst.y,-1,0};
+				Threads::Frame next2 = {inst.x,-1,0};
+				list.stack.push_back(next1);
+				list.stack.push_back(next2);
+			}
+			break;
+
+			case SAVE: {
+				Threads::Frame restore = {0,static_cast<int>(inst.x),caps[inst.x]};
+				Threads::Frame next = {f.pc + 1,-1,0};
+				list.stack.push_back(restore);
+				list.stack.push_back(next);
+				caps[inst.x] = pos;
+			}
+			break;
+
+			case EOL:
+				if(pos == len) {
+					Threads::Frame next = {f.pc + 1,-1,0};
+					list.stack.push_back(next);
+				}
+				break;
+
+			case CLASS:
+			case MATCH:
+				memcpy(tcaps,caps,slots * sizeof(ssize_t));
+				break;
+		}
+	}
+}
+
+bool Regex::Program::runPike(const std::string &str,size_t pos,uint flags,bool anchored,
+		Result *res) const {
+	size_t slots = _groups * 2;
+	size_t len = str.length();
+	Threads list1(_insts.size(),slots);
+	Threads list2(_insts.size(),slots);
+	Threads *clist = &list1;
+	Threads *nlist = &list2;
+	std::vector<ssize_t> caps(slots,-1);
+	std::vector<ssize_t> best(slots,-1);
+	bool matched = false;
+
+	for(size_t start = pos; ; ++pos) {
+		// start a new thread with the lowest priority, as long as we have no match
+		if(!matched && (!anchored || pos == start)) {
+			if(clist->count == 0 && !anchored) {
+				pos = findPrefix(str,pos,flags);
+				if(pos == std::string::npos)
+					break;
+			}
+			for(size_t i = 0; i < slots; ++i)
+				caps[i] = -1;
+			addThread(*clist,0,caps.data(),pos,len);
+		}
+		if(clist->count == 0)
+			break;
+
+		nlist->count = 0;
+		for(size_t i = 0; i < clist->count; ++i) {
+			uint pc = clist->dense[i];
+			ssize_t *tcaps = &clist->caps[i * slots];
+			const Inst &inst = _insts[pc];
+			if(inst.op == MATCH) {
+				// the threads behind this one have a lower priority
+				matched = true;
+				memcpy(best.data(),tcaps,slots * sizeof(ssize_t));
+				break;
+			}
+			if(inst.op == CLASS && pos < len &&
+					charset(inst.x,flags).test(static_cast<uint8_t>(str[pos])))
+				addThread(*nlist,pc + 1,tcaps,pos + 1,len);
+		}
+		std::swap(clist,nlist);
+		if(pos >= len)
+			break;
+	}
+
+	if(matched) {
+		for(size_t i = 0; i < _groups; ++i) {
+			if(best[i * 2] != -1 && best[i * 2 + 1] != -1)
+				res->set(i,str.substr(best[i * 2],best[i * 2 + 1] - best[i * 2]));
+		}
+		res->setSuccess(true);
+	}
+	return matched;
+}
+
+bool Regex::Program::matches(const std::string &str,uint flags) const {
+	return runDFA(str,0,flags,true,false);
+}
+
+bool Regex::Program::search(const std::string &str,uint flags,Result *res) const {
+	bool anchored = _flags & REGEX_FLAG_BEGIN;
+	size_t pos = 0;
+	if(!anchored) {
+		pos = findPrefix(str,0,flags);
+		if(pos == std::string::npos)
+			return false;
+	}
+
+	// the DFA is much faster, so use it to check whether there is a match at all
+	if(!runDFA(str,pos,flags,anchored,true))
+		return false;
+	if(!res)
+		return true;
+	return runPike(str,pos,flags,anchored,res);
+}
+
+}
@@ -19,6 +19,7 @@
 
 #include <esc/regex/regex.h>
 #include <esc/regex/elements.h>
+#include <esc/regex/program.h>
 #include <esc/stream/std.h>
 
 #include "pattern.h"
@@ -37,6 +38,22 @@ extern "C" void yyerror(char const *s) {
 
 namespace esc {
 
+Regex::Pattern::Pattern(Element *root,int flags,size_t groups)
+	: _flags(flags), _root(root), _prog() {
+	try {
+		_prog = new Program(root,flags,groups);
+	}
+	catch(...) {
+		delete _root;
+		throw;
+	}
+}
+
+void Regex::Pattern::destroy() {
+	delete _prog;
+	delete _root;
+}
+
 esc::OStream &operator<<(esc::OStream &os,const Regex::Pattern &p) {
 	p._root->print(os,0);
 	return os;
@@ -57,33 +74,19 @@ Regex::Pattern Regex::compile(const std::string &regex) {
 	}
 
 	Regex::Element *root = reinterpret_cast<Regex::Element*>(regex_result);
-	return Regex::Pattern(root,regex_flags);
-}
-
-Regex::Result Regex::test(const Pattern &p,const std::string &str,size_t pos,uint flags) {
-	Input in(str,pos,flags);
-	Regex::Result res(regex_groups);
-	if(p.root()->match(&res,in))
-		res.setSuccess(true);
-	return res;
+	return Regex::Pattern(root,regex_flags,regex_groups);
 }
 
 Regex::Result Regex::search(const Pattern &p,const std::string &str,uint flags) {
-	if(p.flags() & REGEX_FLAG_BEGIN)
-		return test(p,str,0,flags);
-	for(size_t i = 0; i < str.length(); ++i) {
-		Regex::Result res = test(p,str,i,flags);
-		if(res.matched()) {
-			if((~p.flags() & REGEX_FLAG_END) || (i + res.get(0).length() == str.length()))
-				return res;
-		}
-	}
-	return Regex::Result();
+	const Program &prog = p.program();
+	Regex::Result res(prog.groups());
+	if(!prog.search(str,flags,&res))
+		return Regex::Result();
+	return res;
 }
 
 bool Regex::matches(const Pattern &p,const std::string &str,uint flags) {
-	Input in(str,0,flags);
-	return p.root()->match(NULL,in) && in.peek() == '\0';
+	return p.program().matches(str,flags);
 }
 
 std::string Regex::replace(const Pattern &p,const std::string &str,const std::string &repl,uint flags) {
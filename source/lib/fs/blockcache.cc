@@ -22,36 +22,57 @@
 #include <sys/common.h>
 #include <sys/debug.h>
 #include <sys/thread.h>
+#include <algorithm>
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-#define ALLOC_LOCK	0xF7180000
+#include <string.h>
 
 namespace fs {
 
 BlockCache::BlockCache(int fd,size_t blocks,size_t bsize)
-		: _blockCacheSize(blocks), _blockSize(bsize), _hashmap(new CBlock*[HASH_SIZE]()),
-		  _oldestBlock(NULL), _newestBlock(NULL), _freeBlocks(NULL),
-		  _blockCache(new CBlock[blocks]), _blockmem(), _blockfd(), _hits(), _misses() {
-	size_t i;
-	CBlock *bentry;
-	if((_blockfd = sharebuf(fd,_blockCacheSize * _blockSize,&_blockmem,0)) < 0) {
+		: _blockCacheSize(blocks), _blockSize(bsize), _probationSize(std::max<size_t>(blocks / 4,1)),
+		  _ghostCount(std::max<size_t>(blocks / 2,1)), _hashmap(), _hashSize(), _hashShift(),
+		  _lists(), _blockCache(new CBlock[_blockCacheSize + _ghostCount]), _blockmem(), _bulkmem(),
+		  _wbmem(), _blockfd(), _hits(), _misses(), _raBlocks(), _raHits(), _ghostHits(),
+		  _dirtyCount(), _ticks(), _wbRequests(), _wbBlocks(), _syncEvictions(), _flusher(-1),
+		  _flusherRun(), _trace(), _mutex(), _bulkMutex(), _wbMutex(), _locks(LOCK_COUNT) {
+	/* behind the blocks, we have space to read up to MAX_BULK blocks at once and to write up to
+	 * MAX_BULK blocks at once */
+	size_t size = (_blockCacheSize + MAX_BULK * 2) * _blockSize;
+	if(fd < 0)
+		_blockfd = createbuf(size,&_blockmem,0);
+	else
+		_blockfd = sharebuf(fd,size,&_blockmem,0);
+	if(_blockfd < 0) {
 		if(_blockmem == NULL)
 			VTHROW("Unable to create block cache");
 		printe("Unable to share buffer with disk driver");
 	}
-	bentry = _blockCache;
-	for(i = 0; i < _blockCacheSize; i++) {
+	_bulkmem = (char*)_blockmem + _blockCacheSize * _blockSize;
+	_wbmem = (char*)_bulkmem + MAX_BULK * _blockSize;
+
+	/* use at most 50% of the hashmap to keep the probe sequences short */
+	_hashSize = 2;
+	_hashShift = 31;
+	while(_hashSize < (_blockCacheSize + _ghostCount) * 2) {
+		_hashSize *= 2;
+		_hashShift--;
+	}
+	_hashmap = new CBlock*[_hashSize]();
+
+	for(size_t i = 0; i < _blockCacheSize + _ghostCount; i++) {
+		CBlock *bentry = _blockCache + i;
 		bentry->blockNo = 0;
-		bentry->buffer = (char*)_blockmem + i * _blockSize;
+		bentry->buffer = i < _blockCacheSize ? (char*)_blockmem + i * _blockSize : NULL;
 		bentry->dirty = false;
 		bentry->refs = 0;
-		bentry->prev = (i < _blockCacheSize - 1) ? bentry + 1 : NULL;
-		bentry->next = _freeBlocks;
-		bentry->hnext = NULL;
-		_freeBlocks = bentry;
-		bentry++;
+		bentry->dirtyTick = 0;
+		bentry->readahead = false;
+		bentry->invalid = false;
+		bentry->list = i < _blockCacheSize ? LIST_FREE : LIST_GHOSTFREE;
+		_lists[bentry->list].append(bentry);
 	}
 }
 
@@ -61,171 +82,465 @@ BlockCache::~BlockCache() {
 	delete[] _blockCache;
 }
 
+void BlockCache::BlockList::append(CBlock *b) {
+	b->prev = NULL;
+	b->next = newest;
+	if(newest)
+		newest->prev = b;
+	else
+		oldest = b;
+	newest = b;
+	count++;
+}
+
+void BlockCache::BlockList::remove(CBlock *b) {
+	if(b->prev)
+		b->prev->next = b->next;
+	else
+		newest = b->next;
+	if(b->next)
+		b->next->prev = b->prev;
+	else
+		oldest = b->prev;
+	b->prev = b->next = NULL;
+	count--;
+}
+
 void BlockCache::flush() {
-	CBlock *bentry = _newestBlock;
-	while(bentry != NULL) {
-		sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
-		if(bentry->dirty) {
-			acquire(bentry,READ);
-			writeBlocks(bentry->buffer,bentry->blockNo,1);
-			bentry->dirty = false;
-			doRelease(bentry,false);
+	writeback(0,true);
+}
+
+void BlockCache::startFlusher() {
+	_flusherRun = true;
+	if((_flusher = startthread(flusherThread,this)) < 0)
+		printe("Unable to start flusher thread");
+}
+
+void BlockCache::stopFlusher() {
+	if(_flusher >= 0) {
+		_flusherRun = false;
+		while(join(_flusher) == -EINTR)
+			;
+		_flusher = -1;
+	}
+}
+
+void BlockCache::markDirty(CBlock *b) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	if(!b->dirty) {
+		b->dirty = true;
+		b->dirtyTick = _ticks;
+		_dirtyCount++;
+	}
+}
+
+int BlockCache::flusherThread(void *arg) {
+	BlockCache *bc = static_cast<BlockCache*>(arg);
+	while(bc->_flusherRun) {
+		usleep(FLUSH_INTERVAL);
+
+		bc->_mutex.lock();
+		bc->_ticks++;
+		size_t dirty = bc->_dirtyCount;
+		bc->_mutex.unlock();
+
+		/* if more than 1/8 of the cache is dirty, write back until only 1/16 is left */
+		size_t needed = 0;
+		if(dirty > bc->_blockCacheSize / 8)
+			needed = dirty - bc->_blockCacheSize / 16;
+		bc->writeback(needed,false);
+	}
+	return 0;
+}
+
+static bool blockNoLess(CBlock *a,CBlock *b) {
+	return a->blockNo < b->blockNo;
+}
+
+void BlockCache::writeback(size_t needed,bool all) {
+	CBlock *blocks[WB_BATCH];
+	/* only one writeback at a time; this way, no block is collected twice */
+	std::lock_guard<std::mutex> guard(_wbMutex);
+	while(true) {
+		size_t n = 0, written = 0;
+
+		/* collect the oldest dirty blocks and keep them referenced, so that they aren't evicted.
+		 * start with the probation-list, because its blocks are evicted first */
+		_mutex.lock();
+		static const uchar lists[] = {LIST_PROBATION,LIST_PROTECTED};
+		for(size_t l = 0; l < ARRAY_SIZE(lists); ++l) {
+			CBlock *b = _lists[lists[l]].oldest;
+			for(; b != NULL && n < WB_BATCH; b = b->prev) {
+				if(b->dirty && (all || needed > 0 || _ticks - b->dirtyTick >= DIRTY_MAX_AGE)) {
+					b->refs++;
+					blocks[n++] = b;
+					if(needed > 0)
+						needed--;
+				}
+			}
+		}
+		_mutex.unlock();
+
+		if(n == 0)
+			break;
+
+		/* write them in disk order and consecutive ones at once */
+		std::sort(blocks,blocks + n,blockNoLess);
+		for(size_t i = 0; i < n; ) {
+			size_t count = 1;
+			while(i + count < n && count < MAX_BULK &&
+					blocks[i + count]->blockNo == blocks[i]->blockNo + count)
+				count++;
+			if(writeRun(blocks + i,count))
+				written += count;
+			i += count;
 		}
-		sassert(tpool_unlock(ALLOC_LOCK) == 0);
-		bentry = bentry->next;
+
+		/* with a persistent write error, we would collect the same blocks again and again */
+		if(written == 0) {
+			printe("Unable to write back %zu dirty blocks",n);
+			break;
+		}
+		if(n < WB_BATCH)
+			break;
 	}
 }
 
-void BlockCache::acquire(CBlock *b,A_UNUSED uint mode) {
-	assert(!(mode & WRITE) || b->refs == 0);
+bool BlockCache::writeRun(CBlock **blocks,size_t count) {
+	/* copy the blocks into the writeback area, so that they are only locked during the copy */
+	for(size_t i = 0; i < count; ++i) {
+		_locks.lock((ulong)blocks[i],LockTable::SHARED);
+		memcpy((char*)_wbmem + i * _blockSize,blocks[i]->buffer,_blockSize);
+		_mutex.lock();
+		blocks[i]->dirty = false;
+		_dirtyCount--;
+		_mutex.unlock();
+		_locks.unlock((ulong)blocks[i]);
+	}
+
+	bool failed = writeBlocks(_wbmem,blocks[0]->blockNo,count) != 0;
+
+	std::lock_guard<std::mutex> guard(_mutex);
+	_wbRequests++;
+	_wbBlocks += count;
+	for(size_t i = 0; i < count; ++i) {
+		/* if the write failed, try it again later */
+		if(failed && !blocks[i]->dirty) {
+			blocks[i]->dirty = true;
+			blocks[i]->dirtyTick = _ticks;
+			_dirtyCount++;
+		}
+		assert(blocks[i]->refs > 0);
+		blocks[i]->refs--;
+	}
+	return !failed;
+}
+
+void BlockCache::acquire(CBlock *b,uint mode) {
 	b->refs++;
-	sassert(tpool_unlock(ALLOC_LOCK) == 0);
-	sassert(tpool_lock((uint)b,(mode & WRITE) ? LOCK_EXCLUSIVE : 0) == 0);
+	_mutex.unlock();
+	_locks.lock((ulong)b,(mode & WRITE) ? LockTable::EXCLUSIVE : LockTable::SHARED);
 }
 
 void BlockCache::doRelease(CBlock *b,bool unlockAlloc) {
-	sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	/* unlock it first to ensure that nobody can reuse the block while we still hold it */
+	_locks.unlock((ulong)b);
+	_mutex.lock();
 	assert(b->refs > 0);
 	b->refs--;
 	if(unlockAlloc)
-		sassert(tpool_unlock(ALLOC_LOCK) == 0);
-	sassert(tpool_unlock((uint)b) == 0);
+		_mutex.unlock();
 }
 
 CBlock *BlockCache::doRequest(block_t blockNo,bool doRead,uint mode) {
 	CBlock *block,*bentry;
 
-	/* acquire tpool_lock for getting a block */
-	sassert(tpool_lock(ALLOC_LOCK,LOCK_EXCLUSIVE | LOCK_KEEP) == 0);
+	_mutex.lock();
 
+	if(_trace)
+		fprintf(_trace,"%c %u\n",!doRead ? 'c' : (mode & WRITE) ? 'w' : 'r',blockNo);
+
+retry:
 	/* search for the block. perhaps it's already in cache */
-	bentry = _hashmap[blockNo % HASH_SIZE];
-	while(bentry != NULL) {
-		if(bentry->blockNo == blockNo) {
-			/* remove from list and put at the beginning of the usedlist because it was
-			 * used most recently */
-			if(bentry->prev != NULL) {
-				/* update oldest */
-				if(_oldestBlock == bentry)
-					_oldestBlock = bentry->prev;
-				/* remove */
-				bentry->prev->next = bentry->next;
-				if(bentry->next)
-					bentry->next->prev = bentry->prev;
-				/* put at the beginning */
-				bentry->prev = NULL;
-				bentry->next = _newestBlock;
-				bentry->next->prev = bentry;
-				_newestBlock = bentry;
-			}
-			acquire(bentry,mode);
-			_hits++;
-			return bentry;
+	bentry = find(blockNo);
+	if(bentry != NULL) {
+		/* blocks in the probation-list stay where they are; only the ones that have been
+		 * promoted to the protected-list are managed as LRU */
+		if(bentry->list == LIST_PROTECTED)
+			moveTo(bentry,LIST_PROTECTED);
+		if(bentry->readahead) {
+			bentry->readahead = false;
+			_raHits++;
 		}
-		bentry = bentry->hnext;
+		_hits++;
+		acquire(bentry,mode);
+		/* if loading it failed while we waited for the lock, the content is garbage */
+		if(EXPECT_FALSE(bentry->invalid)) {
+			doRelease(bentry,false);
+			if(bentry->refs == 0)
+				invalidate(bentry);
+			goto retry;
+		}
+		return bentry;
 	}
 
 	/* init cached block */
 	block = getBlock(blockNo);
+	if(block == NULL) {
+		_mutex.unlock();
+		return NULL;
+	}
 	block->blockNo = blockNo;
 	block->dirty = false;
-	block->refs = 0;
+	block->refs = 1;
+	block->readahead = false;
+	block->invalid = false;
+
+	/* we need always a write-lock because we have to fill the block first. nobody else can hold
+	 * the lock of the new entry. thus, take it before others can find the block, so that they
+	 * wait until we're done. this only fails if all locks are in use */
+	if(!_locks.tryLock((ulong)block,LockTable::EXCLUSIVE)) {
+		block->refs = 0;
+		invalidate(block);
+		_mutex.unlock();
+		yield();
+		_mutex.lock();
+		goto retry;
+	}
+	_misses++;
+	_mutex.unlock();
 
 	/* now read from disk */
-	if(doRead) {
-		/* we need always a write-tpool_lock because we have to read the content into it */
-		acquire(block,WRITE);
-		if(readBlocks(block->buffer,blockNo,1) != 0) {
-			block->blockNo = 0;
-			doRelease(block,true);
-			return NULL;
-		}
+	if(doRead && readBlocks(block->buffer,blockNo,1) != 0) {
+		/* others might wait for it; they notice that and try it again */
+		block->invalid = true;
 		doRelease(block,false);
+		if(block->refs == 0)
+			invalidate(block);
+		_mutex.unlock();
+		return NULL;
 	}
-
-	acquire(block,mode);
-	_misses++;
+	if(!(mode & WRITE))
+		_locks.downgrade((ulong)block);
 	return block;
 }
 
-CBlock *BlockCache::getBlock(block_t blockNo) {
-	CBlock *block = _freeBlocks;
-	if(block != NULL) {
-		/* remove from freelist and put in usedlist */
-		_freeBlocks = block->next;
-		if(_freeBlocks)
-			_freeBlocks->prev = NULL;
-		/* block->prev is already NULL */
-		block->next = _newestBlock;
-		if(block->next)
-			block->next->prev = block;
-		_newestBlock = block;
-		/* update oldest */
-		if(_oldestBlock == NULL)
-			_oldestBlock = block;
-		/* insert into hashmap */
-		CBlock **list = &_hashmap[blockNo % HASH_SIZE];
-		block->hnext = *list;
-		*list = block;
-		return block;
+void BlockCache::prefetch(block_t start,size_t count,size_t demanded) {
+	CBlock *blocks[MAX_BULK];
+	bool loaded[MAX_BULK];
+	if(_trace) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		fprintf(_trace,"p %u %zu %zu\n",start,count,demanded);
 	}
+	while(count > 0) {
+		size_t n = 0;
 
-	/* take the oldest one */
-	block = _oldestBlock;
-	assert(block->refs == 0);
-	_oldestBlock = block->prev;
-	_oldestBlock->next = NULL;
-	/* remove from hashmap */
-	bool diffhash = block->blockNo % HASH_SIZE != blockNo % HASH_SIZE;
-	if(diffhash) {
-		CBlock **list = &_hashmap[block->blockNo % HASH_SIZE];
-		CBlock *b = *list, *p = NULL;
-		while(b != NULL) {
-			if(b == block) {
-				if(p)
-					p->hnext = b->hnext;
-				else
-					*list = b->hnext;
+		_mutex.lock();
+		/* skip the blocks that are already in cache */
+		while(count > 0 && find(start) != NULL) {
+			start++;
+			count--;
+			if(demanded > 0)
+				demanded--;
+		}
+
+		/* create entries for the following missing blocks and lock them until they are loaded */
+		while(n < count && n < MAX_BULK && find(start + n) == NULL) {
+			CBlock *block = getBlock(start + n);
+			if(block == NULL)
+				break;
+			block->blockNo = start + n;
+			block->dirty = false;
+			block->refs = 1;
+			block->readahead = n >= demanded;
+			block->invalid = false;
+			/* nobody else can hold it. thus, this only fails if all locks are in use */
+			if(!_locks.tryLock((ulong)block,LockTable::EXCLUSIVE)) {
+				block->refs = 0;
+				invalidate(block);
 				break;
 			}
-			p = b;
-			b = b->hnext;
+			if(block->readahead)
+				_raBlocks++;
+			blocks[n++] = block;
+		}
+		_mutex.unlock();
+
+		/* if we can't get entries, leave the rest to request() */
+		if(n == 0)
+			break;
+
+		bool success = readBulk(blocks,start,n);
+		for(size_t i = 0; i < n; ++i) {
+			/* if that failed, try it block by block to load as much as possible */
+			loaded[i] = success || readBlocks(blocks[i]->buffer,start + i,1) == 0;
+			blocks[i]->invalid = !loaded[i];
+			_locks.unlock((ulong)blocks[i]);
+		}
+
+		_mutex.lock();
+		for(size_t i = 0; i < n; ++i) {
+			blocks[i]->refs--;
+			if(!loaded[i] && blocks[i]->refs == 0)
+				invalidate(blocks[i]);
 		}
+		_mutex.unlock();
+
+		start += n;
+		count -= n;
+		demanded = demanded > n ? demanded - n : 0;
 	}
-	/* put at beginning of usedlist */
-	block->prev = NULL;
-	block->next = _newestBlock;
-	if(block->next)
-		block->next->prev = block;
-	_newestBlock = block;
-	/* insert into hashmap */
-	if(diffhash) {
-		CBlock **list = &_hashmap[blockNo % HASH_SIZE];
-		block->hnext = *list;
-		*list = block;
+}
+
+bool BlockCache::readBulk(CBlock **blocks,block_t start,size_t count) {
+	if(count == 1)
+		return readBlocks(blocks[0]->buffer,start,1) == 0;
+
+	/* read them into the bulk area and distribute them afterwards */
+	std::lock_guard<std::mutex> guard(_bulkMutex);
+	if(readBlocks(_bulkmem,start,count) != 0)
+		return false;
+	for(size_t i = 0; i < count; ++i)
+		memcpy(blocks[i]->buffer,(char*)_bulkmem + i * _blockSize,_blockSize);
+	return true;
+}
+
+CBlock *BlockCache::find(block_t blockNo) {
+	CBlock *bentry = lookup(blockNo);
+	/* ignore ghost entries */
+	return bentry && bentry->buffer ? bentry : NULL;
+}
+
+CBlock *BlockCache::lookup(block_t blockNo) {
+	size_t mask = _hashSize - 1;
+	for(size_t i = hash(blockNo); _hashmap[i] != NULL; i = (i + 1) & mask) {
+		if(_hashmap[i]->blockNo == blockNo)
+			return _hashmap[i];
 	}
-	/* if it is dirty we have to write it first to disk */
-	if(block->dirty) {
-		acquire(block,READ);
-		writeBlocks(block->buffer,block->blockNo,1);
-		doRelease(block,false);
+	return NULL;
+}
+
+void BlockCache::insertIntoHash(CBlock *block) {
+	size_t mask = _hashSize - 1;
+	size_t i = hash(block->blockNo);
+	while(_hashmap[i] != NULL)
+		i = (i + 1) & mask;
+	_hashmap[i] = block;
+}
+
+void BlockCache::removeFromHash(CBlock *block) {
+	size_t mask = _hashSize - 1;
+	size_t i = hash(block->blockNo);
+	while(_hashmap[i] != block) {
+		assert(_hashmap[i] != NULL);
+		i = (i + 1) & mask;
+	}
+	_hashmap[i] = NULL;
+
+	/* move the following entries of the cluster backwards, if their probe sequence would be
+	 * interrupted by the free slot otherwise */
+	for(size_t j = (i + 1) & mask; _hashmap[j] != NULL; j = (j + 1) & mask) {
+		size_t k = hash(_hashmap[j]->blockNo);
+		/* the entry can stay at j if its home k lies cyclically in (i,j] */
+		bool stay = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+		if(!stay) {
+			_hashmap[i] = _hashmap[j];
+			_hashmap[j] = NULL;
+			i = j;
+		}
 	}
+}
+
+void BlockCache::invalidate(CBlock *block) {
+	assert(block->refs == 0);
+	removeFromHash(block);
+	if(block->dirty)
+		_dirtyCount--;
+	block->blockNo = 0;
+	block->dirty = false;
+	block->readahead = false;
+	block->invalid = false;
+	moveTo(block,LIST_FREE);
+}
+
+void BlockCache::addGhost(size_t blockNo) {
+	CBlock *ghost = _lists[LIST_GHOSTFREE].oldest;
+	/* if there is no free one, forget the oldest ghost */
+	if(ghost == NULL) {
+		ghost = _lists[LIST_GHOST].oldest;
+		removeFromHash(ghost);
+	}
+	ghost->blockNo = blockNo;
+	moveTo(ghost,LIST_GHOST);
+	insertIntoHash(ghost);
+}
+
+CBlock *BlockCache::victim(uchar list) {
+	/* take the oldest one that is not in use. prefer clean blocks, because dirty ones have to
+	 * be written first */
+	CBlock *block,*dirty = NULL;
+	for(block = _lists[list].oldest; block != NULL; block = block->prev) {
+		if(block->refs == 0) {
+			if(!block->dirty)
+				return block;
+			if(dirty == NULL)
+				dirty = block;
+		}
+	}
+	return dirty;
+}
+
+CBlock *BlockCache::getBlock(block_t blockNo) {
+	/* if we have evicted the block recently, it has been used before; thus, protect it */
+	uchar list = LIST_PROBATION;
+	CBlock *ghost = lookup(blockNo);
+	if(ghost != NULL) {
+		assert(ghost->buffer == NULL);
+		removeFromHash(ghost);
+		moveTo(ghost,LIST_GHOSTFREE);
+		list = LIST_PROTECTED;
+		_ghostHits++;
+	}
+
+	CBlock *block = _lists[LIST_FREE].oldest;
+	if(block == NULL) {
+		/* evict from the probation-list, if it exceeds its share, and from the protected-list
+		 * otherwise. if that's not possible, try the other one */
+		bool probation = _lists[LIST_PROBATION].count > _probationSize;
+		block = victim(probation ? LIST_PROBATION : LIST_PROTECTED);
+		if(block == NULL)
+			block = victim(probation ? LIST_PROTECTED : LIST_PROBATION);
+		if(block == NULL)
+			return NULL;
+
+		if(block->list == LIST_PROBATION)
+			addGhost(block->blockNo);
+		removeFromHash(block);
+
+		/* if it is dirty we have to write it first to disk. we keep _mutex meanwhile, because
+		 * otherwise somebody could request the old block and read the outdated content */
+		if(block->dirty) {
+			writeBlocks(block->buffer,block->blockNo,1);
+			block->dirty = false;
+			_dirtyCount--;
+			_syncEvictions++;
+		}
+	}
+
+	moveTo(block,list);
+	block->blockNo = blockNo;
+	insertIntoHash(block);
 	return block;
 }
 
 void BlockCache::printStats(FILE *f) {
+	std::lock_guard<std::mutex> guard(_mutex);
 	float hitrate;
-	size_t used = 0,dirty = 0;
-	CBlock *bentry = _newestBlock;
-	while(bentry != NULL) {
-		used++;
-		if(bentry->dirty)
-			dirty++;
-		bentry = bentry->next;
-	}
 	fprintf(f,"\tTotal blocks: %zu\n",_blockCacheSize);
-	fprintf(f,"\tUsed blocks: %zu\n",used);
-	fprintf(f,"\tDirty blocks: %zu\n",dirty);
+	fprintf(f,"\tProbation blocks: %zu\n",_lists[LIST_PROBATION].count);
+	fprintf(f,"\tProtected blocks: %zu\n",_lists[LIST_PROTECTED].count);
+	fprintf(f,"\tDirty blocks: %zu\n",_dirtyCount);
+	fprintf(f,"\tHashmap size: %zu\n",_hashSize);
 	fprintf(f,"\tHits: %lu\n",_hits);
 	fprintf(f,"\tMisses: %lu\n",_misses);
 	if(_hits == 0)
@@ -233,22 +548,34 @@ void BlockCache::printStats(FILE *f) {
 	else
 		hitrate = 100.0f / ((float)(_misses + _hits) / _hits);
 	fprintf(f,"\tHitrate: %.3f%%\n",hitrate);
+	fprintf(f,"\tReadahead blocks: %lu\n",_raBlocks);
+	fprintf(f,"\tReadahead hits: %lu\n",_raHits);
+	if(_raHits == 0)
+		hitrate = 0;
+	else
+		hitrate = 100.0f * _raHits / _raBlocks;
+	fprintf(f,"\tReadahead hitrate: %.3f%%\n",hitrate);
+	fprintf(f,"\tGhost hits: %lu\n",_ghostHits);
+	fprintf(f,"\tWriteback requests: %lu\n",_wbRequests);
+	fprintf(f,"\tWriteback blocks: %lu\n",_wbBlocks);
+	fprintf(f,"\tSync evictions: %lu\n",_syncEvictions);
 }
 
 #if DEBUGGING
 
 void BlockCache::print() {
-	size_t i = 0;
-	CBlock *block;
-	printf("Used blocks:\n\t");
-	block = _newestBlock;
-	while(block != NULL) {
-		if(++i % 8 == 0)
-			printf("\n\t");
-		printf("%zu ",block->blockNo);
-		block = block->next;
+	std::lock_guard<std::mutex> guard(_mutex);
+	static const char *names[] = {"Probation","Protected","Ghost"};
+	for(uchar l = LIST_PROBATION; l <= LIST_GHOST; ++l) {
+		size_t i = 0;
+		printf("%s blocks:\n\t",names[l - LIST_PROBATION]);
+		for(CBlock *block = _lists[l].newest; block != NULL; block = block->next) {
+			if(++i % 8 == 0)
+				printf("\n\t");
+			printf("%zu ",block->blockNo);
+		}
+		printf("\n");
 	}
-	printf("\n");
 }
 
 #endif
@@ -0,0 +1,138 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/vthrow.h>
+#include <fs/locktable.h>
+#include <sys/common.h>
+#include <sys/debug.h>
+#include <sys/io.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
+#include <assert.h>
+
+namespace fs {
+
+LockTable::LockTable(size_t size) : _mutex(), _size(size), _entries(new Entry[size]) {
+	for(size_t i = 0; i < _size; ++i) {
+		_entries[i].key = 0;
+		_entries[i].refs = 0;
+		_entries[i].waits = 0;
+		_entries[i].state = 0;
+		_entries[i].sem = semcrt(0);
+		if(_entries[i].sem < 0) {
+			int err = _entries[i].sem;
+			while(i-- > 0)
+				semdestr(_entries[i].sem);
+			delete[] _entries;
+			VTHROWE("Unable to create semaphore",err);
+		}
+	}
+}
+
+LockTable::~LockTable() {
+	for(size_t i = 0; i < _size; ++i)
+		semdestr(_entries[i].sem);
+	delete[] _entries;
+}
+
+void LockTable::lock(ulong key,uint mode) {
+	Entry *e;
+	_mutex.lock();
+	while((e = get(key)) == NULL) {
+		/* all entries are in use; wait until somebody releases one */
+		_mutex.unlock();
+		yield();
+		_mutex.lock();
+	}
+
+	e->refs++;
+	while(mode == EXCLUSIVE ? e->state != 0 : e->state < 0) {
+		/* we register ourself before releasing the mutex. this way, the one that unlocks it
+		 * will do an up for us, even if we haven't reached the semdown yet. */
+		e->waits++;
+		_mutex.unlock();
+		IGNSIGS(semdown(e->sem));
+		_mutex.lock();
+	}
+	e->state = mode == EXCLUSIVE ? -1 : e->state + 1;
+	_mutex.unlock();
+}
+
+bool LockTable::tryLock(ulong key,uint mode) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	Entry *e = get(key);
+	if(e == NULL || (mode == EXCLUSIVE ? e->state != 0 : e->state < 0))
+		return false;
+
+	e->refs++;
+	e->state = mode == EXCLUSIVE ? -1 : e->state + 1;
+	return true;
+}
+
+void LockTable::unlock(ulong key) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	Entry *e = find(key);
+	assert(e != NULL && e->state != 0);
+	if(e->state < 0 || --e->state == 0) {
+		e->state = 0;
+		wakeup(e);
+	}
+	/* if nobody holds or waits for it anymore, the entry is free again */
+	e->refs--;
+}
+
+void LockTable::downgrade(ulong key) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	Entry *e = find(key);
+	assert(e != NULL && e->state == -1);
+	e->state = 1;
+	wakeup(e);
+}
+
+LockTable::Entry *LockTable::find(ulong key) {
+	for(size_t i = 0; i < _size; ++i) {
+		if(_entries[i].refs > 0 && _entries[i].key == key)
+			return _entries + i;
+	}
+	return NULL;
+}
+
+LockTable::Entry *LockTable::get(ulong key) {
+	Entry *e = find(key);
+	if(e)
+		return e;
+
+	for(size_t i = 0; i < _size; ++i) {
+		if(_entries[i].refs == 0) {
+			_entries[i].key = key;
+			_entries[i].state = 0;
+			_entries[i].waits = 0;
+			return _entries + i;
+		}
+	}
+	return NULL;
+}
+
+void LockTable::wakeup(Entry *e) {
+	/* everybody rechecks the state; the ones that can't get it will register again */
+	for(; e->waits > 0; e->waits--)
+		semup(e->sem);
+}
+
+}
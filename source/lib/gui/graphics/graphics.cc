@@ -18,6 +18,7 @@
  */
 
 #include <gui/graphics/graphics.h>
+#include <gui/graphics/span.h>
 #include <gui/window.h>
 #include <sys/common.h>
 #include <algorithm>
@@ -53,20 +54,20 @@ namespace gui {
 		pixels += startx * psize;
 		if(up > 0) {
 			for(gsize_t i = 0; i < rsize.height; i++) {
-				memcpy(pixels + (starty + i - up) * bwsize,
+				Span::copyBytes(pixels + (starty + i - up) * bwsize,
 					pixels + (starty + i) * bwsize,
 					wsize);
 			}
 		}
 		else {
 			for(gsize_t i = 0; i < rsize.height; i++) {
-				memcpy(pixels + (starty + rsize.height - 1 - i - up) * bwsize,
+				Span::copyBytes(pixels + (starty + rsize.height - 1 - i - up) * bwsize,
 					pixels + (starty + rsize.height - 1 - i) * bwsize,
 					wsize);
 			}
 		}
-		updateMinMax(Pos(rpos.x,rpos.y - up));
-		updateMinMax(Pos(rsize.width - 1,rpos.y + rsize.height - up - 1));
+		updateMinMax(Pos(rpos.x,rpos.y - up),
+			Pos(rpos.x + rsize.width - 1,rpos.y + rsize.height - up - 1));
 	}
 
 	void Graphics::moveCols(const Pos &pos,const Size &size,int left) {
@@ -97,8 +98,8 @@ namespace gui {
 				pixels + (starty + i) * bwsize,
 				wsize);
 		}
-		updateMinMax(Pos(rpos.x - left,rpos.y));
-		updateMinMax(Pos(rpos.x + rsize.width - left - 1,rsize.height - 1));
+		updateMinMax(Pos(rpos.x - left,rpos.y),
+			Pos(rpos.x + rsize.width - left - 1,rpos.y + rsize.height - 1));
 	}
 
 	void Graphics::drawChar(const Pos &pos,char c) {
@@ -107,17 +108,17 @@ namespace gui {
 		if(!getPixels() || !validateParams(rpos,fsize))
 			return;
 
-		updateMinMax(rpos);
-		updateMinMax(Pos(rpos.x + fsize.width - 1,rpos.y + fsize.height - 1));
-		gpos_t cx,cy;
+		updateMinMax(rpos,Pos(rpos.x + fsize.width - 1,rpos.y + fsize.height - 1));
 		gpos_t xoff = rpos.x - pos.x,yoff = rpos.y - pos.y;
-		gpos_t xend = xoff + fsize.width;
 		gpos_t yend = yoff + fsize.height;
-		for(cy = yoff; cy < yend; cy++) {
-			for(cx = xoff; cx < xend; cx++) {
-				if(_font.isPixelSet(c,cx,cy))
-					doSetPixel(pos.x + cx,pos.y + cy);
-			}
+
+		// draw the visible part of each row at once
+		gcoldepth_t bpp = Application::getInstance()->getColorDepth();
+		gsize_t widthadd = _buf->getSize().width * (bpp / 8);
+		uint8_t *addr = getPixelAddr(rpos.x,rpos.y,bpp / 8);
+		for(gpos_t cy = yoff; cy < yend; cy++) {
+			Span::mask(addr,_font.getRow(c,cy) << xoff,fsize.width,_col,bpp);
+			addr += widthadd;
 		}
 	}
 
@@ -199,15 +200,14 @@ namespace gui {
 			}
 		}
 		setLinePixel(minx,miny,maxx,maxy,Pos(*px,*py));
-		updateMinMax(Pos(max(minx,min(maxx,x0)),max(miny,min(maxy,y0))));
-		updateMinMax(Pos(max(minx,min(maxx,xn)),max(miny,min(maxy,yn))));
+		updateMinMax(Pos(max(minx,min(maxx,x0)),max(miny,min(maxy,y0))),
+			Pos(max(minx,min(maxx,xn)),max(miny,min(maxy,yn))));
 	}
 
 	void Graphics::drawVertLine(gpos_t x,gpos_t y1,gpos_t y2) {
 		if(!getPixels() || !validateLine(x,y1,x,y2))
 			return;
-		updateMinMax(Pos(x,y1));
-		updateMinMax(Pos(x,y2));
+		updateMinMax(Pos(x,y1),Pos(x,y2));
 		if(y1 > y2)
 			swap(y1,y2);
 		for(; y1 <= y2; y1++)
@@ -217,12 +217,11 @@ namespace gui {
 	void Graphics::drawHorLine(gpos_t y,gpos_t x1,gpos_t x2) {
 		if(!getPixels() || !validateLine(x1,y,x2,y))
 			return;
-		updateMinMax(Pos(x1,y));
-		updateMinMax(Pos(x2,y));
+		updateMinMax(Pos(x1,y),Pos(x2,y));
 		if(x1 > x2)
 			swap(x1,x2);
-		for(; x1 <= x2; x1++)
-			doSetPixel(x1,y);
+		gcoldepth_t bpp = Application::getInstance()->getColorDepth();
+		Span::fill(getPixelAddr(x1,y,bpp / 8),_col,x2 - x1 + 1,bpp);
 	}
 
 	void Graphics::drawRect(const Pos &pos,const Size &size) {
@@ -246,57 +245,15 @@ namespace gui {
 			return;
 
 		gpos_t yend = rpos.y + rsize.height;
-		updateMinMax(rpos);
-		updateMinMax(Pos(rpos.x + rsize.width - 1,yend - 1));
-		gpos_t xcur;
-		gpos_t xend = rpos.x + rsize.width;
+		updateMinMax(rpos,Pos(rpos.x + rsize.width - 1,yend - 1));
 
+		// fill it row by row with the kernel for the current color depth
 		gcoldepth_t bpp = Application::getInstance()->getColorDepth();
-		gsize_t bwidth = _buf->getSize().width;
-		uint8_t *orgaddr = getPixels() + (((_off.y + rpos.y) * bwidth + (_off.x + rpos.x)) * (bpp / 8));
-		gsize_t widthadd = bwidth * (bpp / 8);
-		// optimized versions for the individual color depths
-		// This is necessary if we want to have reasonable speed because the simple version
-		// performs too many function-calls (one to a virtual-function and one to memcpy
-		// that the compiler doesn't inline). Additionally the offset into the
-		// memory-region will be calculated many times.
-		// This version is much quicker :)
-		switch(bpp) {
-			case 16: {
-				for(; rpos.y < yend; rpos.y++) {
-					// always 16-bit aligned
-					uint16_t *addr = (uint16_t*)(void*)orgaddr;
-					for(xcur = rpos.x; xcur < xend; xcur++)
-						*addr++ = _col;
-					orgaddr += widthadd;
-				}
-			}
-			break;
-
-			case 24: {
-				uint8_t *col = (uint8_t*)&_col;
-				for(; rpos.y < yend; rpos.y++) {
-					uint8_t *addr = orgaddr;
-					for(xcur = rpos.x; xcur < xend; xcur++) {
-						*addr++ = *col;
-						*addr++ = *(col + 1);
-						*addr++ = *(col + 2);
-					}
-					orgaddr += widthadd;
-				}
-			}
-			break;
-
-			case 32: {
-				for(; rpos.y < yend; rpos.y++) {
-					// always 32-bit aligned
-					uint32_t *addr = (uint32_t*)(void*)orgaddr;
-					for(xcur = rpos.x; xcur < xend; xcur++)
-						*addr++ = _col;
-					orgaddr += widthadd;
-				}
-			}
-			break;
+		gsize_t widthadd = _buf->getSize().width * (bpp / 8);
+		uint8_t *addr = getPixelAddr(rpos.x,rpos.y,bpp / 8);
+		for(; rpos.y < yend; rpos.y++) {
+			Span::fill(addr,_col,rsize.width,bpp);
+			addr += widthadd;
 		}
 	}
 
@@ -360,8 +317,7 @@ namespace gui {
 		bool res2 = validatePoint(maxx,maxy) != 0;
 		if(res1 && res2)
 			return;
-		updateMinMax(Pos(minx,miny));
-		updateMinMax(Pos(maxx,maxy));
+		updateMinMax(Pos(minx,miny),Pos(maxx,maxy));
 
 		// deltas
 		const gpos_t dx12 = x1 - x2;
@@ -448,8 +404,7 @@ namespace gui {
 		bool res2 = validatePoint(xend,yend) != 0;
 		if(res1 && res2)
 			return;
-		updateMinMax(Pos(xstart,ystart));
-		updateMinMax(Pos(xend,yend));
+		updateMinMax(Pos(xstart,ystart),Pos(xend,yend));
 
 		ystart -= p.y;
 		yend -= p.y;
@@ -466,13 +421,14 @@ namespace gui {
 	}
 
 	void Graphics::requestUpdate() {
-		Rectangle dirty = _buf->getDirtyRect();
-		if(dirty.empty())
-			return;
-		if(!validateParams(dirty.getPos(),dirty.getSize()))
-			return;
+		// send an update for each dirty rectangle instead of their bounding box
+		for(size_t i = 0; i < _buf->getDirtyCount(); ++i) {
+			Rectangle dirty = _buf->getDirtyRect(i);
+			if(dirty.empty() || !validateParams(dirty.getPos(),dirty.getSize()))
+				continue;
 
-		_buf->requestUpdate(dirty.getPos(),dirty.getSize());
+			_buf->requestUpdate(dirty.getPos(),dirty.getSize());
+		}
 		_buf->resetDirty();
 	}
 
@@ -60,6 +60,11 @@ namespace gui {
 		_pos.y = min((gpos_t)screenSize.height - 1,pos.y);
 	}
 
+	void GraphicsBuffer::updateDirty(const Rectangle &r) {
+		if(!r.empty())
+			merge(_dirty,_dirtyCount,MAX_DIRTY,r);
+	}
+
 	void GraphicsBuffer::requestUpdate(const Pos &pos,const Size &size) {
 		if(_win->isCreated())
 			Application::getInstance()->requestWinUpdate(_win->getId(),pos,size);
@@ -208,6 +208,43 @@ namespace gui {
 		return res;
 	}
 
+	size_t merge(Rectangle *rects,size_t &count,size_t max,const Rectangle &r) {
+		Rectangle rect = r;
+		size_t merges = 0;
+
+		// as the union might be mergeable with the ones we've already checked, start again
+		for(size_t i = 0; i < count; ) {
+			Rectangle uni = unify(rects[i],rect);
+			size_t covered = rects[i].area() + rect.area() - intersection(rects[i],rect).area();
+			if(uni.area() - covered <= covered / 4) {
+				rect = uni;
+				rects[i] = rects[--count];
+				merges++;
+				i = 0;
+			}
+			else
+				i++;
+		}
+
+		if(count < max) {
+			rects[count++] = rect;
+			return merges;
+		}
+
+		// no free slot; merge it with the one that grows the least
+		size_t best = 0;
+		size_t bestGrow = (size_t)-1;
+		for(size_t i = 0; i < count; ++i) {
+			size_t grow = unify(rects[i],rect).area() - rects[i].area();
+			if(grow < bestGrow) {
+				bestGrow = grow;
+				best = i;
+			}
+		}
+		rects[best] = unify(rects[best],rect);
+		return merges + 1;
+	}
+
 	Rectangle intersection(const Rectangle &r1,const Rectangle &r2) {
 		bool p1in,p2in,p3in,p4in;
 		bool op1in,op2in,op3in,op4in;
@@ -0,0 +1,171 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gui/graphics/span.h>
+#include <sys/common.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+namespace gui {
+	void Span::fill32(uint32_t *dst,uint32_t col,size_t count) {
+#if defined(__SSE2__)
+		// write single pixels until we're 16-byte aligned
+		while(count > 0 && ((uintptr_t)dst & 15)) {
+			*dst++ = col;
+			count--;
+		}
+
+		__m128i v = _mm_set1_epi32(col);
+		for(; count >= 16; count -= 16, dst += 16) {
+			_mm_store_si128(reinterpret_cast<__m128i*>(dst + 0),v);
+			_mm_store_si128(reinterpret_cast<__m128i*>(dst + 4),v);
+			_mm_store_si128(reinterpret_cast<__m128i*>(dst + 8),v);
+			_mm_store_si128(reinterpret_cast<__m128i*>(dst + 12),v);
+		}
+		for(; count >= 4; count -= 4, dst += 4)
+			_mm_store_si128(reinterpret_cast<__m128i*>(dst),v);
+#endif
+		while(count-- > 0)
+			*dst++ = col;
+	}
+
+	void Span::fill16(uint16_t *dst,uint16_t col,size_t count) {
+		// pixels are always 16-bit aligned; make them 32-bit aligned and fill two at once
+		if(count > 0 && ((uintptr_t)dst & 2)) {
+			*dst++ = col;
+			count--;
+		}
+		fill32(reinterpret_cast<uint32_t*>(dst),col | ((uint32_t)col << 16),count / 2);
+		if(count & 1)
+			dst[count - 1] = col;
+	}
+
+	void Span::fill24(uint8_t *dst,Color::color_type col,size_t count) {
+		// the pixel is stored in the first three bytes of <col> (in memory order)
+		const uint8_t *c = reinterpret_cast<const uint8_t*>(&col);
+
+		// write single pixels until we're 32-bit aligned
+		while(count > 0 && ((uintptr_t)dst & 3)) {
+			*dst++ = c[0];
+			*dst++ = c[1];
+			*dst++ = c[2];
+			count--;
+		}
+
+		// 4 pixels are 3 words. build them in memory order to be independent of the endianess
+		uint8_t pattern[12];
+		for(size_t i = 0; i < sizeof(pattern); ++i)
+			pattern[i] = c[i % 3];
+		uint32_t words[3];
+		memcpy(words,pattern,sizeof(words));
+
+		uint32_t *wdst = reinterpret_cast<uint32_t*>(dst);
+#if defined(__SSE2__)
+		// 16 pixels are 3 vectors: w0 w1 w2 w0 | w1 w2 w0 w1 | w2 w0 w1 w2
+		__m128i v0 = _mm_set_epi32(words[0],words[2],words[1],words[0]);
+		__m128i v1 = _mm_set_epi32(words[1],words[0],words[2],words[1]);
+		__m128i v2 = _mm_set_epi32(words[2],words[1],words[0],words[2]);
+		for(; count >= 16; count -= 16, wdst += 12) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(wdst + 0),v0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(wdst + 4),v1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(wdst + 8),v2);
+		}
+#endif
+		for(; count >= 4; count -= 4) {
+			*wdst++ = words[0];
+			*wdst++ = words[1];
+			*wdst++ = words[2];
+		}
+
+		dst = reinterpret_cast<uint8_t*>(wdst);
+		while(count-- > 0) {
+			*dst++ = c[0];
+			*dst++ = c[1];
+			*dst++ = c[2];
+		}
+	}
+
+	void Span::copyBytes(uint8_t *dst,const uint8_t *src,size_t count) {
+#if defined(__SSE2__)
+		if(count >= 64) {
+			// align the destination; the source might stay unaligned
+			size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+			memcpy(dst,src,head);
+			dst += head;
+			src += head;
+			count -= head;
+
+			for(; count >= 64; count -= 64, dst += 64, src += 64) {
+				const __m128i *s = reinterpret_cast<const __m128i*>(src);
+				__m128i a = _mm_loadu_si128(s + 0);
+				__m128i b = _mm_loadu_si128(s + 1);
+				__m128i c = _mm_loadu_si128(s + 2);
+				__m128i d = _mm_loadu_si128(s + 3);
+				__m128i *d128 = reinterpret_cast<__m128i*>(dst);
+				_mm_store_si128(d128 + 0,a);
+				_mm_store_si128(d128 + 1,b);
+				_mm_store_si128(d128 + 2,c);
+				_mm_store_si128(d128 + 3,d);
+			}
+		}
+#endif
+		memcpy(dst,src,count);
+	}
+
+	void Span::mask(uint8_t *dst,uint8_t bits,size_t count,Color::color_type col,gcoldepth_t bpp) {
+		// ignore the bits behind <count>
+		if(count < 8)
+			bits &= ~(0xFF >> count);
+
+		switch(bpp) {
+			case 16: {
+				uint16_t *addr = reinterpret_cast<uint16_t*>(dst);
+				for(; bits; bits <<= 1, addr++) {
+					if(bits & 0x80)
+						*addr = col;
+				}
+			}
+			break;
+
+			case 24: {
+				const uint8_t *c = reinterpret_cast<const uint8_t*>(&col);
+				for(; bits; bits <<= 1, dst += 3) {
+					if(bits & 0x80) {
+						dst[0] = c[0];
+						dst[1] = c[1];
+						dst[2] = c[2];
+					}
+				}
+			}
+			break;
+
+			case 32: {
+				uint32_t *addr = reinterpret_cast<uint32_t*>(dst);
+				for(; bits; bits <<= 1, addr++) {
+					if(bits & 0x80)
+						*addr = col;
+				}
+			}
+			break;
+		}
+	}
+}
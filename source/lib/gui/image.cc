@@ -39,8 +39,8 @@ void Image::paint(Graphics &g,const Pos &pos) {
 
 	_img->paint(rpos.x,rpos.y,rsize.width,rsize.height);
 
-	g.updateMinMax(Pos(pos.x + rpos.x,pos.y + rpos.y));
-	g.updateMinMax(Pos(pos.x + rpos.x + rsize.width - 1,pos.y + rpos.y + rsize.height - 1));
+	g.updateMinMax(Pos(pos.x + rpos.x,pos.y + rpos.y),
+		Pos(pos.x + rpos.x + rsize.width - 1,pos.y + rpos.y + rsize.height - 1));
 }
 
 }
@@ -17,33 +17,204 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+
 #include <z/crc32.h>
+#include <assert.h>
+
+#if defined(__x86_64__)
+#	include <emmintrin.h>
+
+/* our compiler does not allow the intrinsic without enabling pclmul globally */
+#	define CLMUL(a,b,imm)	({									\
+		__m128i __res = (a);										\
+		asm("pclmulqdq %2, %1, %0" : "+x"(__res) : "x"(b), "i"(imm));	\
+		__res;														\
+	})
+#endif
 
 namespace z {
 
 /* source: http://tools.ietf.org/html/rfc1952 */
 
+static const CRC32::type POLY		= 0xedb88320;
+/* below that, the setup of the PCLMULQDQ folding is not worth it */
+static const size_t PCLMUL_MIN_LEN	= 64;
+
+bool CRC32::_init = false;
+bool CRC32::_pclmul = false;
+CRC32::type CRC32::_table[8][256];
+CRC32::type CRC32::_x2n[32];
+
 CRC32::CRC32() {
+	if(!_init)
+		init();
+}
+
+void CRC32::init() {
 	/* Make the table for a fast CRC. */
 	for(size_t n = 0; n < 256; n++) {
-		ulong c = n;
+		type c = n;
 		for(int k = 0; k < 8; k++) {
 			if(c & 1)
-				c = 0xedb88320L ^ (c >> 1);
+				c = POLY ^ (c >> 1);
 			else
 				c = c >> 1;
 		}
-		_table[n] = c;
+		_table[0][n] = c;
+	}
+
+	/* _table[k][n] is the CRC of n followed by k zero bytes */
+	for(size_t n = 0; n < 256; n++) {
+		type c = _table[0][n];
+		for(size_t k = 1; k < 8; k++) {
+			c = _table[0][c & 0xff] ^ (c >> 8);
+			_table[k][n] = c;
+		}
 	}
+
+	/* _x2n[n] is x^(2^n) modulo the polynomial */
+	type p = 1U << 30;
+	_x2n[0] = p;
+	for(size_t n = 1; n < 32; n++)
+		_x2n[n] = p = multmodp(p,p);
+
+#if defined(__x86_64__)
+	uint32_t eax,ebx,ecx,edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	_pclmul = (ecx & (1 << 1)) != 0;
+#endif
+
+	/* multiple threads might do that concurrently, but they all write the same values */
+	_init = true;
 }
 
 CRC32::type CRC32::update(type crc,const void *buf,size_t len) {
 	type c = crc ^ 0xffffffffL;
-	const char *b = reinterpret_cast<const char*>(buf);
+	const uint8_t *b = reinterpret_cast<const uint8_t*>(buf);
+
+#if defined(__x86_64__)
+	if(_pclmul && len >= PCLMUL_MIN_LEN) {
+		size_t amount = len & ~static_cast<size_t>(15);
+		c = update_pclmul(c,b,amount);
+		b += amount;
+		len -= amount;
+	}
+#endif
 
-	for(size_t n = 0; n < len; n++)
-		c = _table[(c ^ b[n]) & 0xff] ^ (c >> 8);
+	c = update_slice8(c,b,len);
 	return c ^ 0xffffffffL;
 }
 
+CRC32::type CRC32::update_slice8(type c,const uint8_t *b,size_t len) {
+	/* assemble the words bytewise to be independent of the endianess */
+	for(; len >= 8; len -= 8, b += 8) {
+		type one = c ^ (b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<type>(b[3]) << 24));
+		type two = b[4] | (b[5] << 8) | (b[6] << 16) | (static_cast<type>(b[7]) << 24);
+		c = _table[7][one & 0xff] ^ _table[6][(one >> 8) & 0xff] ^
+			_table[5][(one >> 16) & 0xff] ^ _table[4][one >> 24] ^
+			_table[3][two & 0xff] ^ _table[2][(two >> 8) & 0xff] ^
+			_table[1][(two >> 16) & 0xff] ^ _table[0][two >> 24];
+	}
+
+	while(len-- > 0)
+		c = _table[0][(c ^ *b++) & 0xff] ^ (c >> 8);
+	return c;
+}
+
+#if defined(__x86_64__)
+/* see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" by Intel. the
+ * constants are x^(k) mod P for the bit-reflected polynomial */
+CRC32::type CRC32::update_pclmul(type c,const uint8_t *b,size_t len) {
+	const __m128i k1k2 = _mm_set_epi64x(0x00000001c6e41596,0x0000000154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00000000ccaa009e,0x00000001751997d0);
+	const __m128i k5 = _mm_set_epi64x(0,0x0000000163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x00000001f7011641,0x00000001db710641);
+	const __m128i mask32 = _mm_set_epi32(0,0,0,~0);
+	const __m128i *p = reinterpret_cast<const __m128i*>(b);
+
+	assert(len >= PCLMUL_MIN_LEN && (len & 15) == 0);
+
+	__m128i x1 = _mm_xor_si128(_mm_loadu_si128(p + 0),_mm_cvtsi32_si128(c));
+	__m128i x2 = _mm_loadu_si128(p + 1);
+	__m128i x3 = _mm_loadu_si128(p + 2);
+	__m128i x4 = _mm_loadu_si128(p + 3);
+	p += 4;
+	len -= 64;
+
+	/* fold 4 times 128 bits in parallel */
+	for(; len >= 64; len -= 64, p += 4) {
+		x1 = _mm_xor_si128(_mm_xor_si128(CLMUL(x1,k1k2,0x00),CLMUL(x1,k1k2,0x11)),
+			_mm_loadu_si128(p + 0));
+		x2 = _mm_xor_si128(_mm_xor_si128(CLMUL(x2,k1k2,0x00),CLMUL(x2,k1k2,0x11)),
+			_mm_loadu_si128(p + 1));
+		x3 = _mm_xor_si128(_mm_xor_si128(CLMUL(x3,k1k2,0x00),CLMUL(x3,k1k2,0x11)),
+			_mm_loadu_si128(p + 2));
+		x4 = _mm_xor_si128(_mm_xor_si128(CLMUL(x4,k1k2,0x00),CLMUL(x4,k1k2,0x11)),
+			_mm_loadu_si128(p + 3));
+	}
+
+	/* fold them into one */
+	x1 = _mm_xor_si128(_mm_xor_si128(CLMUL(x1,k3k4,0x00),CLMUL(x1,k3k4,0x11)),x2);
+	x1 = _mm_xor_si128(_mm_xor_si128(CLMUL(x1,k3k4,0x00),CLMUL(x1,k3k4,0x11)),x3);
+	x1 = _mm_xor_si128(_mm_xor_si128(CLMUL(x1,k3k4,0x00),CLMUL(x1,k3k4,0x11)),x4);
+
+	/* fold the remaining 128 bit blocks */
+	for(; len >= 16; len -= 16, p++)
+		x1 = _mm_xor_si128(_mm_xor_si128(CLMUL(x1,k3k4,0x00),CLMUL(x1,k3k4,0x11)),_mm_loadu_si128(p));
+
+	/* fold 128 to 64 bits */
+	x2 = CLMUL(k3k4,x1,0x01);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1,8),x2);
+
+	/* fold 64 to 32 bits */
+	x2 = _mm_srli_si128(x1,4);
+	x1 = _mm_and_si128(x1,mask32);
+	x1 = _mm_xor_si128(CLMUL(x1,k5,0x00),x2);
+
+	/* barrett reduction to 32 bits */
+	x2 = x1;
+	x1 = _mm_and_si128(x1,mask32);
+	x1 = CLMUL(x1,poly,0x10);
+	x1 = _mm_and_si128(x1,mask32);
+	x1 = CLMUL(x1,poly,0x00);
+	x1 = _mm_xor_si128(x1,x2);
+	return _mm_cvtsi128_si32(_mm_srli_si128(x1,4));
+}
+#endif
+
+/* returns a(x) * b(x) modulo the polynomial. the bits are reflected, i.e., x^0 is the MSB */
+CRC32::type CRC32::multmodp(type a,type b) {
+	type m = 1U << 31;
+	type p = 0;
+	while(1) {
+		if(a & m) {
+			p ^= b;
+			if((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+	}
+	return p;
+}
+
+/* returns x^(n * 2^k) modulo the polynomial */
+CRC32::type CRC32::x2nmodp(uint64_t n,uint k) {
+	type p = 1U << 31;
+	while(n) {
+		if(n & 1)
+			p = multmodp(_x2n[k & 31],p);
+		n >>= 1;
+		k++;
+	}
+	return p;
+}
+
+CRC32::type CRC32::combine(type crc1,type crc2,uint64_t len2) {
+	if(!_init)
+		init();
+	/* appending len2 bytes to A multiplies its CRC by x^(8 * len2) */
+	return multmodp(x2nmodp(len2,3),crc1) ^ crc2;
+}
+
 }
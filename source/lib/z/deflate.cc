@@ -17,7 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
-#include <esc/util.h>
+
 #include <sys/endian.h>
 #include <z/deflate.h>
 
@@ -25,226 +25,720 @@ namespace z {
 
 /* based on http://tools.ietf.org/html/rfc1951 */
 
+/* the parameters for the compression levels (the same as zlib uses) */
+const Deflate::Config Deflate::configs[] = {
+	/* good lazy nice chain lazymatch */
+	{0,		0,		0,		0,		false},	/* 0: store only */
+	{4,		4,		8,		4,		false},	/* 1: fastest, no lazy matches */
+	{4,		5,		16,		8,		false},
+	{4,		6,		32,		32,		false},
+	{4,		4,		16,		16,		true},	/* 4: lazy matches */
+	{8,		16,		32,		32,		true},
+	{8,		16,		128,	128,	true},	/* 6: default */
+	{8,		32,		128,	256,	true},
+	{32,	128,	258,	1024,	true},
+	{32,	258,	258,	4096,	true},	/* 9: best */
+};
+
+/* special ordering of code length codes */
+const unsigned char Deflate::clcidx[] = {
+	16,17,18,0,8,7,9,6,
+	10,5,11,4,12,3,13,2,
+	14,1,15
+};
+
+/* reverses the lowest <len> bits of <code> */
+static inline uint reverse(uint code,uint len) {
+	uint res = 0;
+	for(uint i = 0; i < len; ++i) {
+		res = (res << 1) | (code & 1);
+		code >>= 1;
+	}
+	return res;
+}
+
+/* determines the number of equal bytes in <a> and <b>, up to <max> */
+static inline uint match_length(const uint8_t *a,const uint8_t *b,uint max) {
+	uint len = 0;
+	while(len + sizeof(ulong) <= max) {
+		ulong x,y;
+		memcpy(&x,a + len,sizeof(x));
+		memcpy(&y,b + len,sizeof(y));
+		if(x != y)
+			break;
+		len += sizeof(ulong);
+	}
+	while(len < max && a[len] == b[len])
+		len++;
+	return len;
+}
+
 /* ---------------------- *
  * -- encode functions -- *
  * ---------------------- */
 
 void Deflate::flush(Data *d) {
-	if(d->bitcount > 0) {
-		d->drain->put(d->tag);
-		d->tag = 0;
-		d->bitcount = 0;
+	if(d->outpos > 0) {
+		d->drain->write(_state->out,d->outpos);
+		d->outpos = 0;
 	}
 }
 
-void Deflate::writebit(Data *d,int bit) {
-	assert((bit & ~0x1) == 0);
-	d->tag |= bit << d->bitcount;
-
-	if(++d->bitcount == 8)
+void Deflate::put_byte(Data *d,uint8_t c) {
+	if(d->outpos == OUT_SIZE)
 		flush(d);
+	_state->out[d->outpos++] = c;
 }
 
-void Deflate::write_bits(Data *d,unsigned int bits,int num) {
-	while(num-- > 0) {
-		writebit(d,bits & 0x1);
-		bits >>= 1;
+void Deflate::put_bits(Data *d,uint bits,uint num) {
+	d->bitbuf |= static_cast<uint64_t>(bits) << d->bitcount;
+	d->bitcount += num;
+	if(d->bitcount >= 32) {
+		if(d->outpos + 4 > OUT_SIZE)
+			flush(d);
+		uint8_t *out = _state->out + d->outpos;
+		out[0] = d->bitbuf;
+		out[1] = d->bitbuf >> 8;
+		out[2] = d->bitbuf >> 16;
+		out[3] = d->bitbuf >> 24;
+		d->outpos += 4;
+		d->bitbuf >>= 32;
+		d->bitcount -= 32;
 	}
 }
 
-void Deflate::write_bits_reverse(Data *d,unsigned int bits,unsigned int num) {
-	while(num-- > 0)
-		writebit(d,(bits >> num) & 0x1);
+void Deflate::align(Data *d) {
+	while(d->bitcount > 0) {
+		put_byte(d,d->bitbuf & 0xFF);
+		d->bitbuf >>= 8;
+		d->bitcount = d->bitcount > 8 ? d->bitcount - 8 : 0;
+	}
+	d->bitbuf = 0;
 }
 
-void Deflate::write_symbol(Data *d,Tree *t,unsigned int sym) {
-	size_t i;
-	for(i = 0; i < 4; ++i) {
-		if(t->litbase[i] > sym)
-			break;
+/* ------------------------- *
+ * -- huffman construction -- *
+ * ------------------------- */
+
+/* determines the code lengths for the first <num> symbols of <t>, based on their frequencies.
+ * no code will be longer than <maxbits> */
+void Deflate::build_tree(Tree *t,uint num,uint maxbits) {
+	uint32_t weight[2 * LIT_CODES];
+	uint16_t parent[2 * LIT_CODES];
+	uint16_t syms[LIT_CODES];
+	uint8_t depth[2 * LIT_CODES];
+	uint blcount[MAX_BITS + 1];
+	uint n = 0;
+
+	for(uint i = 0; i < num; ++i) {
+		t->len[i] = 0;
+		if(t->freq[i])
+			syms[n++] = i;
+	}
+	/* a complete code needs at least two symbols. just add unused ones */
+	for(uint i = 0; n < 2; ++i) {
+		if(!t->freq[i])
+			syms[n++] = i;
+	}
+
+	/* sort the symbols by frequency (ascending) */
+	std::sort(syms,syms + n,[t](uint16_t a,uint16_t b) {
+		return t->freq[a] < t->freq[b] || (t->freq[a] == t->freq[b] && a < b);
+	});
+	for(uint i = 0; i < n; ++i)
+		weight[i] = t->freq[syms[i]];
+
+	/* build the huffman tree with two queues: the sorted leafs and the internal nodes, which are
+	 * created in ascending order of weights as well */
+	uint leaf = 0,node = n;
+	for(uint next = n; next < 2 * n - 1; ++next) {
+		uint child[2];
+		for(uint c = 0; c < 2; ++c) {
+			if(leaf < n && (node >= next || weight[leaf] <= weight[node]))
+				child[c] = leaf++;
+			else
+				child[c] = node++;
+		}
+		weight[next] = weight[child[0]] + weight[child[1]];
+		parent[child[0]] = parent[child[1]] = next;
 	}
-	assert(i > 0);
-	i--;
 
-	unsigned int num = t->length[i];
-	unsigned int bits = t->codebase[i] + (sym - t->litbase[i]);
-	write_bits_reverse(d,bits,num);
+	/* determine the depths, starting at the root. parents have always a higher index */
+	for(uint i = 0; i <= MAX_BITS; ++i)
+		blcount[i] = 0;
+	depth[2 * n - 2] = 0;
+	for(int i = 2 * n - 3; i >= 0; --i) {
+		uint dep = depth[parent[i]] + 1;
+		depth[i] = std::min<uint>(dep,255);
+		if(i < static_cast<int>(n))
+			blcount[std::min(dep,maxbits)]++;
+	}
+
+	/* if we had to limit the lengths, the code is over-subscribed now. to fix that, turn a leaf
+	 * with maximum length and a shorter one into two leafs with a length of one more */
+	uint32_t total = 0;
+	for(uint i = maxbits; i > 0; --i)
+		total += blcount[i] << (maxbits - i);
+	while(total != (1U << maxbits)) {
+		blcount[maxbits]--;
+		for(uint i = maxbits - 1; i > 0; --i) {
+			if(blcount[i]) {
+				blcount[i]--;
+				blcount[i + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
+
+	/* the least frequent symbols get the longest codes */
+	for(uint len = maxbits, i = 0; len > 0; --len) {
+		for(uint j = 0; j < blcount[len]; ++j)
+			t->len[syms[i++]] = len;
+	}
 }
 
-void Deflate::write_int(Data *d,Tree *t,unsigned short *base,unsigned char *bits,unsigned int value,int add) {
-	/* determine code */
-	size_t i;
-	for(i = 0; i < 30; ++i) {
-		if(base[i] > value)
+/* assigns the canonical codes (bit-reversed, because they are written LSB first) according to the
+ * code lengths of the first <num> symbols of <t> */
+void Deflate::build_codes(Tree *t,uint num) {
+	uint blcount[MAX_BITS + 1];
+	uint next[MAX_BITS + 1];
+
+	for(uint i = 0; i <= MAX_BITS; ++i)
+		blcount[i] = 0;
+	for(uint i = 0; i < num; ++i)
+		blcount[t->len[i]]++;
+	blcount[0] = 0;
+
+	for(uint len = 1, code = 0; len <= MAX_BITS; ++len) {
+		code = (code + blcount[len - 1]) << 1;
+		next[len] = code;
+	}
+
+	for(uint i = 0; i < num; ++i) {
+		if(t->len[i])
+			t->code[i] = reverse(next[t->len[i]]++,t->len[i]);
+	}
+}
+
+/* ------------------------ *
+ * -- matching functions -- *
+ * ------------------------ */
+
+void Deflate::fill_window(Data *d) {
+	State *s = _state;
+	do {
+		size_t more = 2 * WSIZE - d->lookahead - d->strstart;
+
+		/* if the lookahead gets close to the end of the window, move the upper half down */
+		if(d->strstart >= WSIZE + MAX_DIST) {
+			memcpy(s->window,s->window + WSIZE,WSIZE - more);
+			d->matchstart -= WSIZE;
+			d->strstart -= WSIZE;
+			d->blockstart -= WSIZE;
+			for(size_t i = 0; i < HASH_SIZE; ++i)
+				s->head[i] = s->head[i] >= WSIZE ? s->head[i] - WSIZE : 0;
+			for(size_t i = 0; i < WSIZE; ++i)
+				s->prev[i] = s->prev[i] >= WSIZE ? s->prev[i] - WSIZE : 0;
+			more += WSIZE;
+		}
+
+		if(d->eof)
 			break;
+
+		size_t count = d->source->read(s->window + d->strstart + d->lookahead,more);
+		if(count == 0)
+			d->eof = true;
+		d->lookahead += count;
 	}
-	assert(i > 0);
-	i--;
+	while(d->lookahead < MIN_LOOKAHEAD && !d->eof);
+}
+
+/* inserts the string at <pos> into the hash table and returns the previous head of the chain */
+uint Deflate::insert_string(Data *d,size_t pos) {
+	State *s = _state;
+	d->inshash = ((d->inshash << HASH_SHIFT) ^ s->window[pos + MIN_MATCH - 1]) & (HASH_SIZE - 1);
+	uint head = s->head[d->inshash];
+	s->prev[pos & WMASK] = head;
+	s->head[d->inshash] = pos;
+	return head;
+}
+
+/* walks through the hash chain, starting at <cur>, to find the longest match for strstart that is
+ * longer than prevlength. the start of it is stored in matchstart */
+uint Deflate::longest_match(Data *d,uint cur) {
+	State *s = _state;
+	const Config *cfg = d->cfg;
+	const uint8_t *scan = s->window + d->strstart;
+	uint chain = cfg->chain;
+	uint best = d->prevlength;
+	uint nice = std::min<size_t>(cfg->nice,d->lookahead);
+	size_t limit = d->strstart > MAX_DIST ? d->strstart - MAX_DIST : 0;
+
+	/* if we have a good match already, don't try that hard */
+	if(best >= cfg->good)
+		chain >>= 2;
+
+	do {
+		const uint8_t *match = s->window + cur;
+		/* quickly skip the candidates that can't be better */
+		if(match[best] != scan[best] || match[best - 1] != scan[best - 1] ||
+				match[0] != scan[0] || match[1] != scan[1])
+			continue;
+
+		uint len = match_length(scan + 2,match + 2,MAX_MATCH - 2) + 2;
+		if(len > best) {
+			d->matchstart = cur;
+			best = len;
+			if(len >= nice)
+				break;
+		}
+	}
+	while((cur = s->prev[cur & WMASK]) > limit && --chain != 0);
+
+	return std::min<size_t>(best,d->lookahead);
+}
 
-	/* write code */
-	write_symbol(d,t,add + i);
-	write_bits(d,value - base[i],bits[i]);
+bool Deflate::tally_lit(Data *d,uint8_t c) {
+	State *s = _state;
+	s->symdist[d->symcount] = 0;
+	s->symlen[d->symcount] = c;
+	s->ltree.freq[c]++;
+	return ++d->symcount == SYM_COUNT;
 }
 
-void Deflate::write_symbol_chain(Data *d,Tree *lt,Tree *dt,unsigned int len,unsigned int dist) {
-	write_int(d,lt,length_base,length_bits,len,257);
-	write_int(d,dt,dist_base,dist_bits,dist,0);
+bool Deflate::tally_match(Data *d,uint dist,uint len) {
+	State *s = _state;
+	s->symdist[d->symcount] = dist;
+	s->symlen[d->symcount] = len - MIN_MATCH;
+	s->ltree.freq[257 + _lcode[len - MIN_MATCH]]++;
+	dist--;
+	s->dtree.freq[dist < 256 ? _dcode[dist] : _dcode[256 + (dist >> 7)]]++;
+	return ++d->symcount == SYM_COUNT;
 }
 
 /* ----------------------------- *
  * -- block deflate functions -- *
  * ----------------------------- */
 
-void Deflate::deflate_fixed_block(Data *d) {
-	size_t len = d->source->cached();
-	size_t orglen = len;
-	while(len > 0) {
-		unsigned char sym = d->source->peek(0);
-
-		// first, check if we already had the now following byte-sequence
-		int x,maxlen = 0,max = 0;
-		// ensure that we don't look more than 29 bytes back and not past the block-start and our
-		// current position
-		int end = esc::Util::min((size_t)29,len);
-		int begin = -esc::Util::min((size_t)29,orglen - len);
-		for(x = begin; x < 0; ++x) {
-			// check how many bytes match
-			int y;
-			for(y = 0; x + y < 0 && y < end; ++y) {
-				if(d->source->peek(x + y) != d->source->peek(y))
-					break;
+/* run-length encodes the code lengths of both trees into <syms> (symbol in the lower 5 bits and
+ * the value of the extra bits above) and counts the frequencies of the code length codes */
+uint Deflate::encode_lengths(Data *,uint hlit,uint hdist,uint16_t *syms) {
+	State *s = _state;
+	uint8_t lens[LIT_CODES + DIST_CODES];
+	uint total = hlit + hdist;
+	uint n = 0;
+
+	memcpy(lens,s->ltree.len,hlit);
+	memcpy(lens + hlit,s->dtree.len,hdist);
+
+	for(uint i = 0; i < total; ) {
+		uint8_t len = lens[i];
+		uint run = 1;
+		while(i + run < total && lens[i + run] == len)
+			run++;
+		i += run;
+
+		if(len == 0) {
+			/* repeat code length 0 for 11-138 times */
+			while(run >= 11) {
+				uint r = std::min(run,138U);
+				syms[n++] = 18 | ((r - 11) << 5);
+				run -= r;
 			}
-			// if we reached the end, the last one didn't match
-			if(x + y >= 0 || y >= end)
-				y--;
-
-			// the longest so far?
-			if(y > maxlen) {
-				maxlen = y;
-				max = x;
+			/* repeat code length 0 for 3-10 times */
+			if(run >= 3) {
+				syms[n++] = 17 | ((run - 3) << 5);
+				run = 0;
 			}
 		}
-
-		// the smallest length we can encode is 3
-		if(maxlen >= 3) {
-			write_symbol_chain(d,&sltree,&sdtree,maxlen,-max);
-			x = maxlen;
-		}
 		else {
-			// first write the symbol
-			write_symbol(d,&sltree,sym);
-
-			// now check if the symbol is following again at least 3 times
-			for(x = 1; x < end; ++x) {
-				if(d->source->peek(x) != sym)
-					break;
+			/* copy previous code length 3-6 times */
+			syms[n++] = len;
+			run--;
+			while(run >= 3) {
+				uint r = std::min(run,6U);
+				syms[n++] = 16 | ((r - 3) << 5);
+				run -= r;
 			}
-			x--;
-			if(x == end)
-				x--;
-
-			if(x >= 3) {
-				write_symbol_chain(d,&sltree,&sdtree,x,1);
-				x++;
-			}
-			// adjust x to fetch one byte from source
-			else
-				x = 1;
 		}
+		while(run-- > 0)
+			syms[n++] = len;
+	}
 
-		// fetch the bytes from source
-		len -= x;
-		while(x-- > 0)
-			d->source->get();
+	memset(s->cltree.freq,0,sizeof(s->cltree.freq));
+	for(uint i = 0; i < n; ++i)
+		s->cltree.freq[syms[i] & 0x1F]++;
+	return n;
+}
+
+void Deflate::compress_block(Data *d,const Tree *lt,const Tree *dt) {
+	State *s = _state;
+	for(size_t i = 0; i < d->symcount; ++i) {
+		uint dist = s->symdist[i];
+		uint lc = s->symlen[i];
+		if(dist == 0)
+			put_bits(d,lt->code[lc],lt->len[lc]);
+		else {
+			uint code = _lcode[lc];
+			put_bits(d,lt->code[257 + code],lt->len[257 + code]);
+			put_bits(d,lc + MIN_MATCH - length_base[code],length_bits[code]);
+
+			code = dist - 1 < 256 ? _dcode[dist - 1] : _dcode[256 + ((dist - 1) >> 7)];
+			put_bits(d,dt->code[code],dt->len[code]);
+			put_bits(d,dist - dist_base[code],dist_bits[code]);
+		}
 	}
 
 	/* end of block */
-	write_symbol(d,&sltree,256);
+	put_bits(d,lt->code[256],lt->len[256]);
 }
 
-void Deflate::deflate_uncompressed_block(Data *d) {
-	unsigned int length,invlength;
-	unsigned int i;
+void Deflate::stored_block(Data *d,const uint8_t *buf,size_t len,bool last) {
+	do {
+		size_t amount = std::min<size_t>(len,0xFFFF);
+		len -= amount;
+
+		put_bits(d,last && len == 0,1);
+		put_bits(d,BT_STORED,2);
 
-	/* make sure we start next block on a byte boundary */
+		/* stored blocks start on a byte boundary */
+		align(d);
+		put_byte(d,amount & 0xFF);
+		put_byte(d,amount >> 8);
+		put_byte(d,~amount & 0xFF);
+		put_byte(d,(~amount >> 8) & 0xFF);
+
+		flush(d);
+		d->drain->write(buf,amount);
+		buf += amount;
+	}
+	while(len > 0);
+}
+
+void Deflate::flush_block(Data *d,bool last) {
+	State *s = _state;
+	uint16_t clsyms[LIT_CODES + DIST_CODES];
+
+	/* build the dynamic trees */
+	s->ltree.freq[256]++;
+	build_tree(&s->ltree,LIT_CODES - 2,MAX_BITS);
+	build_codes(&s->ltree,LIT_CODES - 2);
+	build_tree(&s->dtree,DIST_CODES,MAX_BITS);
+	build_codes(&s->dtree,DIST_CODES);
+
+	uint hlit = LIT_CODES - 2;
+	while(hlit > 257 && !s->ltree.len[hlit - 1])
+		hlit--;
+	uint hdist = DIST_CODES;
+	while(hdist > 1 && !s->dtree.len[hdist - 1])
+		hdist--;
+
+	uint clcount = encode_lengths(d,hlit,hdist,clsyms);
+	build_tree(&s->cltree,CL_CODES,MAX_CL_BITS);
+	build_codes(&s->cltree,CL_CODES);
+
+	uint hclen = CL_CODES;
+	while(hclen > 4 && !s->cltree.len[clcidx[hclen - 1]])
+		hclen--;
+
+	/* determine the size of the block for all block types */
+	static const uint clextra[] = {2,3,7};
+	uint64_t dynbits = 3 + 5 + 5 + 4 + 3 * hclen;
+	for(uint i = 0; i < clcount; ++i) {
+		uint sym = clsyms[i] & 0x1F;
+		dynbits += s->cltree.len[sym] + (sym >= 16 ? clextra[sym - 16] : 0);
+	}
+	uint64_t fixbits = 3;
+	uint64_t extra = 0;
+	for(uint i = 0; i < LIT_CODES - 2; ++i) {
+		dynbits += static_cast<uint64_t>(s->ltree.freq[i]) * s->ltree.len[i];
+		fixbits += static_cast<uint64_t>(s->ltree.freq[i]) * _fltree.len[i];
+		if(i > 256)
+			extra += static_cast<uint64_t>(s->ltree.freq[i]) * length_bits[i - 257];
+	}
+	for(uint i = 0; i < DIST_CODES; ++i) {
+		dynbits += static_cast<uint64_t>(s->dtree.freq[i]) * s->dtree.len[i];
+		fixbits += static_cast<uint64_t>(s->dtree.freq[i]) * _fdtree.len[i];
+		extra += static_cast<uint64_t>(s->dtree.freq[i]) * dist_bits[i];
+	}
+	dynbits += extra;
+	fixbits += extra;
+
+	/* we can only store the block if the data is still in the window */
+	size_t storedlen = d->strstart - d->blockstart;
+	uint64_t storedbits = ~0ULL;
+	if(d->blockstart >= 0) {
+		size_t blocks = std::max<size_t>(1,(storedlen + 0xFFFE) / 0xFFFF);
+		storedbits = blocks * (3 + 7 + 32) + storedlen * 8;
+	}
+
+	if(storedbits <= fixbits && storedbits <= dynbits)
+		stored_block(d,s->window + d->blockstart,storedlen,last);
+	else if(fixbits <= dynbits) {
+		put_bits(d,last,1);
+		put_bits(d,BT_FIXED,2);
+		compress_block(d,&_fltree,&_fdtree);
+	}
+	else {
+		put_bits(d,last,1);
+		put_bits(d,BT_DYNAMIC,2);
+		put_bits(d,hlit - 257,5);
+		put_bits(d,hdist - 1,5);
+		put_bits(d,hclen - 4,4);
+		for(uint i = 0; i < hclen; ++i)
+			put_bits(d,s->cltree.len[clcidx[i]],3);
+		for(uint i = 0; i < clcount; ++i) {
+			uint sym = clsyms[i] & 0x1F;
+			put_bits(d,s->cltree.code[sym],s->cltree.len[sym]);
+			if(sym >= 16)
+				put_bits(d,clsyms[i] >> 5,clextra[sym - 16]);
+		}
+		compress_block(d,&s->ltree,&s->dtree);
+	}
+
+	/* start a new block */
+	memset(s->ltree.freq,0,sizeof(s->ltree.freq));
+	memset(s->dtree.freq,0,sizeof(s->dtree.freq));
+	d->symcount = 0;
+	d->blockstart = d->strstart;
+
+	if(last) {
+		align(d);
+		flush(d);
+	}
+}
+
+/* level 0: store the data without compression */
+void Deflate::deflate_stored(Data *d) {
+	State *s = _state;
+	size_t count = 0;
+	/* read ahead one chunk to know whether the current one is the last one */
+	while(count < WSIZE) {
+		size_t res = d->source->read(s->window + count,WSIZE - count);
+		if(res == 0)
+			break;
+		count += res;
+	}
+
+	while(1) {
+		size_t next = 0;
+		while(count == WSIZE && next < WSIZE) {
+			size_t res = d->source->read(s->window + WSIZE + next,WSIZE - next);
+			if(res == 0)
+				break;
+			next += res;
+		}
+
+		stored_block(d,s->window,count,next == 0);
+		if(next == 0)
+			break;
+		memcpy(s->window,s->window + WSIZE,next);
+		count = next;
+	}
+	align(d);
 	flush(d);
+}
+
+/* levels 1-3: take the longest match at the current position, if there is any */
+void Deflate::deflate_fast(Data *d) {
+	State *s = _state;
+	while(1) {
+		if(d->lookahead < MIN_LOOKAHEAD) {
+			fill_window(d);
+			if(d->lookahead == 0)
+				break;
+		}
+
+		uint head = 0;
+		if(d->lookahead >= MIN_MATCH)
+			head = insert_string(d,d->strstart);
+
+		uint matchlen = 0;
+		if(head != 0 && d->strstart - head <= MAX_DIST) {
+			d->prevlength = MIN_MATCH - 1;
+			matchlen = longest_match(d,head);
+		}
+
+		bool full;
+		if(matchlen >= MIN_MATCH) {
+			full = tally_match(d,d->strstart - d->matchstart,matchlen);
+			d->lookahead -= matchlen;
+
+			/* insert the strings of the match into the hash table, if it is not too long */
+			if(matchlen <= d->cfg->lazy && d->lookahead >= MIN_MATCH) {
+				while(--matchlen > 0) {
+					d->strstart++;
+					insert_string(d,d->strstart);
+				}
+				d->strstart++;
+			}
+			else {
+				d->strstart += matchlen;
+				d->inshash = ((s->window[d->strstart] << HASH_SHIFT) ^ s->window[d->strstart + 1]) &
+					(HASH_SIZE - 1);
+			}
+		}
+		else {
+			full = tally_lit(d,s->window[d->strstart]);
+			d->lookahead--;
+			d->strstart++;
+		}
 
-	/* get length */
-	length = d->source->cached();
-	invlength = ~length & 0x0000ffff;
-	assert(length <= 0xffff);
+		if(full)
+			flush_block(d,false);
+	}
+	flush_block(d,true);
+}
+
+/* levels 4-9: take the match at the current position only if the next position has no better
+ * one. otherwise, emit a literal and take the next one */
+void Deflate::deflate_slow(Data *d) {
+	State *s = _state;
+	uint matchlen = MIN_MATCH - 1;
+	bool available = false;
+	while(1) {
+		if(d->lookahead < MIN_LOOKAHEAD) {
+			fill_window(d);
+			if(d->lookahead == 0)
+				break;
+		}
+
+		uint head = 0;
+		if(d->lookahead >= MIN_MATCH)
+			head = insert_string(d,d->strstart);
+
+		/* remember the previous match and search for a better one */
+		d->prevlength = matchlen;
+		size_t prevmatch = d->matchstart;
+		matchlen = MIN_MATCH - 1;
+
+		if(head != 0 && d->prevlength < d->cfg->lazy && d->strstart - head <= MAX_DIST) {
+			matchlen = longest_match(d,head);
+			/* a short match that is far away is not worth it */
+			if(matchlen == MIN_MATCH && d->strstart - d->matchstart > TOO_FAR)
+				matchlen = MIN_MATCH - 1;
+		}
+
+		/* if the previous match was at least as good, take it */
+		if(d->prevlength >= MIN_MATCH && matchlen <= d->prevlength) {
+			size_t maxinsert = d->strstart + d->lookahead - MIN_MATCH;
+			bool full = tally_match(d,d->strstart - 1 - prevmatch,d->prevlength);
+
+			/* insert the strings of the match into the hash table. strstart - 1 and strstart
+			 * are already inserted */
+			d->lookahead -= d->prevlength - 1;
+			for(uint i = d->prevlength - 2; i > 0; --i) {
+				if(++d->strstart <= maxinsert)
+					insert_string(d,d->strstart);
+			}
+			available = false;
+			matchlen = MIN_MATCH - 1;
+			d->strstart++;
 
-	length = cputole16(length);
-	invlength = cputole16(invlength);
-	d->drain->put(length & 0xff);
-	d->drain->put(length >> 8);
-	d->drain->put(invlength & 0xff);
-	d->drain->put(invlength >> 8);
+			if(full)
+				flush_block(d,false);
+		}
+		/* otherwise, emit the previous byte as a literal, if there is one */
+		else if(available) {
+			if(tally_lit(d,s->window[d->strstart - 1]))
+				flush_block(d,false);
+			d->strstart++;
+			d->lookahead--;
+		}
+		else {
+			available = true;
+			d->strstart++;
+			d->lookahead--;
+		}
+	}
 
-	/* copy block */
-	for(i = le16tocpu(length); i; --i)
-		d->drain->put(d->source->get());
+	if(available)
+		tally_lit(d,s->window[d->strstart - 1]);
+	flush_block(d,true);
 }
 
 /* ---------------------- *
  * -- public functions -- *
  * ---------------------- */
 
-Deflate::Deflate() : DeflateBase() {
-	/* init static length tree */
-	sltree.litbase[0] = 0;
-	sltree.length[0] = 8;
-	sltree.codebase[0] = 0x30;
-
-	sltree.litbase[1] = 144;
-	sltree.length[1] = 9;
-	sltree.codebase[1] = 0x190;
+Deflate::Deflate() : DeflateBase(), _state(new State), _fltree(), _fdtree(), _lcode(), _dcode() {
+	uint i;
+
+	/* build the fixed trees */
+	for(i = 0; i < 144; ++i)
+		_fltree.len[i] = 8;
+	for(; i < 256; ++i)
+		_fltree.len[i] = 9;
+	for(; i < 280; ++i)
+		_fltree.len[i] = 7;
+	for(; i < LIT_CODES; ++i)
+		_fltree.len[i] = 8;
+	build_codes(&_fltree,LIT_CODES);
+
+	for(i = 0; i < DIST_CODES; ++i)
+		_fdtree.len[i] = 5;
+	build_codes(&_fdtree,DIST_CODES);
+
+	/* build the tables to map lengths and distances to codes. distances above 256 are looked up
+	 * by the upper bits; this works because those codes cover multiples of 128 */
+	for(i = 0; i < 28; ++i) {
+		for(uint j = 0; j < (1U << length_bits[i]); ++j)
+			_lcode[length_base[i] + j - MIN_MATCH] = i;
+	}
+	_lcode[MAX_MATCH - MIN_MATCH] = 28;
 
-	sltree.litbase[2] = 256;
-	sltree.length[2] = 7;
-	sltree.codebase[2] = 0;
+	for(i = 0; i < DIST_CODES; ++i) {
+		for(uint j = 0; j < (1U << dist_bits[i]); ++j) {
+			uint dist = dist_base[i] + j - 1;
+			_dcode[dist < 256 ? dist : 256 + (dist >> 7)] = i;
+		}
+	}
 
-	sltree.litbase[3] = 280;
-	sltree.length[3] = 8;
-	sltree.codebase[3] = 0xC0;
+	memset(_state->window,0,sizeof(_state->window));
+}
 
-	/* init static distance tree */
-	sdtree.litbase[0] = 0;
-	sdtree.length[0] = 5;
-	sdtree.codebase[0] = 0;
-	// termination
-	sdtree.litbase[1] = 32;
+Deflate::~Deflate() {
+	delete _state;
 }
 
 int Deflate::compress(DeflateDrain *drain,DeflateSource *source,int compr) {
+	if(compr < NONE || compr > BEST)
+		return FAILED;
+
 	Data d;
 	d.source = source;
-	d.bitcount = 0;
-	d.tag = 0;
 	d.drain = drain;
-
-	while(source->more() || source->cached() > 0) {
-		/* final block? */
-		writebit(&d,source->more() ? 0 : 1);
-		/* compression type */
-		write_bits(&d,compr,2);
-
-		/* write data */
-		switch(compr) {
-			case NONE:
-				deflate_uncompressed_block(&d);
-				break;
-			case FIXED:
-				deflate_fixed_block(&d);
-				break;
-			case DYN:
-				// TODO deflate_dynamic_block(&d);
-				break;
-		}
+	d.cfg = configs + compr;
+	d.bitbuf = 0;
+	d.bitcount = 0;
+	d.outpos = 0;
+	d.strstart = 0;
+	d.lookahead = 0;
+	d.blockstart = 0;
+	d.matchstart = 0;
+	d.prevlength = MIN_MATCH - 1;
+	d.inshash = 0;
+	d.eof = false;
+	d.symcount = 0;
+
+	memset(_state->head,0,sizeof(_state->head));
+	memset(_state->ltree.freq,0,sizeof(_state->ltree.freq));
+	memset(_state->dtree.freq,0,sizeof(_state->dtree.freq));
+
+	if(compr == NONE) {
+		deflate_stored(&d);
+		return OK;
 	}
 
-	flush(&d);
-	return 0;
+	fill_window(&d);
+	d.inshash = ((_state->window[0] << HASH_SHIFT) ^ _state->window[1]) & (HASH_SIZE - 1);
+
+	if(d.cfg->lazymatch)
+		deflate_slow(&d);
+	else
+		deflate_fast(&d);
+	return OK;
 }
 
 }
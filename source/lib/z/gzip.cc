@@ -107,7 +107,8 @@ GZipHeader GZipHeader::read(esc::IStream &is) {
 }
 
 void GZipHeader::write(esc::OStream &os) {
-	assert(isGZip() && method == MDEFLATE && (flags & ~(FNAME | FCOMMENT | FHCRC)) == 0 && xflags == 0);
+	assert(isGZip() && method == MDEFLATE && (flags & ~(FNAME | FCOMMENT | FHCRC)) == 0 &&
+		(xflags & ~(XFSLOW | XFFAST)) == 0);
 	mtime = cputole32(mtime);
 	try {
 		if(os.write(this,10) != 10)
@@ -17,7 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
-/* This is a slightly modified version of: */
+/* This is based on: */
 
 /*
  * tinflate  -  tiny inflate
@@ -64,131 +64,162 @@ const unsigned char Inflate::clcidx[] = {
 	14,1,15
 };
 
-/* ----------------------- *
- * -- utility functions -- *
- * ----------------------- */
-
-/* build the fixed huffman trees */
-void Inflate::build_fixed_trees(Tree *lt,Tree *dt) {
-	int i;
-
-	/* build fixed length tree */
-	for(i = 0; i < 7; ++i)
-		lt->table[i] = 0;
-
-	lt->table[7] = 24;
-	lt->table[8] = 152;
-	lt->table[9] = 112;
-
-	for(i = 0; i < 24; ++i)
-		lt->trans[i] = 256 + i;
-	for(i = 0; i < 144; ++i)
-		lt->trans[24 + i] = i;
-	for(i = 0; i < 8; ++i)
-		lt->trans[24 + 144 + i] = 280 + i;
-	for(i = 0; i < 112; ++i)
-		lt->trans[24 + 144 + 8 + i] = 144 + i;
-
-	/* build fixed distance tree */
-	for(i = 0; i < 5; ++i)
-		dt->table[i] = 0;
-
-	dt->table[5] = 32;
+static inline uint entry_len(uint32_t e) {
+	return (e >> 16) & 0xFF;
+}
+static inline uint entry_val(uint32_t e) {
+	return e & 0xFFFF;
+}
 
-	for(i = 0; i < 32; ++i)
-		dt->trans[i] = i;
+/* reverses the lowest <len> bits of <code> */
+static inline uint reverse(uint code,uint len) {
+	uint res = 0;
+	for(uint i = 0; i < len; ++i) {
+		res = (res << 1) | (code & 1);
+		code >>= 1;
+	}
+	return res;
 }
 
-/* given an array of code lengths, build a tree */
-void Inflate::build_tree(Tree *t,const unsigned char *lengths,unsigned int num) {
-	unsigned short offs[16];
-	unsigned int i,sum;
+/* ----------------------- *
+ * -- utility functions -- *
+ * ----------------------- */
 
-	/* clear code length count table */
-	for(i = 0; i < 16; ++i)
-		t->table[i] = 0;
+/* given an array of code lengths, build a lookup table with <bits> bits for the primary table */
+bool Inflate::build_table(uint32_t *table,size_t size,uint bits,const uint8_t *lengths,uint num) {
+	uint count[MAX_BITS + 1];
+	uint first[MAX_BITS + 1];
+	uint next[MAX_BITS + 1];
+	uint8_t subbits[1 << LIT_BITS];
+	uint mask = (1 << bits) - 1;
+
+	/* scan symbol lengths and sum code length counts */
+	for(uint i = 0; i <= MAX_BITS; ++i)
+		count[i] = 0;
+	for(uint i = 0; i < num; ++i)
+		count[lengths[i]]++;
+	count[0] = 0;
+
+	/* refuse over-subscribed codes and incomplete codes, except for a single code of length 1,
+	 * which is used if a block has only one distance */
+	int left = 1;
+	uint maxlen = 0;
+	for(uint len = 1; len <= MAX_BITS; ++len) {
+		left = (left << 1) - count[len];
+		if(left < 0)
+			return false;
+		if(count[len])
+			maxlen = len;
+	}
+	if(left > 0 && maxlen > 1)
+		return false;
 
-	/* scan symbol lengths,and sum code length counts */
-	for(i = 0; i < num; ++i)
-		t->table[lengths[i]]++;
+	/* determine the first code of each length (canonical huffman code) */
+	for(uint len = 1, code = 0; len <= MAX_BITS; ++len) {
+		code = (code + count[len - 1]) << 1;
+		first[len] = code;
+	}
 
-	t->table[0] = 0;
+	/* determine the required size of the subtable for each primary entry */
+	memset(subbits,0,1 << bits);
+	memcpy(next,first,sizeof(next));
+	for(uint i = 0; i < num; ++i) {
+		uint len = lengths[i];
+		if(len > bits) {
+			uint idx = reverse(next[len]++,len) & mask;
+			subbits[idx] = std::max<uint>(subbits[idx],len - bits);
+		}
+	}
 
-	/* compute offset table for distribution sort */
-	for(sum = 0,i = 0; i < 16; ++i) {
-		offs[i] = sum;
-		sum += t->table[i];
+	/* allocate the subtables behind the primary table */
+	memset(table,0,size * sizeof(uint32_t));
+	size_t used = 1 << bits;
+	for(uint i = 0; i <= mask; ++i) {
+		if(subbits[i]) {
+			if(used + (1 << subbits[i]) > size)
+				return false;
+			table[i] = ENT_SUB | (subbits[i] << 16) | used;
+			used += 1 << subbits[i];
+		}
 	}
 
-	/* create code->symbol translation table (symbols sorted by code) */
-	for(i = 0; i < num; ++i) {
-		if(lengths[i])
-			t->trans[offs[lengths[i]]++] = i;
+	/* fill the entries. since the codes are read LSB first, a code of length len occupies every
+	 * (1 << len)'th entry, starting at its reversed code */
+	memcpy(next,first,sizeof(next));
+	for(uint i = 0; i < num; ++i) {
+		uint len = lengths[i];
+		if(!len)
+			continue;
+
+		uint rev = reverse(next[len]++,len);
+		if(len <= bits) {
+			for(uint j = rev; j <= mask; j += 1 << len)
+				table[j] = (len << 16) | i;
+		}
+		else {
+			uint32_t e = table[rev & mask];
+			uint sublen = len - bits;
+			uint32_t *sub = table + entry_val(e);
+			for(uint j = rev >> bits; j < (1U << entry_len(e)); j += 1 << sublen)
+				sub[j] = (sublen << 16) | i;
+		}
 	}
+	return true;
 }
 
 /* ---------------------- *
  * -- decode functions -- *
  * ---------------------- */
 
-/* get one bit from source stream */
-int Inflate::getbit(Data *d) {
-	unsigned int bit;
-
-	/* check if tag is empty */
-	if(!d->bitcount--) {
-		/* load next tag */
-		d->tag = d->source->get();
-		d->bitcount = 7;
-	}
-
-	/* shift bit out of tag */
-	bit = d->tag & 0x01;
-	d->tag >>= 1;
-
-	return bit;
-}
-
 /* read a num bit value from a stream and add base */
-unsigned int Inflate::read_bits(Data *d,int num,int base) {
-	unsigned int val = 0;
-
-	/* read num bits */
-	if(num) {
-		unsigned int limit = 1 << (num);
-		unsigned int mask;
-
-		for(mask = 1; mask < limit; mask *= 2)
-			if(getbit(d)) val += mask;
-	}
+uint Inflate::read_bits(Data *d,uint num,uint base) {
+	while(d->bitcount < num)
+		fetch(d);
 
+	uint val = d->bitbuf & ((1U << num) - 1);
+	consume(d,num);
 	return val + base;
 }
 
-/* given a data stream and a tree, decode a symbol */
-int Inflate::decode_symbol(Data *d,Tree *t) {
-	int sum = 0,cur = 0,len = 0;
+/* read the next byte, assuming that the bit buffer is at a byte boundary */
+uint8_t Inflate::read_byte(Data *d) {
+	if(d->bitcount >= 8) {
+		uint8_t val = d->bitbuf & 0xFF;
+		consume(d,8);
+		return val;
+	}
+	return d->source->get();
+}
 
-	/* get more bits while code value is above sum */
-	do {
-		cur = 2 * cur + getbit(d);
+/* given a data stream and a table, decode a symbol */
+int Inflate::decode_symbol(Data *d,const uint32_t *table,uint bits) {
+	uint mask = (1 << bits) - 1;
+	while(1) {
+		/* missing bits are zero, which is fine, as long as the code does not need them */
+		uint32_t e = table[d->bitbuf & mask];
+		uint len = entry_len(e);
+		if(e & ENT_SUB) {
+			e = table[entry_val(e) + ((d->bitbuf >> bits) & ((1U << len) - 1))];
+			len = entry_len(e) ? bits + entry_len(e) : 0;
+		}
 
-		++len;
+		if(EXPECT_TRUE(len != 0 && len <= d->bitcount)) {
+			consume(d,len);
+			return entry_val(e);
+		}
 
-		sum += t->table[len];
-		cur -= t->table[len];
+		/* either we need more bits or the code is invalid */
+		if(d->bitcount >= MAX_BITS)
+			return FAILED;
+		fetch(d);
 	}
-	while(cur >= 0);
-
-	return t->trans[sum + cur];
 }
 
 /* given a data stream, decode dynamic trees from it */
-void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
-	Tree code_tree;
-	unsigned char lengths[288 + 32];
-	unsigned int hlit,hdist,hclen;
-	unsigned int i,num,length;
+int Inflate::decode_trees(Data *d,uint32_t *lt,uint32_t *dt) {
+	uint8_t lengths[288 + 32];
+	uint hlit,hdist,hclen;
+	uint i,num,length;
 
 	/* get 5 bits HLIT (257-286) */
 	hlit = read_bits(d,5,257);
@@ -199,103 +230,132 @@ void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
 	/* get 4 bits HCLEN (4-19) */
 	hclen = read_bits(d,4,4);
 
+	if(hlit > 286 || hdist > 30)
+		return FAILED;
+
 	for(i = 0; i < 19; ++i)
 		lengths[i] = 0;
 
 	/* read code lengths for code length alphabet */
 	for(i = 0; i < hclen; ++i) {
 		/* get 3 bits code length (0-7) */
-		unsigned int clen = read_bits(d,3,0);
-
-		lengths[clcidx[i]] = clen;
+		lengths[clcidx[i]] = read_bits(d,3,0);
 	}
 
-	/* build code length tree */
-	build_tree(&code_tree,lengths,19);
+	/* build code length table */
+	if(!build_table(_tables->codes,CODE_ENTRIES,CODE_BITS,lengths,19))
+		return FAILED;
 
 	/* decode code lengths for the dynamic trees */
 	for(num = 0; num < hlit + hdist;) {
-		int sym = decode_symbol(d,&code_tree);
+		int sym = decode_symbol(d,_tables->codes,CODE_BITS);
+		uint8_t val = 0;
 
 		switch(sym) {
 			case 16:
 				/* copy previous code length 3-6 times (read 2 bits) */
-				{
-					unsigned char prev = lengths[num - 1];
-					for(length = read_bits(d,2,3); length; --length)
-						lengths[num++] = prev;
-				}
+				if(num == 0)
+					return FAILED;
+				val = lengths[num - 1];
+				length = read_bits(d,2,3);
 				break;
 			case 17:
 				/* repeat code length 0 for 3-10 times (read 3 bits) */
-				for(length = read_bits(d,3,3); length; --length)
-					lengths[num++] = 0;
+				length = read_bits(d,3,3);
 				break;
 			case 18:
 				/* repeat code length 0 for 11-138 times (read 7 bits) */
-				for(length = read_bits(d,7,11); length; --length)
-					lengths[num++] = 0;
+				length = read_bits(d,7,11);
 				break;
+			case FAILED:
+				return FAILED;
 			default:
 				/* values 0-15 represent the actual code lengths */
-				lengths[num++] = sym;
+				val = sym;
+				length = 1;
 				break;
 		}
+
+		if(num + length > hlit + hdist)
+			return FAILED;
+		while(length-- > 0)
+			lengths[num++] = val;
 	}
 
-	/* build dynamic trees */
-	build_tree(lt,lengths,hlit);
-	build_tree(dt,lengths + hlit,hdist);
+	/* the end-of-block code is required */
+	if(lengths[256] == 0)
+		return FAILED;
+
+	/* build dynamic tables */
+	if(!build_table(lt,LIT_ENTRIES,LIT_BITS,lengths,hlit))
+		return FAILED;
+	if(!build_table(dt,DIST_ENTRIES,DIST_BITS,lengths + hlit,hdist))
+		return FAILED;
+	return OK;
 }
 
 /* ----------------------------- *
  * -- block inflate functions -- *
  * ----------------------------- */
 
-/* given a stream and two trees, inflate a block of data */
-int Inflate::inflate_block_data(Data *d,Tree *lt,Tree *dt) {
+/* given a stream and two tables, inflate a block of data */
+int Inflate::inflate_block_data(Data *d,const uint32_t *lt,const uint32_t *dt) {
 	while(1) {
-		int sym = decode_symbol(d,lt);
+		int sym = decode_symbol(d,lt,LIT_BITS);
 
+		if(EXPECT_TRUE(sym < 256)) {
+			if(sym < 0)
+				return FAILED;
+			d->drain->put(sym);
+			d->written++;
+		}
 		/* check for end of block */
-		if(sym == 256)
+		else if(sym == 256)
 			return OK;
-
-		if(sym < 256)
-			d->drain->put(sym);
 		else {
-			int length,dist,offs;
-			int i;
+			uint length,offs;
+			int dist;
 
+			/* 286 and 287 are not used */
 			sym -= 257;
+			if(sym >= 29)
+				return FAILED;
 
 			/* possibly get more bits from length code */
 			length = read_bits(d,length_bits[sym],length_base[sym]);
 
-			dist = decode_symbol(d,dt);
+			/* 30 and 31 are not used */
+			dist = decode_symbol(d,dt,DIST_BITS);
+			if(dist < 0 || dist >= 30)
+				return FAILED;
 
 			/* possibly get more bits from distance code */
 			offs = read_bits(d,dist_bits[dist],dist_base[dist]);
+			if(offs > d->written)
+				return FAILED;
 
 			/* copy match */
-			for(i = 0; i < length; ++i)
-				d->drain->put(d->drain->get(offs));
+			d->drain->copy(offs,length);
+			d->written += length;
 		}
 	}
 }
 
 /* inflate an uncompressed block of data */
 int Inflate::inflate_uncompressed_block(Data *d) {
-	unsigned int length,invlength;
-	unsigned int i;
+	uint length,invlength;
+	uint i;
+
+	/* skip to the next byte boundary */
+	consume(d,d->bitcount & 7);
 
 	/* get length */
-	length = d->source->get();
-	length = length + 256 * d->source->get();
+	length = read_byte(d);
+	length = length + 256 * read_byte(d);
 
 	/* get one's complement of length */
-	invlength = d->source->get();
-	invlength = invlength + 256 * d->source->get();
+	invlength = read_byte(d);
+	invlength = invlength + 256 * read_byte(d);
 
 	/* check length */
 	if(length != (~invlength & 0x0000ffff))
@@ -303,56 +363,79 @@ int Inflate::inflate_uncompressed_block(Data *d) {
 
 	/* copy block */
 	for(i = length; i; --i)
-		d->drain->put(d->source->get());
-
-	/* make sure we start next block on a byte boundary */
-	d->bitcount = 0;
+		d->drain->put(read_byte(d));
+	d->written += length;
 
 	return OK;
 }
 
 /* inflate a block of data compressed with fixed huffman trees */
 int Inflate::inflate_fixed_block(Data *d) {
-	/* decode block using fixed trees */
-	return inflate_block_data(d,&sltree,&sdtree);
+	/* decode block using fixed tables */
+	return inflate_block_data(d,_tables->flit,_tables->fdist);
 }
 
 /* inflate a block of data compressed with dynamic huffman trees */
 int Inflate::inflate_dynamic_block(Data *d) {
 	/* decode trees from stream */
-	decode_trees(d,&d->ltree,&d->dtree);
+	if(decode_trees(d,_tables->lit,_tables->dist) != OK)
+		return FAILED;
 
-	/* decode block using decoded trees */
-	return inflate_block_data(d,&d->ltree,&d->dtree);
+	/* decode block using decoded tables */
+	return inflate_block_data(d,_tables->lit,_tables->dist);
 }
 
 /* ---------------------- *
  * -- public functions -- *
  * ---------------------- */
 
-/* initialize global (static) data */
-Inflate::Inflate() : DeflateBase() {
-	/* build fixed huffman trees */
-	build_fixed_trees(&sltree,&sdtree);
+Inflate::Inflate() : DeflateBase(), _tables(new Tables) {
+	uint8_t lengths[288];
+	uint i;
+
+	/* build fixed length table */
+	for(i = 0; i < 144; ++i)
+		lengths[i] = 8;
+	for(; i < 256; ++i)
+		lengths[i] = 9;
+	for(; i < 280; ++i)
+		lengths[i] = 7;
+	for(; i < 288; ++i)
+		lengths[i] = 8;
+	A_UNUSED bool res = build_table(_tables->flit,LIT_ENTRIES,LIT_BITS,lengths,288);
+	assert(res);
+
+	/* build fixed distance table */
+	for(i = 0; i < 32; ++i)
+		lengths[i] = 5;
+	res = build_table(_tables->fdist,DIST_ENTRIES,DIST_BITS,lengths,32);
+	assert(res);
+}
+
+Inflate::~Inflate() {
+	delete _tables;
 }
 
 /* inflate stream from source to dest */
 int Inflate::uncompress(InflateDrain *drain,InflateSource *source) {
 	Data d;
-	int bfinal;
+	uint bfinal;
 
-	/* initialise data */
+	/* initialise data. we only fetch bytes on demand, so that we never read more than the
+	 * compressed data from the source */
 	d.source = source;
+	d.bitbuf = 0;
 	d.bitcount = 0;
 
 	d.drain = drain;
+	d.written = 0;
 
 	do {
-		unsigned int btype;
+		uint btype;
 		int res;
 
 		/* read final block flag */
-		bfinal = getbit(&d);
+		bfinal = read_bits(&d,1,0);
 
 		/* read block type (2 bits) */
 		btype = read_bits(&d,2,0);
@@ -30,7 +30,7 @@
 
 using namespace esc;
 
-static int compr = z::Deflate::FIXED;
+static int compr = z::Deflate::DEFAULT;
 static int tostdout = false;
 static int keep = false;
 
@@ -47,6 +47,10 @@ static void compress(IStream &is,const std::string &filename) {
 	}
 
 	z::GZipHeader header(&is == &sin ? NULL : filename.c_str(),NULL,true);
+	if(compr == z::Deflate::BEST)
+		header.xflags = z::GZipHeader::XFSLOW;
+	else if(compr == z::Deflate::FASTEST)
+		header.xflags = z::GZipHeader::XFFAST;
 	header.write(*out);
 
 	z::StreamDeflateSource src(is);
@@ -75,7 +79,7 @@ static void compress(IStream &is,const std::string &filename) {
 static void usage(const char *name) {
 	serr << "Usage: " << name << " [-c] [-l <level>] [-k] [<file>...]\n";
 	serr << "  -c: write to stdout\n";
-	serr << "  -l: the compression type (0=none, 1=fixed, 2=dyn)\n";
+	serr << "  -l: the compression level (0=none, 1=fastest, ..., 9=best; default: 6)\n";
 	serr << "  -k: keep the original files, don't delete them\n";
 	serr << "  If no file is given or <file> is '-', stdin is compressed to stdout.\n";
 	exit(EXIT_FAILURE);
@@ -90,7 +94,7 @@ int main(int argc,char **argv) {
 			case 'k': keep = true; break;
 			case 'l':
 				compr = atoi(optarg);
-				if(compr != z::Deflate::NONE && compr != z::Deflate::FIXED && compr != z::Deflate::DYN)
+				if(compr < z::Deflate::NONE || compr > z::Deflate::BEST)
 					usage(argv[0]);
 				break;
 			default:
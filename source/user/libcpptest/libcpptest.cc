@@ -29,6 +29,8 @@ extern sTestModule tModStreams;
 extern sTestModule tModFunctional;
 extern sTestModule tModBintree;
 extern sTestModule tModMap;
+extern sTestModule tModUnorderedMap;
+extern sTestModule tModUnorderedSet;
 extern sTestModule tModSmartPtr;
 extern sTestModule tModTuple;
 
@@ -41,6 +43,8 @@ int main(void) {
 	test_register(&tModFunctional);
 	test_register(&tModBintree);
 	test_register(&tModMap);
+	test_register(&tModUnorderedMap);
+	test_register(&tModUnorderedSet);
 	test_register(&tModSmartPtr);
 	test_register(&tModTuple);
 	test_start();
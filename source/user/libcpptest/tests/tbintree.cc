@@ -32,6 +32,10 @@ static void test_order(void);
 static void test_copy(void);
 static void test_erase(void);
 static void test_iterators(void);
+static void test_balance(void);
+static void test_bounds(void);
+static void test_stable(void);
+static void test_random(void);
 
 /* our test-module */
 sTestModule tModBintree = {
@@ -45,6 +49,10 @@ static void test_bintree(void) {
 	test_copy();
 	test_erase();
 	test_iterators();
+	test_balance();
+	test_bounds();
+	test_stable();
+	test_random();
 }
 
 static void test_insert(void) {
@@ -413,3 +421,164 @@ static void test_iterators(void) {
 
 	test_caseSucceeded();
 }
+
+/* a red-black tree with n nodes has a depth of at most 2 * log2(n + 1) */
+static size_t maxDepth(size_t n) {
+	size_t log = 0;
+	for(n++; n > 1; n >>= 1)
+		log++;
+	return 2 * (log + 1);
+}
+
+static void test_balance(void) {
+	size_t before,after;
+	test_caseStart("Testing balance");
+
+	before = heapspace();
+	{
+		bintree<int,int> t;
+		for(int i = 0; i < 1000; i++)
+			t.insert(i,i);
+		test_assertSize(t.size(),1000);
+		test_assertTrue(t.depth() <= maxDepth(t.size()));
+
+		for(int i = 0; i < 1000; i += 2)
+			t.erase(i);
+		test_assertSize(t.size(),500);
+		test_assertTrue(t.depth() <= maxDepth(t.size()));
+		for(int i = 0; i < 1000; i++)
+			test_assertTrue((t.find(i) == t.end()) == (i % 2 == 0));
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	before = heapspace();
+	{
+		bintree<int,int> t;
+		for(int i = 999; i >= 0; i--)
+			t.insert(t.begin(),i,i);
+		test_assertTrue(t.depth() <= maxDepth(t.size()));
+
+		int i = 0;
+		for(auto it = t.begin(); it != t.end(); ++it, ++i)
+			test_assertInt(it->first,i);
+		test_assertInt(i,1000);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	before = heapspace();
+	{
+		bintree<int,int> t;
+		for(int i = 0; i < 1000; i++)
+			t.insert(t.end(),i,i);
+		test_assertTrue(t.depth() <= maxDepth(t.size()));
+
+		bintree<int,int> cpy(t);
+		test_assertTrue(cpy == t);
+		test_assertTrue(cpy.depth() <= maxDepth(cpy.size()));
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_bounds(void) {
+	test_caseStart("Testing lower_bound and upper_bound");
+
+	bintree<int,int> t;
+	for(int i = 0; i < 100; i += 10)
+		t.insert(i,i);
+
+	test_assertInt(t.lower_bound(-5)->first,0);
+	test_assertInt(t.lower_bound(0)->first,0);
+	test_assertInt(t.lower_bound(35)->first,40);
+	test_assertInt(t.lower_bound(40)->first,40);
+	test_assertTrue(t.lower_bound(91) == t.end());
+
+	test_assertInt(t.upper_bound(-5)->first,0);
+	test_assertInt(t.upper_bound(0)->first,10);
+	test_assertInt(t.upper_bound(35)->first,40);
+	test_assertInt(t.upper_bound(40)->first,50);
+	test_assertTrue(t.upper_bound(90) == t.end());
+
+	const bintree<int,int> &ct = t;
+	test_assertInt(ct.lower_bound(55)->first,60);
+	test_assertInt(ct.upper_bound(60)->first,70);
+
+	test_caseSucceeded();
+}
+
+static void test_stable(void) {
+	size_t before,after;
+	test_caseStart("Testing iterators during erase");
+
+	before = heapspace();
+	{
+		bintree<int,int> t;
+		for(int i = 0; i < 64; i++)
+			t.insert(i,i * 2);
+
+		/* erasing nodes with two children must not invalidate iterators to other nodes */
+		bintree<int,int>::iterator its[64];
+		for(int i = 0; i < 64; i++)
+			its[i] = t.find(i);
+		for(int i = 0; i < 64; i += 3)
+			t.erase(i);
+		for(int i = 0; i < 64; i++) {
+			if(i % 3 != 0)
+				test_assertTrue(*its[i] == make_pair(i,i * 2));
+		}
+
+		/* erase every element while iterating */
+		for(auto it = t.begin(); it != t.end(); )
+			t.erase(it++);
+		test_assertSize(t.size(),0);
+		test_assertTrue(t.begin() == t.end());
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_random(void) {
+	static bool present[512];
+	size_t before,after;
+	test_caseStart("Testing random inserts and erases");
+
+	before = heapspace();
+	{
+		bintree<int,int> t;
+		size_t count = 0;
+		srand(0x1234);
+		for(int i = 0; i < 4000; i++) {
+			int k = rand() % ARRAY_SIZE(present);
+			if(rand() % 3 == 0) {
+				test_assertTrue(t.erase(k) == present[k]);
+				count -= present[k];
+				present[k] = false;
+			}
+			else {
+				t.insert(k,k + 1);
+				count += !present[k];
+				present[k] = true;
+			}
+		}
+
+		test_assertSize(t.size(),count);
+		test_assertTrue(t.depth() <= maxDepth(t.size()));
+		int last = -1;
+		for(auto it = t.begin(); it != t.end(); ++it) {
+			test_assertTrue(it->first > last);
+			test_assertTrue(present[it->first]);
+			test_assertInt(it->second,it->first + 1);
+			last = it->first;
+		}
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
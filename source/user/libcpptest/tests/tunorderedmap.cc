@@ -0,0 +1,258 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#include <sys/common.h>
+#include <sys/test.h>
+#include <unordered_map>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+
+/* forward declarations */
+static void test_unorderedmap(void);
+static void test_insert(void);
+static void test_erase(void);
+static void test_rehash(void);
+static void test_strings(void);
+static void test_pointers(void);
+static void test_copy(void);
+
+/* our test-module */
+sTestModule tModUnorderedMap = {
+	"Unordered map",
+	&test_unorderedmap
+};
+
+static void test_unorderedmap(void) {
+	test_insert();
+	test_erase();
+	test_rehash();
+	test_strings();
+	test_pointers();
+	test_copy();
+}
+
+static void test_insert(void) {
+	size_t before,after;
+	test_caseStart("Testing insert");
+
+	before = heapspace();
+	{
+		unordered_map<int,int> m;
+		test_assertTrue(m.empty());
+		test_assertTrue(m.begin() == m.end());
+		test_assertTrue(m.find(4) == m.end());
+
+		m[4] = 2;
+		m[1] = -12;
+		test_assertSize(m.size(),2);
+		test_assertInt(m[4],2);
+		test_assertInt(m.at(1),-12);
+
+		pair<unordered_map<int,int>::iterator,bool> res = m.insert(make_pair(4,5));
+		test_assertFalse(res.second);
+		test_assertInt(res.first->second,2);
+		res = m.insert(make_pair(5,6));
+		test_assertTrue(res.second);
+		test_assertInt(res.first->first,5);
+		test_assertSize(m.size(),3);
+
+		for(int i = 0; i < 1000; ++i)
+			m[i] = i * 2;
+		test_assertSize(m.size(),1000);
+		test_assertTrue(m.load_factor() <= m.max_load_factor());
+		for(int i = 0; i < 1000; ++i) {
+			unordered_map<int,int>::iterator it = m.find(i);
+			test_assertTrue(it != m.end());
+			test_assertInt(it->second,i * 2);
+		}
+		test_assertSize(m.count(1000),0);
+		test_assertSize(m.count(999),1);
+
+		size_t n = 0;
+		for(auto it = m.begin(); it != m.end(); ++it)
+			n++;
+		test_assertSize(n,1000);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_erase(void) {
+	size_t before,after;
+	test_caseStart("Testing erase");
+
+	before = heapspace();
+	{
+		unordered_map<int,int> m;
+		for(int i = 0; i < 500; ++i)
+			m[i] = i;
+
+		test_assertSize(m.erase(600),0);
+		for(int i = 0; i < 500; i += 2)
+			test_assertSize(m.erase(i),1);
+		test_assertSize(m.size(),250);
+		for(int i = 0; i < 500; ++i)
+			test_assertSize(m.count(i),i % 2);
+
+		// erase while iterating
+		for(auto it = m.begin(); it != m.end(); ) {
+			if(it->first % 3 == 0)
+				it = m.erase(it);
+			else
+				++it;
+		}
+		for(int i = 0; i < 500; ++i)
+			test_assertSize(m.count(i),(i % 2) && (i % 3) ? 1 : 0);
+
+		// reuse the tombstones
+		for(int i = 0; i < 500; ++i)
+			m[i] = -i;
+		test_assertSize(m.size(),500);
+		for(int i = 0; i < 500; ++i)
+			test_assertInt(m[i],-i);
+
+		m.erase(m.begin(),m.end());
+		test_assertTrue(m.empty());
+		test_assertTrue(m.begin() == m.end());
+
+		m[1] = 2;
+		m.clear();
+		test_assertTrue(m.empty());
+		test_assertTrue(m.find(1) == m.end());
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_rehash(void) {
+	test_caseStart("Testing rehash");
+
+	unordered_map<int,int> m;
+	m.reserve(100);
+	size_t buckets = m.bucket_count();
+	test_assertTrue(buckets >= 100);
+	for(int i = 0; i < 100; ++i)
+		m[i] = i;
+	test_assertSize(m.bucket_count(),buckets);
+
+	m.rehash(1000);
+	test_assertTrue(m.bucket_count() >= 1000);
+	for(int i = 0; i < 100; ++i)
+		test_assertInt(m[i],i);
+
+	m.max_load_factor(0.5f);
+	for(int i = 100; i < 1000; ++i)
+		m[i] = i;
+	test_assertTrue(m.load_factor() <= 0.5f);
+	for(int i = 0; i < 1000; ++i)
+		test_assertInt(m[i],i);
+
+	test_caseSucceeded();
+}
+
+static void test_strings(void) {
+	size_t before,after;
+	test_caseStart("Testing strings");
+
+	before = heapspace();
+	{
+		unordered_map<string,int> m;
+		m["foo"] = 1;
+		m["bar"] = 4;
+		m["a"] = 12;
+		m["abcdef"] = 142;
+		test_assertSize(m.size(),4);
+		test_assertInt(m["foo"],1);
+		test_assertInt(m["abcdef"],142);
+		test_assertTrue(m.find("foobar") == m.end());
+
+		m.erase("bar");
+		test_assertTrue(m.find("bar") == m.end());
+		test_assertSize(m.size(),3);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_pointers(void) {
+	size_t before,after;
+	test_caseStart("Testing aligned pointers");
+
+	before = heapspace();
+	{
+		/* the keys only differ in the upper bits */
+		static char objs[256 * 64];
+		unordered_map<void*,size_t> m;
+		for(size_t i = 0; i < 256; ++i)
+			m[objs + i * 64] = i;
+		test_assertSize(m.size(),256);
+		for(size_t i = 0; i < 256; ++i) {
+			auto it = m.find(objs + i * 64);
+			test_assertTrue(it != m.end());
+			test_assertSize(it->second,i);
+		}
+		test_assertTrue(m.find(objs + 1) == m.end());
+
+		for(size_t i = 0; i < 256; i += 2)
+			test_assertSize(m.erase(objs + i * 64),1);
+		test_assertSize(m.size(),128);
+		for(size_t i = 0; i < 256; ++i)
+			test_assertTrue((m.find(objs + i * 64) == m.end()) == (i % 2 == 0));
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_copy(void) {
+	test_caseStart("Testing copy and compare");
+
+	unordered_map<string,int> m1;
+	m1["foo"] = 1;
+	m1["bar"] = 4;
+	m1["a"] = 12;
+	unordered_map<string,int> m2(m1);
+	test_assertTrue(m1 == m2);
+
+	m2["a"] = 13;
+	test_assertTrue(m1 != m2);
+	test_assertInt(m1["a"],12);
+
+	unordered_map<string,int> m3;
+	m3 = m1;
+	test_assertTrue(m1 == m3);
+	m3.erase("foo");
+	test_assertTrue(m1 != m3);
+
+	swap(m1,m3);
+	test_assertSize(m1.size(),2);
+	test_assertSize(m3.size(),3);
+
+	test_caseSucceeded();
+}
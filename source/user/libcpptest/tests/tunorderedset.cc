@@ -0,0 +1,131 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#include <sys/common.h>
+#include <sys/test.h>
+#include <unordered_set>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+
+/* forward declarations */
+static void test_unorderedset(void);
+static void test_insert(void);
+static void test_erase(void);
+static void test_strings(void);
+
+/* our test-module */
+sTestModule tModUnorderedSet = {
+	"Unordered set",
+	&test_unorderedset
+};
+
+static void test_unorderedset(void) {
+	test_insert();
+	test_erase();
+	test_strings();
+}
+
+static void test_insert(void) {
+	size_t before,after;
+	test_caseStart("Testing insert");
+
+	before = heapspace();
+	{
+		unordered_set<int> s;
+		test_assertTrue(s.empty());
+		test_assertTrue(s.find(1) == s.end());
+
+		for(int i = 0; i < 1000; ++i)
+			test_assertTrue(s.insert(i * 7).second);
+		test_assertFalse(s.insert(7).second);
+		test_assertSize(s.size(),1000);
+		for(int i = 0; i < 7000; ++i)
+			test_assertSize(s.count(i),i % 7 == 0 ? 1 : 0);
+
+		int sum = 0;
+		for(auto it = s.begin(); it != s.end(); ++it)
+			sum += *it;
+		test_assertInt(sum,7 * (999 * 1000 / 2));
+
+		int vals[] = {1,2,3,2,1};
+		unordered_set<int> s2(vals,vals + 5);
+		test_assertSize(s2.size(),3);
+		unordered_set<int> s3(s2);
+		test_assertTrue(s2 == s3);
+		s3.insert(4);
+		test_assertTrue(s2 != s3);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_erase(void) {
+	test_caseStart("Testing erase");
+
+	unordered_set<int> s;
+	for(int i = 0; i < 100; ++i)
+		s.insert(i);
+	for(auto it = s.begin(); it != s.end(); ) {
+		if(*it >= 50)
+			it = s.erase(it);
+		else
+			++it;
+	}
+	test_assertSize(s.size(),50);
+	for(int i = 0; i < 100; ++i)
+		test_assertSize(s.count(i),i < 50 ? 1 : 0);
+
+	test_assertSize(s.erase(10),1);
+	test_assertSize(s.erase(10),0);
+	test_assertSize(s.size(),49);
+
+	s.clear();
+	test_assertTrue(s.empty());
+	test_assertTrue(s.begin() == s.end());
+
+	test_caseSucceeded();
+}
+
+static void test_strings(void) {
+	size_t before,after;
+	test_caseStart("Testing strings");
+
+	before = heapspace();
+	{
+		unordered_set<string> s;
+		s.insert("foo");
+		s.insert("bar");
+		s.insert("foo");
+		test_assertSize(s.size(),2);
+		test_assertSize(s.count("foo"),1);
+		test_assertSize(s.count("baz"),0);
+		s.erase("foo");
+		test_assertSize(s.count("foo"),0);
+		test_assertSize(s.size(),1);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
@@ -33,6 +33,10 @@ static void test_charclass();
 static void test_choice();
 static void test_errors();
 static void test_replace();
+static void test_semantics();
+static void test_prefix();
+static void test_dfacache();
+static void test_perf();
 static void test_regex();
 
 /* our test-module */
@@ -50,6 +54,10 @@ static void test_regex() {
     test_choice();
     test_errors();
     test_replace();
+    test_semantics();
+    test_prefix();
+    test_dfacache();
+    test_perf();
 }
 
 static void test_basic() {
@@ -509,6 +517,9 @@ static void test_errors() {
 	assert_compileFail("a{a,4}");
 	assert_compileFail("a{4,2}");
 	assert_compileFail("a{0,0}");
+	assert_compileFail("a{1001}");
+	assert_compileFail("a{0,1000000000}");
+	assert_compileFail("((a{1000}){1000}){1000}");
 	assert_compileFail("a}");
 	assert_compileFail("|");
 	assert_compileFail("|b");
@@ -534,3 +545,158 @@ static void test_replace() {
 
 	test_caseSucceeded();
 }
+
+static void test_semantics() {
+	test_caseStart("Testing matching semantics");
+
+	size_t before = heapspace();
+	{
+		// repetitions give characters back, if required
+		Regex::Pattern pat = Regex::compile("a*a");
+		test_assertTrue(Regex::matches(pat,"a"));
+		test_assertTrue(Regex::matches(pat,"aaa"));
+		test_assertFalse(Regex::matches(pat,""));
+
+		Regex::Result res = Regex::search(pat,"baaab");
+		test_assertTrue(res.matched());
+		test_assertStr(res.get(0).c_str(),"aaa");
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("^(a*)(a{2})$");
+		Regex::Result res = Regex::search(pat,"aaaaa");
+		test_assertTrue(res.matched());
+		test_assertStr(res.get(1).c_str(),"aaa");
+		test_assertStr(res.get(2).c_str(),"aa");
+	}
+
+	{
+		// the first alternative is preferred, but the others are tried as well
+		Regex::Pattern pat = Regex::compile("((a)|(ab))((c)|(bcd))");
+		Regex::Result res = Regex::search(pat,"xxabcd");
+		test_assertTrue(res.matched());
+		test_assertStr(res.get(0).c_str(),"abcd");
+		test_assertStr(res.get(1).c_str(),"a");
+		test_assertStr(res.get(4).c_str(),"bcd");
+	}
+
+	{
+		// leftmost match wins, even if a later one would be longer
+		Regex::Pattern pat = Regex::compile("(a|b)*c");
+		Regex::Result res = Regex::search(pat,"xxbc_aababc");
+		test_assertTrue(res.matched());
+		test_assertStr(res.get(0).c_str(),"bc");
+		test_assertStr(res.get(1).c_str(),"b");
+		test_assertFalse(Regex::search(pat,"ababababab").matched());
+		test_assertTrue(Regex::matches(pat,"abbbac"));
+		test_assertFalse(Regex::matches(pat,"abbbacc"));
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("[a-z]+[0-9]$");
+		test_assertTrue(Regex::search(pat,"12 foo bar5").matched());
+		test_assertStr(Regex::search(pat,"12 foo bar5").get(0).c_str(),"bar5");
+		test_assertFalse(Regex::search(pat,"12 foo bar5 ").matched());
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("h[a-z]llo");
+		test_assertFalse(Regex::search(pat,"HELLO").matched());
+		test_assertStr(Regex::search(pat,"HELLO",Regex::CASE_INSENSITIVE).get(0).c_str(),"HELLO");
+		test_assertStr(Regex::search(pat,"xhAllo",Regex::CASE_INSENSITIVE).get(0).c_str(),"hAllo");
+		test_assertTrue(Regex::matches(pat,"HeLlo",Regex::CASE_INSENSITIVE));
+		test_assertFalse(Regex::matches(pat,"HeLlo"));
+	}
+	test_assertSize(heapspace(),before);
+
+	test_caseSucceeded();
+}
+
+static void test_prefix() {
+	test_caseStart("Testing literal prefixes");
+
+	size_t before = heapspace();
+	{
+		Regex::Pattern pat = Regex::compile("foo[0-9]+");
+		test_assertFalse(Regex::search(pat,"").matched());
+		test_assertFalse(Regex::search(pat,"fo").matched());
+		test_assertFalse(Regex::search(pat,"foo foo").matched());
+		test_assertStr(Regex::search(pat,"foo fofoo12 foo3").get(0).c_str(),"foo12");
+		test_assertStr(Regex::search(pat,"ffoo1").get(0).c_str(),"foo1");
+	}
+
+	{
+		// the prefix is searched case-sensitively only without CASE_INSENSITIVE
+		Regex::Pattern pat = Regex::compile("abc");
+		test_assertStr(Regex::search(pat,"xABCabc").get(0).c_str(),"abc");
+		test_assertStr(Regex::search(pat,"xABCabc",Regex::CASE_INSENSITIVE).get(0).c_str(),"ABC");
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("1-2*");
+		test_assertStr(Regex::search(pat,"3 1-1-222").get(0).c_str(),"1-");
+		test_assertStr(Regex::search(pat,"3 1+1-222").get(0).c_str(),"1-222");
+		test_assertStr(Regex::search(pat,"3 1+1-222",Regex::CASE_INSENSITIVE).get(0).c_str(),"1-222");
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("^foo");
+		test_assertFalse(Regex::search(pat,"xfoo").matched());
+		test_assertTrue(Regex::search(pat,"foox").matched());
+	}
+	test_assertSize(heapspace(),before);
+
+	test_caseSucceeded();
+}
+
+static void test_dfacache() {
+	test_caseStart("Testing DFA cache");
+
+	size_t before = heapspace();
+	{
+		// this pattern has 2^13 DFA states, which does not fit into the cache
+		Regex::Pattern pat = Regex::compile("(a|b)*a(a|b){12}$");
+		std::string str;
+		uint x = 1;
+		for(size_t i = 0; i < 20000; ++i) {
+			x = x * 1103515245 + 12345;
+			str += (x >> 16) & 1 ? 'a' : 'b';
+		}
+
+		str[str.length() - 13] = 'a';
+		test_assertTrue(Regex::search(pat,str).matched());
+		test_assertTrue(Regex::matches(pat,str));
+		str[str.length() - 13] = 'b';
+		test_assertFalse(Regex::search(pat,str).matched());
+		test_assertFalse(Regex::matches(pat,str));
+	}
+	test_assertSize(heapspace(),before);
+
+	test_caseSucceeded();
+}
+
+static void test_perf() {
+	test_caseStart("Testing pathological patterns");
+
+	static const struct {
+		const char *pattern;
+		const char *line;
+	} tests[] = {
+		{"(a|b)*c",			"ab"},
+		{"(a*)*c",			"a"},
+		{"[a-z]+[0-9]$",	"foo "},
+		{"error: [0-9]+",	"warning: 12 "},
+	};
+
+	for(size_t i = 0; i < ARRAY_SIZE(tests); ++i) {
+		Regex::Pattern pat = Regex::compile(tests[i].pattern);
+		std::string line;
+		while(line.length() < 64 * 1024)
+			line += tests[i].line;
+
+		/* these would take exponential time with backtracking */
+		test_assertFalse(Regex::search(pat,line).matched());
+	}
+
+	test_caseSucceeded();
+}
@@ -0,0 +1,219 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gui/graphics/span.h>
+#include <sys/common.h>
+#include <sys/test.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace gui;
+
+static const uint8_t GUARD = 0xAA;
+static const size_t MAX_PIXELS = 80;
+static const size_t MAX_OFF = 16;
+
+static void test_span(void);
+static void test_fill(void);
+static void test_copy(void);
+static void test_mask(void);
+static void test_bench(void);
+
+/* our test-module */
+sTestModule tModSpan = {
+	"Span",
+	&test_span
+};
+
+static void test_span(void) {
+	test_fill();
+	test_copy();
+	test_mask();
+	test_bench();
+}
+
+static bool isPixel(const uint8_t *addr,Color::color_type col,gcoldepth_t bpp) {
+	switch(bpp) {
+		case 16:
+			return *(const uint16_t*)addr == (uint16_t)col;
+		case 24:
+			return memcmp(addr,&col,3) == 0;
+		default:
+			return *(const uint32_t*)addr == col;
+	}
+}
+
+static bool isGuard(const uint8_t *addr,size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		if(addr[i] != GUARD)
+			return false;
+	}
+	return true;
+}
+
+static void test_fill(void) {
+	static const gcoldepth_t depths[] = {16,24,32};
+	static uint8_t buf[(MAX_OFF + MAX_PIXELS + 1) * 4];
+	const Color::color_type col = 0x11223344;
+
+	for(size_t d = 0; d < ARRAY_SIZE(depths); ++d) {
+		gcoldepth_t bpp = depths[d];
+		size_t bytespp = bpp / 8;
+		test_caseStart("Testing fill with %u bpp",bpp);
+
+		/* try all alignments and lengths to hit the head, vector and tail parts */
+		for(size_t off = 0; off < MAX_OFF; ++off) {
+			for(size_t count = 0; count < MAX_PIXELS; ++count) {
+				memset(buf,GUARD,sizeof(buf));
+				uint8_t *dst = buf + off * bytespp;
+				Span::fill(dst,col,count,bpp);
+
+				bool ok = isGuard(buf,off * bytespp);
+				for(size_t i = 0; ok && i < count; ++i)
+					ok = isPixel(dst + i * bytespp,col,bpp);
+				ok = ok && isGuard(dst + count * bytespp,sizeof(buf) - (off + count) * bytespp);
+				if(!test_assertTrue(ok)) {
+					test_caseFailed("off=%zu, count=%zu",off,count);
+					return;
+				}
+			}
+		}
+
+		test_caseSucceeded();
+	}
+}
+
+static void test_copy(void) {
+	static uint8_t src[MAX_OFF + MAX_PIXELS * 4];
+	static uint8_t dst[MAX_OFF + MAX_PIXELS * 4 + 1];
+	test_caseStart("Testing copy");
+
+	for(size_t i = 0; i < sizeof(src); ++i)
+		src[i] = i;
+
+	for(size_t soff = 0; soff < MAX_OFF; ++soff) {
+		for(size_t doff = 0; doff < MAX_OFF; ++doff) {
+			for(size_t count = 0; count < MAX_PIXELS; ++count) {
+				memset(dst,GUARD,sizeof(dst));
+				Span::copy(dst + doff,src + soff,count,32);
+				bool ok = isGuard(dst,doff) && memcmp(dst + doff,src + soff,count * 4) == 0;
+				ok = ok && dst[doff + count * 4] == GUARD;
+				if(!test_assertTrue(ok)) {
+					test_caseFailed("soff=%zu, doff=%zu, count=%zu",soff,doff,count);
+					return;
+				}
+			}
+		}
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_mask(void) {
+	static const gcoldepth_t depths[] = {16,24,32};
+	uint8_t buf[9 * 4];
+	const Color::color_type col = 0x11223344;
+
+	for(size_t d = 0; d < ARRAY_SIZE(depths); ++d) {
+		gcoldepth_t bpp = depths[d];
+		size_t bytespp = bpp / 8;
+		test_caseStart("Testing mask with %u bpp",bpp);
+
+		for(uint bits = 0; bits < 0x100; ++bits) {
+			for(size_t count = 0; count <= 8; ++count) {
+				memset(buf,GUARD,sizeof(buf));
+				Span::mask(buf,bits,count,col,bpp);
+
+				bool ok = true;
+				for(size_t i = 0; ok && i < 8; ++i) {
+					bool set = i < count && (bits & (0x80 >> i));
+					if(set)
+						ok = isPixel(buf + i * bytespp,col,bpp);
+					else
+						ok = isGuard(buf + i * bytespp,bytespp);
+				}
+				if(!test_assertTrue(ok)) {
+					test_caseFailed("bits=%#x, count=%zu",bits,count);
+					return;
+				}
+			}
+		}
+
+		test_caseSucceeded();
+	}
+}
+
+static void report(const char *name,gcoldepth_t bpp,size_t pixels,uint64_t start) {
+	uint64_t usecs = tsctotime(rdtsc() - start);
+	printf("%-6s %2u bpp: %6Lu Mpixels/s\n",name,bpp,pixels / (usecs ? usecs : 1));
+}
+
+static void test_bench(void) {
+	static const gcoldepth_t depths[] = {16,24,32};
+	const size_t width = 1024, height = 768, rounds = 8;
+	test_caseStart("Measuring fill, blit and text throughput");
+
+	uint8_t *src = (uint8_t*)malloc(width * height * 4);
+	uint8_t *dst = (uint8_t*)malloc(width * height * 4);
+	if(!test_assertTrue(src != NULL && dst != NULL)) {
+		free(src);
+		free(dst);
+		return;
+	}
+	memset(src,0x5A,width * height * 4);
+
+	for(size_t d = 0; d < ARRAY_SIZE(depths); ++d) {
+		gcoldepth_t bpp = depths[d];
+		size_t stride = width * (bpp / 8);
+
+		/* fill the whole screen, but start at an odd pixel to get the unaligned case, too */
+		uint64_t start = rdtsc();
+		for(size_t r = 0; r < rounds; ++r) {
+			for(size_t y = 0; y < height; ++y)
+				Span::fill(dst + y * stride + (bpp / 8),0x00112233,width - 1,bpp);
+		}
+		report("fill",bpp,rounds * height * (width - 1),start);
+
+		start = rdtsc();
+		for(size_t r = 0; r < rounds; ++r) {
+			for(size_t y = 0; y < height; ++y)
+				Span::copy(dst + y * stride,src + y * stride,width,bpp);
+		}
+		report("blit",bpp,rounds * height * width,start);
+
+		/* draw 8x16 glyphs with a typical mix of set and unset pixels */
+		start = rdtsc();
+		for(size_t r = 0; r < rounds; ++r) {
+			for(size_t y = 0; y < height; ++y) {
+				uint8_t *addr = dst + y * stride;
+				for(size_t x = 0; x < width; x += 8, addr += bpp) {
+					uint8_t bits = 0x3C ^ (y * 0x11) ^ x;
+					Span::mask(addr,bits,8,0x00112233,bpp);
+				}
+			}
+		}
+		report("text",bpp,rounds * height * width,start);
+	}
+
+	free(dst);
+	free(src);
+	test_caseSucceeded();
+}
@@ -0,0 +1,147 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/test.h>
+#include <z/crc32.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUF_SIZE		(64 * 1024)
+
+/* forward declarations */
+static void test_crc32();
+static void test_known();
+static void test_lengths();
+static void test_update();
+static void test_combine();
+
+/* our test-module */
+sTestModule tModCRC32 = {
+	"CRC32",
+	&test_crc32
+};
+
+static uint8_t *buffer;
+
+/* the byte-at-a-time implementation that we used before, as a reference */
+static z::CRC32::type ref_crc32(z::CRC32::type crc,const uint8_t *buf,size_t len) {
+	static z::CRC32::type table[256];
+	if(table[1] == 0) {
+		for(size_t n = 0; n < 256; n++) {
+			z::CRC32::type c = n;
+			for(int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+
+	z::CRC32::type c = crc ^ 0xffffffff;
+	for(size_t n = 0; n < len; n++)
+		c = table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
+	return c ^ 0xffffffff;
+}
+
+static void test_crc32() {
+	buffer = (uint8_t*)malloc(BUF_SIZE);
+	srand(0x1234);
+	for(size_t i = 0; i < BUF_SIZE; ++i)
+		buffer[i] = rand();
+
+	test_known();
+	test_lengths();
+	test_update();
+	test_combine();
+
+	free(buffer);
+}
+
+static void test_known() {
+	test_caseStart("Known values");
+
+	z::CRC32 crc;
+	test_assertUInt(crc.get("",0),0);
+	test_assertUInt(crc.get("a",1),0xe8b7be43);
+	test_assertUInt(crc.get("123456789",9),0xcbf43926);
+	test_assertUInt(crc.get("The quick brown fox jumps over the lazy dog",43),0x414fa339);
+
+	uint8_t zeros[256];
+	memset(zeros,0,sizeof(zeros));
+	test_assertUInt(crc.get(zeros,32),0x190a55ad);
+	test_assertUInt(crc.get(zeros,256),0x0d968558);
+
+	test_caseSucceeded();
+}
+
+static void test_lengths() {
+	test_caseStart("All lengths and alignments");
+
+	z::CRC32 crc;
+	/* short ones take the table path only, longer ones might use PCLMULQDQ with a remainder */
+	for(size_t off = 0; off < 16; ++off) {
+		for(size_t len = 0; len < 300; ++len) {
+			if(!test_assertUInt(crc.get(buffer + off,len),ref_crc32(0,buffer + off,len)))
+				break;
+		}
+	}
+
+	test_assertUInt(crc.get(buffer,BUF_SIZE),ref_crc32(0,buffer,BUF_SIZE));
+	test_assertUInt(crc.get(buffer + 3,BUF_SIZE - 7),ref_crc32(0,buffer + 3,BUF_SIZE - 7));
+
+	test_caseSucceeded();
+}
+
+static void test_update() {
+	test_caseStart("Incremental updates");
+
+	z::CRC32 crc;
+	z::CRC32::type expected = ref_crc32(0,buffer,BUF_SIZE);
+	static const size_t steps[] = {1,7,63,64,65,1000,4096};
+	for(size_t s = 0; s < ARRAY_SIZE(steps); ++s) {
+		z::CRC32::type c = 0;
+		for(size_t pos = 0; pos < BUF_SIZE; pos += steps[s])
+			c = crc.update(c,buffer + pos,MIN(steps[s],BUF_SIZE - pos));
+		test_assertUInt(c,expected);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_combine() {
+	test_caseStart("Combining CRCs");
+
+	z::CRC32 crc;
+	z::CRC32::type expected = crc.get(buffer,BUF_SIZE);
+	static const size_t splits[] = {0,1,15,16,1000,BUF_SIZE / 2,BUF_SIZE - 1,BUF_SIZE};
+	for(size_t s = 0; s < ARRAY_SIZE(splits); ++s) {
+		z::CRC32::type crc1 = crc.get(buffer,splits[s]);
+		z::CRC32::type crc2 = crc.get(buffer + splits[s],BUF_SIZE - splits[s]);
+		test_assertUInt(z::CRC32::combine(crc1,crc2,BUF_SIZE - splits[s]),expected);
+	}
+
+	/* combine multiple parts, as a parallel compressor would do */
+	z::CRC32::type c = 0;
+	for(size_t pos = 0; pos < BUF_SIZE; pos += 5000) {
+		size_t len = MIN(5000,BUF_SIZE - pos);
+		c = z::CRC32::combine(c,crc.get(buffer + pos,len),len);
+	}
+	test_assertUInt(c,expected);
+
+	test_caseSucceeded();
+}
@@ -35,7 +35,7 @@
 static bool run = true;
 
 static void usage(const char *name) {
-	fprintf(stderr,"Usage: %s [--ms <ms>] [-p <perms>] <device> <path> <fs>\n",name);
+	fprintf(stderr,"Usage: %s [--ms <ms>] [-p <perms>] [-o <opts>] <device> <path> <fs>\n",name);
 	fprintf(stderr,"    Creates a child process that executes <fs>. <fs> receives\n");
 	fprintf(stderr,"    the fs-device to create and the device to work with (<device>)\n");
 	fprintf(stderr,"    as command line arguments. Afterwards, mount opens the\n");
@@ -45,6 +45,8 @@ static void usage(const char *name) {
 	fprintf(stderr,"\n");
 	fprintf(stderr,"    -p <perms>: set the permissions to <perms>, which is a combination\n");
 	fprintf(stderr,"                of the letters r, w and x (rwx by default).\n");
+	fprintf(stderr,"    -o <opts>:  pass the filesystem specific options <opts> to <fs>\n");
+	fprintf(stderr,"                (e.g., -o noatime for ext2).\n");
 	fprintf(stderr,"    --ms <ms>:  By default, the current mountspace (/sys/pid/self/ms)\n");
 	fprintf(stderr,"                will be used. This can be overwritten by specifying\n");
 	fprintf(stderr,"                --ms <ms>.\n");
@@ -68,16 +70,18 @@ int main(int argc,char *argv[]) {
 	char devpath[MAX_PATH_LEN];
 	char *mspath = (char*)"/sys/pid/self/ms";
 	char *perms = (char*)"rwx";
+	char *opts = NULL;
 
 	int opt;
 	const struct option longopts[] = {
 		{"ms",		required_argument,	0,	'm'},
 		{0, 0, 0, 0},
 	};
-	while((opt = getopt_long(argc,argv,"p:",longopts,NULL)) != -1) {
+	while((opt = getopt_long(argc,argv,"p:o:",longopts,NULL)) != -1) {
 		switch(opt) {
 			case 'm': mspath = optarg; break;
 			case 'p': perms = optarg; break;
+			case 'o': opts = optarg; break;
 			default:
 				usage(argv[0]);
 		}
@@ -124,7 +128,13 @@ int main(int argc,char *argv[]) {
 	if(pid < 0)
 		error("fork failed");
 	if(pid == 0) {
-		const char *args[] = {fs,fsdev,devpath,NULL};
+		const char *args[] = {fs,fsdev,devpath,NULL,NULL,NULL};
+		if(opts) {
+			args[1] = "-o";
+			args[2] = opts;
+			args[3] = fsdev;
+			args[4] = devpath;
+		}
 		execvp(fs,args);
 		error("exec failed");
 	}
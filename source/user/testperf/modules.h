@@ -19,6 +19,10 @@
 
 #include <sys/common.h>
 
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 extern int mod_getpid(int,char**);
 extern int mod_yield(int,char**);
 extern int mod_fork(int,char**);
@@ -36,3 +40,19 @@ extern int mod_chgsize(int,char**);
 extern int mod_pagefault(int,char**);
 extern int mod_heap(int,char**);
 extern int mod_stdio(int,char**);
+extern int mod_cpuscale(int,char**);
+extern int mod_wakeup(int,char**);
+extern int mod_zerocopy(int,char**);
+extern int mod_fsreaders(int,char**);
+extern int mod_bcreplay(int,char**);
+extern int mod_diskread(int,char**);
+extern int mod_inflate(int,char**);
+extern int mod_deflate(int,char**);
+extern int mod_dirlookup(int,char**);
+extern int mod_filewrite(int,char**);
+extern int mod_map(int,char**);
+extern int mod_regex(int,char**);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,141 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <fs/blockcache.h>
+#include <sys/common.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../modules.h"
+
+/* replays a block trace, as written by ext2 -o trace=<file>, against a block cache that does not
+ * access a disk. without trace, a synthetic one is used: a sequential scan through lots of
+ * blocks with interleaved accesses to a small set of metadata blocks. */
+
+#define BLOCK_SIZE		1024
+#define CACHE_BLOCKS	512
+#define META_BLOCKS		64
+#define SCAN_START		10000
+
+struct Op {
+	char type;
+	block_t block;
+	size_t count;
+	size_t demanded;
+};
+
+class ReplayCache : public fs::BlockCache {
+public:
+	explicit ReplayCache(size_t blocks)
+		: BlockCache(-1,blocks,BLOCK_SIZE), reads(), writes() {
+	}
+
+	bool readBlocks(void *,block_t,size_t blockCount) override {
+		reads += blockCount;
+		return false;
+	}
+	bool writeBlocks(const void *,size_t,size_t blockCount) override {
+		writes += blockCount;
+		return false;
+	}
+
+	ulong reads;
+	ulong writes;
+};
+
+static bool loadTrace(const char *path,std::vector<Op> &ops) {
+	FILE *f = fopen(path,"r");
+	if(f == NULL) {
+		printe("Unable to open '%s'",path);
+		return false;
+	}
+
+	char line[64];
+	while(fgets(line,sizeof(line),f) != NULL) {
+		Op op = {line[0],0,1,1};
+		char *end;
+		op.block = strtoul(line + 1,&end,10);
+		if(op.type == 'p') {
+			op.count = strtoul(end,&end,10);
+			op.demanded = strtoul(end,NULL,10);
+		}
+		if(strchr("rwcp",op.type) != NULL)
+			ops.push_back(op);
+	}
+	fclose(f);
+	return true;
+}
+
+static void genTrace(size_t cacheBlocks,std::vector<Op> &ops) {
+	for(size_t i = 0; i < cacheBlocks * 16; ++i) {
+		if(i % 8 == 0) {
+			Op meta = {'r',(block_t)(1 + (i / 8) % META_BLOCKS),1,1};
+			ops.push_back(meta);
+		}
+		Op scan = {'r',(block_t)(SCAN_START + i),1,1};
+		ops.push_back(scan);
+	}
+}
+
+int mod_bcreplay(int argc,char *argv[]) {
+	const char *path = argc > 2 ? argv[2] : NULL;
+	size_t cacheBlocks = argc > 3 ? strtoul(argv[3],NULL,0) : CACHE_BLOCKS;
+
+	std::vector<Op> ops;
+	if(path == NULL)
+		genTrace(cacheBlocks,ops);
+	else if(!loadTrace(path,ops))
+		return 1;
+
+	ReplayCache cache(cacheBlocks);
+	uint64_t start = rdtsc();
+	for(auto op = ops.begin(); op != ops.end(); ++op) {
+		if(op->type == 'p') {
+			cache.prefetch(op->block,op->count,op->demanded);
+			continue;
+		}
+
+		fs::CBlock *b;
+		if(op->type == 'c')
+			b = cache.create(op->block);
+		else {
+			uint mode = op->type == 'w' ? fs::BlockCache::WRITE : fs::BlockCache::READ;
+			b = cache.request(op->block,mode);
+		}
+		if(b == NULL) {
+			printe("Request of block %u failed",op->block);
+			return 1;
+		}
+		if(op->type != 'r')
+			cache.markDirty(b);
+		cache.release(b);
+	}
+	uint64_t end = rdtsc();
+
+	printf("%zu requests with %zu blocks: %Lu cycles, %Lu cycles/request\n",
+		ops.size(),cacheBlocks,end - start,(end - start) / (ops.size() ? ops.size() : 1));
+	printf("Blocks read from disk: %lu\n",cache.reads);
+	cache.flush();
+	printf("Blocks written to disk: %lu\n",cache.writes);
+	cache.printStats(stdout);
+	return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/conf.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../modules.h"
+
+#define MAX_CPUS		32
+#define YIELD_COUNT		100000
+#define PINGPONG_COUNT	50000
+
+static int startsem;
+static int pingsems[MAX_CPUS][2];
+
+static void pin(size_t cpu) {
+	if(setaffinity(gettid(),1UL << cpu) < 0)
+		printe("Unable to pin thread %d to CPU %zu",gettid(),cpu);
+}
+
+static int thread_yield(void *arg) {
+	pin((size_t)arg);
+	semdown(startsem);
+	for(int i = 0; i < YIELD_COUNT; ++i)
+		yield();
+	return 0;
+}
+
+static int thread_ping(void *arg) {
+	size_t cpu = (size_t)arg & ~(1UL << 16);
+	bool first = ((size_t)arg & (1UL << 16)) != 0;
+	int s1 = pingsems[cpu][first ? 0 : 1];
+	int s2 = pingsems[cpu][first ? 1 : 0];
+	pin(cpu);
+	semdown(startsem);
+	for(int i = 0; i < PINGPONG_COUNT; ++i) {
+		if(first)
+			semup(s2);
+		semdown(s1);
+		if(!first)
+			semup(s2);
+	}
+	return 0;
+}
+
+static void run(size_t threads,uint64_t ops,const char *name,size_t cpus) {
+	/* let all threads start at the same time */
+	uint64_t start = rdtsc();
+	for(size_t i = 0; i < threads; ++i)
+		semup(startsem);
+	join(0);
+	uint64_t end = rdtsc();
+
+	uint64_t usecs = tsctotime(end - start);
+	printf("%-8s on %2zu CPUs: %8Lu cycles, %6Lu ops/ms\n",
+		name,cpus,(end - start) / ops,(ops * 1000) / (usecs ? usecs : 1));
+	fflush(stdout);
+}
+
+static void test_yield(size_t cpus) {
+	/* two threads per CPU, so that there is always somebody to switch to */
+	for(size_t i = 0; i < cpus * 2; ++i) {
+		if(startthread(thread_yield,(void*)(i % cpus)) < 0)
+			printe("startthread failed");
+	}
+	run(cpus * 2,(uint64_t)cpus * 2 * YIELD_COUNT,"yield",cpus);
+}
+
+static void test_pingpong(size_t cpus) {
+	for(size_t i = 0; i < cpus; ++i) {
+		pingsems[i][0] = semcrt(0);
+		pingsems[i][1] = semcrt(0);
+		if(pingsems[i][0] < 0 || pingsems[i][1] < 0)
+			error("Unable to create semaphore");
+		if(startthread(thread_ping,(void*)(i | (1UL << 16))) < 0)
+			printe("startthread failed");
+		if(startthread(thread_ping,(void*)i) < 0)
+			printe("startthread failed");
+	}
+	run(cpus * 2,(uint64_t)cpus * PINGPONG_COUNT,"pingpong",cpus);
+	for(size_t i = 0; i < cpus; ++i) {
+		semdestr(pingsems[i][0]);
+		semdestr(pingsems[i][1]);
+	}
+}
+
+int mod_cpuscale(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	long cpucount = sysconf(CONF_CPU_COUNT);
+	if(cpucount > MAX_CPUS)
+		cpucount = MAX_CPUS;
+
+	startsem = semcrt(0);
+	if(startsem < 0)
+		error("Unable to create semaphore");
+
+	/* per CPU, we run one independent pair of threads. thus, the throughput should grow
+	 * linearly with the number of CPUs */
+	for(long cpus = 1; cpus <= cpucount; ++cpus)
+		test_yield(cpus);
+	for(long cpus = 1; cpus <= cpucount; ++cpus)
+		test_pingpong(cpus);
+
+	semdestr(startsem);
+	return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/stream/istringstream.h>
+#include <sys/common.h>
+#include <sys/time.h>
+#include <z/deflate.h>
+#include <z/inflate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "../modules.h"
+
+/* measures the compression ratio and throughput of z::Deflate for all levels. every file of the
+ * corpus is compressed repeatedly, until at least MIN_BYTES have been consumed. */
+
+#define MIN_BYTES		(4 * 1024 * 1024)
+
+static const char *defCorpus[] = {
+	"/bin/testperf",
+	"/etc/pci.ids",
+	"/etc/settings.png",
+};
+
+class StringDeflateDrain : public z::DeflateDrain {
+public:
+	explicit StringDeflateDrain(std::string &str) : z::DeflateDrain(), _str(str) {
+	}
+
+	virtual void put(uint8_t c) {
+		_str.push_back(c);
+	}
+	virtual void write(const void *buffer,size_t count) {
+		_str.append(static_cast<const char*>(buffer),count);
+	}
+
+private:
+	std::string &_str;
+};
+
+static bool loadFile(const char *path,std::string &data) {
+	FILE *f = fopen(path,"r");
+	if(f == NULL) {
+		printe("Unable to open '%s'",path);
+		return false;
+	}
+
+	char buf[4096];
+	size_t res;
+	while((res = fread(buf,1,sizeof(buf),f)) > 0)
+		data.append(buf,res);
+	fclose(f);
+	return true;
+}
+
+static bool testFile(z::Deflate &deflate,const char *path,int level) {
+	std::string data;
+	if(!loadFile(path,data))
+		return false;
+
+	std::string compr;
+	size_t count = MIN_BYTES / (data.length() + 1) + 1;
+	uint64_t total = 0;
+	for(size_t i = 0; i < count; ++i) {
+		esc::IStringStream is(data);
+		z::StreamDeflateSource src(is);
+		compr.clear();
+		StringDeflateDrain drain(compr);
+
+		uint64_t start = rdtsc();
+		int res = deflate.compress(&drain,&src,level);
+		total += rdtsc() - start;
+
+		if(res != 0) {
+			printe("Compression of '%s' failed",path);
+			return false;
+		}
+	}
+
+	/* check whether we get the original data back */
+	char *out = new char[data.length() + 1];
+	z::Inflate inflate;
+	z::MemInflateSource isrc(&compr[0],compr.length());
+	z::MemInflateDrain idrain(out,data.length());
+	bool ok = inflate.uncompress(&idrain,&isrc) == 0 && memcmp(out,data.c_str(),data.length()) == 0;
+	delete[] out;
+	if(!ok) {
+		printe("Decompression of '%s' with level %d failed",path,level);
+		return false;
+	}
+
+	uint64_t bytes = (uint64_t)data.length() * count;
+	uint64_t usecs = tsctotime(total);
+	size_t ratio = data.length() ? (compr.length() * 1000) / data.length() : 0;
+	printf("%-20s level %d: %8zu -> %8zu bytes (%3zu.%zu%%), %4Lu cycles/byte, %4Lu MB/s\n",
+		path,level,data.length(),compr.length(),ratio / 10,ratio % 10,
+		total / (bytes ? bytes : 1),bytes / (usecs ? usecs : 1));
+	fflush(stdout);
+	return true;
+}
+
+int mod_deflate(int argc,char *argv[]) {
+	z::Deflate deflate;
+
+	int res = 0;
+	size_t files = argc > 2 ? argc - 2 : ARRAY_SIZE(defCorpus);
+	for(size_t i = 0; i < files; ++i) {
+		const char *path = argc > 2 ? argv[i + 2] : defCorpus[i];
+		for(int level = z::Deflate::NONE; level <= z::Deflate::BEST; ++level)
+			res |= !testFile(deflate,path,level);
+	}
+	return res;
+}
@@ -0,0 +1,119 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../modules.h"
+
+/* measures open() and stat() of files in directories of different sizes. the directories are
+ * created in <dir> (/tmp by default), which should therefore be on the filesystem to test. */
+
+#define ROUNDS			4
+#define PRIME			7919
+
+static const size_t sizes[] = {16,512,5000};
+static char path[MAX_PATH_LEN];
+
+static const char *filePath(const char *dir,size_t i) {
+	snprintf(path,sizeof(path),"%s/dirlookup/file-%zu",dir,i);
+	return path;
+}
+
+static void test_lookups(const char *dir,size_t files) {
+	uint64_t opentime = 0,stattime = 0,misstime = 0;
+	struct stat info;
+	for(int r = 0; r < ROUNDS; ++r) {
+		/* visit all files in a different order than they have been created */
+		for(size_t i = 0; i < files; ++i) {
+			const char *p = filePath(dir,(i * PRIME) % files);
+
+			uint64_t start = rdtsc();
+			int fd = open(p,O_RDONLY);
+			if(fd >= 0)
+				close(fd);
+			opentime += rdtsc() - start;
+			if(fd < 0)
+				printe("open of '%s' failed",p);
+
+			start = rdtsc();
+			int res = stat(p,&info);
+			stattime += rdtsc() - start;
+			if(res < 0)
+				printe("stat of '%s' failed",p);
+
+			/* names that don't exist */
+			p = filePath(dir,files + i);
+			start = rdtsc();
+			res = stat(p,&info);
+			misstime += rdtsc() - start;
+			if(res == 0)
+				printe("stat of '%s' succeeded",p);
+		}
+	}
+
+	uint64_t calls = (uint64_t)files * ROUNDS;
+	printf("%5zu files: open+close %7Lu, stat %7Lu, stat (ENOENT) %7Lu cycles/call\n",
+		files,opentime / calls,stattime / calls,misstime / calls);
+	fflush(stdout);
+}
+
+static void removeFiles(const char *dir,size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		if(unlink(filePath(dir,i)) < 0)
+			printe("Unlink of '%s' failed",path);
+	}
+}
+
+int mod_dirlookup(int argc,char *argv[]) {
+	const char *dir = argc > 2 ? argv[2] : "/tmp";
+
+	snprintf(path,sizeof(path),"%s/dirlookup",dir);
+	if(mkdir(path,0700) < 0) {
+		printe("Unable to create '%s'",path);
+		return 1;
+	}
+
+	int res = 0;
+	size_t count = 0;
+	for(size_t s = 0; s < ARRAY_SIZE(sizes); ++s) {
+		/* grow the directory to the next size */
+		for(; count < sizes[s]; ++count) {
+			int fd = creat(filePath(dir,count),0600);
+			if(fd < 0) {
+				printe("Unable to create '%s'",path);
+				res = 1;
+				goto error;
+			}
+			close(fd);
+		}
+
+		test_lookups(dir,count);
+	}
+
+error:
+	removeFiles(dir,count);
+	snprintf(path,sizeof(path),"%s/dirlookup",dir);
+	if(rmdir(path) < 0)
+		printe("Unable to remove '%s'",path);
+	return res;
+}
@@ -0,0 +1,94 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../modules.h"
+
+/* reads sequentially from a block device with different request sizes, once via a buffer that is
+ * shared with the driver (which allows the ATA driver to use DMA directly) and once via
+ * messages. */
+
+#define TOTAL_SIZE		(16 * 1024 * 1024)
+#define MIN_REQ_SIZE	(4 * 1024)
+#define MAX_REQ_SIZE	(1024 * 1024)
+#define MAX_MSG_SIZE	(64 * 1024)
+
+static void test_read(int fd,char *buf,size_t reqSize,const char *name) {
+	if(seek(fd,0,SEEK_SET) < 0) {
+		printe("seek failed");
+		return;
+	}
+
+	uint64_t start = rdtsc();
+	size_t total;
+	for(total = 0; total < TOTAL_SIZE; total += reqSize) {
+		if(read(fd,buf,reqSize) != (ssize_t)reqSize) {
+			printe("read failed");
+			break;
+		}
+	}
+	uint64_t end = rdtsc();
+
+	uint64_t usecs = tsctotime(end - start);
+	printf("%-8s %7zu bytes/request: %4Lu MB/s\n",
+		name,reqSize,((uint64_t)total * 1000000) / (1024 * 1024 * (usecs ? usecs : 1)));
+	fflush(stdout);
+}
+
+int mod_diskread(int argc,char *argv[]) {
+	const char *dev = argc > 2 ? argv[2] : "/dev/hda1";
+
+	int fd = open(dev,O_RDONLY);
+	if(fd < 0) {
+		printe("Unable to open '%s'",dev);
+		return 1;
+	}
+
+	void *shbuf;
+	int shfd = sharebuf(fd,MAX_REQ_SIZE,&shbuf,0);
+	if(shfd < 0) {
+		if(shbuf == NULL) {
+			printe("Unable to create buffer");
+			close(fd);
+			return 1;
+		}
+		printe("Unable to share buffer with '%s'",dev);
+	}
+	else {
+		for(size_t size = MIN_REQ_SIZE; size <= MAX_REQ_SIZE; size *= 2)
+			test_read(fd,(char*)shbuf,size,"shared");
+	}
+
+	char *buf = (char*)malloc(MAX_MSG_SIZE);
+	if(buf != NULL) {
+		for(size_t size = MIN_REQ_SIZE; size <= MAX_MSG_SIZE; size *= 2)
+			test_read(fd,buf,size,"message");
+		free(buf);
+	}
+
+	destroybuf(shbuf,shfd);
+	close(fd);
+	return 0;
+}
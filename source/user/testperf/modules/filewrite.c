@@ -0,0 +1,183 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+/* measures the throughput of creating and writing files of different sizes in <dir> (/tmp by
+ * default) and of growing several files at once. if the info file of the filesystem is given
+ * as well (the device of the ext2 instance), the block allocation statistics are used to show
+ * how fragmented the written files are. */
+
+#define TOTAL_SIZE		(8 * 1024 * 1024)
+#define CHUNK_SIZE		4096
+#define PARALLEL		4
+
+typedef struct {
+	ulong runs;
+	ulong blocks;
+	ulong misses;
+} AllocStats;
+
+static const size_t sizes[] = {4 * 1024,64 * 1024,1024 * 1024};
+static char buffer[CHUNK_SIZE];
+static char path[MAX_PATH_LEN];
+
+static const char *filePath(const char *dir,size_t i) {
+	snprintf(path,sizeof(path),"%s/filewrite-%zu",dir,i);
+	return path;
+}
+
+static void readStats(const char *info,AllocStats *stats) {
+	char line[128];
+	memset(stats,0,sizeof(*stats));
+	if(!info)
+		return;
+
+	FILE *f = fopen(info,"r");
+	if(!f) {
+		printe("Unable to open '%s'",info);
+		return;
+	}
+	while(fgets(line,sizeof(line),f)) {
+		if(sscanf(line,"\tRuns: %lu",&stats->runs) == 1)
+			continue;
+		if(sscanf(line,"\tBlocks: %lu",&stats->blocks) == 1)
+			continue;
+		sscanf(line,"\tRuns not at goal: %lu",&stats->misses);
+	}
+	fclose(f);
+}
+
+static void printResult(const char *name,uint64_t cycles,size_t bytes,const char *info,
+		const AllocStats *before) {
+	uint64_t usecs = tsctotime(cycles);
+	printf("%-16s: %4Lu MB/s",
+		name,((uint64_t)bytes * 1000000) / (1024 * 1024 * (usecs ? usecs : 1)));
+	if(info) {
+		AllocStats after;
+		readStats(info,&after);
+		ulong runs = after.runs - before->runs;
+		printf(", %lu blocks in %lu runs, %lu not at goal",
+			after.blocks - before->blocks,runs,after.misses - before->misses);
+	}
+	putchar('\n');
+	fflush(stdout);
+}
+
+static bool removeFiles(const char *dir,size_t count) {
+	bool res = true;
+	for(size_t i = 0; i < count; ++i) {
+		if(unlink(filePath(dir,i)) < 0) {
+			printe("Unlink of '%s' failed",path);
+			res = false;
+		}
+	}
+	return res;
+}
+
+static bool test_create(const char *dir,size_t size,const char *info) {
+	AllocStats stats;
+	char name[32];
+	size_t files = TOTAL_SIZE / size;
+	readStats(info,&stats);
+
+	uint64_t start = rdtsc();
+	for(size_t i = 0; i < files; ++i) {
+		int fd = creat(filePath(dir,i),0600);
+		if(fd < 0) {
+			printe("Unable to create '%s'",path);
+			removeFiles(dir,i);
+			return false;
+		}
+		for(size_t total = 0; total < size; total += CHUNK_SIZE) {
+			if(write(fd,buffer,CHUNK_SIZE) != CHUNK_SIZE) {
+				printe("Writing to '%s' failed",path);
+				close(fd);
+				removeFiles(dir,i + 1);
+				return false;
+			}
+		}
+		close(fd);
+	}
+	uint64_t end = rdtsc();
+
+	snprintf(name,sizeof(name),"%zu x %zuK",files,size / 1024);
+	printResult(name,end - start,TOTAL_SIZE,info,&stats);
+	return removeFiles(dir,files);
+}
+
+static bool test_parallel(const char *dir,const char *info) {
+	AllocStats stats;
+	char name[32];
+	int fds[PARALLEL];
+	bool res = true;
+	size_t i;
+	readStats(info,&stats);
+
+	for(i = 0; i < PARALLEL; ++i) {
+		fds[i] = creat(filePath(dir,i),0600);
+		if(fds[i] < 0) {
+			printe("Unable to create '%s'",path);
+			res = false;
+			goto error;
+		}
+	}
+
+	/* grow all files alternately, which scatters their blocks without goals */
+	uint64_t start,end;
+	start = rdtsc();
+	for(size_t total = 0; total < TOTAL_SIZE; total += CHUNK_SIZE * PARALLEL) {
+		for(size_t j = 0; j < PARALLEL; ++j) {
+			if(write(fds[j],buffer,CHUNK_SIZE) != CHUNK_SIZE) {
+				printe("Writing to '%s' failed",filePath(dir,j));
+				res = false;
+				goto error;
+			}
+		}
+	}
+	end = rdtsc();
+
+	snprintf(name,sizeof(name),"%d interleaved",PARALLEL);
+	printResult(name,end - start,TOTAL_SIZE,info,&stats);
+
+error:
+	for(size_t j = 0; j < i; ++j)
+		close(fds[j]);
+	return removeFiles(dir,i) && res;
+}
+
+int mod_filewrite(int argc,char *argv[]) {
+	const char *dir = argc > 2 ? argv[2] : "/tmp";
+	const char *info = argc > 3 ? argv[3] : NULL;
+
+	memset(buffer,0xAA,sizeof(buffer));
+	for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+		if(!test_create(dir,sizes[i],info))
+			return 1;
+	}
+	return test_parallel(dir,info) ? 0 : 1;
+}
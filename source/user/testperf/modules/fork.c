@@ -17,16 +17,20 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <sys/arch.h>
 #include <sys/common.h>
 #include <sys/proc.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../modules.h"
 
 #define TEST_COUNT		1000
+#define SCALE_COUNT		10
+#define DEF_MAX_SIZE	64		/* MiB */
 
 static void firenforget(void) {
 	size_t i;
@@ -67,12 +71,53 @@ static void waitdead(void) {
 	printf("fork      : %Lu cycles/call\n",total / TEST_COUNT);
 }
 
-int mod_fork(A_UNUSED int argc,A_UNUSED char *argv[]) {
+static void scale(size_t maxSize) {
+	for(size_t mb = 1; mb <= maxSize; mb *= 4) {
+		size_t size = mb * 1024 * 1024;
+		char *mem = (char*)malloc(size);
+		if(!mem) {
+			printe("Unable to allocate %zu MiB",mb);
+			return;
+		}
+		/* touch all pages to make sure that they are present */
+		memset(mem,0,size);
+
+		uint64_t forkTotal = 0, cowTotal = 0;
+		for(size_t i = 0; i < SCALE_COUNT; ++i) {
+			uint64_t start = rdtsc();
+			int pid = fork();
+			if(pid == 0) {
+				/* write to every page to copy them */
+				for(size_t off = 0; off < size; off += PAGE_SIZE)
+					mem[off] = 1;
+				exit(0);
+			}
+			else if(pid < 0) {
+				printe("fork failed");
+				free(mem);
+				return;
+			}
+			forkTotal += rdtsc() - start;
+			waitchild(NULL,-1,0);
+			cowTotal += rdtsc() - start;
+		}
+		printf("%4zu MiB  : fork %Lu cycles/call, %Lu cycles/page; with COW %Lu cycles/page\n",
+			mb,forkTotal / SCALE_COUNT,forkTotal / (SCALE_COUNT * (size / PAGE_SIZE)),
+			cowTotal / (SCALE_COUNT * (size / PAGE_SIZE)));
+		fflush(stdout);
+		free(mem);
+	}
+}
+
+int mod_fork(int argc,char *argv[]) {
 	printf("Fire and forget...\n");
 	fflush(stdout);
 	firenforget();
 	printf("Wait until they're dead...\n");
 	fflush(stdout);
 	waitdead();
+	printf("Scaling with the process size...\n");
+	fflush(stdout);
+	scale(argc > 2 ? strtoul(argv[2],NULL,0) : DEF_MAX_SIZE);
 	return EXIT_SUCCESS;
 }
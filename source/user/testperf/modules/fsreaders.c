@@ -0,0 +1,129 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/stat.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+/* note that the files are read by separate channels and thus, by different worker threads of the
+ * filesystem, if it uses multiple ones (e.g., ext2 -t <threads>). */
+
+#define MAX_READERS		16
+#define FILE_SIZE		0x20000
+#define BUF_SIZE		0x4000
+#define ROUNDS			20
+
+static int startsem;
+static char buffer[BUF_SIZE];
+static char paths[MAX_READERS][MAX_PATH_LEN];
+
+static int thread_read(void *arg) {
+	const char *path = paths[(size_t)arg];
+	char *buf = (char*)malloc(BUF_SIZE);
+	int fd = open(path,O_RDONLY);
+	if(buf == NULL || fd < 0) {
+		printe("Unable to open %s",path);
+		return 1;
+	}
+
+	semdown(startsem);
+	for(int i = 0; i < ROUNDS; ++i) {
+		for(size_t off = 0; off < FILE_SIZE; off += BUF_SIZE) {
+			if(read(fd,buf,BUF_SIZE) != BUF_SIZE) {
+				printe("read of %s failed",path);
+				goto error;
+			}
+		}
+		if(seek(fd,0,SEEK_SET) < 0) {
+			printe("seek in %s failed",path);
+			goto error;
+		}
+	}
+
+error:
+	close(fd);
+	free(buf);
+	return 0;
+}
+
+static void test_readers(size_t readers) {
+	for(size_t i = 0; i < readers; ++i) {
+		if(startthread(thread_read,(void*)i) < 0)
+			printe("startthread failed");
+	}
+
+	/* give them the chance to open their files before we start measuring */
+	usleep(100 * 1000);
+
+	uint64_t start = rdtsc();
+	for(size_t i = 0; i < readers; ++i)
+		semup(startsem);
+	join(0);
+	uint64_t end = rdtsc();
+
+	uint64_t usecs = tsctotime(end - start);
+	uint64_t bytes = (uint64_t)readers * ROUNDS * FILE_SIZE;
+	printf("%2zu readers: %10Lu cycles, %6Lu KB/s total\n",
+		readers,end - start,(bytes * 1000000) / (1024 * (usecs ? usecs : 1)));
+	fflush(stdout);
+}
+
+int mod_fsreaders(int argc,char *argv[]) {
+	const char *dir = argc > 2 ? argv[2] : "/tmp";
+
+	startsem = semcrt(0);
+	if(startsem < 0)
+		error("Unable to create semaphore");
+
+	/* create one file per reader */
+	memset(buffer,0xAB,sizeof(buffer));
+	for(size_t i = 0; i < MAX_READERS; ++i) {
+		snprintf(paths[i],sizeof(paths[i]),"%s/fsreaders%zu",dir,i);
+		int fd = creat(paths[i],0600);
+		if(fd < 0) {
+			printe("Unable to create %s",paths[i]);
+			return 1;
+		}
+		for(size_t off = 0; off < FILE_SIZE; off += sizeof(buffer)) {
+			if(write(fd,buffer,sizeof(buffer)) != sizeof(buffer)) {
+				printe("write to %s failed",paths[i]);
+				return 1;
+			}
+		}
+		close(fd);
+	}
+
+	for(size_t readers = 1; readers <= MAX_READERS; readers *= 2)
+		test_readers(readers);
+
+	for(size_t i = 0; i < MAX_READERS; ++i) {
+		if(unlink(paths[i]) < 0)
+			printe("Unlink of %s failed",paths[i]);
+	}
+	semdestr(startsem);
+	return 0;
+}
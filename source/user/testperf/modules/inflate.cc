@@ -0,0 +1,114 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/stream/istringstream.h>
+#include <esc/stream/ostringstream.h>
+#include <sys/common.h>
+#include <sys/time.h>
+#include <z/deflate.h>
+#include <z/inflate.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "../modules.h"
+
+/* measures the throughput of z::Inflate. every file of the corpus is compressed in memory first
+ * and decompressed repeatedly afterwards, until at least MIN_BYTES have been produced. */
+
+#define MIN_BYTES		(16 * 1024 * 1024)
+
+static const char *defCorpus[] = {
+	"/bin/testperf",
+	"/etc/pci.ids",
+	"/etc/settings.png",
+};
+
+static bool loadFile(const char *path,std::string &data) {
+	FILE *f = fopen(path,"r");
+	if(f == NULL) {
+		printe("Unable to open '%s'",path);
+		return false;
+	}
+
+	char buf[4096];
+	size_t res;
+	while((res = fread(buf,1,sizeof(buf),f)) > 0)
+		data.append(buf,res);
+	fclose(f);
+	return true;
+}
+
+static bool testFile(z::Inflate &inflate,const char *path,int level) {
+	std::string data;
+	if(!loadFile(path,data))
+		return false;
+
+	esc::IStringStream is(data);
+	esc::OStringStream os;
+	z::StreamDeflateSource dsrc(is);
+	z::StreamDeflateDrain ddrain(os);
+	z::Deflate deflate;
+	deflate.compress(&ddrain,&dsrc,level);
+	std::string compr = os.str();
+
+	char *out = new char[data.length() + 1];
+	size_t count = MIN_BYTES / (data.length() + 1) + 1;
+	uint64_t total = 0;
+	for(size_t i = 0; i < count; ++i) {
+		z::MemInflateSource src(&compr[0],compr.length());
+		z::MemInflateDrain drain(out,data.length());
+
+		uint64_t start = rdtsc();
+		int res = inflate.uncompress(&drain,&src);
+		total += rdtsc() - start;
+
+		if(res != 0 || memcmp(out,data.c_str(),data.length()) != 0) {
+			printe("Decompression of '%s' failed",path);
+			delete[] out;
+			return false;
+		}
+	}
+	delete[] out;
+
+	uint64_t bytes = (uint64_t)data.length() * count;
+	uint64_t usecs = tsctotime(total);
+	printf("%-20s level %d: %8zu -> %8zu bytes, %3Lu.%02Lu cycles/byte, %4Lu MB/s\n",
+		path,level,compr.length(),data.length(),total / (bytes ? bytes : 1),
+		((total * 100) / (bytes ? bytes : 1)) % 100,bytes / (usecs ? usecs : 1));
+	fflush(stdout);
+	return true;
+}
+
+int mod_inflate(int argc,char *argv[]) {
+	z::Inflate inflate;
+
+	static const int levels[] = {
+		z::Deflate::NONE,z::Deflate::FASTEST,z::Deflate::DEFAULT,z::Deflate::BEST
+	};
+
+	int res = 0;
+	size_t files = argc > 2 ? argc - 2 : ARRAY_SIZE(defCorpus);
+	for(size_t i = 0; i < files; ++i) {
+		const char *path = argc > 2 ? argv[i + 2] : defCorpus[i];
+		for(size_t l = 0; l < ARRAY_SIZE(levels); ++l)
+			res |= !testFile(inflate,path,levels[l]);
+	}
+	return res;
+}
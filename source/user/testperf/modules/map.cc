@@ -0,0 +1,94 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <unordered_map>
+
+#include "../modules.h"
+
+/* measures insert, find and erase of std::map and std::unordered_map with sequential keys (like
+ * file descriptors or message ids) and with random keys for different sizes. */
+
+#define ROUNDS			4
+
+static const size_t sizes[] = {100,1000,10000};
+
+template<class M>
+static void test_keys(const char *type,const char *name,const int *keys,size_t count) {
+	uint64_t insTime = 0,findTime = 0,eraseTime = 0;
+	for(int r = 0; r < ROUNDS; ++r) {
+		M m;
+
+		uint64_t start = rdtsc();
+		for(size_t i = 0; i < count; ++i)
+			m.insert(std::make_pair(keys[i],(int)i));
+		insTime += rdtsc() - start;
+		if(m.size() != count)
+			printe("Inserting into %s failed",type);
+
+		start = rdtsc();
+		for(size_t i = 0; i < count; ++i) {
+			if(m.find(keys[i]) == m.end())
+				printe("Key %d not found",keys[i]);
+		}
+		findTime += rdtsc() - start;
+
+		start = rdtsc();
+		for(size_t i = 0; i < count; ++i)
+			m.erase(keys[i]);
+		eraseTime += rdtsc() - start;
+		if(!m.empty())
+			printe("Erasing from %s failed",type);
+	}
+
+	uint64_t ops = (uint64_t)count * ROUNDS;
+	printf("%-13s %-10s %5zu keys: insert %5Lu, find %5Lu, erase %5Lu cycles/op\n",
+		type,name,count,insTime / ops,findTime / ops,eraseTime / ops);
+	fflush(stdout);
+}
+
+int mod_map(int,char**) {
+	for(size_t s = 0; s < ARRAY_SIZE(sizes); ++s) {
+		size_t count = sizes[s];
+		int *keys = new int[count];
+
+		for(size_t i = 0; i < count; ++i)
+			keys[i] = i;
+		test_keys<std::map<int,int> >("map","sequential",keys,count);
+		test_keys<std::unordered_map<int,int> >("unordered_map","sequential",keys,count);
+
+		/* shuffle them */
+		srand(count);
+		for(size_t i = count - 1; i > 0; --i) {
+			size_t j = rand() % (i + 1);
+			int tmp = keys[i];
+			keys[i] = keys[j];
+			keys[j] = tmp;
+		}
+		test_keys<std::map<int,int> >("map","random",keys,count);
+		test_keys<std::unordered_map<int,int> >("unordered_map","random",keys,count);
+
+		delete[] keys;
+	}
+	return 0;
+}
@@ -18,9 +18,11 @@
  */
 
 #include <sys/common.h>
+#include <sys/io.h>
 #include <sys/proc.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,9 +31,41 @@
 
 #define WRITE_COUNT		10000
 
-static void test_pipe(size_t size) {
+static int open_pipe(bool kernel,int *rfd,int *wfd) {
+	/* the kernel pipes are the default; the driver is still there for comparison */
+	if(kernel)
+		return pipe(rfd,wfd);
+
+	*wfd = open("/dev/pipe",O_WRONLY);
+	if(*wfd < 0)
+		return *wfd;
+	*rfd = obtain(*wfd,0);
+	if(*rfd < 0) {
+		close(*wfd);
+		return *rfd;
+	}
+	return 0;
+}
+
+static int get_buffer(bool kernel,int fd,size_t size,void **buf) {
+	/* kernel pipes copy directly from/to the user buffer, so that there is nothing to share */
+	if(kernel) {
+		*buf = malloc(size);
+		return *buf ? 0 : -ENOMEM;
+	}
+	return sharebuf(fd,size,buf,0);
+}
+
+static void put_buffer(bool kernel,void *buf,int buffd) {
+	if(kernel)
+		free(buf);
+	else
+		destroybuf(buf,buffd);
+}
+
+static void test_pipe(bool kernel,size_t size) {
 	int rfd,wfd;
-	if(pipe(&rfd,&wfd) < 0) {
+	if(open_pipe(kernel,&rfd,&wfd) < 0) {
 		printe("pipe failed");
 		return;
 	}
@@ -43,24 +77,34 @@ static void test_pipe(size_t size) {
 	int buffd;
 	if(fork() == 0) {
 		close(wfd);
-		if((buffd = sharebuf(rfd,size,&buf,0)) < 0)
-			printe("Unable to share buffer");
+		if((buffd = get_buffer(kernel,rfd,size,&buf)) < 0) {
+			printe("Unable to get buffer");
+			exit(1);
+		}
 		name = "read";
 		start = rdtsc();
-		for(i = 0; i < WRITE_COUNT; ++i) {
-			if(read(rfd,buf,size) < 0) {
+		/* kernel pipes might return less than requested */
+		size_t total = size * WRITE_COUNT;
+		for(i = 0; total > 0; ++i) {
+			ssize_t res = read(rfd,buf,size);
+			if(res <= 0) {
 				printe("read failed");
-				return;
+				exit(1);
 			}
+			total -= res;
 		}
 		end = rdtsc();
-		destroybuf(buf,buffd);
+		put_buffer(kernel,buf,buffd);
 		close(rfd);
 	}
 	else {
 		close(rfd);
-		if((buffd = sharebuf(wfd,size,&buf,0)) < 0)
-			printe("Unable to share buffer");
+		if((buffd = get_buffer(kernel,wfd,size,&buf)) < 0) {
+			printe("Unable to get buffer");
+			close(wfd);
+			waitchild(NULL,-1,0);
+			return;
+		}
 		name = "write";
 		start = rdtsc();
 		for(i = 0; i < WRITE_COUNT; ++i) {
@@ -70,13 +114,13 @@ static void test_pipe(size_t size) {
 			}
 		}
 		end = rdtsc();
-		destroybuf(buf,buffd);
+		put_buffer(kernel,buf,buffd);
 		close(wfd);
 		waitchild(NULL,-1,0);
 	}
 
-	printf("[%4d] %s(%3zuK): %6Lu cycles/call, %Lu MB/s\n",
-			getpid(),name,size / 1024,(end - start) / WRITE_COUNT,
+	printf("[%4d] %s %5s(%3zuK): %6Lu cycles/call, %Lu MB/s\n",
+			getpid(),kernel ? "kernel" : "driver",name,size / 1024,(end - start) / i,
 			(size * WRITE_COUNT) / tsctotime(end - start));
 	/* child should exit here */
 	if(strcmp(name,"read") == 0)
@@ -87,7 +131,9 @@ int mod_pipe(A_UNUSED int argc,A_UNUSED char *argv[]) {
 	size_t i, sizes[] = {0x1000,0x2000,0x4000,0x8000,0x10000};
 	for(i = 0; i < ARRAY_SIZE(sizes); ++i) {
 		fflush(stdout);
-		test_pipe(sizes[i]);
+		test_pipe(true,sizes[i]);
+		fflush(stdout);
+		test_pipe(false,sizes[i]);
 	}
 	return 0;
 }
@@ -0,0 +1,141 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/regex/regex.h>
+#include <sys/common.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../modules.h"
+
+/* measures esc::Regex: patterns that take exponential time with backtracking, searches with and
+ * without a literal prefix the DFA can skip to and a grep-like search through the lines of a
+ * file (/etc/pci.ids by default). */
+
+#define TEXT_SIZE		(64 * 1024)
+#define GREP_ROUNDS		4
+
+using namespace esc;
+
+static const struct {
+	const char *pattern;
+	const char *text;
+} pathological[] = {
+	{"(a|b)*c",			"ab"},
+	{"(a*)*c",			"a"},
+	{"[a-z]+[0-9]$",	"foo "},
+	{"(x+x+)+y",		"x"},
+};
+
+/* the same search once with a literal prefix and once without */
+static const struct {
+	const char *pattern;
+	const char *text;
+} prefixed[] = {
+	{"error: [0-9]+",	"warning: 12 "},
+	{"[e]rror: [0-9]+",	"warning: 12 "},
+	{"needle",			"haystack "},
+	{"[n]eedle",		"haystack "},
+};
+
+static const char *grepPatterns[] = {
+	"Intel",
+	"[Nn]etwork",
+	"^[0-9a-f][0-9a-f][0-9a-f][0-9a-f] ",
+	"(USB|PCI) [0-9]\\.[0-9]",
+};
+
+static void searchText(const char *pattern,const char *part) {
+	Regex::Pattern pat = Regex::compile(pattern);
+	std::string text;
+	while(text.length() < TEXT_SIZE)
+		text += part;
+
+	uint64_t start = rdtsc();
+	bool res = Regex::search(pat,text).matched();
+	uint64_t total = rdtsc() - start;
+
+	if(res)
+		printe("'%s' should not match",pattern);
+	printf("%-20s: %3Lu.%02Lu cycles/byte, %Lu us\n",pattern,
+		total / text.length(),((total * 100) / text.length()) % 100,tsctotime(total));
+	fflush(stdout);
+}
+
+static bool loadLines(const char *path,std::vector<std::string> &lines,size_t *bytes) {
+	FILE *f = fopen(path,"r");
+	if(f == NULL) {
+		printe("Unable to open '%s'",path);
+		return false;
+	}
+
+	char buf[512];
+	*bytes = 0;
+	while(fgets(buf,sizeof(buf),f)) {
+		std::string line(buf);
+		if(!line.empty() && line[line.length() - 1] == '\n')
+			line.erase(line.length() - 1);
+		*bytes += line.length();
+		lines.push_back(line);
+	}
+	fclose(f);
+	return true;
+}
+
+static void grepLines(const char *pattern,const std::vector<std::string> &lines,size_t bytes) {
+	Regex::Pattern pat = Regex::compile(pattern);
+	size_t matches = 0;
+	uint64_t start = rdtsc();
+	for(int r = 0; r < GREP_ROUNDS; ++r) {
+		for(auto it = lines.begin(); it != lines.end(); ++it) {
+			if(Regex::search(pat,*it).matched())
+				matches++;
+		}
+	}
+	uint64_t total = rdtsc() - start;
+
+	size_t count = lines.size() * GREP_ROUNDS;
+	printf("%-36s: %6zu matches, %5Lu cycles/line, %3Lu cycles/byte\n",pattern,
+		matches / GREP_ROUNDS,total / count,total / (bytes * GREP_ROUNDS));
+	fflush(stdout);
+}
+
+int mod_regex(int argc,char *argv[]) {
+	const char *path = argc > 2 ? argv[2] : "/etc/pci.ids";
+
+	printf("Pathological patterns:\n");
+	for(size_t i = 0; i < ARRAY_SIZE(pathological); ++i)
+		searchText(pathological[i].pattern,pathological[i].text);
+
+	printf("\nSearches with and without literal prefix:\n");
+	for(size_t i = 0; i < ARRAY_SIZE(prefixed); ++i)
+		searchText(prefixed[i].pattern,prefixed[i].text);
+
+	std::vector<std::string> lines;
+	size_t bytes;
+	if(!loadLines(path,lines,&bytes) || lines.empty() || bytes == 0)
+		return 1;
+
+	printf("\nSearching %zu lines (%zu bytes) of %s:\n",lines.size(),bytes,path);
+	for(size_t i = 0; i < ARRAY_SIZE(grepPatterns); ++i)
+		grepLines(grepPatterns[i],lines,bytes);
+	return 0;
+}
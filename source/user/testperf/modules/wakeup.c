@@ -0,0 +1,97 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../modules.h"
+
+#define PINGPONG_COUNT	10000
+
+static const size_t sleeperCounts[] = {1,100,10000};
+
+static int readysem;
+static int sleepsem;
+static int pingsems[2];
+
+static int thread_sleeper(A_UNUSED void *arg) {
+	semup(readysem);
+	semdown(sleepsem);
+	return 0;
+}
+
+static int thread_pong(A_UNUSED void *arg) {
+	for(int i = 0; i < PINGPONG_COUNT; ++i) {
+		semdown(pingsems[0]);
+		semup(pingsems[1]);
+	}
+	return 0;
+}
+
+static void test_wakeup(size_t count) {
+	/* start the sleepers; as the number of threads is limited, we might get less than requested */
+	size_t sleepers = 0;
+	for(; sleepers < count; ++sleepers) {
+		if(startthread(thread_sleeper,NULL) < 0)
+			break;
+	}
+	for(size_t i = 0; i < sleepers; ++i)
+		semdown(readysem);
+
+	/* now measure how long it takes to wake up a single thread while the others are blocked */
+	if(startthread(thread_pong,NULL) < 0)
+		error("startthread failed");
+	uint64_t total = 0;
+	for(int i = 0; i < PINGPONG_COUNT; ++i) {
+		uint64_t start = rdtsc();
+		semup(pingsems[0]);
+		semdown(pingsems[1]);
+		total += rdtsc() - start;
+	}
+
+	printf("%5zu sleepers: %8Lu cycles per wakeup round-trip\n",sleepers,total / PINGPONG_COUNT);
+	fflush(stdout);
+
+	for(size_t i = 0; i < sleepers; ++i)
+		semup(sleepsem);
+	join(0);
+}
+
+int mod_wakeup(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	readysem = semcrt(0);
+	sleepsem = semcrt(0);
+	pingsems[0] = semcrt(0);
+	pingsems[1] = semcrt(0);
+	if(readysem < 0 || sleepsem < 0 || pingsems[0] < 0 || pingsems[1] < 0)
+		error("Unable to create semaphore");
+
+	/* the time should not depend on the number of threads that wait for other objects */
+	for(size_t i = 0; i < ARRAY_SIZE(sleeperCounts); ++i)
+		test_wakeup(sleeperCounts[i]);
+
+	semdestr(pingsems[1]);
+	semdestr(pingsems[0]);
+	semdestr(sleepsem);
+	semdestr(readysem);
+	return 0;
+}
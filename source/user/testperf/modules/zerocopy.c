@@ -0,0 +1,125 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/arch.h>
+#include <sys/common.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+#define MAX_READ_SIZE		(1024 * 1024)
+#define TEST_BYTES			(64 * 1024 * 1024)
+
+static size_t sizes[] = {0x1000,0x4000,0x10000,0x40000,0x100000};
+static char *buffer;
+
+static bool do_read(int fd,char *buf,size_t size) {
+	/* the driver might give us less than requested */
+	size_t total = 0;
+	while(total < size) {
+		ssize_t res = read(fd,buf + total,size - total);
+		if(res <= 0)
+			return false;
+		total += res;
+	}
+	return true;
+}
+
+static void test_read(const char *path,size_t offset) {
+	int fd = open(path,O_RDONLY);
+	if(fd < 0) {
+		printe("Unable to open %s",path);
+		return;
+	}
+
+	/* large messages are only mapped into present pages */
+	memset(buffer,0,MAX_READ_SIZE + PAGE_SIZE);
+
+	for(size_t s = 0; s < ARRAY_SIZE(sizes); ++s) {
+		size_t count = TEST_BYTES / sizes[s];
+		uint64_t total = 0;
+		for(size_t i = 0; i < count; ++i) {
+			uint64_t start = rdtsc();
+			if(!do_read(fd,buffer + offset,sizes[s])) {
+				printe("read of %s failed",path);
+				goto error;
+			}
+			total += rdtsc() - start;
+
+			if(seek(fd,0,SEEK_SET) < 0) {
+				printe("seek in %s failed",path);
+				goto error;
+			}
+		}
+
+		uint64_t bytes = (uint64_t)sizes[s] * count;
+		printf("%-14s %-9s %7zub: %8Lu cycles/read, %4Lu.%02Lu bytes/cycle\n",
+			path,offset ? "unaligned" : "aligned",sizes[s],total / count,
+			bytes / total,((bytes * 100) / total) % 100);
+		fflush(stdout);
+	}
+
+error:
+	close(fd);
+}
+
+int mod_zerocopy(int argc,char **argv) {
+	const char *file = argc > 2 ? argv[2] : "/tmp/zerocopy";
+
+	/* the frames can only be mapped into anonymous memory. one more page to be able to use an
+	 * unaligned buffer as well */
+	buffer = mmap(NULL,MAX_READ_SIZE + PAGE_SIZE,0,PROT_READ | PROT_WRITE,MAP_PRIVATE,-1,0);
+	if(!buffer) {
+		printe("mmap failed");
+		return 1;
+	}
+
+	/* page-aligned buffers allow the kernel to map the received frames, while unaligned ones
+	 * require a copy */
+	test_read("/dev/zero",0);
+	test_read("/dev/zero",1);
+
+	int fd = creat(file,0600);
+	if(fd < 0) {
+		printe("Unable to create %s",file);
+		munmap(buffer);
+		return 1;
+	}
+	memset(buffer,'a',MAX_READ_SIZE);
+	if(write(fd,buffer,MAX_READ_SIZE) != MAX_READ_SIZE) {
+		printe("write to %s failed",file);
+		close(fd);
+		munmap(buffer);
+		return 1;
+	}
+	close(fd);
+
+	test_read(file,0);
+	test_read(file,1);
+
+	if(unlink(file) < 0)
+		printe("Unlink of %s failed",file);
+	munmap(buffer);
+	return 0;
+}
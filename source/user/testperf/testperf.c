@@ -51,6 +51,18 @@ static sTestModule modules[] = {
 	{"pagefault",	mod_pagefault},
 	{"heap",		mod_heap},
 	{"stdio",		mod_stdio},
+	{"cpuscale",	mod_cpuscale},
+	{"wakeup",		mod_wakeup},
+	{"zerocopy",	mod_zerocopy},
+	{"fsreaders",	mod_fsreaders},
+	{"bcreplay",	mod_bcreplay},
+	{"diskread",	mod_diskread},
+	{"inflate",		mod_inflate},
+	{"deflate",		mod_deflate},
+	{"dirlookup",	mod_dirlookup},
+	{"filewrite",	mod_filewrite},
+	{"map",			mod_map},
+	{"regex",		mod_regex},
 };
 
 int main(int argc,char *argv[]) {